@@ -12,8 +12,7 @@
 #include <string.h>
 
 namespace umumk {
-void PipelineBuilder::Show() {
-  auto pCtx = umugu_get();
+void PipelineBuilder::Show(umugu_ctx *pCtx) {
   auto AddNode = [pCtx, this](const auto &It) {
     if (ImGui::CollapsingHeader("Add node")) {
       for (int i = 0; i < pCtx->nodes_info_next; ++i) {
@@ -28,7 +27,7 @@ void PipelineBuilder::Show() {
   ImGui::Begin("Pipeline builder");
   static umugu_name NodeName;
   if (ImGui::Button("Load info")) {
-    um_node_info_load(&NodeName);
+    um_node_info_load(pCtx, &NodeName);
     memset(NodeName.str, 0, 32);
   }
   ImGui::SameLine();
@@ -37,7 +36,7 @@ void PipelineBuilder::Show() {
   for (auto It = mNodes.begin(); It != mNodes.end(); ++It) {
     ImGui::PushID(*It);
     AddNode(It);
-    DrawNodeWidgets(*It);
+    DrawNodeWidgets(pCtx, *It);
     ImGui::PopID();
   }
   AddNode(mNodes.end());
@@ -10,7 +10,7 @@ class PipelineBuilder {
 public:
   PipelineBuilder() = default;
 
-  void Show();
+  void Show(umugu_ctx *apCtx);
 
 private:
   std::list<umugu_node *> mNodes;
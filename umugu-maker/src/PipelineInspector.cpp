@@ -10,18 +10,20 @@
 #include <stdio.h>
 
 namespace umumk {
-void PipelineInspector::Show() {
+void PipelineInspector::Show(umugu_ctx *apCtx) {
   ImGui::Begin("Pipeline graph");
-  ImGui::Text("Available time for the callback: %lf",
-              ((umugu_portaudio *)(umugu_get()->io.backend.internal_data))->time_margin_sec);
-  for (int i = 0; i < umugu_get()->pipeline.node_count; ++i) {
-    NodeWidgets(umugu_get()->pipeline.nodes[i]);
+  if (apCtx->io.backend_data) {
+    ImGui::Text("Available time for the callback: %lf",
+                ((umugu_portaudio *)apCtx->io.backend_data)->time_margin_sec);
+  }
+  for (int i = 0; i < apCtx->pipeline.node_count; ++i) {
+    NodeWidgets(apCtx, apCtx->pipeline.nodes[i], i);
   }
   ImGui::End();
 }
 
-void PipelineInspector::NodeWidgets(umugu_node *apNode) {
-  const umugu_node_info *pInfo = &umugu_get()->nodes_info[apNode->info_idx];
+void PipelineInspector::NodeWidgets(umugu_ctx *apCtx, umugu_node *apNode, int aNodeIdx) {
+  const umugu_node_info *pInfo = &apCtx->nodes_info[apNode->info_idx];
   if (!pInfo) {
     printf("Node info not found.\n");
     return;
@@ -30,7 +32,7 @@ void PipelineInspector::NodeWidgets(umugu_node *apNode) {
   ImGui::PushID(apNode);
   ImGui::Separator();
 
-  umumk::DrawNodeWidgets(apNode);
+  umumk::DrawNodeWidgets(apCtx, apNode, aNodeIdx);
 
   ImGui::PopID();
 }
@@ -2,15 +2,16 @@
 #define __UMUGU_MAKER_PIPELINE_ISPECTOR_H__
 extern "C" {
 struct umugu_node;
+struct umugu_ctx;
 }
 namespace umumk {
 class PipelineInspector {
 public:
   PipelineInspector() = default;
-  void Show();
+  void Show(umugu_ctx *apCtx);
 
 private:
-  void NodeWidgets(umugu_node *apNode);
+  void NodeWidgets(umugu_ctx *apCtx, umugu_node *apNode, int aNodeIdx);
 };
 } // namespace umumk
 
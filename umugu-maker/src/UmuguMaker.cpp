@@ -31,11 +31,11 @@ void UmuguMaker::MainMenu() {
     }
     static bool StreamStarted = false;
     if (ImGui::MenuItem("Start stream", "", StreamStarted, true)) {
-      umugu_audio_backend_start_stream();
+      umugu_audio_backend_start_stream(mpCtx);
       StreamStarted = true;
     }
     if (ImGui::MenuItem("Stop stream", "", !StreamStarted, true)) {
-      umugu_audio_backend_stop_stream();
+      umugu_audio_backend_stop_stream(mpCtx);
       StreamStarted = false;
     }
     ImGui::EndMenu();
@@ -67,29 +67,82 @@ void UmuguMaker::MainMenu() {
   ImGui::EndMainMenuBar();
 }
 
+void UmuguMaker::MetricsWindow() {
+  ImGui::Begin("Metrics");
+  ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate,
+              ImGui::GetIO().Framerate);
+
+  // Last window published by the audio thread, it never waits for this read.
+  umugu_metrics Metrics;
+  mNodeTimings.resize(mpCtx->pipeline_capacity);
+  if (umugu_metrics_read(mpCtx, &Metrics, mNodeTimings.data(), (int)mNodeTimings.size()) !=
+      UMUGU_SUCCESS) {
+    ImGui::Text("Waiting for %d audio blocks...", UMUGU_METRICS_WINDOW);
+    ImGui::End();
+    return;
+  }
+
+  const umugu_timing &Block = Metrics.block;
+  ImGui::Text("Blocks %ld, deadline misses %ld, stream underruns %ld", (long)Metrics.blocks,
+              (long)Metrics.deadline_misses, (long)Metrics.stream_underruns);
+  ImGui::Text("Block budget %.1f us, load avg %.1f%% p99 %.1f%%", Metrics.budget_ns / 1000.0f,
+              100.0f * Block.avg_ns / Metrics.budget_ns, 100.0f * Block.p99_ns / Metrics.budget_ns);
+  ImGui::Text("Arena high-water %.1f of %.1f KiB, overflows %ld",
+              Metrics.arena_high_water / 1024.0f, mpCtx->arena_capacity / 1024.0f,
+              (long)Metrics.arena_overflows);
+
+  const ImGuiTableFlags Flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg;
+  if (ImGui::BeginTable("Node timings", 5, Flags)) {
+    ImGui::TableSetupColumn("Node");
+    ImGui::TableSetupColumn("Min (us)");
+    ImGui::TableSetupColumn("Avg (us)");
+    ImGui::TableSetupColumn("p99 (us)");
+    ImGui::TableSetupColumn("Max (us)");
+    ImGui::TableHeadersRow();
+    const int64_t NodeCount = Metrics.node_count < mpCtx->pipeline.node_count
+                                  ? Metrics.node_count
+                                  : mpCtx->pipeline.node_count;
+    for (int i = -1; i < NodeCount; ++i) {
+      const umugu_timing &Timing = i < 0 ? Block : mNodeTimings[i];
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      if (i < 0) {
+        ImGui::TextUnformatted("Block");
+      } else {
+        const umugu_node *pNode = mpCtx->pipeline.nodes[i];
+        ImGui::Text("%d %s", i, mpCtx->nodes_info[pNode->info_idx].name.str);
+      }
+      const int64_t Values[] = {Timing.min_ns, Timing.avg_ns, Timing.p99_ns, Timing.max_ns};
+      for (int64_t Value : Values) {
+        ImGui::TableNextColumn();
+        ImGui::Text("%.2f", Value / 1000.0f);
+      }
+    }
+    ImGui::EndTable();
+  }
+  ImGui::End();
+}
+
 void UmuguMaker::ToolWindows() {
   if (mShowLoadWindow) {
     static char Buffer[1024] = "../assets/pipelines/";
     ImGui::Begin("Load file");
     ImGui::InputText("Pipeline file to load", Buffer, 1024);
     if (ImGui::Button("Load")) {
-      umugu_import_pipeline(Buffer);
+      umugu_pipeline_import(mpCtx, Buffer);
       mShowLoadWindow = false;
     }
     ImGui::End();
   }
   if (mShowPipelineWindow) {
-    mInspector.Show();
+    mInspector.Show(mpCtx);
   }
   if (mShowBuilderWindow) {
-    mBuilder.Show();
+    mBuilder.Show(mpCtx);
   }
 
   if (mShowMetricsWindow) {
-    ImGui::Begin("Metrics");
-    ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate,
-                ImGui::GetIO().Framerate);
-    ImGui::End();
+    MetricsWindow();
   }
 
   if (mShowWaveformWindow) {
@@ -142,25 +195,28 @@ UmuguMaker::UmuguMaker() {
                          .fatal_err_fn = ErrorFatal,
                          .load_file = CopyFileToBuffer,
                          .config_file = "../assets/config.ucg",
-                         .arena = malloc(Size),
-                         .arena_size = Size,
+                         .arena = NULL,
+                         .arena_size = 0,
                          .fallback_ppln = {},
                          .fallback_ppln_node_count = 0};
-  auto *pCtx = umugu_load(&Config);
-
-  pCtx->io.backend.channel_count = 2;
-  pCtx->io.backend.sample_rate = 48000;
-  pCtx->io.backend.format = UMUGU_TYPE_FLOAT;
-  pCtx->io.backend.interleaved_channels = true;
-  pCtx->io.backend.audio_input = false;
-  pCtx->io.backend.audio_output = true;
-  pCtx->io.backend.audio_callback = umugu_process;
+  // Huge pages, locked and faulted in: the audio callback never faults on the arena.
+  if (umugu_arena_map(&Config, Size, UMUGU_ARENA_REALTIME) < UMUGU_SUCCESS) {
+    Config.arena = malloc(Size);
+    Config.arena_size = Size;
+    mArenaMapped = false;
+  }
+  auto *pCtx = mpCtx = umugu_load(&Config);
+
+  pCtx->io.out_audio.samples.channel_count = 2;
+  pCtx->io.out_audio.sample_rate = 48000;
+  pCtx->io.out_audio.format = UMUGU_TYPE_FLOAT;
+  pCtx->io.out_audio.interleaved_channels = true;
   if (pCtx->state != UMUGU_STATE_IDLE) {
     pCtx->io.log("Something went wrong initializing umugu.\n");
   }
 
-  umugu_audio_backend_init();
-  // umugu_audio_backend_start_stream();
+  umugu_audio_backend_init(pCtx);
+  // umugu_audio_backend_start_stream(mpCtx);
   OpenWindow();
 }
 
@@ -174,8 +230,16 @@ UmuguMaker::~UmuguMaker() {
   SDL_DestroyWindow((SDL_Window *)mpWindowHandle);
   SDL_Quit();
 
-  umugu_audio_backend_stop_stream();
-  umugu_audio_backend_close();
+  umugu_audio_backend_stop_stream(mpCtx);
+  umugu_audio_backend_close(mpCtx);
+  void *pArena = mpCtx->arena_head;
+  const size_t ArenaSize = mpCtx->arena_capacity;
+  umugu_unload(mpCtx);
+  if (mArenaMapped) {
+    umugu_arena_unmap(pArena, ArenaSize);
+  } else {
+    free(pArena);
+  }
 }
 
 bool UmuguMaker::Update() {
@@ -4,6 +4,10 @@
 #include "PipelineBuilder.h"
 #include "PipelineInspector.h"
 
+#include <umugu/umugu.h>
+
+#include <vector>
+
 namespace umumk {
 class UmuguMaker {
 public:
@@ -16,6 +20,8 @@ private:
   bool PollEvents();
   void Render();
 
+  umugu_ctx *mpCtx = NULL;
+  bool mArenaMapped = true; // umugu_arena_map, else malloc.
   PipelineInspector mInspector;
   PipelineBuilder mBuilder;
 
@@ -31,6 +37,7 @@ private:
   void MainMenu();
   void ToolWindows();
   void MetricsWindow();
+  std::vector<umugu_timing> mNodeTimings; // By node, umugu_metrics_read.
   void PipelineWindow();
   void BuilderWindow();
   void LoadWindow();
@@ -1,19 +1,35 @@
 #include "Utilities.h"
 
 #include <umugu/umugu.h>
+#include <umugu/umugu_internal.h>
 
 #include <imgui/imgui.h>
 #include <imgui/implot.h>
 
+#include <string.h>
+
 namespace umumk {
-void DrawNodeWidgets(umugu_node *aNode) {
-  const umugu_node_info &Info = umugu_get()->nodes_info[aNode->info_idx];
+// Glide of the float attributes changed in live nodes.
+static constexpr int kRampFrames = 480;
+
+void DrawNodeWidgets(umugu_ctx *pCtx, umugu_node *aNode, int aNodeIdx) {
+  const umugu_node_info &Info = pCtx->nodes_info[aNode->info_idx];
 
   ImGui::TextUnformatted(Info.name.str);
   const int VarCount = Info.attrib_count;
   for (int i = 0; i < VarCount; ++i) {
     const umugu_attrib_info &Var = Info.attribs[i];
-    char *Value = ((char *)aNode + Var.offset_bytes);
+    char *Attrib = ((char *)aNode + Var.offset_bytes);
+
+    // The audio thread reads live nodes: the widgets edit a copy and the changes go
+    // through the attribute queue of the context. Text is only read at init.
+    char Copy[1024];
+    const int Size = Var.type == UMUGU_TYPE_TEXT ? 1 : um_type_sizeof(Var.type);
+    const int Bytes = Size * (Var.count > 1 ? Var.count : 1);
+    const bool Live = aNodeIdx >= 0 && Var.type != UMUGU_TYPE_TEXT &&
+                      !(Var.flags & UMUGU_ATTR_PLOTLINE) && Bytes <= (int)sizeof(Copy);
+    char *Value = Live ? (char *)memcpy(Copy, Attrib, Bytes) : Attrib;
+    bool Changed = false;
     int Step = 1;
     int FastStep = 50;
     switch (Var.type) {
@@ -28,31 +44,32 @@ void DrawNodeWidgets(umugu_node *aNode) {
           ImPlot::EndPlot();
         }
       } else {
-        ImGui::SliderScalarN(Var.name.str, ImGuiDataType_Float, Value, Var.count,
-                             &Var.misc.rangef.min, &Var.misc.rangef.max, "%.2f");
+        Changed = ImGui::SliderScalarN(Var.name.str, ImGuiDataType_Float, Value, Var.count,
+                                       &Var.misc.rangef.min, &Var.misc.rangef.max, "%.2f");
       }
       break;
     }
 
     case UMUGU_TYPE_INT32: {
-      ImGui::InputScalarN(Var.name.str, ImGuiDataType_S32, Value, Var.count, &Step, &FastStep,
-                          "%d");
+      Changed = ImGui::InputScalarN(Var.name.str, ImGuiDataType_S32, Value, Var.count, &Step,
+                                    &FastStep, "%d");
       break;
     }
 
     case UMUGU_TYPE_INT16: {
-      ImGui::InputScalarN(Var.name.str, ImGuiDataType_S16, Value, Var.count, &Step, &FastStep,
-                          "%d");
+      Changed = ImGui::InputScalarN(Var.name.str, ImGuiDataType_S16, Value, Var.count, &Step,
+                                    &FastStep, "%d");
       break;
     }
 
     case UMUGU_TYPE_UINT8: {
-      ImGui::InputScalarN(Var.name.str, ImGuiDataType_U8, Value, Var.count, &Step, &FastStep, "%u");
+      Changed = ImGui::InputScalarN(Var.name.str, ImGuiDataType_U8, Value, Var.count, &Step,
+                                    &FastStep, "%u");
       break;
     }
 
     case UMUGU_TYPE_BOOL: {
-      ImGui::Checkbox(Var.name.str, (bool *)Value);
+      Changed = ImGui::Checkbox(Var.name.str, (bool *)Value);
       break;
     }
 
@@ -66,6 +83,15 @@ void DrawNodeWidgets(umugu_node *aNode) {
       break;
     }
     }
+
+    if (Live && Changed) {
+      for (int e = 0; e < Bytes / Size; ++e) {
+        if (memcmp(Copy + e * Size, Attrib + e * Size, Size)) {
+          umugu_attrib_set(pCtx, aNodeIdx, i, e, Copy + e * Size,
+                           Var.type == UMUGU_TYPE_FLOAT ? kRampFrames : 0);
+        }
+      }
+    }
   }
 }
 } // namespace umumk
@@ -3,10 +3,13 @@
 
 extern "C" {
 struct umugu_node;
+struct umugu_ctx;
 }
 
 namespace umumk {
-void DrawNodeWidgets(umugu_node* aNode);
+// aNodeIdx: index of the node in the running pipeline, -1 for nodes not processed yet
+// (their memory is edited directly).
+void DrawNodeWidgets(umugu_ctx* apCtx, umugu_node* aNode, int aNodeIdx = -1);
 }
 
 #endif // __UMUGU_EDITOR_UTILITIES_H__
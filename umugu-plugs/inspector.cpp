@@ -48,6 +48,8 @@ extern "C" const int size = (int)sizeof(Inspector);
 extern "C" umugu_node_func getfn(int fn);
 extern "C" const umugu_attrib_info *attribs;
 extern "C" const int attrib_count = sizeof(metadata) / sizeof(*metadata);
+/* Reads the input in any layout and passes it through. */
+extern "C" const umugu_node_flags flags = UMUGU_NODE_ANY_LAYOUT;
 
 const umugu_attrib_info *attribs = &metadata[0];
 
@@ -71,17 +73,20 @@ static int Process(umugu_ctx *apCtx, umugu_node *apNode,
                    umugu_fn_flags aFlags) {
     UM_UNUSED(aFlags);
     Inspector *pSelf = (Inspector *)apNode;
-    auto pInputNode = apCtx->pipeline.nodes[apNode->prev_node];
+    auto pInputNode = um_node_get_input(apCtx, apNode);
 
-    if (pSelf->Pause) {
+    if (pSelf->Pause || !pInputNode) {
         return UMUGU_SUCCESS;
     }
 
-    float *pInputFloat = (float *)pInputNode->out_pipe.samples;
-    const int Count = pInputNode->out_pipe.frame_count;
-    for (int i = pSelf->Offset; i < Count * 2; i += pSelf->Stride) {
-        pSelf->Values[pSelf->It] = pInputFloat[i];
-        pSelf->Values[pSelf->It + pSelf->Size] = pInputFloat[i];
+    /* Offset and Stride walk the samples frame by frame, whatever the input layout. */
+    const umugu_samples *pInput = &pInputNode->out_pipe;
+    const int Channels = pInput->channel_count;
+    const int Count = pInput->frame_count * Channels;
+    for (int i = pSelf->Offset; i < Count; i += pSelf->Stride) {
+        const float Value = *um_samples_at(pInput, i / Channels, i % Channels);
+        pSelf->Values[pSelf->It] = Value;
+        pSelf->Values[pSelf->It + pSelf->Size] = Value;
         pSelf->It++;
         if (pSelf->It >= pSelf->Size) {
             pSelf->It -= pSelf->Size;
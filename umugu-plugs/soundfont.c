@@ -32,6 +32,7 @@ static inline int um_init(umugu_ctx *ctx, umugu_node *node,
     }
 
     node->out_pipe.channel_count = 2;
+    node->prev_node = UMUGU_NO_INPUT;
 
     if (flags & UMUGU_FN_INIT_DEFAULTS) {
         return UMUGU_SUCCESS;
@@ -153,3 +154,4 @@ static const umugu_attrib_info metadata[] = {
 const size_t size = sizeof(um_sf);
 const umugu_attrib_info *attribs = &metadata[0];
 const int32_t attrib_count = sizeof(metadata) / sizeof(*metadata);
+const umugu_node_flags flags = UMUGU_NODE_PLANNED_OUTPUT;
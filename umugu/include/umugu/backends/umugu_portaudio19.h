@@ -5,6 +5,8 @@
 extern "C" {
 #endif
 
+/* Stream timing of a context, available through its io.backend_data once
+ * umugu_audio_backend_init succeeds. */
 typedef struct umugu_portaudio {
     double time_current;
     /* Seconds between the stream callback call and the moment when the produced
@@ -27,33 +29,19 @@ int umugu_audio_backend_stop_stream(struct umugu_ctx *ctx);
 #ifdef UMUGU_PORTAUDIO19_IMPL
 
 #include <umugu/umugu.h>
+#include <umugu/umugu_internal.h>
 
 #include <portaudio.h>
 
+/* Backend instance of a context (io.backend_data). Every context owns its stream, so
+ * independent contexts can run their own streams at the same time. */
 typedef struct {
+    umugu_portaudio data; /* Public part, keep it first. */
     PaStream *stream;
     PaError error;
     PaStreamParameters input_params;
     PaStreamParameters output_params;
-} um__pa_internal;
-
-static um__pa_internal um__pa_intern = {
-    .stream = NULL,
-    .error = paNoError,
-    .input_params =
-        {.device = paNoDevice,
-         .channelCount = 0,
-         .sampleFormat = paCustomFormat,
-         .suggestedLatency = 0.0,
-         .hostApiSpecificStreamInfo = NULL},
-    .output_params = {
-        .device = paNoDevice,
-        .channelCount = 0,
-        .sampleFormat = paCustomFormat,
-        .suggestedLatency = 0.0,
-        .hostApiSpecificStreamInfo = NULL}};
-
-static umugu_portaudio um__pa_data = {.time_current = 0.0, .time_margin_sec = 0.0};
+} um__pa_instance;
 
 static inline PaSampleFormat
 um__pa_samplefmt(int umugu_type, bool non_interleaved)
@@ -75,15 +63,15 @@ um__pa_samplefmt(int umugu_type, bool non_interleaved)
 }
 
 static inline void
-um__pa_terminate(umugu_ctx *ctx)
+um__pa_terminate(umugu_ctx *ctx, um__pa_instance *pa)
 {
-    ctx->io.log("Error PortAudio: %s\n", Pa_GetErrorText(um__pa_intern.error));
+    ctx->io.log("Error PortAudio: %s\n", Pa_GetErrorText(pa->error));
     Pa_Terminate();
     ctx->io.log(
         "An error occurred while using the portaudio stream.\n"
         "\tError number: %d.\n"
         "\tError message: %s.",
-        um__pa_intern.error, Pa_GetErrorText(um__pa_intern.error));
+        pa->error, Pa_GetErrorText(pa->error));
     ctx->io.backend_data = NULL;
     ctx->io.backend_name = NULL;
 }
@@ -133,14 +121,20 @@ um__pa_callback(
 int
 umugu_audio_backend_start_stream(umugu_ctx *ctx)
 {
-    if (Pa_IsStreamActive(um__pa_intern.stream)) {
+    um__pa_instance *pa = (um__pa_instance *)ctx->io.backend_data;
+    if (!pa) {
+        ctx->io.log("PortAudio: The backend is not initialized.\n");
+        return UMUGU_ERR_AUDIO_BACKEND;
+    }
+
+    if (Pa_IsStreamActive(pa->stream)) {
         ctx->io.log("The stream is already running. Ignoring call...\n");
         return UMUGU_NOOP;
     }
 
-    um__pa_intern.error = Pa_StartStream(um__pa_intern.stream);
-    if (um__pa_intern.error != paNoError) {
-        um__pa_terminate(ctx);
+    pa->error = Pa_StartStream(pa->stream);
+    if (pa->error != paNoError) {
+        um__pa_terminate(ctx, pa);
         ctx->io.log("Error PortAudio: Unable to start the stream.\n");
         return UMUGU_ERR_STREAM;
     }
@@ -152,9 +146,15 @@ umugu_audio_backend_start_stream(umugu_ctx *ctx)
 int
 umugu_audio_backend_stop_stream(umugu_ctx *ctx)
 {
-    um__pa_intern.error = Pa_StopStream(um__pa_intern.stream);
-    if (um__pa_intern.error != paNoError) {
-        um__pa_terminate(ctx);
+    um__pa_instance *pa = (um__pa_instance *)ctx->io.backend_data;
+    if (!pa) {
+        ctx->io.log("PortAudio: The backend is not initialized.\n");
+        return UMUGU_ERR_AUDIO_BACKEND;
+    }
+
+    pa->error = Pa_StopStream(pa->stream);
+    if (pa->error != paNoError) {
+        um__pa_terminate(ctx, pa);
         ctx->io.log("Error PortAudio: Unable to stop the stream.\n");
         return UMUGU_ERR_STREAM;
     }
@@ -173,65 +173,69 @@ umugu_audio_backend_init(umugu_ctx *ctx)
         return UMUGU_ERR_AUDIO_BACKEND;
     }
 
-    um__pa_intern.error = Pa_Initialize();
-    if (um__pa_intern.error != paNoError) {
-        um__pa_terminate(ctx);
+    /* Pa_Initialize and Pa_Terminate are reference counted by PortAudio: every context
+     * initializes and terminates its own reference. */
+    um__pa_instance *pa = (um__pa_instance *)um_allocprs(ctx, sizeof(um__pa_instance));
+    memset(pa, 0, sizeof(*pa));
+    pa->error = Pa_Initialize();
+    if (pa->error != paNoError) {
+        um__pa_terminate(ctx, pa);
         ctx->io.log("PortAudio Error: Initialize failed.\n");
         return UMUGU_ERR_AUDIO_BACKEND;
     }
 
-    ctx->io.backend_data = &um__pa_data;
+    ctx->io.backend_data = pa;
     ctx->io.backend_name = "PortAudio19";
     PaStreamParameters *iparams = NULL;
     PaStreamParameters *oparams = NULL;
-    um__pa_intern.input_params.device = Pa_GetDefaultInputDevice();
-    um__pa_intern.output_params.device = Pa_GetDefaultOutputDevice();
+    pa->input_params.device = Pa_GetDefaultInputDevice();
+    pa->output_params.device = Pa_GetDefaultOutputDevice();
     /* Input signal params */
-    if (um__pa_intern.input_params.device != paNoDevice && ctx->io.in_audio.samples.channel_count) {
-        um__pa_intern.input_params.sampleFormat = (double)ctx->io.in_audio.sample_rate;
-        um__pa_samplefmt(ctx->io.in_audio.format, !ctx->io.in_audio.interleaved_channels);
+    if (pa->input_params.device != paNoDevice && ctx->io.in_audio.samples.channel_count) {
+        pa->input_params.channelCount = ctx->io.in_audio.samples.channel_count;
+        pa->input_params.sampleFormat =
+            um__pa_samplefmt(ctx->io.in_audio.format, !ctx->io.in_audio.interleaved_channels);
 
-        if (um__pa_intern.input_params.sampleFormat == paCustomFormat) {
+        if (pa->input_params.sampleFormat == paCustomFormat) {
             ctx->io.log(
                 "PortAudio input stream sample format error.\n"
                 "Umugu type %d to PortAudio sample format not implemented yet, "
                 "please add the corresponding switch case.\n",
                 ctx->io.in_audio.format);
         } else {
-            um__pa_intern.input_params.suggestedLatency =
-                Pa_GetDeviceInfo(um__pa_intern.input_params.device)->defaultLowInputLatency;
-            um__pa_intern.input_params.hostApiSpecificStreamInfo = NULL;
-            iparams = &um__pa_intern.input_params;
+            pa->input_params.suggestedLatency =
+                Pa_GetDeviceInfo(pa->input_params.device)->defaultLowInputLatency;
+            pa->input_params.hostApiSpecificStreamInfo = NULL;
+            iparams = &pa->input_params;
         }
     }
 
     /* Output signal params */
-    if (um__pa_intern.output_params.device != paNoDevice &&
-        ctx->io.out_audio.samples.channel_count) {
-        um__pa_intern.output_params.channelCount = ctx->io.out_audio.samples.channel_count;
-        um__pa_intern.output_params.sampleFormat =
+    if (pa->output_params.device != paNoDevice && ctx->io.out_audio.samples.channel_count) {
+        pa->output_params.channelCount = ctx->io.out_audio.samples.channel_count;
+        pa->output_params.sampleFormat =
             um__pa_samplefmt(ctx->io.out_audio.format, !ctx->io.out_audio.interleaved_channels);
 
-        if (um__pa_intern.output_params.sampleFormat == paCustomFormat) {
+        if (pa->output_params.sampleFormat == paCustomFormat) {
             ctx->io.log(
                 "PortAudio output stream sample format error.\n"
                 "Umugu type %d to PortAudio sample format not implemented yet, "
                 "please add the corresponding switch case.\n",
                 ctx->io.out_audio.format);
         } else {
-            um__pa_intern.output_params.suggestedLatency =
-                Pa_GetDeviceInfo(um__pa_intern.output_params.device)->defaultLowOutputLatency;
-            um__pa_intern.output_params.hostApiSpecificStreamInfo = NULL;
-            oparams = &um__pa_intern.output_params;
+            pa->output_params.suggestedLatency =
+                Pa_GetDeviceInfo(pa->output_params.device)->defaultLowOutputLatency;
+            pa->output_params.hostApiSpecificStreamInfo = NULL;
+            oparams = &pa->output_params;
         }
     }
 
-    um__pa_intern.error = Pa_OpenStream(
-        &um__pa_intern.stream, iparams, oparams, (double)ctx->io.out_audio.sample_rate,
+    pa->error = Pa_OpenStream(
+        &pa->stream, iparams, oparams, (double)ctx->io.out_audio.sample_rate,
         paFramesPerBufferUnspecified, paClipOff, um__pa_callback, ctx);
 
-    if (um__pa_intern.error != paNoError) {
-        um__pa_terminate(ctx);
+    if (pa->error != paNoError) {
+        um__pa_terminate(ctx, pa);
         return UMUGU_ERR_AUDIO_BACKEND;
     }
     ctx->io.log("PortAudio: Stream Opened!\n");
@@ -242,9 +246,15 @@ umugu_audio_backend_init(umugu_ctx *ctx)
 int
 umugu_audio_backend_close(umugu_ctx *ctx)
 {
-    um__pa_intern.error = Pa_CloseStream(um__pa_intern.stream);
-    if (um__pa_intern.error != paNoError) {
-        um__pa_terminate(ctx);
+    um__pa_instance *pa = (um__pa_instance *)ctx->io.backend_data;
+    if (!pa) {
+        ctx->io.log("PortAudio: The backend is not initialized.\n");
+        return UMUGU_ERR_AUDIO_BACKEND;
+    }
+
+    pa->error = Pa_CloseStream(pa->stream);
+    if (pa->error != paNoError) {
+        um__pa_terminate(ctx, pa);
         return UMUGU_ERR_AUDIO_BACKEND;
     }
 
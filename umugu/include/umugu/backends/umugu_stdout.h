@@ -26,7 +26,8 @@ umugu_audio_backend_play(umugu_ctx *ctx, int milliseconds)
     int frames_left = (int)(ctx->io.out_audio.sample_rate / 1000) * milliseconds;
     UMUGU_ASSERT(frames_left >= 0);
     char buffer[44];
-    um_signal_wav_header(&ctx->io.out_audio, frames_left, buffer);
+    um_signal_wav_header(
+        &ctx->io.out_audio, (size_t)frames_left * um_signal_stride(&ctx->io.out_audio), buffer);
     fwrite(buffer, 44, 1, stdout);
 
     while (frames_left) {
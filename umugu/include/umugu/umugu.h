@@ -12,7 +12,6 @@
         - Resampler: sample rate conversions.
         - Stream abstraction:
             - File i/o
-            - Ring buffer
         - Finish swapping the remaining stdio.h calls with the umugu_io ones
         - Evolve the fatal_err callback into critical_err, which is like the actual fatal,
            but has extra data to allow a last attempt to handle the error without closing the app.
@@ -20,7 +19,6 @@
            a controller is properly connected then retry, provide a larger memory arena or
            to configure another audio backend.
         - Extend the log func for loglevel, file, func and line.
-        - Persistent alloc with the exact size for node infos and pipeline nodes.
         - Revisit the optional deps like PortAudio. The current header-only with optional impl
            does not work well with development tools.
         - Move the builtin nodes to umugu.c
@@ -29,7 +27,6 @@
         - Sanitizers build config.
         - Fuzzy tests.
         - Lib documentation.
-        - Gather tracing and metrics data if UMUGU_TRACE is defined
         - Verbose logs, core dump, stack trace print...
         - Benchmark and unit test of: timer, names, hash table, math...
 
@@ -62,11 +59,15 @@
 #define UMUGU_PATH_LEN 64
 #define UMUGU_NOTE_COUNT 128
 
-/* TODO: Remove this. Use permanent allocations from the arena instead. */
+/* Default of umugu_config.node_info_capacity. */
 #define UMUGU_DEFAULT_NODE_INFO_CAPACITY 64
 #define UMUGU_FALLBACK_PIPELINE_CAPACITY 8
+#define UMUGU_METRICS_WINDOW 256 /* Blocks summarized by each umugu_metrics snapshot. */
 #define UMUGU_MIXER_MAX_INPUTS 8
 
+/* Value of umugu_node.prev_node for nodes without input (e.g. signal generators). */
+#define UMUGU_NO_INPUT UINT16_MAX
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -92,23 +93,135 @@ typedef struct umugu_attrib_info umugu_attrib_info;
 typedef struct umugu_node_type_info umugu_node_type_info;
 typedef struct umugu_node umugu_node;
 typedef struct umugu_pipeline umugu_pipeline;
+typedef struct umugu_exec_step umugu_exec_step;
+typedef struct umugu_plan umugu_plan;
+typedef struct umugu_event umugu_event;
+typedef struct umugu_automation_point umugu_automation_point;
+typedef struct umugu_timing umugu_timing;
+typedef struct umugu_metrics umugu_metrics;
 
 typedef int umugu_state;             /* enum umugu_state_ */
 typedef int umugu_waveform;          /* enum umugu_waveform_ */
 typedef uint16_t umugu_type;         /* enum umugu_type_ */
 typedef uint32_t umugu_fn_flags;     /* enum umugu_fn_flags_ */
 typedef uint32_t umugu_attrib_flags; /* enum umugu_attrib_flags_ */
+typedef uint32_t umugu_node_flags;   /* enum umugu_node_flags_ */
+typedef uint16_t umugu_event_kind;   /* enum umugu_event_kind_ */
+typedef uint32_t umugu_arena_flags;  /* enum umugu_arena_flags_ */
 
 typedef int (*umugu_node_func)(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags);
 
 /* PUBLIC API */
+
+/*
+ * Thread safety: the library has no global mutable state, every context lives in the arena
+ * of its config. Distinct contexts can be loaded, processed and unloaded concurrently from
+ * different threads, as long as their arenas do not overlap and the io callbacks of the
+ * config (log, file reads, fatal) are safe to call from those threads.
+ * A single context is driven by one thread at a time: umugu_load, umugu_process,
+ * umugu_unload and the rest of the calls over the same context must not overlap, except
+ * the ones documented as thread safe (umugu_attrib_set, umugu_event_push) or as control
+ * thread calls (umugu_pipeline_swap, umugu_pipeline_collect).
+ */
 UMUGU_API umugu_ctx *umugu_load(const umugu_config *cfg);
 UMUGU_API void umugu_unload(umugu_ctx *ctx);
 UMUGU_API int umugu_process(umugu_ctx *ctx, size_t frames);
 
+/**
+ * Arena provisioning (optional, any buffer works as umugu_config.arena). Maps an anonymous
+ * region of at least size bytes and sets it as cfg->arena and cfg->arena_size, so the
+ * audio callback neither page faults nor misses the TLB on it (see
+ * umugu_arena_flags_). Call it before umugu_load and umugu_arena_unmap after
+ * umugu_unload with the same arena and size.
+ * @return UMUGU_SUCCESS, UMUGU_NOOP if the region is mapped but some flag could not be
+ * honored (logged with cfg->log_fn) or UMUGU_ERR_MEM if the region could not be mapped.
+ */
+UMUGU_API int umugu_arena_map(umugu_config *cfg, size_t size, umugu_arena_flags flags);
+UMUGU_API void umugu_arena_unmap(void *arena, size_t size);
+
+/* Pipeline files keep the nodes wiring and settable attribs (not their buffers, handles or
+ * internal state). Importing maps the file and builds all the nodes in one arena allocation:
+ * the defaults of their type with the attribs of the file over them, then initialized and
+ * compiled (umugu_process does neither). If a node type changed
+ * since the export, its attribs are matched by name (numbers are converted between types)
+ * and the ones missing in the file keep their defaults. */
 UMUGU_API int umugu_pipeline_export(umugu_ctx *ctx, const char *filename);
 UMUGU_API int umugu_pipeline_import(umugu_ctx *ctx, const char *filename);
 
+/**
+ * Offline render, as fast as the cpu goes (no audio backend). Processes frames of the
+ * current pipeline in blocks of block_frames (0 for the default) into the wav file
+ * filename, with the format of io.out_audio (float stereo at the pipeline rate if it has
+ * no channels). The blocks are gathered and written in large chunks, and the disk streams
+ * of the pipeline are waited for instead of underrunning. io.out_audio is restored after.
+ * @return UMUGU_SUCCESS, UMUGU_ERR_ARGS if the wav data would not fit in 4GiB,
+ * UMUGU_ERR_FILE or the umugu_process errors.
+ */
+UMUGU_API int umugu_render(umugu_ctx *ctx, const char *filename, int64_t frames, int block_frames);
+
+/**
+ * Replaces the pipeline while the stream runs (from one control thread, concurrently
+ * with umugu_process). The pipeline of the file (see umugu_pipeline_export) is built and
+ * initialized by the caller in a pipeline region of the arena (see
+ * umugu_config.pipeline_region_size). umugu_process takes it at the start of a block and
+ * crossfades the outputs of both pipelines along fade_frames. Pending events and ramps
+ * are dropped. The previous pipeline is released by the next swap or collect call.
+ * @return UMUGU_SUCCESS, UMUGU_ERR_BUSY while the previous swap is in progress (try again
+ * later), UMUGU_ERR_MEM without pipeline regions or the umugu_pipeline_import errors.
+ */
+UMUGU_API int umugu_pipeline_swap(umugu_ctx *ctx, const char *filename, int fade_frames);
+
+/**
+ * Releases (UMUGU_FN_RELEASE) the pipeline retired by the last swap once its fade is
+ * over, and frees its region for the next swap. Same thread as umugu_pipeline_swap.
+ * @return UMUGU_SUCCESS, or UMUGU_NOOP if there was nothing to release yet.
+ */
+UMUGU_API int umugu_pipeline_collect(umugu_ctx *ctx);
+
+/**
+ * Thread safe attribute write (lock-free, from any number of threads). The change is
+ * applied by the audio thread at the start of the next umugu_process, writing node
+ * memory directly races with it. Same as pushing a SET or RAMP event at frame 0.
+ * @param element Index for array attributes, 0 otherwise.
+ * @param value Of the attribute type (not TEXT, read-only, plot line or input attribs).
+ * @param ramp_frames Float attributes glide to the value along these frames, 0 jumps.
+ * @return UMUGU_SUCCESS, UMUGU_ERR_ARGS or UMUGU_ERR_FULL_STORAGE if the queue is full.
+ */
+UMUGU_API int umugu_attrib_set(
+    umugu_ctx *ctx, int node_idx, int attrib_idx, int element, const void *value,
+    int ramp_frames);
+
+/**
+ * Thread safe timestamped event (see umugu_attrib_set). It happens at ev->frame of the
+ * pipeline clock (umugu_ctx.frame_clock), past frames at the start of the next block.
+ * Nodes with UMUGU_NODE_EVENTS render up to the exact frame, the others get it at the
+ * start of the block it falls in.
+ * @return UMUGU_SUCCESS, UMUGU_ERR_ARGS or UMUGU_ERR_FULL_STORAGE if the queue is full.
+ */
+UMUGU_API int umugu_event_push(umugu_ctx *ctx, const umugu_event *ev);
+
+/**
+ * Sets the automation curve of a float attribute: linear segments between the points
+ * (sorted by frame), holding the last value. Replaces the previous curve of the
+ * attribute, count 0 removes it. The points are copied to the persistent arena, so it
+ * is not thread safe: call it between umugu_process calls.
+ * @return UMUGU_SUCCESS, UMUGU_ERR_ARGS or UMUGU_ERR_FULL_TABLE if there are too many.
+ */
+UMUGU_API int umugu_automation_set(
+    umugu_ctx *ctx, int node_idx, int attrib_idx, int element,
+    const umugu_automation_point *points, int count);
+
+/**
+ * Thread safe copy of the last metrics published by the audio thread (every
+ * UMUGU_METRICS_WINDOW blocks). Lock-free for the audio thread: the reader retries while
+ * a snapshot is being written, it never makes umugu_process wait.
+ * @param nodes Optional, gets the timings of the first node_capacity nodes of the snapshot
+ * (by umugu_pipeline.nodes index, out->node_count in total).
+ * @return UMUGU_SUCCESS, or UMUGU_NOOP if no window has been completed yet.
+ */
+UMUGU_API int umugu_metrics_read(
+    const umugu_ctx *ctx, umugu_metrics *out, umugu_timing *nodes, int node_capacity);
+
 /* DATA TYPES */
 
 enum {
@@ -129,6 +242,8 @@ enum {
     UMUGU_ERR_MIDI,
     UMUGU_ERR_FULL_STORAGE,
     UMUGU_ERR_FULL_TABLE,
+    UMUGU_ERR_GRAPH,
+    UMUGU_ERR_BUSY,
 };
 
 /**
@@ -184,6 +299,98 @@ enum umugu_attrib_flags_ {
     UMUGU_ATTR_RANGE = 0x2,
     UMUGU_ATTR_PLOTLINE = 0x4,
     UMUGU_ATTR_DEBUG = 0x8,
+    /* The attrib holds pipeline node indices (INT16 or UINT16) whose output is read by
+     * this node, in addition to prev_node. Negative or out of range values are ignored. */
+    UMUGU_ATTR_INPUT = 0x10,
+};
+
+/* Backing of the arenas provisioned by umugu_arena_map. */
+enum umugu_arena_flags_ {
+    UMUGU_ARENA_FLAG_NONE = 0,
+    /* 2MiB pages: reserved ones (vm.nr_hugepages) or else transparent huge pages. The
+     * size is rounded up to whole huge pages. */
+    UMUGU_ARENA_HUGE_PAGES = 0x1,
+    /* mlock, never paged out (limited by RLIMIT_MEMLOCK). */
+    UMUGU_ARENA_LOCK = 0x2,
+    /* Every page is faulted in before returning instead of in the first blocks. */
+    UMUGU_ARENA_PREFAULT = 0x4,
+    UMUGU_ARENA_REALTIME = UMUGU_ARENA_HUGE_PAGES | UMUGU_ARENA_LOCK | UMUGU_ARENA_PREFAULT,
+};
+
+/**
+ * Node type behaviour hints for the pipeline compiler.
+ * Plugs declare them exporting an umugu_node_flags named "flags" (optional).
+ */
+enum umugu_node_flags_ {
+    UMUGU_NODE_FLAG_NONE = 0,
+    /* Every process writes the whole out_pipe in a buffer obtained with um_alloc_samples,
+     * so the plan can provide it from a reusable slot. Nodes aliasing the out_pipe of
+     * their inputs or of other nodes must not set it. */
+    UMUGU_NODE_PLANNED_OUTPUT = 0x1,
+    /* Single input processed sample by sample (out[i] depends only on in[i]), so the
+     * output can be written over the input buffer. Needs UMUGU_NODE_PLANNED_OUTPUT. */
+    UMUGU_NODE_INPLACE = 0x2,
+    /* Renders the block in segments split at the offsets of its events (um_node_events),
+     * so they are sample accurate. Otherwise they are applied at the start of the block
+     * and note events are ignored. */
+    UMUGU_NODE_EVENTS = 0x4,
+    /* Sink of the pipeline into io.out_audio (single input, no readers). When the device
+     * buffer has the layout of its input (float, same layout or mono) the plan renders the
+     * input straight into it and the node has nothing to copy. */
+    UMUGU_NODE_DEVICE_OUTPUT = 0x8,
+    /* Reads its inputs and writes its output interleaved (frame by frame) instead of
+     * planar (channel by channel, the default). The compiler converts the signals
+     * between nodes of different layouts (see umugu_samples.interleaved). */
+    UMUGU_NODE_INTERLEAVED = 0x10,
+    /* Reads its inputs in any layout, checking umugu_samples.interleaved, and its output
+     * has the layout of its prev_node: nothing is converted around it. */
+    UMUGU_NODE_ANY_LAYOUT = 0x20,
+};
+
+enum umugu_event_kind_ {
+    UMUGU_EVENT_SET,      /* Attribute value. */
+    UMUGU_EVENT_RAMP,     /* Float attribute glide to value along ramp_frames. */
+    UMUGU_EVENT_NOTE_ON,  /* note and velocity, for nodes handling them. */
+    UMUGU_EVENT_NOTE_OFF, /* note. */
+};
+
+struct umugu_event {
+    int64_t frame;    /* Pipeline clock frame when it happens. */
+    umugu_event_kind kind;
+    uint16_t node;    /* Index in umugu_pipeline.nodes. */
+    uint16_t attrib;  /* SET and RAMP: index in the node type attribs. */
+    uint8_t note;     /* NOTE_ON and NOTE_OFF. */
+    uint8_t velocity; /* NOTE_ON, [0, 127]. */
+    int32_t element;  /* SET and RAMP: array attribs index. */
+    int32_t ramp_frames;
+    union {
+        float f;
+        uint8_t bytes[8]; /* Of the attrib type. */
+    } value;
+};
+
+struct umugu_automation_point {
+    int64_t frame; /* Pipeline clock. */
+    float value;
+};
+
+/* Processing times of the last window of blocks, in nanoseconds. */
+struct umugu_timing {
+    int64_t min_ns;
+    int64_t avg_ns;
+    int64_t p99_ns; /* Upper bound of its histogram bucket (a quarter of octave). */
+    int64_t max_ns;
+};
+
+struct umugu_metrics {
+    int64_t blocks;           /* umugu_process calls since the load. */
+    int64_t deadline_misses;  /* Blocks processed slower than real time (not offline). */
+    int64_t stream_underruns; /* Blocks that a disk stream could not fill in time. */
+    int64_t budget_ns;        /* Duration of the last block at the output rate. */
+    int64_t arena_high_water; /* Most arena bytes in use by a block (and the persistent). */
+    int64_t arena_overflows;  /* Blocks whose temporary allocations did not fit the arena. */
+    umugu_timing block;       /* Whole umugu_process calls. */
+    int64_t node_count;       /* Node timings of the snapshot, see umugu_metrics_read. */
 };
 
 /* Node field descriptor with type metadata for external node communication
@@ -216,6 +423,7 @@ struct umugu_node_type_info {
     umugu_name name;
     int size_bytes;
     int attrib_count;
+    umugu_node_flags flags;
     umugu_node_func (*getfn)(int fn);
     const umugu_attrib_info *attribs;
     void *plug_handle;
@@ -225,6 +433,8 @@ struct umugu_samples {
     float *samples;
     int frame_count;
     int8_t channel_count;
+    int8_t channel_capacity; /* Of the buffer assigned by the plan, 0 if there is none. */
+    bool interleaved;        /* Layout, set by the compiler (see UMUGU_NODE_INTERLEAVED). */
 };
 
 struct umugu_signal {
@@ -237,8 +447,9 @@ struct umugu_signal {
 struct umugu_node {
     umugu_samples out_pipe;
     int8_t input_channel;
-    uint16_t prev_node; /* Index in umugu_ctx->pipeline->nodes. */
+    uint16_t prev_node; /* Index in umugu_ctx->pipeline->nodes or UMUGU_NO_INPUT. */
     uint16_t info_idx;  /* Index in umugu_ctx->node_info. */
+    uint16_t idx;       /* Index in umugu_ctx->pipeline->nodes, set by the compile. */
 };
 
 /* Defines the audio fx pipeline graph. Pipelines are the scenes of umugu.
@@ -247,12 +458,54 @@ struct umugu_node {
  * Is the struct that has to be imported/exported or generated with tools
  * like umg-editor. */
 struct umugu_pipeline {
-    umugu_node *nodes[64];
+    umugu_node **nodes; /* Persistent, of node_capacity (the loaded ones plus room for a
+                         * layout conversion of each). */
     int64_t node_count;
+    int64_t node_capacity;
     umugu_signal sig; // Internal signal config.
     // TODO: Add in and out signals here.
 };
 
+/* Pipeline schedule entry: the graph data of a step (the cold part, what every block
+ * runs is in the execution table of umugu_plan). The node functions are resolved once at
+ * compile time so the audio callback does not go through the node type's getfn. */
+struct umugu_exec_step {
+    umugu_node_func init;    /* Can be NULL. */
+    umugu_node_func release; /* Can be NULL. */
+    int32_t port_first;      /* First input of this step in umugu_plan.ports. */
+    uint16_t port_count;     /* Number of inputs. */
+    uint16_t consumer_count; /* Number of steps reading this output. */
+    int32_t consumer_first;  /* First reader of this output in umugu_plan.consumers. */
+    int32_t last_use;        /* Last step reading this output, -1 if nobody does. */
+};
+
+/* Compiled pipeline. The node graph (prev_node plus UMUGU_ATTR_INPUT attribs)
+ * topologically sorted into a flat array of steps, generated from umugu_pipeline
+ * by um_pipeline_compile. It has to be compiled again every time the pipeline
+ * nodes or their connections change. */
+struct umugu_plan {
+    /* Execution table: one array per field, by step. The processing loop and the output
+     * binding of every block read only these, in order. */
+    umugu_node_func *exec_process;
+    umugu_node **exec_node;
+    uint16_t *exec_node_idx; /* Index in umugu_pipeline.nodes. */
+    int16_t *exec_slot;      /* Output buffer in the slots, -1 if allocated by the node. */
+
+    umugu_exec_step *steps;
+    uint16_t *ports;     /* Step indices of the inputs of every step, see port_first. */
+    uint16_t *consumers; /* Step indices of the readers of every step, see consumer_first. */
+    int32_t step_count;
+    int32_t step_capacity; /* Of the arrays by step, the node capacity of the pipeline. */
+    int32_t port_count;
+    int32_t port_capacity;
+    int8_t *slot_channels; /* Channel capacity of every output buffer slot. */
+    int32_t *slot_first;   /* First channel of every slot in the block pool, and the total. */
+    int32_t slot_count;
+    int16_t direct_slot; /* Slot bound to io.out_audio when its layout matches, -1 if none. */
+    bool direct_interleaved; /* Layout of the direct slot. */
+    struct um_plan_scratch *scratch; /* Arrays of um_pipeline_compile, by capacity. */
+};
+
 /**
  * @brief Initial configuration provided by the user at context creation.
  *  No instances of this struct are kept in memory once the lib is loaded.
@@ -275,6 +528,33 @@ struct umugu_config {
      */
     umugu_name fallback_ppln[UMUGU_FALLBACK_PIPELINE_CAPACITY];
     size_t fallback_ppln_node_count;
+
+    /**
+     * Nodes the per context tables (timings, events, parallel executor) are sized for up
+     * front, layout conversions included. They grow with the pipelines generated or
+     * imported later, zero sizes them for the first one. Only the pipelines staged by
+     * umugu_pipeline_swap can not grow them (the audio thread is using them): set it to
+     * the largest pipeline that will be swapped in. Pipelines are limited to INT16_MAX nodes.
+     * node_info_capacity is the most node types loaded, zero for the UMUGU_DEFAULT_ one.
+     */
+    int pipeline_capacity;
+    int node_info_capacity;
+
+    /**
+     * Parallel processing (opt-in). Number of extra threads that process the independent
+     * branches of the pipeline together with the thread calling umugu_process.
+     * Zero processes the pipeline serially.
+     */
+    int worker_count;
+    /* SCHED_FIFO priority of the workers (needs privileges). Zero keeps the default policy. */
+    int worker_rt_priority;
+
+    /**
+     * Pipeline hot-swap (opt-in). Two regions of this many bytes are reserved in the
+     * arena for the pipelines built by umugu_pipeline_swap (nodes, plan and their
+     * persistent allocations). Zero disables umugu_pipeline_swap.
+     */
+    size_t pipeline_region_size;
 };
 
 /* Input and output abstraction.
@@ -317,21 +597,39 @@ struct umugu_ctx {
     umugu_state state;
     umugu_io io;             /* Input / output abstraction layer. */
     umugu_pipeline pipeline; /* Audio processing pipeline. */
+    umugu_plan plan;         /* Compiled pipeline, the one actually processed. */
+    struct um_exec_pool *workers; /* Parallel executor, NULL when processing serially. */
+    const struct um_kernels *kernels; /* SIMD kernels for the running cpu. */
+    struct um_resampler *resampler; /* Pipeline to output rate conversion, NULL if none. */
+    struct um_params *params;       /* Events queued by umugu_event_push and automation. */
+    struct um_swap *swap;           /* Pipeline hot-swap, NULL if there are no regions. */
+    struct um_metrics *metrics;     /* Node and block timings (umugu_metrics_read). */
+    struct um_registry *registry;   /* Node type lookup by name. */
+    int64_t frame_clock;            /* Pipeline frames processed, the time of the events. */
+    int32_t out_frames;             /* Frames requested to umugu_process. */
+    bool offline;                   /* In umugu_render: disk streams are waited for. */
 
     /* Nodes type info. */
-    umugu_node_type_info nodes_info[UMUGU_DEFAULT_NODE_INFO_CAPACITY];
+    umugu_node_type_info *nodes_info; /* Persistent, of nodes_info_capacity. */
     int32_t nodes_info_next;
+    int32_t nodes_info_capacity;
+    int32_t pipeline_capacity; /* Nodes of the per context tables, see umugu_config. */
 
     /* Memory arena. */
-    uint8_t *arena_head;      /* First byte of the memory arena. */
-    ptrdiff_t arena_capacity; /* In bytes. */
-    uint8_t *arena_pers_end;  /* First byte after the permanent allocated region. */
-    uint8_t *arena_tail;      /* First unallocated byte of the arena. */
+    uint8_t *arena_head;        /* First byte of the memory arena. */
+    ptrdiff_t arena_capacity;   /* In bytes. */
+    uint8_t *arena_pers_end;    /* First byte after the permanent allocated region. */
+    uint8_t *arena_tail;        /* First unallocated byte of the arena. */
+    int64_t arena_high_water;   /* Most bytes in use (persistent and one iteration). */
+    int64_t arena_overflows;    /* Iterations whose temporary allocs wrapped around. */
+    int32_t arena_it_overflows; /* Wraps of the current iteration. */
 
     /* Debug metric data. */
     int64_t ppln_iterations;   // Counter that increases for each umugu_produce_signal call.
     int64_t ppln_it_allocated; // Number of arena bytes allocated this pipeline iteration.
 
+    int64_t stream_underruns; // Blocks that a disk stream could not fill in time.
+
     int64_t init_time_ns;         // initialization time in nanoseconds.
     int64_t ppln_process_time_ns; // last pipeline process time in nanoseconds.
 
@@ -44,7 +44,10 @@
 #endif
 /* END UMUGU_TRAP */
 
-/* UMUGU_TRACE */
+/* UMUGU_TRACE
+ * Tracy zones, frame marks and plots. Only the debug and profile builds define UMUGU_TRACE
+ * (see UM_PROFILE in CMakeLists.txt) and it needs the tracy client (TRACY_ENABLE), otherwise
+ * the macros expand to nothing and their arguments are not evaluated. */
 #if defined(UMUGU_TRACE) && defined(TRACY_ENABLE) && (defined(__clang__) || defined(__GNUC__))
 #include "tracy/TracyC.h"
 static inline void
@@ -55,6 +58,10 @@ um___tracy_zone_end(TracyCZoneCtx *ctx)
 #define UM_TRACE_ZONE()                                                                            \
     TracyCZone(UM_STRCAT_(CTX, __LINE__) __attribute((cleanup(um___tracy_zone_end))), true);       \
     ((void)UM_STRCAT_(CTX, __LINE__))
+/* Zone with a runtime name (e.g. the node type of a pipeline step). */
+#define UM_TRACE_ZONE_NAMED(NAME)                                                                  \
+    UM_TRACE_ZONE();                                                                               \
+    TracyCZoneName(UM_STRCAT_(CTX, __LINE__), (NAME), strlen(NAME))
 #define UM_TRACE_ZONE_COLOR(...) TracyCZoneColor(UM_STRCAT_(CTX, __LINE__), (__VA_ARGS__))
 #define UM_TRACE_FRAME_MARK TracyCFrameMark
 #define UM_TRACE_MSG(...) TracyCMessageL(__VA_ARGS__)
@@ -63,8 +70,13 @@ um___tracy_zone_end(TracyCZoneCtx *ctx)
 #define UM_TRACE_PLOT_CONFIG(...) TracyCPlotConfig(__VA_ARGS__)
 #else
 #define UM_TRACE_ZONE() ((void)0)
+#define UM_TRACE_ZONE_NAMED(NAME) ((void)0)
 #define UM_TRACE_ZONE_COLOR(...) ((void)0)
 #define UM_TRACE_FRAME_MARK ((void)0)
+#define UM_TRACE_MSG(...) ((void)0)
+#define UM_TRACE_PLOTI(...) ((void)0)
+#define UM_TRACE_PLOTF(...) ((void)0)
+#define UM_TRACE_PLOT_CONFIG(...) ((void)0)
 #endif
 /* END UMUGU TRACE */
 
@@ -76,13 +88,50 @@ typedef int umugu_fn; /* enum umugu_fn_ */
 
 /**
  * Initializes the current context's pipeline using the given names and default
- * values.
+ * values, and compiles and initializes its nodes (um_pipeline_init).
  * @param ctx Pointer to the context instance where generate the pipeline.
  * @param names Array of the desired node types.
  * @param count Number of names in the node_names array.
  */
 UMUGU_API int um_pipeline_generate(umugu_ctx *ctx, const umugu_name *names, int count);
 
+/**
+ * Builds the execution plan of the current pipeline: resolves every node function,
+ * gathers the input ports of each node and sorts the graph so every node runs
+ * after all of its inputs. Call it after any change in the pipeline's nodes or
+ * connections (um_pipeline_init already does).
+ * @return UMUGU_SUCCESS, UMUGU_ERR_NULL if some node does not provide a process func
+ *  or UMUGU_ERR_GRAPH if the node connections have cycles.
+ */
+UMUGU_API int um_pipeline_compile(umugu_ctx *ctx);
+
+/**
+ * Compiles the pipeline, runs the init of every node and compiles it again (inits can
+ * rewire the inputs). Generate and import already do it, call it again after setting up
+ * nodes (files, connections) or the output rate, before processing: umugu_process never
+ * compiles nor initializes nodes.
+ * @return The result of the last compile.
+ */
+UMUGU_API int um_pipeline_init(umugu_ctx *ctx);
+
+/* Binds the plan output slots for the current block and processes every step (in
+ * parallel if there are workers). */
+void um_plan_run(umugu_ctx *ctx);
+
+/**
+ * Parallel executor. Starts worker_count threads (pinned and optionally with real-time
+ * priority) that process the compiled plan with work stealing. The thread calling
+ * um_exec_pool_process takes part and always runs the last step (the output) once
+ * every other step has finished.
+ * @return The pool or NULL if no worker thread could be started.
+ */
+UMUGU_API struct um_exec_pool *
+um_exec_pool_create(umugu_ctx *ctx, int worker_count, int rt_priority);
+UMUGU_API void um_exec_pool_destroy(struct um_exec_pool *pool);
+/* Room for plans of up to capacity steps. Between blocks, the workers are parked. */
+void um_exec_pool_reserve(umugu_ctx *ctx, struct um_exec_pool *pool, int capacity);
+UMUGU_API int um_exec_pool_process(struct um_exec_pool *pool);
+
 /* Search the file lib<name>.so in the rpath and load it if found.
  * Return the index of the context's node infos array where it has been copied.
  * If the dynamic object can not be found, return UMUGU_ERR_PLUG. */
@@ -101,26 +150,61 @@ UMUGU_API int um_node_dispatch(umugu_ctx *ctx, umugu_node *node, umugu_fn fn, um
  */
 UMUGU_API const umugu_node_type_info *um_node_info_load(umugu_ctx *ctx, const umugu_name *name);
 
+/* Appends a node type to the context (indexed by name right away) and returns its index,
+ * or UMUGU_ERR_FULL_STORAGE at umugu_config.node_info_capacity. Types are only appended by
+ * one thread at a time, never by the audio thread: the Layout type of the conversions
+ * inserted while processing is loaded with the context. */
+UMUGU_API int um_node_info_add(umugu_ctx *ctx, const umugu_node_type_info *info);
+
+/* Every arena allocation starts at a cache line: sample buffers suit any vector load and
+ * buffers written by different threads never share a line. */
+#define UM_ARENA_ALIGN 64
+/* Nodes packed together in one allocation (generated and imported pipelines). */
+#define UM_NODE_ALIGN 16
+
+static inline size_t
+um_align_up(size_t bytes, size_t align)
+{
+    return (bytes + align - 1) & ~(align - 1);
+}
+
+static inline void *
+um_align_ptr(void *ptr, size_t align)
+{
+    return (void *)(((uintptr_t)ptr + align - 1) & ~(uintptr_t)(align - 1));
+}
+
 /**
  * @brief Persistent allocation.
  * The allocated buffer can not be released and will be valid until the context is unloaded.
  * The more persistent memory allocated the less available memory for temporal allocs.
  * This alloc is intended only for initialization time.
  * @param bytes Alloc size in bytes.
- * @return Allocated memory. It never returns NULL.
+ * @return Allocated memory aligned to UM_ARENA_ALIGN. It never returns NULL.
  */
 UMUGU_API void *um_allocprs(umugu_ctx *ctx, size_t bytes);
 
 /**
  * @brief Temporal allocation.
- * The allocated memory will be automatically reassigned at some point after the current iteration
- * finishes, so do not read from it afterwards.
- * @note This allocator manages the remaining space after the permanent allocs as a ring buffer.
+ * The allocated memory is released at the start of the next umugu_process (see
+ * um_arena_frame_begin), so do not read from it afterwards.
+ * @note If a single iteration needs more than the free arena, the allocations wrap back
+ * over the older ones of the iteration: umugu_process returns UMUGU_ERR_MEM and the
+ * overflow is counted in umugu_metrics.arena_overflows. With UMUGU_DEBUG every allocation
+ * is filled with 0xFF (NaN floats) and surrounded by guards checked at the end of the
+ * iteration.
  * @param bytes Alloc size in bytes.
- * @return Allocated memory. It never returns NULL.
+ * @return Allocated memory aligned to UM_ARENA_ALIGN. It never returns NULL.
  */
 UMUGU_API void *um_alloctmp(umugu_ctx *ctx, size_t bytes);
 
+/* Frame markers of the temporary allocations, called by umugu_process around every
+ * iteration. Begin releases every temporary allocation. End updates the high-water mark
+ * and returns UMUGU_ERR_MEM if the iteration overflowed the arena (or, with UMUGU_DEBUG,
+ * wrote out of the bounds of a temporary allocation). */
+UMUGU_API void um_arena_frame_begin(umugu_ctx *ctx);
+UMUGU_API int um_arena_frame_end(umugu_ctx *ctx);
+
 /**
  * Allocates a large enough sample buffer in the signal for the current iteration frame count.
  * @param samples Caller's owned sample buffer.
@@ -230,7 +314,7 @@ static inline const umugu_node *
 um_node_get_input(umugu_ctx *ctx, const umugu_node *node)
 {
     int idx = node->prev_node;
-    if (idx < 0) {
+    if (idx == UMUGU_NO_INPUT || idx >= ctx->pipeline.node_count) {
         return NULL;
     }
 
@@ -286,6 +370,15 @@ um_signal_get_channel(const umugu_samples *signal, int channel)
     return signal->samples + signal->frame_count * channel;
 }
 
+/* Sample of a frame and channel in either layout (see umugu_samples.interleaved). */
+static inline float *
+um_samples_at(const umugu_samples *s, int frame, int channel)
+{
+    UMUGU_ASSERT(s && s->samples && frame < s->frame_count && channel < s->channel_count);
+    return s->samples + (s->interleaved ? frame * s->channel_count + channel
+                                        : s->frame_count * channel + frame);
+}
+
 static inline float
 um_signal_samplef(const umugu_signal *sig, int frame, int ch)
 {
@@ -295,6 +388,8 @@ um_signal_samplef(const umugu_signal *sig, int frame, int ch)
         return ((float)(*(uint8_t *)sample) / 255.0f) * 2.0f - 1.0f;
     case UMUGU_TYPE_INT16:
         return (float)(*(int16_t *)sample) / 32768.0f;
+    case UMUGU_TYPE_INT32:
+        return (float)(*(int32_t *)sample) / 2147483648.0f;
     case UMUGU_TYPE_FLOAT:
         return *(float *)sample;
     default:
@@ -304,6 +399,16 @@ um_signal_samplef(const umugu_signal *sig, int frame, int ch)
 }
 
 void um_signal_wav_header(umugu_signal *sig, size_t wav_data_size, void *out_buffer);
+/* Walks the RIFF chunks of the first size bytes of a wav file of file_size bytes: reads
+ * the signal format from the "fmt " chunk (PCM, float or extensible) and points the
+ * samples to the "data" chunk, which can continue past size. Returns the number of frames
+ * (also in sig->samples.frame_count) or an error code. */
+int um_signal_wav_parse(umugu_signal *sig, const void *file, size_t size, size_t file_size);
+/* Maps a wav file read-only with sequential access hints and parses it, the samples of
+ * sig point into the mapping. Returns the number of frames or an error code; on success
+ * release the mapping with um_wav_unmap. */
+int um_wav_map(const char *filename, umugu_signal *sig, void **map, size_t *map_size);
+void um_wav_unmap(void *map, size_t map_size);
 
 /* ## WAVEFORM GENERATION ## */
 
@@ -324,6 +429,18 @@ void um_oscillator_triangle(um_oscillator *self, umugu_samples *sig, int sample_
 void um_oscillator_square(um_oscillator *self, umugu_samples *sig, int sample_rate);
 void um_noisegen_white(um_noisegen *self, umugu_samples *sig);
 
+enum {
+    UM_OSCBANK_LANES = 8, /* Voices rendered together by the bank kernels. */
+    UM_OSCBANK_MAX_VOICES = 256,
+};
+
+/* Oscillator bank voices in SoA layout. */
+typedef struct um_voices {
+    float freq[UM_OSCBANK_MAX_VOICES];  /* hz */
+    float amp[UM_OSCBANK_MAX_VOICES];
+    float phase[UM_OSCBANK_MAX_VOICES]; /* normalized [0, 1) */
+} um_voices;
+
 /* ## MATH ## */
 static inline float
 um_minf(float a, float b)
@@ -360,9 +477,317 @@ typedef struct {
     float imag;
 } um_complex;
 
+static inline um_complex
+um_cmul(um_complex a, um_complex b)
+{
+    um_complex r; /* No compound literal: the header is included from C++ too. */
+    r.real = a.real * b.real - a.imag * b.imag;
+    r.imag = a.real * b.imag + a.imag * b.real;
+    return r;
+}
+
 void um_fft(um_complex *v, int n, um_complex *tmp);
 void um_ifft(um_complex *v, int n, um_complex *tmp);
 
+/* ## SIMD KERNELS ## */
+
+/* Converts float samples to the kernel's sample format. The channels are interleaved
+ * into dst, call it once per channel with channels = 1 for planar outputs.
+ * Values out of [-1, 1] saturate. */
+typedef void (*um_convert_fn)(void *dst, const float *const *src, int channels, int frames);
+/* Interleaved samples of the given type to planar float, one dst pointer per channel.
+ * Same scaling as um_signal_samplef. */
+typedef void (*um_decode_fn)(float *const *dst, const void *src, int channels, int frames);
+
+/* Sample processing kernels, one table per instruction set. The context keeps the
+ * best one for the running cpu in ctx->kernels (selected at load time).
+ * The buffers do not need to be aligned and dst can be the same as src. */
+typedef struct um_kernels {
+    const char *isa;
+    void (*gain)(float *dst, const float *src, float gain, int count);
+    void (*clamp)(float *dst, const float *src, float min, float max, int count);
+    /* dst = (src[0] + src[1] + ... + src[n - 1]) * scale. */
+    void (*mix)(float *dst, const float *const *src, int n, float scale, int count);
+    um_convert_fn convert[UMUGU_TYPE_COUNT]; /* By output umugu_type, NULL if not supported. */
+    um_decode_fn decode[UMUGU_TYPE_COUNT];   /* By input umugu_type, NULL if not supported. */
+    /* dst = sum of the first count voices, band-limited (PolyBLEP / PolyBLAMP) saw, square
+     * and triangle. SAWSIN and WHITE_NOISE render as SINE. Advances the voice phases. */
+    void (*oscbank)(
+        float *dst, um_voices *voices, int count, umugu_waveform waveform, float inv_sample_rate,
+        int frames);
+    /* In-place radix-4 pass of the plan ffts, see um_fft_plan. */
+    void (*fft_radix4)(um_complex *v, int n, int h, const um_complex *tw, int inverse);
+    /* acc += a * b, complex (spectral convolution). */
+    void (*cmac)(um_complex *acc, const um_complex *a, const um_complex *b, int count);
+    /* a . b, count multiple of 8 (resampling filters). */
+    float (*dot)(const float *a, const float *b, int count);
+} um_kernels;
+
+/* Best kernels for the running cpu. */
+const um_kernels *um_kernels_select(void);
+/* Every kernel table supported by the running cpu (scalar first), for testing. */
+int um_kernels_available(const um_kernels **out, int capacity);
+
+/* ## FFT PLANS ## */
+
+/* Precomputed tables of a power of two transform size n (>= 4), allocated in the
+ * persistent arena. Iterative: bit-reversal permutation, an initial radix-2 pass for odd
+ * log2 sizes and then radix-4 passes (kernels->fft_radix4). The same plan does complex
+ * transforms of n points and real transforms of n samples (through n/2 complex points).
+ * The inverse transforms are not normalized, like um_ifft: scale the result by 1/n. */
+typedef struct um_fft_plan {
+    int n;
+    int log2n;
+    const um_kernels *kernels;
+    uint32_t *bitrev;       /* Bit-reversed index, log2n bits. */
+    um_complex *twiddles;   /* Radix-4 twiddles for spans h = 1, 2, 4 ... n/4, at 3(h - 1). */
+    um_complex *rtwiddles;  /* W_n^k, k < n/2, for splitting the real transforms. */
+} um_fft_plan;
+
+um_fft_plan *um_fft_plan_create(umugu_ctx *ctx, int n);
+/* In-place complex transforms of plan->n points. */
+void um_fft_forward(const um_fft_plan *plan, um_complex *v);
+void um_fft_inverse(const um_fft_plan *plan, um_complex *v);
+/* plan->n real samples to the plan->n / 2 + 1 non-negative frequency bins. */
+void um_fft_real_forward(const um_fft_plan *plan, const float *in, um_complex *out);
+/* plan->n / 2 + 1 bins to plan->n real samples. The bins are not modified. */
+void um_fft_real_inverse(const um_fft_plan *plan, const um_complex *in, float *out);
+
+/* ## STREAMS ## */
+
+/* Lock-free single producer, single consumer byte ring. The positions grow monotonically
+ * (offset = position % capacity), the producer owns head and the consumer tail. */
+typedef struct um_ring {
+    uint64_t head; /* Bytes written. */
+    char pad0[56];
+    uint64_t tail; /* Bytes read. */
+    char pad1[56];
+    uint8_t *data;
+    uint64_t capacity;
+} um_ring;
+
+static inline void
+um_ring_init(um_ring *r, void *buffer, uint64_t capacity)
+{
+    r->head = 0;
+    r->tail = 0;
+    r->data = (uint8_t *)buffer;
+    r->capacity = capacity;
+}
+
+/* Producer: contiguous free bytes at the write position. */
+static inline uint64_t
+um_ring_write_region(um_ring *r, void **region)
+{
+    const uint64_t head = r->head;
+    const uint64_t free_bytes = r->capacity - (head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE));
+    const uint64_t offset = head % r->capacity;
+    *region = r->data + offset;
+    return free_bytes < r->capacity - offset ? free_bytes : r->capacity - offset;
+}
+
+static inline void
+um_ring_commit(um_ring *r, uint64_t bytes)
+{
+    __atomic_store_n(&r->head, r->head + bytes, __ATOMIC_RELEASE);
+}
+
+/* Consumer: contiguous ready bytes at the read position. */
+static inline uint64_t
+um_ring_read_region(um_ring *r, const void **region)
+{
+    const uint64_t tail = r->tail;
+    const uint64_t ready = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE) - tail;
+    const uint64_t offset = tail % r->capacity;
+    *region = r->data + offset;
+    return ready < r->capacity - offset ? ready : r->capacity - offset;
+}
+
+/* Consumer: moves the read position to tail (consumed or discarded bytes). */
+static inline void
+um_ring_consume_to(um_ring *r, uint64_t tail)
+{
+    __atomic_store_n(&r->tail, tail, __ATOMIC_RELEASE);
+}
+
+/* Wav data read ahead from disk by a background thread into a ring of whole frames.
+ * The consumer side (um_stream_peek, um_stream_consume, um_stream_seek) does not block
+ * nor call the system, so it can run in the audio callback. */
+typedef struct um_stream um_stream;
+
+/* Reads the wav header of filename, allocates the stream and its ring (ring_frames) in
+ * the persistent arena and starts the reader thread. sig gets the format (its samples are
+ * NULL). loop is read by the reader at the end of the file. Returns NULL on error. */
+um_stream *um_stream_open(
+    umugu_ctx *ctx, const char *filename, umugu_signal *sig, const bool *loop, int ring_frames);
+void um_stream_close(um_stream *s);
+/* Contiguous frames ready (up to max_frames), 0 while a seek is on its way. */
+int um_stream_peek(um_stream *s, const void **frames, int max_frames);
+void um_stream_consume(um_stream *s, int frames);
+/* The frames after the current ones are discarded, the data from frame follows. */
+void um_stream_seek(um_stream *s, uint32_t frame);
+/* At least frames ready, or the end of the file (not looping) reached. */
+bool um_stream_ready(um_stream *s, int frames);
+/* Nothing ready although the file goes on: the reader is late (an underrun). */
+bool um_stream_starved(um_stream *s);
+/* Offline consumers (umugu_render) wait for the reader instead of underrunning: wakes it
+ * up and yields the cpu. Calls the system, not for the audio callback. */
+void um_stream_wait(um_stream *s);
+
+/* ## RESAMPLING ## */
+
+/* Windowed-sinc (Kaiser) polyphase filters: taps per output (x in / out rate when
+ * decimating). The latency is about half of them, in input frames. */
+typedef enum {
+    UM_RESAMPLE_FAST,     /* 16 taps, ~60dB stopband. */
+    UM_RESAMPLE_BALANCED, /* 32 taps, ~80dB stopband. */
+    UM_RESAMPLE_BEST,     /* 64 taps, ~100dB stopband. */
+    UM_RESAMPLE_QUALITY_COUNT
+} um_resample_quality;
+
+/* Rational ratio L / M (out / in rate). Up to UM_RESAMPLER_MAX_PHASES the filter table
+ * has every phase; bigger L interpolate between the UM_RESAMPLER_TABLE_PHASES ones. */
+enum {
+    UM_RESAMPLER_MAX_PHASES = 1024,
+    UM_RESAMPLER_TABLE_PHASES = 256,
+    UM_RESAMPLER_MAX_TAPS = 256,
+};
+
+typedef struct um_resampler um_resampler;
+
+/* Planar converter of channels from in_rate to out_rate, allocated in the persistent
+ * arena. NULL if the rates are not valid. */
+um_resampler *um_resampler_create(
+    umugu_ctx *ctx, int in_rate, int out_rate, int channels, um_resample_quality quality);
+/* Input frames that the next out_frames consume. */
+int um_resampler_input_frames(const um_resampler *r, int out_frames);
+/* Converts um_resampler_input_frames(r, out_frames) frames of in into out_frames. */
+void um_resampler_process(
+    um_resampler *r, const float *const *in, float *const *out, int out_frames);
+/* Clears the filter history (discontinuities like seeks). */
+void um_resampler_reset(um_resampler *r);
+int um_resampler_latency(const um_resampler *r);
+
+/* ## EVENTS ## */
+
+enum {
+    UM_PARAM_QUEUE_CAPACITY = 1024,   /* Pushed events not drained yet, power of two. */
+    UM_NODE_MAX_RAMPS = 8,            /* Float glides running at once on a node. */
+    UM_EVENT_PENDING_CAPACITY = 1024, /* Drained events waiting for their block. */
+    UM_EVENT_BLOCK_CAPACITY = 256,    /* Events per block, the rest go to the next one. */
+    UM_AUTOMATION_MAX_CURVES = 64,
+};
+
+typedef struct um_params um_params;
+
+/* Events of a node in the current block, sorted by frame. */
+typedef struct {
+    const umugu_event *events;
+    int count;
+    int next;
+    int64_t clock; /* Frame of the block start. */
+} um_event_cursor;
+
+um_params *um_params_create(umugu_ctx *ctx);
+/* Tables by node for pipelines of up to capacity nodes (not while processing). */
+void um_params_reserve(umugu_ctx *ctx, int capacity);
+/* Pipeline the thread safe calls (umugu_event_push, umugu_attrib_set) check the events
+ * against, published atomically. NULL publishes a copy of ctx->pipeline (control thread,
+ * not while processing); the audio thread publishes the pipeline of the region it swaps
+ * in, which does not change until it is collected. */
+void um_params_publish(umugu_ctx *ctx, const umugu_pipeline *pipeline);
+/* Audio thread, before processing a block of frames: collects its events and applies
+ * the ones of the nodes without UMUGU_NODE_EVENTS. */
+void um_params_apply(umugu_ctx *ctx, int frames);
+/* Audio thread, after processing the block: moves the ramps and the clock forward. */
+void um_params_advance(umugu_ctx *ctx, int frames);
+/* Audio thread: drops the ramps and pending events (they refer to the nodes of a
+ * pipeline that has been swapped out). */
+void um_params_reset(umugu_ctx *ctx);
+
+/* Glide of a float attribute of the node from the block frame: returns the per frame
+ * increment, value is the one before that frame and frames the ones left of the ramp (0
+ * if it is not ramping). Nodes that do not ask see the value change once per block. */
+float um_param_ramp(
+    const umugu_ctx *ctx, const umugu_node *node, const float *param, int frame, float *value,
+    int *frames);
+
+/* UMUGU_NODE_EVENTS nodes render the block in segments:
+ *     um_event_cursor c = um_node_events(ctx, node);
+ *     for (int from = 0, n; (n = um_event_segment(ctx, &c, from, frames, &at, &k)); from += n)
+ * Every call applies the attribute events at from (notes are for the node, in at) and
+ * returns the frames until the next event or the end of the block. */
+um_event_cursor um_node_events(umugu_ctx *ctx, const umugu_node *node);
+int um_event_segment(
+    umugu_ctx *ctx, um_event_cursor *c, int from, int frames, const umugu_event **at,
+    int *at_count);
+
+/* ## PIPELINE SWAP ## */
+
+typedef struct um_swap um_swap;
+
+/* Reserves the two pipeline regions of umugu_pipeline_swap. */
+um_swap *um_swap_create(umugu_ctx *ctx, size_t region_size);
+/* Audio thread, at the start of the block: takes the staged pipeline (once the previous
+ * one has faded out) and processes the one fading out. */
+void um_swap_process(umugu_ctx *ctx, int frames);
+/* Audio thread, after processing the block: hands back the pipeline faded out. */
+void um_swap_advance(umugu_ctx *ctx, int frames);
+/* Output node: keeps the output of the pipeline fading out (returns true, nothing has
+ * to be written) and mixes it into the one of the new pipeline (src is replaced). */
+bool um_swap_output(umugu_ctx *ctx, const float **src, int channels, int frames);
+/* Releases every pipeline that is not the current one (unload). */
+void um_swap_release(umugu_ctx *ctx);
+
+/* ## NODE TYPE REGISTRY ## */
+
+typedef struct um_registry um_registry;
+
+#define UM_REGISTRY_MISSING (-1) /* Neither built in nor a plug, see um_registry_missing. */
+#define UM_REGISTRY_UNKNOWN (-2) /* Not looked for yet. */
+
+um_registry *um_registry_create(umugu_ctx *ctx);
+/* The entries of src (same node info capacity) for a context sharing its node infos. */
+void um_registry_copy(um_registry *dst, const um_registry *src);
+/* Index in ctx->nodes_info of the node type, or UM_REGISTRY_MISSING/UNKNOWN. Read only,
+ * any thread. */
+int um_registry_find(const umugu_ctx *ctx, const umugu_name *name);
+/* Indexes ctx->nodes_info[info_idx] (see um_node_info_add). Only the thread appending
+ * node types writes. */
+void um_registry_add(umugu_ctx *ctx, int info_idx);
+/* The name will be found as UM_REGISTRY_MISSING (while there is room for it). */
+void um_registry_missing(umugu_ctx *ctx, const umugu_name *name);
+
+/* ## METRICS ## */
+
+typedef struct um_metrics um_metrics;
+
+um_metrics *um_metrics_create(umugu_ctx *ctx);
+/* Tables by node for pipelines of up to capacity nodes (not while processing, the
+ * readers can keep reading). */
+void um_metrics_reserve(umugu_ctx *ctx, int capacity);
+/* Thread processing the step: accounts its time in the current window. */
+void um_metrics_node(umugu_ctx *ctx, int node_idx, um_nanosec elapsed);
+/* Audio thread: the pipeline fading out after a swap is not measured, its node indices
+ * are not the ones of ctx->pipeline. */
+void um_metrics_pause(umugu_ctx *ctx, bool paused);
+/* Audio thread, after processing a block of frames (every step is done): accounts its
+ * time and publishes the snapshot when the window is complete. */
+void um_metrics_block(umugu_ctx *ctx, um_nanosec elapsed, int frames);
+
+/* Processes the step s of the current plan measuring it. */
+static inline int
+um_step_process(umugu_ctx *ctx, int s)
+{
+    const umugu_plan *plan = &ctx->plan;
+    umugu_node *node = plan->exec_node[s];
+    UM_TRACE_ZONE_NAMED(ctx->nodes_info[node->info_idx].name.str);
+    const um_nanosec start = um_time_now();
+    const int err = plan->exec_process[s](ctx, node, UMUGU_NOFLAG);
+    um_metrics_node(ctx, plan->exec_node_idx[s], um_time_elapsed(start));
+    return err;
+}
+
 /* ## NOTES ## */
 
 float um_note_freq(int note_index);
@@ -379,9 +804,34 @@ typedef struct {
 
 typedef struct {
     umugu_node node;
-    umugu_signal wav;
+    int32_t voice_count;
+    int32_t waveform;
+    um_voices voices;
+} um_oscbank;
+
+enum {
+    UM_WAVPLAYER_MAX_CHANNELS = 8,
+    UM_WAVPLAYER_STREAM_FRAMES = 1 << 15, /* Minimum read ahead of the disk streams. */
+};
+
+/* Bigger files are streamed from disk instead of mapped. */
+#define UM_WAVPLAYER_MAP_MAX_BYTES ((int64_t)512 << 20)
+
+typedef struct {
+    umugu_node node;
+    umugu_signal wav; /* Data chunk of the mapped file, samples.frame_count is the total. */
     char filename[UMUGU_PATH_LEN];
-    void *file_handle;
+    void *map;
+    size_t map_size;
+    um_stream *stream; /* Instead of the mapping (streaming). */
+    int32_t position;  /* Next frame to play. */
+    int32_t seek;      /* Frame to jump to at the start of the next block, -1 if none. */
+    int32_t underruns; /* Blocks the stream could not fill in time. */
+    int32_t quality;   /* um_resample_quality when the file rate is not the pipeline one. */
+    um_resampler *resampler;
+    bool loop;
+    bool streaming;
+    int8_t padding[6];
 } um_wavplayer;
 
 typedef struct {
@@ -403,15 +853,65 @@ typedef struct {
     int8_t extra_pipe_in_channel[UMUGU_MIXER_MAX_INPUTS];
 } um_mixer;
 
+enum {
+    UM_CONVOLVER_MAX_CHANNELS = 2,
+    UM_CONVOLVER_MAX_PARTITION = 1 << 14,
+};
+
+/* Uniformly partitioned overlap-save convolution with an impulse response wav. Adds no
+ * latency when the callback frame count is a multiple of the partition size, otherwise
+ * the output is delayed by one partition. The spectra live in the persistent arena,
+ * allocated by the (non default) init. */
+typedef struct {
+    umugu_node node;
+    char filename[UMUGU_PATH_LEN];
+    int32_t partition_size;  /* Power of two. 0: the callback frame count. */
+    int32_t partition_count; /* Impulse response frames / partition size, rounded up. */
+    float gain;
+    int32_t channels; /* Convolved (output) channels. */
+    int32_t ir_channels;
+    int32_t fdl_head; /* Delay line slot of the newest input spectrum. */
+    int32_t fill;     /* Input frames buffered for the next partition. */
+    int32_t padding;
+    um_fft_plan *plan; /* 2 * partition_size real samples. */
+    /* Partition spectra (partition_size + 1 bins each), per channel. */
+    um_complex *ir;  /* Impulse response, scaled for the unnormalized inverse fft. */
+    um_complex *fdl; /* Frequency-domain delay line, a ring of input spectra. */
+    um_complex *acc;
+    float *window; /* Per channel: previous and current input partitions. */
+    float *out;    /* Per channel: last convolved partition. */
+    float *tmp;    /* 2 * partition_size. */
+} um_convolver;
+
+/* Converts the pipeline rate to the output device one. Placed before the Output node, it
+ * makes umugu_process run the rest of the pipeline with the frames it needs as input. */
+typedef struct {
+    umugu_node node;
+    int32_t quality; /* um_resample_quality. */
+    int32_t out_rate;
+    um_resampler *resampler; /* NULL when the rates match (passthrough). */
+} um_resample;
+
 typedef struct {
     umugu_node node;
 } um_output;
 
+/* Layout conversion inserted by the pipeline compiler between nodes that expect different
+ * layouts (UMUGU_NODE_INTERLEAVED), it can also be placed by hand. */
+typedef struct {
+    umugu_node node;
+    bool interleaved; /* Output layout, the input can have any. */
+} um_layout;
+
 umugu_node_func um_oscil_getfn(umugu_fn fn);
+umugu_node_func um_oscbank_getfn(umugu_fn fn);
 umugu_node_func um_wavplayer_getfn(umugu_fn fn);
 umugu_node_func um_amplitude_getfn(umugu_fn fn);
 umugu_node_func um_limiter_getfn(umugu_fn fn);
 umugu_node_func um_mixer_getfn(umugu_fn fn);
+umugu_node_func um_convolver_getfn(umugu_fn fn);
+umugu_node_func um_resample_getfn(umugu_fn fn);
 umugu_node_func um_output_getfn(umugu_fn fn);
+umugu_node_func um_layout_getfn(umugu_fn fn);
 
 #endif /* __UMUGU_INTERNAL_H__ */
@@ -5,27 +5,33 @@
 
 #ifndef UMUGU_DEBUG
 
-static int
-umugu_node_print(umugu_node *node)
+/* Same signatures as the debug ones, so the callers build with every profile. */
+static inline int
+umugu_node_print(umugu_ctx *ctx, umugu_node *node)
 {
+    (void)ctx;
+    (void)node;
     return UMUGU_NOOP;
 }
 
-static int
-umugu_pipeline_print(void)
+static inline int
+umugu_pipeline_print(umugu_ctx *ctx)
 {
+    (void)ctx;
     return UMUGU_NOOP;
 }
 
-static int
-umugu_mem_arena_print(void)
+static inline int
+umugu_mem_arena_print(umugu_ctx *ctx)
 {
+    (void)ctx;
     return UMUGU_NOOP;
 }
 
-static int
-umugu_out_signal_print(void)
+static inline int
+umugu_out_signal_print(umugu_ctx *ctx)
 {
+    (void)ctx;
     return UMUGU_NOOP;
 }
 
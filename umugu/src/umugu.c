@@ -4,11 +4,16 @@
 
 #include <dlfcn.h>
 #include <math.h>
-#include <stdio.h> /* pipeline import/export fwrite and fread */
+#include <stdio.h> /* pipeline export fwrite */
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+#include <fcntl.h> /* wav file mapping */
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #define UMUGU_CONFIG_MAP_SIZE 32
 #define UMUGU_CONFIG_VALUE_LEN 32 // Average value length for string storage buffer size.
 
@@ -36,6 +41,10 @@ static const bool UM_DEFAULT_INTERLEAVED_CHANNELS = true;
 typedef struct um_confmap um_confmap;
 static const umugu_node_type_info *um_node_info_builtin_find(const umugu_name *name);
 static int um_load_config(umugu_ctx *ctx, const char *filename);
+static void um_plan_bind_slots(umugu_ctx *ctx);
+static int um_node_gather_inputs(umugu_ctx *ctx, const umugu_node *node, uint16_t *out);
+static int um_node_max_inputs(umugu_ctx *ctx, const umugu_node *node);
+static int um_pipeline_reserve(umugu_ctx *ctx, int node_count);
 static int um_confmap_insert(um_confmap *cm, const umugu_name *key, const char *value, size_t len);
 static const char *um_confmap_get(const um_confmap *cm, const umugu_name *key);
 
@@ -44,24 +53,30 @@ um_node_info_load(umugu_ctx *ctx, const umugu_name *name)
 {
     UMUGU_ASSERT(ctx && name);
     UM_TRACE_ZONE();
-    /* Check if the node info is already loaded. */
-    for (int i = 0; i < ctx->nodes_info_next; ++i) {
-        if (um_name_equals(&ctx->nodes_info[i].name, name)) {
-            return ctx->nodes_info + i;
-        }
+    /* Check if the node info is already loaded, or known to be missing. */
+    const int idx = um_registry_find(ctx, name);
+    if (idx >= 0) {
+        return ctx->nodes_info + idx;
+    }
+    if (idx == UM_REGISTRY_MISSING) {
+        return NULL;
     }
 
     /* Look for it in the built-in nodes. */
     const umugu_node_type_info *bi_info = um_node_info_builtin_find(name);
     if (bi_info) {
         /* Add the node info to the current context. */
-        UMUGU_ASSERT(ctx->nodes_info_next < UMUGU_DEFAULT_NODE_INFO_CAPACITY);
-        umugu_node_type_info *info = &ctx->nodes_info[ctx->nodes_info_next++];
-        memcpy(info, bi_info, sizeof(umugu_node_type_info));
+        const int added = um_node_info_add(ctx, bi_info);
+        if (added < 0) {
+            ctx->io.log(
+                "Node type %s not loaded: umugu_config.node_info_capacity (%d) reached.\n",
+                name->str, ctx->nodes_info_capacity);
+            return NULL;
+        }
 #ifdef UMUGU_VERBOSE
         ctx->io.log("Built-in node %s loaded.\n", name->str);
 #endif
-        return info;
+        return ctx->nodes_info + added;
     }
 
     /* Check if there's a plug with that name and load it. */
@@ -70,8 +85,11 @@ um_node_info_load(umugu_ctx *ctx, const umugu_name *name)
         return ctx->nodes_info + ret;
     }
 
-    /* Node info not found. */
-    UMUGU_ASSERT(ret == UMUGU_ERR_PLUG);
+    /* Node info not found, the next lookups do not try to plug it again. */
+    UMUGU_ASSERT(ret == UMUGU_ERR_PLUG || ret == UMUGU_ERR_FULL_STORAGE);
+    if (ret == UMUGU_ERR_PLUG) {
+        um_registry_missing(ctx, name);
+    }
     ctx->io.log("Node type %s not found.\n", name->str);
     return NULL;
 }
@@ -104,18 +122,43 @@ umugu_load(const umugu_config *cfg)
     ctx->state = UMUGU_STATE_LOADING;
 
     ctx->arena_head = cfg->arena;
-    ctx->arena_tail = ctx->arena_head + sizeof(umugu_ctx);
     ctx->arena_capacity = cfg->arena_size;
-    ctx->arena_pers_end = ctx->arena_tail;
+    ctx->arena_pers_end = um_align_ptr(ctx->arena_head + sizeof(umugu_ctx), UM_ARENA_ALIGN);
+    ctx->arena_tail = ctx->arena_pers_end;
+    ctx->arena_high_water = ctx->arena_pers_end - ctx->arena_head;
+    ctx->arena_overflows = 0;
+    ctx->arena_it_overflows = 0;
 
     ctx->io.in_audio = (umugu_signal){.samples = {.channel_count = 0}};
     ctx->io.out_audio = um_signal_default();
     ctx->ppln_iterations = 0;
     ctx->ppln_it_allocated = 0;
-
+    ctx->stream_underruns = 0;
+    ctx->resampler = NULL;
+    ctx->frame_clock = 0;
+    ctx->out_frames = 0;
+    ctx->plan = (umugu_plan){.steps = NULL, .step_count = 0, .step_capacity = 0};
+    ctx->pipeline = (umugu_pipeline){.nodes = NULL, .node_count = 0, .node_capacity = 0};
+    /* Node and step indices are 16 bit, output slots signed. Grown by the pipelines loaded. */
+    ctx->pipeline_capacity = um_mini(um_maxi(cfg->pipeline_capacity, 0), INT16_MAX);
+    ctx->nodes_info_capacity =
+        cfg->node_info_capacity > 0 ? cfg->node_info_capacity : UMUGU_DEFAULT_NODE_INFO_CAPACITY;
+    ctx->nodes_info = um_allocprs(ctx, ctx->nodes_info_capacity * sizeof(umugu_node_type_info));
+    ctx->nodes_info_next = 0;
+    ctx->registry = um_registry_create(ctx);
+
+    ctx->kernels = um_kernels_select();
+    ctx->params = um_params_create(ctx);
+    ctx->metrics = um_metrics_create(ctx);
+    UM_TRACE_PLOT_CONFIG("Arena persistent", TracyPlotFormatMemory, true, true, 0);
+    UM_TRACE_PLOT_CONFIG("Arena per block", TracyPlotFormatMemory, false, true, 0);
     ctx->io.log = cfg->log_fn;
     ctx->io.fatal = cfg->fatal_err_fn;
     ctx->io.file_read = cfg->load_file_fn;
+    ctx->swap = NULL;
+    ctx->workers = NULL;
+    /* Compiling inserts Layout nodes on the audio thread, which only looks types up. */
+    um_node_info_load(ctx, &(umugu_name){"Layout"});
 
     int err = um_load_config(ctx, cfg->config_file);
     if (err != UMUGU_SUCCESS) {
@@ -126,11 +169,20 @@ umugu_load(const umugu_config *cfg)
         um_pipeline_generate(ctx, cfg->fallback_ppln, cfg->fallback_ppln_node_count);
     }
 
+    if (cfg->pipeline_region_size > 0) {
+        ctx->swap = um_swap_create(ctx, cfg->pipeline_region_size);
+    }
+
+    if (cfg->worker_count > 0) {
+        ctx->workers = um_exec_pool_create(ctx, cfg->worker_count, cfg->worker_rt_priority);
+    }
+
     ctx->init_time_ns = um_time_elapsed(init_time);
     ctx->state = UMUGU_STATE_IDLE;
 
 #ifdef UMUGU_VERBOSE
     ctx->io.log("Umugu initialized in %ldns\n", ctx->init_time_ns);
+    ctx->io.log("Sample kernels: %s.\n", ctx->kernels->isa);
 #endif
 
     return ctx;
@@ -145,8 +197,17 @@ umugu_unload(umugu_ctx *ctx)
     }
 
     ctx->state = UMUGU_STATE_UNLOADING;
-    for (int i = 0; i < ctx->pipeline.node_count; ++i) {
-        um_node_dispatch(ctx, ctx->pipeline.nodes[i], UMUGU_FN_RELEASE, UMUGU_NOFLAG);
+    um_exec_pool_destroy(ctx->workers);
+    ctx->workers = NULL;
+
+    for (int i = 0; i < ctx->plan.step_count; ++i) {
+        const umugu_exec_step *step = &ctx->plan.steps[i];
+        if (step->release) {
+            step->release(ctx, ctx->plan.exec_node[i], UMUGU_NOFLAG);
+        }
+    }
+    if (ctx->swap) {
+        um_swap_release(ctx);
     }
 
     for (int i = 0; i < ctx->nodes_info_next; ++i) {
@@ -164,41 +225,94 @@ umugu_process(umugu_ctx *ctx, size_t frames)
     UM_TRACE_FRAME_MARK;
     UM_TRACE_ZONE();
     UMUGU_ASSERT(ctx);
+    const um_nanosec start = um_time_now();
+    um_arena_frame_begin(ctx);
     ctx->pipeline.sig.samples.frame_count = frames;
-    ctx->state = UMUGU_STATE_PROCESSING;
+    ctx->out_frames = frames;
 
-    if (!ctx->ppln_iterations) {
-        for (int i = 0; i < ctx->pipeline.node_count; ++i) {
-            umugu_node *node = ctx->pipeline.nodes[i];
-            int err = um_node_dispatch(ctx, node, UMUGU_FN_INIT, UMUGU_NOFLAG);
-            if (err < UMUGU_SUCCESS) {
-                ctx->io.log(
-                    "Error (%d) initializing node:\n"
-                    "\tIndex: %d.\n\tName: %s\n",
-                    err, i, ctx->nodes_info[node->info_idx].name);
-            }
-        }
+    /* The plan is built out of the audio thread (um_pipeline_init), a pipeline changed
+     * since or that did not compile is not processed. */
+    if (ctx->plan.step_count != ctx->pipeline.node_count) {
+        ctx->state = UMUGU_STATE_IDLE;
+        return UMUGU_ERR_GRAPH;
     }
 
     ctx->ppln_iterations++;
-    ctx->ppln_it_allocated = 0;
 
-    for (int i = 0; i < ctx->pipeline.node_count; ++i) {
-        umugu_node *node = ctx->pipeline.nodes[i];
-        int err = um_node_dispatch(ctx, node, UMUGU_FN_PROCESS, UMUGU_NOFLAG);
+    /* A swapped in pipeline replaces ctx->pipeline and ctx->plan from here on. */
+    if (ctx->swap) {
+        um_swap_process(ctx, frames);
+    }
+
+    /* With a Resampler node the pipeline runs at its own rate, only the last node produces
+     * the requested frames. */
+    if (ctx->resampler) {
+        ctx->pipeline.sig.samples.frame_count =
+            um_resampler_input_frames(ctx->resampler, frames);
+    }
+
+    um_params_apply(ctx, ctx->pipeline.sig.samples.frame_count);
+
+    ctx->state = UMUGU_STATE_PROCESSING;
+    um_plan_run(ctx);
+
+    um_params_advance(ctx, ctx->pipeline.sig.samples.frame_count);
+    if (ctx->swap) {
+        um_swap_advance(ctx, frames);
+    }
+    ctx->state = UMUGU_STATE_IDLE;
+    const int err = um_arena_frame_end(ctx);
+    ctx->ppln_process_time_ns = um_time_elapsed(start);
+    um_metrics_block(ctx, ctx->ppln_process_time_ns, frames);
+    UM_TRACE_PLOTI("Arena persistent", ctx->arena_pers_end - ctx->arena_head);
+    UM_TRACE_PLOTI("Arena per block", ctx->ppln_it_allocated);
+    return err;
+}
+
+void
+um_plan_run(umugu_ctx *ctx)
+{
+    UM_TRACE_ZONE();
+    const int step_count = ctx->plan.step_count;
+    um_plan_bind_slots(ctx);
+
+    if (ctx->workers && step_count > 1) {
+        int err = um_exec_pool_process(ctx->workers);
+        if (err < UMUGU_SUCCESS) {
+            ctx->io.log("Error (%d) processing the pipeline in parallel.\n", err);
+        }
+        return;
+    }
+
+    for (int i = 0; i < step_count; ++i) {
+        int err = um_step_process(ctx, i);
         if (err < UMUGU_SUCCESS) {
             UMUGU_TRAP();
             ctx->io.log(
                 "Error (%d) processing node:\n"
                 "\tIndex: %d.\n\tName: %s\n",
-                err, i, ctx->nodes_info[node->info_idx].name);
+                err, i, ctx->nodes_info[ctx->plan.exec_node[i]->info_idx].name.str);
         }
     }
-
-    ctx->state = UMUGU_STATE_IDLE;
-    return UMUGU_SUCCESS;
 }
 
+#ifdef UMUGU_DEBUG
+/* Debug layout of a temporary allocation: a header line, the data filled with poison and a
+ * guard from its end (padding included) through one more line, checked by
+ * um_arena_frame_end. */
+#define UM_ARENA_TMP_MAGIC 0x504D5455 /* "UTMP" */
+#define UM_ARENA_POISON 0xFF         /* NaN floats. */
+#define UM_ARENA_GUARD 0xA5
+#define UM_ARENA_DEBUG_BYTES (2 * UM_ARENA_ALIGN)
+
+typedef struct {
+    uint32_t magic;
+    uint64_t bytes;
+} um_arena_tmp_header;
+#else
+#define UM_ARENA_DEBUG_BYTES 0
+#endif
+
 void *
 um_allocprs(umugu_ctx *ctx, size_t bytes)
 {
@@ -217,18 +331,20 @@ um_allocprs(umugu_ctx *ctx, size_t bytes)
             "allocations expand the buffer stealing space from that buffer.");
     }
 
+    /* pers_end stays aligned, every allocation takes whole cache lines. */
     uint8_t *ret = ctx->arena_pers_end;
+    const size_t size = um_align_up(bytes, UM_ARENA_ALIGN);
     register const uint8_t *const arena_end = ctx->arena_head + ctx->arena_capacity;
-    if ((ret + bytes) > arena_end) {
+    if ((ret + size) > arena_end) {
         UMUGU_ASSERT(0 && "Fatal error: Persistent alloc failed. No space left in the arena.");
         ctx->io.fatal(
             UMUGU_ERR_MEM, "Fatal error: Persistent alloc failed. No space left in the arena.\n",
             __FILE__, __LINE__);
         UMUGU_TRAP();
     }
-    ctx->arena_pers_end += bytes;
+    ctx->arena_pers_end += size;
     ctx->arena_tail = ctx->arena_pers_end;
-    UMUGU_ASSERT(ctx->arena_pers_end < arena_end);
+    UMUGU_ASSERT(ctx->arena_pers_end <= arena_end);
     return ret;
 }
 
@@ -245,28 +361,103 @@ um_alloctmp(umugu_ctx *ctx, size_t bytes)
             " you can not use the stack in this situation?\n");
     }
 
-    UMUGU_ASSERT(ctx->arena_tail >= ctx->arena_pers_end);
-    UMUGU_ASSERT(ctx->arena_tail <= (ctx->arena_head + ctx->arena_capacity));
     register const uint8_t *const arena_end = ctx->arena_head + ctx->arena_capacity;
-
-    uint8_t *ret = ctx->arena_tail;
-    if ((ret + bytes) > arena_end) {
-        /* Arena limit reached, wrap back after the last persistent region. */
-        ret = ctx->arena_pers_end;
-        if ((ret + bytes) > arena_end) {
-            UMUGU_ASSERT(0 && "Fatal error: Temporal alloc failed. No space left in the arena.");
-            ctx->io.fatal(
-                UMUGU_ERR_MEM, "Fatal error: Temporal alloc failed. No space left in the arena.\n",
-                __FILE__, __LINE__);
-            UMUGU_TRAP();
+    const size_t size = um_align_up(bytes, UM_ARENA_ALIGN) + UM_ARENA_DEBUG_BYTES;
+
+    /* Nodes processed by the parallel executor allocate concurrently, so the tail is
+     * claimed with a CAS. It is uncontended when processing serially. */
+    uint8_t *ret;
+    bool wrapped;
+    uint8_t *tail = __atomic_load_n(&ctx->arena_tail, __ATOMIC_RELAXED);
+    do {
+        UMUGU_ASSERT(tail >= ctx->arena_pers_end && tail <= arena_end);
+        ret = tail;
+        wrapped = (ret + size) > arena_end;
+        if (wrapped) {
+            /* Arena limit reached, wrap back after the last persistent region overwriting
+             * the first allocations of the iteration. umugu_process reports it. */
+            ret = ctx->arena_pers_end;
+            if ((ret + size) > arena_end) {
+                UMUGU_ASSERT(0 && "Fatal error: Temporal alloc failed. No space left in the arena.");
+                ctx->io.fatal(
+                    UMUGU_ERR_MEM,
+                    "Fatal error: Temporal alloc failed. No space left in the arena.\n", __FILE__,
+                    __LINE__);
+                UMUGU_TRAP();
+            }
         }
+    } while (!__atomic_compare_exchange_n(
+        &ctx->arena_tail, &tail, ret + size, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    if (wrapped) {
+        __atomic_add_fetch(&ctx->arena_it_overflows, 1, __ATOMIC_RELAXED);
     }
+    __atomic_add_fetch(&ctx->ppln_it_allocated, size, __ATOMIC_RELAXED);
 
-    ctx->arena_tail = ret + bytes;
-    ctx->ppln_it_allocated += bytes;
+#ifdef UMUGU_DEBUG
+    um_arena_tmp_header *header = (um_arena_tmp_header *)ret;
+    header->magic = UM_ARENA_TMP_MAGIC;
+    header->bytes = bytes;
+    ret += UM_ARENA_ALIGN;
+    memset(ret, UM_ARENA_POISON, bytes);
+    memset(ret + bytes, UM_ARENA_GUARD, size - UM_ARENA_ALIGN - bytes);
+#endif
     return ret;
 }
 
+void
+um_arena_frame_begin(umugu_ctx *ctx)
+{
+    ctx->arena_tail = ctx->arena_pers_end;
+    ctx->ppln_it_allocated = 0;
+    ctx->arena_it_overflows = 0;
+}
+
+int
+um_arena_frame_end(umugu_ctx *ctx)
+{
+    UM_TRACE_ZONE();
+    const int64_t persistent = ctx->arena_pers_end - ctx->arena_head;
+    const int64_t available = ctx->arena_capacity - persistent;
+    const int64_t used =
+        persistent + (ctx->ppln_it_allocated < available ? ctx->ppln_it_allocated : available);
+    if (used > ctx->arena_high_water) {
+        ctx->arena_high_water = used;
+    }
+
+    if (ctx->arena_it_overflows) {
+        ctx->arena_overflows++;
+        ctx->io.log(
+            "[ERR] Arena: %ld bytes of temporary allocations in an iteration,"
+            " only %ld available.\n",
+            (long)ctx->ppln_it_allocated, (long)available);
+        return UMUGU_ERR_MEM;
+    }
+
+#ifdef UMUGU_DEBUG
+    /* Without wraps the allocations of the iteration are contiguous from pers_end. */
+    for (const uint8_t *it = ctx->arena_pers_end; it < ctx->arena_tail;) {
+        const um_arena_tmp_header *header = (const um_arena_tmp_header *)it;
+        const uint8_t *data = it + UM_ARENA_ALIGN;
+        bool intact = header->magic == UM_ARENA_TMP_MAGIC &&
+                      header->bytes <= (uint64_t)(ctx->arena_tail - data);
+        const uint8_t *end =
+            intact ? data + um_align_up(header->bytes, UM_ARENA_ALIGN) + UM_ARENA_ALIGN : it;
+        for (const uint8_t *g = data + header->bytes; intact && g < end; ++g) {
+            intact = *g == UM_ARENA_GUARD;
+        }
+        if (!intact) {
+            ctx->io.log(
+                "[ERR] Arena: temporary allocation at offset %ld written out of bounds.\n",
+                (long)(it - ctx->arena_head));
+            return UMUGU_ERR_MEM;
+        }
+        it = end;
+    }
+#endif
+    return UMUGU_SUCCESS;
+}
+
 float *
 um_alloc_samples(umugu_ctx *ctx, umugu_samples *s)
 {
@@ -275,6 +466,9 @@ um_alloc_samples(umugu_ctx *ctx, umugu_samples *s)
     UMUGU_ASSERT(s->channel_count > 0 && s->channel_count < 32 && "Invalid number of channels.");
     s->frame_count = ctx->pipeline.sig.samples.frame_count;
     UMUGU_ASSERT(s->frame_count > 0);
+    if (s->channel_count <= s->channel_capacity) {
+        return s->samples; /* Slot assigned by the plan for this iteration. */
+    }
     s->samples = um_alloctmp(ctx, s->frame_count * sizeof(s->samples[0]) * s->channel_count);
     return s->samples;
 }
@@ -301,219 +495,1403 @@ um_node_dispatch(umugu_ctx *ctx, umugu_node *node, umugu_fn fn, umugu_fn_flags f
     return func ? func(ctx, node, flags) : UMUGU_ERR_NULL;
 }
 
-/* SERIALIZATION */
-#define UMUGU_HEAD_CODE 0x00454549
-#define UMUGU_FOOT_CODE 0x00555541
+/* SERIALIZATION
+ * Pipeline files are relocatable: a section table locates the node types, their fields,
+ * the node records, the graph edges and the parameter blob, every section aligned so the
+ * mapped file is read in place. The blob holds the nodes as they are laid out in the
+ * exporting arena with only the attribs written (buffers, handles and internal state are
+ * zeroed and rebuilt by the node init). The fields describe those attribs by name, type,
+ * count and offset: when every node type still has the same layout the blob is copied to
+ * the arena at once, otherwise the fields are mapped by name to the loaded attribs once
+ * per type and each node is copied field by field over its defaults. Host endianness. */
+#define UM_PPLN_MAGIC 0x4C50554D /* "MUPL" */
+#define UM_PPLN_FORMAT 3
+#define UM_PPLN_ALIGN 64      /* Sections. */
+#define UM_PPLN_NODE_ALIGN UM_NODE_ALIGN /* Nodes in the blob, kept in the arena. */
+
+enum {
+    UM_PPLN_SECTION_TYPES,  /* um_ppln_type. */
+    UM_PPLN_SECTION_FIELDS, /* um_ppln_field, grouped by type. */
+    UM_PPLN_SECTION_NODES,  /* um_ppln_node. */
+    UM_PPLN_SECTION_EDGES,  /* um_ppln_edge, grouped by node. */
+    UM_PPLN_SECTION_BLOB,   /* Node parameters. */
+    UM_PPLN_SECTION_COUNT
+};
+
+typedef struct {
+    uint32_t offset; /* From the file start. */
+    uint32_t bytes;
+    uint32_t count; /* Entries. */
+    uint32_t padding;
+} um_ppln_section;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t format;
+    uint16_t section_count;
+    int32_t version; /* UMUGU_VERSION of the exporter. */
+    uint32_t file_bytes;
+    um_ppln_section sections[UM_PPLN_SECTION_COUNT];
+} um_ppln_header;
+
+typedef struct {
+    umugu_name name;
+    uint32_t size_bytes; /* Of the exported nodes. */
+    uint16_t field_first;
+    uint16_t field_count;
+} um_ppln_type;
+
+/* Attrib of the exported node type. */
+typedef struct {
+    umugu_name name;
+    uint32_t offset; /* In the exported nodes. */
+    uint16_t type;
+    uint16_t count;
+} um_ppln_field;
+
+typedef struct {
+    uint16_t type; /* Index in the types section. */
+    uint16_t prev_node;
+    uint16_t edge_first;
+    uint16_t edge_count;
+    uint32_t offset; /* In the blob. */
+    int8_t input_channel;
+    int8_t padding[3];
+} um_ppln_node;
+
+/* The output of input is read by node (prev_node or UMUGU_ATTR_INPUT attribs). */
+typedef struct {
+    uint16_t node;
+    uint16_t input;
+} um_ppln_edge;
+
+/* Field of the file to the attrib of the loaded node type. */
+typedef struct {
+    uint32_t src; /* Offset in the exported node. */
+    uint32_t dst; /* Offset in the loaded node. */
+    uint32_t count;
+    uint32_t dst_count; /* The rest of a TEXT attrib is cleared. */
+    uint8_t src_type;
+    uint8_t dst_type;
+} um_ppln_copy;
+
+static inline uint32_t
+um_ppln_align(uint32_t bytes, uint32_t align)
+{
+    return (bytes + align - 1) & ~(align - 1);
+}
+
+/* Parameters: the attribs that are not outputs of the node. */
+static inline bool
+um_ppln_serialized(const umugu_attrib_info *attr)
+{
+    return !(attr->flags & (UMUGU_ATTR_RDONLY | UMUGU_ATTR_PLOTLINE)) && attr->count > 0 &&
+           attr->type > UMUGU_TYPE_VOID && attr->type < UMUGU_TYPE_BIT;
+}
+
+/* Copies the serialized attribs of the node. */
+static void
+um_ppln_node_params(const umugu_node_type_info *info, const umugu_node *node, uint8_t *dst)
+{
+    memset(dst, 0, info->size_bytes);
+    for (int i = 0; i < info->attrib_count; ++i) {
+        const umugu_attrib_info *attr = &info->attribs[i];
+        if (um_ppln_serialized(attr)) {
+            const int bytes = um_type_sizeof(attr->type) * attr->count;
+            memcpy(dst + attr->offset_bytes, UM_PTR(node, attr->offset_bytes),
+                   um_mini(bytes, info->size_bytes - attr->offset_bytes));
+        }
+    }
+}
+
+static bool
+um_ppln_write(FILE *f, const void *data, size_t bytes, uint32_t *pos, uint32_t align)
+{
+    static const uint8_t zeros[UM_PPLN_ALIGN];
+    const uint32_t padding = um_ppln_align(*pos, align) - *pos;
+    *pos += padding + bytes;
+    return fwrite(zeros, 1, padding, f) == padding &&
+           (!bytes || fwrite(data, 1, bytes, f) == bytes);
+}
+
+int
+umugu_pipeline_export(umugu_ctx *ctx, const char *filename)
+{
+    UM_TRACE_ZONE();
+    const int node_count = ctx->pipeline.node_count;
+    const int info_count = ctx->nodes_info_next;
+    int edge_capacity = 0;
+    int field_capacity = 0;
+    int32_t params_bytes = 0;
+    for (int i = 0; i < node_count; ++i) {
+        const umugu_node_type_info *info = &ctx->nodes_info[ctx->pipeline.nodes[i]->info_idx];
+        edge_capacity += um_node_max_inputs(ctx, ctx->pipeline.nodes[i]);
+        params_bytes = um_maxi(params_bytes, info->size_bytes);
+    }
+    for (int t = 0; t < info_count; ++t) {
+        field_capacity += ctx->nodes_info[t].attrib_count;
+    }
+
+    /* The tables are temporaries (from the end of the last block ones), released when
+     * written: exporting takes no stack by node count. */
+    uint8_t *const tail = ctx->arena_tail;
+    const int32_t overflows = ctx->arena_it_overflows;
+    int16_t *type_of = um_alloctmp(ctx, info_count * sizeof(int16_t)); /* By node info. */
+    const umugu_node_type_info **infos = um_alloctmp(ctx, info_count * sizeof(infos[0]));
+    um_ppln_type *types = um_alloctmp(ctx, info_count * sizeof(um_ppln_type));
+    um_ppln_field *fields = um_alloctmp(ctx, field_capacity * sizeof(um_ppln_field));
+    um_ppln_node *nodes = um_alloctmp(ctx, node_count * sizeof(um_ppln_node));
+    um_ppln_edge *edges = um_alloctmp(ctx, edge_capacity * sizeof(um_ppln_edge));
+    uint16_t *inputs = um_alloctmp(ctx, edge_capacity * sizeof(uint16_t));
+    uint8_t *params = um_alloctmp(ctx, params_bytes);
+    if (ctx->arena_it_overflows != overflows) {
+        ctx->arena_tail = tail;
+        ctx->io.log("Error: no room in the arena for exporting the pipeline.\n");
+        return UMUGU_ERR_MEM;
+    }
+
+    memset(type_of, 0xFF, info_count * sizeof(int16_t));
+    int type_count = 0;
+    int field_count = 0;
+    int edge_count = 0;
+    uint32_t blob_bytes = 0;
+
+    for (int i = 0; i < node_count; ++i) {
+        const umugu_node *n = ctx->pipeline.nodes[i];
+        const umugu_node_type_info *info = &ctx->nodes_info[n->info_idx];
+        if (type_of[n->info_idx] < 0) {
+            const int t = type_count++;
+            type_of[n->info_idx] = t;
+            infos[t] = info;
+            types[t] = (um_ppln_type){
+                .name = info->name, .size_bytes = info->size_bytes, .field_first = field_count};
+            for (int a = 0; a < info->attrib_count; ++a) {
+                field_count += um_ppln_serialized(&info->attribs[a]);
+            }
+            types[t].field_count = field_count - types[t].field_first;
+        }
+        const int type = type_of[n->info_idx];
+
+        const int input_count = um_node_gather_inputs(ctx, n, inputs + edge_count);
+        for (int e = 0; e < input_count; ++e) {
+            edges[edge_count + e] = (um_ppln_edge){.node = i, .input = inputs[edge_count + e]};
+        }
+
+        blob_bytes = um_ppln_align(blob_bytes, UM_PPLN_NODE_ALIGN);
+        nodes[i] = (um_ppln_node){
+            .type = type,
+            .prev_node = n->prev_node,
+            .edge_first = edge_count,
+            .edge_count = input_count,
+            .offset = blob_bytes,
+            .input_channel = n->input_channel};
+        edge_count += input_count;
+        blob_bytes += info->size_bytes;
+    }
+
+    for (int t = 0, f = 0; t < type_count; ++t) {
+        for (int a = 0; a < infos[t]->attrib_count; ++a) {
+            const umugu_attrib_info *attr = &infos[t]->attribs[a];
+            if (um_ppln_serialized(attr)) {
+                fields[f++] = (um_ppln_field){
+                    .name = attr->name,
+                    .offset = attr->offset_bytes,
+                    .type = attr->type,
+                    .count = attr->count};
+            }
+        }
+    }
+
+    um_ppln_header h = {
+        .magic = UM_PPLN_MAGIC,
+        .format = UM_PPLN_FORMAT,
+        .section_count = UM_PPLN_SECTION_COUNT,
+        .version = UMUGU_VERSION};
+    const uint32_t counts[UM_PPLN_SECTION_COUNT] = {
+        type_count, field_count, node_count, edge_count, blob_bytes};
+    const uint32_t sizes[UM_PPLN_SECTION_COUNT] = {
+        sizeof(um_ppln_type), sizeof(um_ppln_field), sizeof(um_ppln_node),
+        sizeof(um_ppln_edge), 1};
+    uint32_t pos = sizeof(h);
+    for (int s = 0; s < UM_PPLN_SECTION_COUNT; ++s) {
+        pos = um_ppln_align(pos, UM_PPLN_ALIGN);
+        h.sections[s] = (um_ppln_section){
+            .offset = pos, .bytes = counts[s] * sizes[s], .count = counts[s]};
+        pos += h.sections[s].bytes;
+    }
+    h.file_bytes = pos;
+
+    FILE *f = fopen(filename, "wb");
+    if (!f) {
+        ctx->arena_tail = tail;
+        ctx->io.log("Error: fopen('wb') failed with filename %s\n", filename);
+        return UMUGU_ERR_FILE;
+    }
+
+    pos = 0;
+    bool ok = um_ppln_write(f, &h, sizeof(h), &pos, 1) &&
+              um_ppln_write(f, types, sizeof(um_ppln_type) * type_count, &pos, UM_PPLN_ALIGN) &&
+              um_ppln_write(f, fields, sizeof(um_ppln_field) * field_count, &pos, UM_PPLN_ALIGN) &&
+              um_ppln_write(f, nodes, sizeof(um_ppln_node) * node_count, &pos, UM_PPLN_ALIGN) &&
+              um_ppln_write(f, edges, sizeof(um_ppln_edge) * edge_count, &pos, UM_PPLN_ALIGN) &&
+              um_ppln_write(f, NULL, 0, &pos, UM_PPLN_ALIGN);
+    for (int i = 0; ok && i < node_count; ++i) {
+        const umugu_node *n = ctx->pipeline.nodes[i];
+        const umugu_node_type_info *info = &ctx->nodes_info[n->info_idx];
+        um_ppln_node_params(info, n, params);
+        ok = um_ppln_write(f, params, info->size_bytes, &pos, UM_PPLN_NODE_ALIGN);
+    }
+
+    ctx->arena_tail = tail;
+    if (fclose(f) || !ok) {
+        ctx->io.log("Error: couldn't write the pipeline file %s\n", filename);
+        return UMUGU_ERR_FILE;
+    }
+    return UMUGU_SUCCESS;
+}
+
+/* The section exists in the file and its entries are entry_bytes each. */
+static bool
+um_ppln_section_valid(const um_ppln_header *h, int section, uint32_t entry_bytes)
+{
+    const um_ppln_section *s = &h->sections[section];
+    return !(s->offset % UM_PPLN_ALIGN) && s->offset >= sizeof(um_ppln_header) &&
+           s->offset <= h->file_bytes && s->bytes <= h->file_bytes - s->offset &&
+           (uint64_t)s->count * entry_bytes == s->bytes;
+}
+
+static inline bool
+um_ppln_numeric(int type)
+{
+    return type != UMUGU_TYPE_TEXT && type > UMUGU_TYPE_VOID && type < UMUGU_TYPE_BIT;
+}
+
+static double
+um_ppln_value_load(const void *src, int type)
+{
+    union {
+        float f;
+        double d;
+        int8_t i8;
+        int16_t i16;
+        int32_t i32;
+        int64_t i64;
+        uint8_t u8;
+        uint16_t u16;
+        uint32_t u32;
+        uint64_t u64;
+        bool b;
+    } v;
+    memcpy(&v, src, um_type_sizeof(type));
+    switch (type) {
+    case UMUGU_TYPE_FLOAT:
+        return v.f;
+    case UMUGU_TYPE_DOUBLE:
+        return v.d;
+    case UMUGU_TYPE_INT8:
+        return v.i8;
+    case UMUGU_TYPE_INT16:
+        return v.i16;
+    case UMUGU_TYPE_INT32:
+        return v.i32;
+    case UMUGU_TYPE_INT64:
+        return v.i64;
+    case UMUGU_TYPE_UINT8:
+        return v.u8;
+    case UMUGU_TYPE_UINT16:
+        return v.u16;
+    case UMUGU_TYPE_UINT32:
+        return v.u32;
+    case UMUGU_TYPE_UINT64:
+        return v.u64;
+    default:
+        return v.b;
+    }
+}
+
+static void
+um_ppln_value_store(void *dst, int type, double value)
+{
+    switch (type) {
+    case UMUGU_TYPE_FLOAT:
+        *(float *)dst = value;
+        break;
+    case UMUGU_TYPE_DOUBLE:
+        *(double *)dst = value;
+        break;
+    case UMUGU_TYPE_INT8:
+        *(int8_t *)dst = value;
+        break;
+    case UMUGU_TYPE_INT16:
+        *(int16_t *)dst = value;
+        break;
+    case UMUGU_TYPE_INT32:
+        *(int32_t *)dst = value;
+        break;
+    case UMUGU_TYPE_INT64:
+        *(int64_t *)dst = value;
+        break;
+    case UMUGU_TYPE_UINT8:
+        *(uint8_t *)dst = value;
+        break;
+    case UMUGU_TYPE_UINT16:
+        *(uint16_t *)dst = value;
+        break;
+    case UMUGU_TYPE_UINT32:
+        *(uint32_t *)dst = value;
+        break;
+    case UMUGU_TYPE_UINT64:
+        *(uint64_t *)dst = value;
+        break;
+    default:
+        *(bool *)dst = value != 0.0;
+        break;
+    }
+}
+
+/* Maps the fields of an exported type to the attribs of the loaded one, by name. Returns
+ * the number of copies, or UMUGU_BADIDX if a field does not fit in the exported nodes or
+ * an attrib in the loaded ones. */
+static int
+um_ppln_map_type(
+    umugu_ctx *ctx, const um_ppln_type *type, const um_ppln_field *fields,
+    const umugu_node_type_info *info, um_ppln_copy *copies)
+{
+    int count = 0;
+    for (int a = 0; a < info->attrib_count; ++a) {
+        const umugu_attrib_info *attr = &info->attribs[a];
+        if (!um_ppln_serialized(attr)) {
+            continue;
+        }
+
+        const um_ppln_field *field = NULL;
+        for (int f = 0; f < type->field_count && !field; ++f) {
+            field = um_name_equals(&fields[f].name, &attr->name) ? &fields[f] : NULL;
+        }
+        const int same = field && field->type == attr->type;
+        if (!field || (!same && !(um_ppln_numeric(field->type) && um_ppln_numeric(attr->type)))) {
+#ifdef UMUGU_VERBOSE
+            ctx->io.log(
+                "Import pipeline: %s attrib %s not in the file or of another type, default "
+                "kept.\n",
+                info->name.str, attr->name.str);
+#endif
+            continue;
+        }
+        if (field->offset + (uint64_t)field->count * um_type_sizeof(field->type) >
+            type->size_bytes) {
+            ctx->io.log("Import pipeline error: Bad binary format.\n");
+            return UMUGU_BADIDX;
+        }
+        if (attr->count < 1 ||
+            attr->offset_bytes + (uint64_t)attr->count * um_type_sizeof(attr->type) >
+                (uint64_t)info->size_bytes) {
+            ctx->io.log(
+                "Import pipeline error: %s attrib %s out of the node.\n", info->name.str,
+                attr->name.str);
+            return UMUGU_BADIDX;
+        }
+
+        copies[count++] = (um_ppln_copy){
+            .src = field->offset,
+            .dst = attr->offset_bytes,
+            .count = um_mini(field->count, attr->count),
+            .dst_count = attr->count,
+            .src_type = field->type,
+            .dst_type = attr->type};
+    }
+    return count;
+}
+
+/* Copies the mapped fields of an exported node over the defaults of a loaded one. */
+static void
+um_ppln_copy_fields(uint8_t *node, const uint8_t *src, const um_ppln_copy *copies, int count)
+{
+    for (int c = 0; c < count; ++c) {
+        const um_ppln_copy *cp = &copies[c];
+        if (cp->src_type == cp->dst_type) {
+            const int size = um_type_sizeof(cp->dst_type);
+            memcpy(node + cp->dst, src + cp->src, cp->count * size);
+            if (cp->dst_type == UMUGU_TYPE_TEXT) {
+                memset(node + cp->dst + cp->count, 0, cp->dst_count - cp->count);
+                node[cp->dst + cp->dst_count - 1] = '\0';
+            }
+            continue;
+        }
+
+        const int src_size = um_type_sizeof(cp->src_type);
+        const int dst_size = um_type_sizeof(cp->dst_type);
+        for (uint32_t i = 0; i < cp->count; ++i) {
+            um_ppln_value_store(
+                node + cp->dst + i * dst_size, cp->dst_type,
+                um_ppln_value_load(src + cp->src + i * src_size, cp->src_type));
+        }
+    }
+}
+
+/* Node type of an exported one, loaded if needed. */
+static const umugu_node_type_info *
+um_ppln_type_info(umugu_ctx *ctx, const um_ppln_type *type)
+{
+    umugu_name name = {0};
+    memcpy(name.str, type->name.str, UMUGU_NAME_LEN - 1);
+    return um_node_info_load(ctx, &name);
+}
+
+/* Builds the nodes of the validated file in the buffer: the defaults of the loaded node
+ * type (the state that is not in the file) with the mapped fields of the file. Unchanged
+ * types just copy every field as is. The tables are by type, copy_first of one more. */
+static int
+um_ppln_build(
+    umugu_ctx *ctx, const uint8_t *file, const umugu_node_type_info **infos,
+    um_ppln_copy *copies, int *copy_first, uint8_t *buffer)
+{
+    const um_ppln_header *h = (const um_ppln_header *)file;
+    const um_ppln_type *types = (const void *)(file + h->sections[UM_PPLN_SECTION_TYPES].offset);
+    const um_ppln_field *fields =
+        (const void *)(file + h->sections[UM_PPLN_SECTION_FIELDS].offset);
+    const um_ppln_node *nodes = (const void *)(file + h->sections[UM_PPLN_SECTION_NODES].offset);
+    const um_ppln_edge *edges = (const void *)(file + h->sections[UM_PPLN_SECTION_EDGES].offset);
+    const uint8_t *blob = file + h->sections[UM_PPLN_SECTION_BLOB].offset;
+    const int type_count = h->sections[UM_PPLN_SECTION_TYPES].count;
+    const int node_count = h->sections[UM_PPLN_SECTION_NODES].count;
+
+    /* Field mapping of every type, the copies of type t start at copy_first[t]. */
+    copy_first[0] = 0;
+    for (int t = 0; t < type_count; ++t) {
+        infos[t] = um_ppln_type_info(ctx, &types[t]);
+        const int count = um_ppln_map_type(
+            ctx, &types[t], &fields[types[t].field_first], infos[t], &copies[copy_first[t]]);
+        if (count < 0) {
+            return UMUGU_ERR_FILE;
+        }
+        copy_first[t + 1] = copy_first[t] + count;
+    }
+
+    ctx->pipeline.node_count = node_count;
+    for (int i = 0, offset = 0; i < node_count; ++i) {
+        const int t = nodes[i].type;
+        offset = um_ppln_align(offset, UM_PPLN_NODE_ALIGN);
+        umugu_node *node = (umugu_node *)(buffer + offset);
+        offset += infos[t]->size_bytes;
+        memset(node, 0, infos[t]->size_bytes);
+        node->info_idx = infos[t] - ctx->nodes_info;
+        um_node_dispatch(ctx, node, UMUGU_FN_INIT, UMUGU_FN_INIT_DEFAULTS);
+        um_ppln_copy_fields(
+            (uint8_t *)node, blob + nodes[i].offset, &copies[copy_first[t]],
+            copy_first[t + 1] - copy_first[t]);
+        ctx->pipeline.nodes[i] = node;
+    }
+
+    for (int i = 0; i < node_count; ++i) {
+        umugu_node *node = ctx->pipeline.nodes[i];
+        /* The node types of the exporting context could have been loaded in another order. */
+        node->info_idx = infos[nodes[i].type] - ctx->nodes_info;
+        node->prev_node = nodes[i].prev_node;
+        node->input_channel = nodes[i].input_channel;
+    }
+
+    /* The wiring read through the loaded attribs has to be the exported one. */
+    for (int i = 0; i < node_count; ++i) {
+        uint16_t inputs[um_node_max_inputs(ctx, ctx->pipeline.nodes[i])];
+        const int input_count = um_node_gather_inputs(ctx, ctx->pipeline.nodes[i], inputs);
+        bool same = input_count == nodes[i].edge_count;
+        for (int e = 0; same && e < input_count; ++e) {
+            const um_ppln_edge *edge = &edges[nodes[i].edge_first + e];
+            same = edge->node == i && edge->input == inputs[e];
+        }
+        if (!same) {
+            ctx->io.log("Import pipeline error: inputs of node %d do not match.\n", i);
+            return UMUGU_ERR_FILE;
+        }
+    }
+    return UMUGU_SUCCESS;
+}
+
+/* Builds the pipeline of the mapped file. */
+static int
+um_ppln_instantiate(umugu_ctx *ctx, const uint8_t *file, size_t file_bytes)
+{
+    UM_TRACE_ZONE();
+    const um_ppln_header *h = (const um_ppln_header *)file;
+    if (h->magic != UM_PPLN_MAGIC || h->format != UM_PPLN_FORMAT ||
+        h->section_count != UM_PPLN_SECTION_COUNT || h->file_bytes != file_bytes ||
+        !um_ppln_section_valid(h, UM_PPLN_SECTION_TYPES, sizeof(um_ppln_type)) ||
+        !um_ppln_section_valid(h, UM_PPLN_SECTION_FIELDS, sizeof(um_ppln_field)) ||
+        !um_ppln_section_valid(h, UM_PPLN_SECTION_NODES, sizeof(um_ppln_node)) ||
+        !um_ppln_section_valid(h, UM_PPLN_SECTION_EDGES, sizeof(um_ppln_edge)) ||
+        !um_ppln_section_valid(h, UM_PPLN_SECTION_BLOB, 1)) {
+        ctx->io.log("Import pipeline error: Bad binary format.\n");
+        return UMUGU_ERR_FILE;
+    }
+
+#ifdef UMUGU_VERBOSE
+    if (h->version != UMUGU_VERSION) {
+        ctx->io.log(
+            "Imported file's version %d, current %d: attribs mapped by name.\n", h->version,
+            UMUGU_VERSION);
+    }
+#endif
+
+    const um_ppln_type *types = (const void *)(file + h->sections[UM_PPLN_SECTION_TYPES].offset);
+    const um_ppln_node *nodes = (const void *)(file + h->sections[UM_PPLN_SECTION_NODES].offset);
+    const um_ppln_section *blob = &h->sections[UM_PPLN_SECTION_BLOB];
+    const int type_count = h->sections[UM_PPLN_SECTION_TYPES].count;
+    const int field_count = h->sections[UM_PPLN_SECTION_FIELDS].count;
+    const int node_count = h->sections[UM_PPLN_SECTION_NODES].count;
+    const int edge_count = h->sections[UM_PPLN_SECTION_EDGES].count;
+    if (um_pipeline_reserve(ctx, node_count) < UMUGU_SUCCESS) {
+        ctx->io.log("Import pipeline error: %d nodes do not fit.\n", node_count);
+        return UMUGU_ERR_FULL_STORAGE;
+    }
+    if (type_count > node_count || type_count > ctx->nodes_info_capacity) {
+        ctx->io.log("Import pipeline error: Bad binary format.\n");
+        return UMUGU_ERR_FILE;
+    }
+
+    /* Every type is loaded before the nodes are sized. */
+    int copy_capacity = 0;
+    for (int t = 0; t < type_count; ++t) {
+        const umugu_node_type_info *info = um_ppln_type_info(ctx, &types[t]);
+        if (!info || types[t].field_first + types[t].field_count > field_count) {
+            return UMUGU_ERR_FILE;
+        }
+        copy_capacity += info->attrib_count;
+    }
+
+    uint32_t buffer_bytes = 0;
+    for (int i = 0; i < node_count; ++i) {
+        const um_ppln_node *n = &nodes[i];
+        if (n->type >= type_count || n->offset % UM_PPLN_NODE_ALIGN ||
+            n->offset > blob->bytes || types[n->type].size_bytes > blob->bytes - n->offset ||
+            n->edge_first + n->edge_count > edge_count) {
+            ctx->io.log("Import pipeline error: Bad binary format.\n");
+            return UMUGU_ERR_FILE;
+        }
+        buffer_bytes = um_ppln_align(buffer_bytes, UM_PPLN_NODE_ALIGN);
+        buffer_bytes += um_ppln_type_info(ctx, &types[n->type])->size_bytes;
+    }
+    uint8_t *buffer = um_allocprs(ctx, buffer_bytes);
+
+    /* The tables by type are temporaries (after the node buffer, which is persistent),
+     * released once the nodes are built: importing takes no stack by file contents. */
+    uint8_t *const tail = ctx->arena_tail;
+    const int32_t overflows = ctx->arena_it_overflows;
+    const umugu_node_type_info **infos = um_alloctmp(ctx, type_count * sizeof(infos[0]));
+    um_ppln_copy *copies = um_alloctmp(ctx, copy_capacity * sizeof(um_ppln_copy));
+    int *copy_first = um_alloctmp(ctx, (type_count + 1) * sizeof(int));
+    if (ctx->arena_it_overflows != overflows) {
+        ctx->arena_tail = tail;
+        ctx->io.log("Error: no room in the arena for importing the pipeline.\n");
+        return UMUGU_ERR_MEM;
+    }
+    const int err = um_ppln_build(ctx, file, infos, copies, copy_first, buffer);
+    ctx->arena_tail = tail;
+    return err;
+}
+
+int
+umugu_pipeline_import(umugu_ctx *ctx, const char *filename)
+{
+    UM_TRACE_ZONE();
+    const int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        ctx->io.log("Error: open failed with filename %s\n", filename);
+        return UMUGU_ERR_FILE;
+    }
+
+    struct stat st;
+    void *file = MAP_FAILED;
+    if (!fstat(fd, &st) && st.st_size >= (off_t)sizeof(um_ppln_header)) {
+        file = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (file == MAP_FAILED) {
+        ctx->io.log("Import pipeline error: Bad binary format.\n");
+        return UMUGU_ERR_FILE;
+    }
+
+    int err = um_ppln_instantiate(ctx, file, st.st_size);
+    munmap(file, st.st_size);
+    if (err < UMUGU_SUCCESS) {
+        ctx->pipeline.node_count = 0;
+        return err;
+    }
+    return um_pipeline_init(ctx);
+}
+
+int
+um_node_plug(umugu_ctx *ctx, const umugu_name *name)
+{
+    UM_TRACE_ZONE();
+    char buf[1024] = {"lib"};
+    strncpy(&buf[3], name->str, UMUGU_NAME_LEN);
+    char *it = &buf[2];
+    while (*++it) {
+    }
+    it[0] = '.';
+    it[1] = 's';
+    it[2] = 'o';
+    it[3] = '\0';
+    // snprintf(buf, 1024, "lib%s.so", name->str);
+    printf("Trying to load plug %s\n", buf);
+
+    if (ctx->nodes_info_next >= ctx->nodes_info_capacity) {
+        ctx->io.log(
+            "Plug %s not loaded: umugu_config.node_info_capacity (%d) reached.\n", name->str,
+            ctx->nodes_info_capacity);
+        return UMUGU_ERR_FULL_STORAGE;
+    }
+    void *hnd = dlopen(buf, RTLD_NOW);
+    if (!hnd) {
+        ctx->io.log("Can't load plug: dlopen(%s) failed.", buf);
+        return UMUGU_ERR_PLUG;
+    }
+
+    umugu_node_type_info info = {.name = *name};
+    *(void **)&info.getfn = dlsym(hnd, "getfn");
+    info.size_bytes = *(int32_t *)dlsym(hnd, "size");
+    info.attribs = *(umugu_attrib_info **)dlsym(hnd, "attribs");
+    info.attrib_count = *(int32_t *)dlsym(hnd, "attrib_count");
+    const umugu_node_flags *flags = dlsym(hnd, "flags");
+    info.flags = flags ? *flags : UMUGU_NODE_FLAG_NONE;
+    info.plug_handle = hnd;
+
+#ifdef UMUGU_VERBOSE
+    ctx->io.log("Node plugged successfuly: %s\n", name->str);
+#endif
+    return um_node_info_add(ctx, &info);
+}
+
+int
+um_node_info_add(umugu_ctx *ctx, const umugu_node_type_info *info)
+{
+    const int idx = ctx->nodes_info_next;
+    if (idx >= ctx->nodes_info_capacity) {
+        return UMUGU_ERR_FULL_STORAGE;
+    }
+    ctx->nodes_info[idx] = *info;
+    um_registry_add(ctx, idx);
+    __atomic_store_n(&ctx->nodes_info_next, idx + 1, __ATOMIC_RELEASE);
+    return idx;
+}
+
+void
+um_node_unplug(umugu_node_type_info *info)
+{
+    if (info && info->plug_handle) {
+        dlclose(info->plug_handle);
+        memset(info, 0, sizeof(*info));
+    }
+}
+
+int
+um_pipeline_generate(umugu_ctx *ctx, const umugu_name *node_names, int node_count)
+{
+    UM_TRACE_ZONE();
+    UMUGU_ASSERT(ctx);
+    UMUGU_ASSERT(ctx->pipeline.node_count == 0);
+    if (um_pipeline_reserve(ctx, node_count) < UMUGU_SUCCESS) {
+        ctx->io.log("[ERR] Pipeline: %d nodes do not fit.\n", node_count);
+        return UMUGU_ERR_FULL_STORAGE;
+    }
+    ctx->pipeline.node_count = node_count;
+
+    int info_indices[node_count > 0 ? node_count : 1];
+    size_t pipeline_size = 0;
+
+    for (int i = 0; i < node_count; ++i) {
+        const umugu_node_type_info *ni = um_node_info_load(ctx, &node_names[i]);
+        if (!ni) {
+            ctx->io.log("Could not load node %s\n", node_names[i].str);
+            if (i == 0) {
+                umugu_name fallback_generator = {.str = "Oscillator"};
+                ni = um_node_info_load(ctx, &fallback_generator);
+                if (!ni) {
+                    ctx->io.fatal(
+                        UMUGU_ERR,
+                        "Failed to create both, the specified node and the fallback (Oscillator).",
+                        __FILE__, __LINE__);
+                    UMUGU_TRAP();
+                }
+            } else if (i == (node_count - 1)) {
+                ctx->io.log("Ignoring it since it is the last.\n");
+                --node_count;
+                --ctx->pipeline.node_count;
+                break;
+            } else {
+                umugu_name fallback_node = {.str = "Amplitude"};
+                ni = um_node_info_load(ctx, &fallback_node);
+                if (!ni) {
+                    ctx->io.fatal(
+                        UMUGU_ERR,
+                        "Failed to create both, the specified node and the fallback (Amplitude).",
+                        __FILE__, __LINE__);
+                    UMUGU_TRAP();
+                }
+            }
+        }
+
+        UMUGU_ASSERT(ni);
+        info_indices[i] = ni - &ctx->nodes_info[0];
+        pipeline_size += um_align_up(ni->size_bytes, UM_NODE_ALIGN);
+    }
+
+    char *node_it = um_allocprs(ctx, pipeline_size);
+    memset(node_it, 0, pipeline_size);
+
+    for (int i = 0; i < node_count; ++i) {
+        umugu_node *n = (void *)node_it;
+        ctx->pipeline.nodes[i] = n;
+        n->info_idx = info_indices[i];
+        n->prev_node = i - 1;
+        um_node_dispatch(ctx, n, UMUGU_FN_INIT, UMUGU_FN_INIT_DEFAULTS);
+        node_it += um_align_up(ctx->nodes_info[n->info_idx].size_bytes, UM_NODE_ALIGN);
+    }
+    return um_pipeline_init(ctx);
+}
+
+/* Reads the node index stored at position i of an UMUGU_ATTR_INPUT attrib. */
+static inline int
+um_attrib_input_at(const umugu_node *node, const umugu_attrib_info *attr, int i)
+{
+    const void *data = UM_PTR(node, attr->offset_bytes);
+    switch (attr->type) {
+    case UMUGU_TYPE_INT16:
+        return ((const int16_t *)data)[i];
+    case UMUGU_TYPE_UINT16:
+        return ((const uint16_t *)data)[i];
+    default:
+        UMUGU_ASSERT(0 && "Input attribs must be INT16 or UINT16 node indices.");
+        return UMUGU_BADIDX;
+    }
+}
+
+/* Replaces every connection of the node from the node at index from by one from index to. */
+static void
+um_node_replace_input(umugu_ctx *ctx, umugu_node *node, int from, int to)
+{
+    const umugu_node_type_info *info = &ctx->nodes_info[node->info_idx];
+    if (node->prev_node == from) {
+        node->prev_node = to;
+    }
+
+    for (int a = 0; a < info->attrib_count; ++a) {
+        const umugu_attrib_info *attr = &info->attribs[a];
+        if (!(attr->flags & UMUGU_ATTR_INPUT)) {
+            continue;
+        }
+
+        void *data = UM_PTR(node, attr->offset_bytes);
+        for (int i = 0; i < attr->count; ++i) {
+            if (um_attrib_input_at(node, attr, i) != from) {
+                continue;
+            }
+            if (attr->type == UMUGU_TYPE_INT16) {
+                ((int16_t *)data)[i] = to;
+            } else {
+                ((uint16_t *)data)[i] = to;
+            }
+        }
+    }
+}
+
+/* Appends the node's inputs to out (deduplicated). Returns the number of inputs. */
+static int
+um_node_gather_inputs(umugu_ctx *ctx, const umugu_node *node, uint16_t *out)
+{
+    const int node_count = ctx->pipeline.node_count;
+    const umugu_node_type_info *info = &ctx->nodes_info[node->info_idx];
+    int count = 0;
+    if (node->prev_node != UMUGU_NO_INPUT && node->prev_node < node_count) {
+        out[count++] = node->prev_node;
+    }
+
+    for (int a = 0; a < info->attrib_count; ++a) {
+        const umugu_attrib_info *attr = &info->attribs[a];
+        if (!(attr->flags & UMUGU_ATTR_INPUT)) {
+            continue;
+        }
+
+        for (int i = 0; i < attr->count; ++i) {
+            int idx = um_attrib_input_at(node, attr, i);
+            if (idx < 0 || idx >= node_count) {
+                continue;
+            }
+            int dup = 0;
+            while (dup < count && out[dup] != idx) {
+                ++dup;
+            }
+            if (dup == count) {
+                out[count++] = idx;
+            }
+        }
+    }
+    return count;
+}
+
+static int
+um_node_max_inputs(umugu_ctx *ctx, const umugu_node *node)
+{
+    const umugu_node_type_info *info = &ctx->nodes_info[node->info_idx];
+    int count = 1; /* prev_node */
+    for (int a = 0; a < info->attrib_count; ++a) {
+        if (info->attribs[a].flags & UMUGU_ATTR_INPUT) {
+            count += info->attribs[a].count;
+        }
+    }
+    return count;
+}
+
+/* Arrays of um_pipeline_compile, allocated with the plan: compiling takes no stack by node
+ * count (it also runs in umugu_process) and compiling the same pipeline again (after the
+ * node inits or the layout conversions) allocates nothing. */
+typedef struct um_plan_scratch {
+    uint16_t *in_nodes;       /* Inputs of every node (CSR by in_first), of port_capacity. */
+    uint16_t *consumers;      /* Readers of every node (CSR by out_first), of port_capacity. */
+    int *in_first;            /* By node, of step_capacity + 1. */
+    int *out_first;           /* By node, of step_capacity + 1. */
+    int *pending;             /* Inputs not scheduled yet, by node. */
+    uint16_t *order;          /* Nodes in execution order. */
+    int *node_step;           /* By node, the fill cursor of consumers before that. */
+    int8_t *channels;         /* By node while negotiating, by step while assigning slots. */
+    int16_t (*converters)[2]; /* Layout node by producer and layout. */
+    umugu_node_flags *flags;  /* By step. */
+    uint64_t *ancestors;      /* Step sets (of words) by step: the ones it depends on. */
+    uint64_t *touch;          /* By step: the ones that could access its output. */
+    uint64_t *slot_touch;     /* By slot: the ones that could access its content. */
+    int words;
+} um_plan_scratch;
+
+/* Step sets of the slot assignment, words of 64 steps. */
+static inline void
+um_steps_set(uint64_t *set, int s)
+{
+    set[s / 64] |= 1ULL << (s % 64);
+}
+
+static inline bool
+um_steps_has(const uint64_t *set, int s)
+{
+    return set[s / 64] & (1ULL << (s % 64));
+}
+
+static inline void
+um_steps_or(uint64_t *dst, const uint64_t *src, int words)
+{
+    for (int w = 0; w < words; ++w) {
+        dst[w] |= src[w];
+    }
+}
+
+/* Any step of set that is not in done, nor is the step self (-1 for none). */
+static inline bool
+um_steps_any_but(const uint64_t *set, const uint64_t *done, int self, int words)
+{
+    for (int w = 0; w < words; ++w) {
+        uint64_t rest = set[w] & ~done[w];
+        if (self >= 0 && w == self / 64) {
+            rest &= ~(1ULL << (self % 64));
+        }
+        if (rest) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Output buffer lifetime analysis. The outputs of UMUGU_NODE_PLANNED_OUTPUT steps are
+ * packed in a few slots, reusing a slot as soon as its previous content is dead (like a
+ * register allocator does), and UMUGU_NODE_INPLACE steps write over their input.
+ * A slot is only reused by a step that depends on every step that could still access its
+ * previous content, so the assignment holds for the parallel executor too. */
+static void
+um_plan_assign_slots(umugu_ctx *ctx)
+{
+    UM_TRACE_ZONE();
+    umugu_plan *plan = &ctx->plan;
+    const int step_count = plan->step_count;
+    um_plan_scratch *scratch = plan->scratch;
+    const int words = scratch->words;
+    int8_t *channels = scratch->channels;
+    umugu_node_flags *flags = scratch->flags;
+#define UM_STEPS(SET, S) (scratch->SET + (size_t)(S) * words)
+
+    for (int s = 0; s < step_count; ++s) {
+        const umugu_exec_step *step = &plan->steps[s];
+        const umugu_node *node = plan->exec_node[s];
+        const uint16_t *ports = plan->ports + step->port_first;
+        uint64_t *ancestors = UM_STEPS(ancestors, s);
+        flags[s] = ctx->nodes_info[node->info_idx].flags;
+        memset(ancestors, 0, words * sizeof(uint64_t));
+        int8_t in_channels = 1;
+        for (int i = 0; i < step->port_count; ++i) {
+            um_steps_or(ancestors, UM_STEPS(ancestors, ports[i]), words);
+            um_steps_set(ancestors, ports[i]);
+            in_channels = in_channels > channels[ports[i]] ? in_channels : channels[ports[i]];
+        }
+        /* Nodes like Amplitude take the channel count of the input while processing. */
+        channels[s] =
+            node->out_pipe.channel_count > 0 ? node->out_pipe.channel_count : in_channels;
+    }
+
+    /* Steps that could access the output of s: itself, its readers and the readers of
+     * the ones not planned, since their out_pipe might be pointing to the same buffer. */
+    for (int s = step_count - 1; s >= 0; --s) {
+        const umugu_exec_step *step = &plan->steps[s];
+        const uint16_t *consumers = plan->consumers + step->consumer_first;
+        uint64_t *touch = UM_STEPS(touch, s);
+        memset(touch, 0, words * sizeof(uint64_t));
+        um_steps_set(touch, s);
+        for (int i = 0; i < step->consumer_count; ++i) {
+            if (flags[consumers[i]] & UMUGU_NODE_PLANNED_OUTPUT) {
+                um_steps_set(touch, consumers[i]);
+            } else {
+                um_steps_or(touch, UM_STEPS(touch, consumers[i]), words);
+            }
+        }
+    }
+
+    plan->slot_count = 0;
+    for (int s = 0; s < step_count; ++s) {
+        const umugu_exec_step *step = &plan->steps[s];
+        plan->exec_slot[s] = -1;
+        if (!(flags[s] & UMUGU_NODE_PLANNED_OUTPUT)) {
+            continue;
+        }
+
+        const int self = (flags[s] & UMUGU_NODE_INPLACE) && step->port_count == 1 ? s : -1;
+        int slot = -1;
+        for (int k = 0; k < plan->slot_count; ++k) {
+            const uint64_t *slot_touch = UM_STEPS(slot_touch, k);
+            if (um_steps_any_but(slot_touch, UM_STEPS(ancestors, s), self, words)) {
+                continue; /* Still alive. */
+            }
+            if (slot < 0 || (self >= 0 && um_steps_has(slot_touch, self))) {
+                slot = k; /* The input's slot is preferred: in place. */
+            }
+        }
+
+        if (slot < 0) {
+            slot = plan->slot_count++;
+            plan->slot_channels[slot] = 0;
+        }
+        /* Anything that depends on s also depends on the previous users of the slot. */
+        memcpy(UM_STEPS(slot_touch, slot), UM_STEPS(touch, s), words * sizeof(uint64_t));
+        if (plan->slot_channels[slot] < channels[s]) {
+            plan->slot_channels[slot] = channels[s];
+        }
+        plan->exec_slot[s] = slot;
+    }
+
+    /* Zero-copy output: the slot of the input of the only device output can be the device
+     * buffer. Its earlier users are ancestors and nobody uses it after (the output has no
+     * readers), but all of them have to fit in the channels of that input. */
+    plan->direct_slot = -1;
+    int device_outputs = 0;
+    for (int s = 0; s < step_count; ++s) {
+        const umugu_exec_step *step = &plan->steps[s];
+        if (!(flags[s] & UMUGU_NODE_DEVICE_OUTPUT)) {
+            continue;
+        }
+        const int in = step->port_count == 1 ? plan->ports[step->port_first] : -1;
+        const int slot = in >= 0 ? plan->exec_slot[in] : -1;
+        const bool fits = slot >= 0 && plan->slot_channels[slot] == channels[in];
+        plan->direct_slot = fits && !step->consumer_count ? slot : -1;
+        plan->direct_interleaved = fits && plan->exec_node[in]->out_pipe.interleaved;
+        device_outputs++;
+    }
+    if (device_outputs != 1) {
+        plan->direct_slot = -1;
+    }
+
+    /* First channel of every slot in the block pool, and their total. The direct slot goes
+     * after the others, it takes room only in the blocks it is not the device buffer. */
+    int first = 0;
+    for (int k = 0; k < plan->slot_count; ++k) {
+        plan->slot_first[k] = first;
+        first += k == plan->direct_slot ? 0 : plan->slot_channels[k];
+    }
+    plan->slot_first[plan->slot_count] = first;
+    if (plan->direct_slot >= 0) {
+        plan->slot_first[plan->direct_slot] = first;
+    }
+#undef UM_STEPS
+}
+
+/* New node array for a pipeline of node_count nodes, with room for a layout conversion of
+ * every node (node and step indices are 16 bit). The main context grows its tables by
+ * node to fit; a staging context (no tables, see umugu_pipeline_swap) can not grow the
+ * ones of the context it is swapped into, its pipeline_capacity is the limit. */
+static int
+um_pipeline_reserve(umugu_ctx *ctx, int node_count)
+{
+    UM_TRACE_ZONE();
+    const bool staging = !ctx->params;
+    const int limit = staging ? ctx->pipeline_capacity : INT16_MAX;
+    if (node_count < 0 || node_count > limit) {
+        return UMUGU_ERR_FULL_STORAGE;
+    }
+
+    const int capacity = um_mini(2 * node_count, limit);
+    if (!staging && capacity > ctx->pipeline_capacity) {
+        um_params_reserve(ctx, capacity);
+        um_metrics_reserve(ctx, capacity);
+        if (ctx->workers) {
+            um_exec_pool_reserve(ctx, ctx->workers, capacity);
+        }
+        ctx->pipeline_capacity = capacity;
+    }
+    ctx->pipeline.nodes = um_allocprs(ctx, capacity * sizeof(umugu_node *));
+    ctx->pipeline.node_capacity = capacity;
+    return UMUGU_SUCCESS;
+}
+
+/* Appends a Layout node converting the output of the producer node. Returns its index. */
+static int
+um_pipeline_insert_layout(umugu_ctx *ctx, int producer, bool interleaved)
+{
+    static const umugu_name layout_name = {"Layout"};
+    umugu_pipeline *ppln = &ctx->pipeline;
+    if (ppln->node_count >= ppln->node_capacity) {
+        ctx->io.log("Pipeline compile error: no room for the layout conversions.\n");
+        return UMUGU_ERR_FULL_STORAGE;
+    }
+
+    const umugu_node_type_info *info = um_node_info_load(ctx, &layout_name);
+    um_layout *conv = um_allocprs(ctx, info->size_bytes);
+    memset(conv, 0, info->size_bytes);
+    conv->node.info_idx = info - ctx->nodes_info;
+    conv->node.prev_node = producer;
+    conv->interleaved = interleaved;
+    const int idx = ppln->node_count++;
+    conv->node.idx = idx;
+    ppln->nodes[idx] = &conv->node;
+    return idx;
+}
+
+/* Layout negotiation, in execution order: nodes produce the layout of their type (planar
+ * unless UMUGU_NODE_INTERLEAVED) and UMUGU_NODE_ANY_LAYOUT ones the layout of their input.
+ * Multichannel inputs in a different layout than the one expected by their reader get a
+ * Layout node in between, shared by the readers of the same producer and layout.
+ * Returns the number of nodes inserted. */
+static int
+um_pipeline_negotiate(umugu_ctx *ctx)
+{
+    UM_TRACE_ZONE();
+    const int node_count = ctx->pipeline.node_count;
+    const um_plan_scratch *scratch = ctx->plan.scratch;
+    const uint16_t *order = scratch->order;
+    const uint16_t *in_nodes = scratch->in_nodes;
+    const int *in_first = scratch->in_first;
+    int8_t *channels = scratch->channels;
+    int16_t(*converters)[2] = scratch->converters; /* By producer and layout. */
+    memset(converters, 0xFF, node_count * sizeof(converters[0]));
+    int inserted = 0;
+
+    for (int s = 0; s < node_count; ++s) {
+        const int n = order[s];
+        umugu_node *node = ctx->pipeline.nodes[n];
+        const umugu_node_type_info *info = &ctx->nodes_info[node->info_idx];
+        int8_t in_channels = 1;
+        for (int e = in_first[n]; e < in_first[n + 1]; ++e) {
+            in_channels = um_maxi(in_channels, channels[in_nodes[e]]);
+        }
+        channels[n] = node->out_pipe.channel_count > 0 ? node->out_pipe.channel_count
+                                                       : in_channels;
+
+        if (info->getfn == um_layout_getfn) {
+            node->out_pipe.interleaved = ((um_layout *)node)->interleaved;
+            continue;
+        }
+        if (info->flags & UMUGU_NODE_ANY_LAYOUT) {
+            const umugu_node *input = um_node_get_input(ctx, node);
+            node->out_pipe.interleaved = input && input->out_pipe.interleaved;
+            continue;
+        }
 
-typedef struct {
-    int32_t header;
-    int32_t version;
-    int32_t node_count;
-} umugu_binary_header;
+        const bool interleaved = info->flags & UMUGU_NODE_INTERLEAVED;
+        node->out_pipe.interleaved = interleaved;
+        for (int e = in_first[n]; e < in_first[n + 1]; ++e) {
+            const int in = in_nodes[e];
+            if (channels[in] == 1 || ctx->pipeline.nodes[in]->out_pipe.interleaved == interleaved) {
+                continue; /* Mono signals are the same in both layouts. */
+            }
+            if (converters[in][interleaved] < 0) {
+                const int conv = um_pipeline_insert_layout(ctx, in, interleaved);
+                if (conv < 0) {
+                    return conv;
+                }
+                converters[in][interleaved] = conv;
+                inserted++;
+            }
+            um_node_replace_input(ctx, node, in, converters[in][interleaved]);
+        }
+    }
+    return inserted;
+}
 
-int
-umugu_pipeline_export(umugu_ctx *ctx, const char *filename)
+/* Arrays by step for plans of up to step_capacity steps and port_capacity inputs. */
+static void
+um_plan_reserve(umugu_ctx *ctx, int step_capacity, int port_capacity)
 {
     UM_TRACE_ZONE();
-    FILE *f = fopen(filename, "wb");
-    if (!f) {
-        ctx->io.log("Error: fopen('wb') failed with filename %s\n", filename);
-        return UMUGU_ERR_FILE;
+    umugu_plan *plan = &ctx->plan;
+    if (!plan->scratch) {
+        plan->scratch = um_allocprs(ctx, sizeof(um_plan_scratch));
+        memset(plan->scratch, 0, sizeof(um_plan_scratch));
     }
-
-    umugu_binary_header h = {
-        .header = UMUGU_HEAD_CODE,
-        .version = UMUGU_VERSION,
-        .node_count = ctx->pipeline.node_count};
-
-    fwrite(&h, sizeof(h), 1, f);
-
-    for (int i = 0; i < h.node_count; ++i) {
-        umugu_node *n = ctx->pipeline.nodes[i];
-        fwrite(&ctx->nodes_info[n->info_idx].name, sizeof(umugu_name), 1, f);
+    um_plan_scratch *scratch = plan->scratch;
+
+    if (step_capacity > plan->step_capacity) {
+        const int n = step_capacity;
+        plan->step_capacity = n;
+        plan->exec_process = um_allocprs(ctx, n * sizeof(umugu_node_func));
+        plan->exec_node = um_allocprs(ctx, n * sizeof(umugu_node *));
+        plan->exec_node_idx = um_allocprs(ctx, n * sizeof(uint16_t));
+        plan->exec_slot = um_allocprs(ctx, n * sizeof(int16_t));
+        plan->steps = um_allocprs(ctx, n * sizeof(umugu_exec_step));
+        plan->slot_channels = um_allocprs(ctx, n * sizeof(int8_t));
+        plan->slot_first = um_allocprs(ctx, (n + 1) * sizeof(int32_t));
+
+        scratch->in_first = um_allocprs(ctx, (n + 1) * sizeof(int));
+        scratch->out_first = um_allocprs(ctx, (n + 1) * sizeof(int));
+        scratch->pending = um_allocprs(ctx, n * sizeof(int));
+        scratch->order = um_allocprs(ctx, n * sizeof(uint16_t));
+        scratch->node_step = um_allocprs(ctx, n * sizeof(int));
+        scratch->channels = um_allocprs(ctx, n * sizeof(int8_t));
+        scratch->converters = um_allocprs(ctx, n * sizeof(scratch->converters[0]));
+        scratch->flags = um_allocprs(ctx, n * sizeof(umugu_node_flags));
+        scratch->words = n / 64 + 1;
+        const size_t set_bytes = (size_t)n * scratch->words * sizeof(uint64_t);
+        scratch->ancestors = um_allocprs(ctx, set_bytes);
+        scratch->touch = um_allocprs(ctx, set_bytes);
+        scratch->slot_touch = um_allocprs(ctx, set_bytes);
     }
 
-    for (int i = 0; i < h.node_count; ++i) {
-        umugu_node *n = ctx->pipeline.nodes[i];
-        fwrite(n, ctx->nodes_info[n->info_idx].size_bytes, 1, f);
+    if (port_capacity > plan->port_capacity) {
+        plan->port_capacity = port_capacity;
+        plan->ports = um_allocprs(ctx, port_capacity * sizeof(uint16_t));
+        plan->consumers = um_allocprs(ctx, port_capacity * sizeof(uint16_t));
+        scratch->in_nodes = um_allocprs(ctx, port_capacity * sizeof(uint16_t));
+        scratch->consumers = um_allocprs(ctx, port_capacity * sizeof(uint16_t));
     }
-
-    int32_t footer = UMUGU_FOOT_CODE;
-    fwrite(&footer, 4, 1, f);
-    fclose(f);
-    return UMUGU_SUCCESS;
 }
 
 int
-umugu_pipeline_import(umugu_ctx *ctx, const char *filename)
+um_pipeline_compile(umugu_ctx *ctx)
 {
     UM_TRACE_ZONE();
-    FILE *f = fopen(filename, "rb");
-    if (!f) {
-        ctx->io.log("Error: fopen('rb') failed with filename %s\n", filename);
-        return UMUGU_ERR_FILE;
+    UMUGU_ASSERT(ctx);
+    umugu_plan *plan = &ctx->plan;
+    const int node_count = ctx->pipeline.node_count;
+    if (!node_count) {
+        /* Nothing to schedule nor any array to size. */
+        plan->step_count = 0;
+        plan->port_count = 0;
+        plan->slot_count = 0;
+        plan->direct_slot = -1;
+        return UMUGU_SUCCESS;
     }
 
-    umugu_binary_header h;
+    int max_ports = 0;
+    for (int i = 0; i < node_count; ++i) {
+        UMUGU_ASSERT(ctx->pipeline.nodes[i]->info_idx < ctx->nodes_info_next && "Node info not loaded.");
+        ctx->pipeline.nodes[i]->idx = i;
+        max_ports += um_node_max_inputs(ctx, ctx->pipeline.nodes[i]);
+    }
 
-    fread(&h, sizeof(h), 1, f);
+    /* Sized for the node capacity of the pipeline, every layout conversion inserted adds a
+     * node with one input. Each array of the execution table is contiguous, so the per
+     * block loop walks a few dense arrays. */
+    const int capacity = um_maxi(ctx->pipeline.node_capacity, node_count);
+    um_plan_reserve(ctx, capacity, max_ports + capacity - node_count);
+    plan->step_count = 0;
+    plan->port_count = 0;
+
+    um_plan_scratch *scratch = plan->scratch;
+    uint16_t *in_nodes = scratch->in_nodes;
+    uint16_t *consumers = scratch->consumers;
+    int *in_first = scratch->in_first;
+    int *out_first = scratch->out_first;
+    int *pending = scratch->pending;
+    uint16_t *order = scratch->order;
+    int *node_step = scratch->node_step;
+
+    int edge_count = 0;
+    memset(out_first, 0, (node_count + 1) * sizeof(int));
+    for (int i = 0; i < node_count; ++i) {
+        in_first[i] = edge_count;
+        pending[i] = um_node_gather_inputs(ctx, ctx->pipeline.nodes[i], in_nodes + edge_count);
+        for (int e = edge_count; e < edge_count + pending[i]; ++e) {
+            out_first[in_nodes[e] + 1]++;
+        }
+        edge_count += pending[i];
+    }
+    in_first[node_count] = edge_count;
 
-    if (h.header != UMUGU_HEAD_CODE) {
-        ctx->io.log("Import pipeline error: Bad binary format.\n");
-        fclose(f);
-        return UMUGU_ERR_FILE;
+    for (int i = 0; i < node_count; ++i) {
+        out_first[i + 1] += out_first[i];
     }
 
-    if (h.version != UMUGU_VERSION) {
-        ctx->io.log(
-            "Imported file's version mismatch. The format may have changed.\n"
-            "File: %d, Current: %d.\n",
-            h.version, UMUGU_VERSION);
+    int *fill = node_step;
+    memcpy(fill, out_first, node_count * sizeof(int));
+    for (int i = 0; i < node_count; ++i) {
+        for (int e = in_first[i]; e < in_first[i + 1]; ++e) {
+            consumers[fill[in_nodes[e]]++] = i;
+        }
     }
 
-    umugu_name names[h.node_count];
-    fread(&names, sizeof(umugu_name), h.node_count, f);
-    ctx->pipeline.node_count = h.node_count;
+    /* Kahn's algorithm. Ready nodes are queued by index so linear pipelines keep their order. */
+    int head = 0, tail = 0;
+    for (int i = 0; i < node_count; ++i) {
+        if (!pending[i]) {
+            order[tail++] = i;
+        }
+    }
 
-    size_t node_buffer_bytes = 0;
+    while (head < tail) {
+        const int n = order[head++];
+        for (int e = out_first[n]; e < out_first[n + 1]; ++e) {
+            if (!--pending[consumers[e]]) {
+                order[tail++] = consumers[e];
+            }
+        }
+    }
 
-    for (int i = 0; i < h.node_count; ++i) {
-        const umugu_node_type_info *ni = um_node_info_load(ctx, &names[i]);
-        /* Storing the offsets because I don't have the node_buffer yet. */
-        ctx->pipeline.nodes[i] = (void *)node_buffer_bytes;
-        node_buffer_bytes += ni->size_bytes;
+    if (tail != node_count) {
+        ctx->io.log("Pipeline compile error: the node connections have cycles.\n");
+        return UMUGU_ERR_GRAPH;
     }
 
-    char *node_buffer = um_allocprs(ctx, node_buffer_bytes);
+    /* The inserted layout conversions change the graph: schedule it again. */
+    const int inserted = um_pipeline_negotiate(ctx);
+    if (inserted < 0) {
+        return inserted;
+    }
+    if (inserted) {
+        return um_pipeline_compile(ctx);
+    }
 
-    for (int i = 0; i < h.node_count; ++i) {
-        /* Adding the buffer address to the previously cached offsets. */
-        ctx->pipeline.nodes[i] = (void *)((size_t)ctx->pipeline.nodes[i] + node_buffer);
+    for (int s = 0; s < node_count; ++s) {
+        node_step[order[s]] = s;
     }
 
-    fread(node_buffer, node_buffer_bytes, 1, f);
+    for (int s = 0; s < node_count; ++s) {
+        const int n = order[s];
+        umugu_node *node = ctx->pipeline.nodes[n];
+        const umugu_node_type_info *info = &ctx->nodes_info[node->info_idx];
+        umugu_exec_step *step = &plan->steps[s];
+        plan->exec_node[s] = node;
+        plan->exec_node_idx[s] = n;
+        plan->exec_process[s] = info->getfn(UMUGU_FN_PROCESS);
+        step->init = info->getfn(UMUGU_FN_INIT);
+        step->release = info->getfn(UMUGU_FN_RELEASE);
+        if (!plan->exec_process[s]) {
+            ctx->io.log(
+                "Pipeline compile error: node %d (%s) has no process func.\n", n, info->name.str);
+            return UMUGU_ERR_NULL;
+        }
 
-    int footer;
-    fread(&footer, 4, 1, f);
-    if (footer != UMUGU_FOOT_CODE) {
-        ctx->io.log("Import pipeline error: Bad binary format.\n");
-        fclose(f);
-        return UMUGU_ERR_FILE;
-    }
+        step->port_first = plan->port_count;
+        step->port_count = in_first[n + 1] - in_first[n];
+        for (int e = in_first[n]; e < in_first[n + 1]; ++e) {
+            plan->ports[plan->port_count++] = node_step[in_nodes[e]];
+        }
 
-    fclose(f);
+        /* Output lifetime: until the latest scheduled consumer runs. */
+        step->consumer_first = out_first[n];
+        step->consumer_count = out_first[n + 1] - out_first[n];
+        step->last_use = -1;
+        for (int e = out_first[n]; e < out_first[n + 1]; ++e) {
+            plan->consumers[e] = node_step[consumers[e]];
+            step->last_use = um_maxi(step->last_use, plan->consumers[e]);
+        }
+    }
 
-    for (int i = 0; i < ctx->pipeline.node_count; ++i) {
-        um_node_dispatch(ctx, ctx->pipeline.nodes[i], UMUGU_FN_INIT, UMUGU_NOFLAG);
+    plan->step_count = node_count;
+    um_plan_assign_slots(ctx);
+    if (ctx->params) {
+        um_params_publish(ctx, NULL); /* Staging contexts have no events. */
     }
     return UMUGU_SUCCESS;
 }
 
 int
-um_node_plug(umugu_ctx *ctx, const umugu_name *name)
+um_pipeline_init(umugu_ctx *ctx)
 {
     UM_TRACE_ZONE();
-    char buf[1024] = {"lib"};
-    strncpy(&buf[3], name->str, UMUGU_NAME_LEN);
-    char *it = &buf[2];
-    while (*++it) {
+    int err = um_pipeline_compile(ctx);
+    if (err < UMUGU_SUCCESS) {
+        return err;
     }
-    it[0] = '.';
-    it[1] = 's';
-    it[2] = 'o';
-    it[3] = '\0';
-    // snprintf(buf, 1024, "lib%s.so", name->str);
-    printf("Trying to load plug %s\n", buf);
 
-    assert(ctx->nodes_info_next < UMUGU_DEFAULT_NODE_INFO_CAPACITY);
-    void *hnd = dlopen(buf, RTLD_NOW);
-    if (!hnd) {
-        ctx->io.log("Can't load plug: dlopen(%s) failed.", buf);
-        return UMUGU_ERR_PLUG;
+    /* In execution order: the inputs of every node are initialized before it. */
+    for (int i = 0; i < ctx->plan.step_count; ++i) {
+        if (!ctx->plan.steps[i].init) {
+            continue;
+        }
+        umugu_node *node = ctx->plan.exec_node[i];
+        err = ctx->plan.steps[i].init(ctx, node, UMUGU_NOFLAG);
+        if (err < UMUGU_SUCCESS) {
+            ctx->io.log(
+                "Error (%d) initializing node:\n"
+                "\tIndex: %d.\n\tName: %s\n",
+                err, i, ctx->nodes_info[node->info_idx].name.str);
+        }
     }
 
-    umugu_node_type_info *info = &ctx->nodes_info[ctx->nodes_info_next++];
-    info->name = *name;
-    *(void **)&info->getfn = dlsym(hnd, "getfn");
-    info->size_bytes = *(int32_t *)dlsym(hnd, "size");
-    info->attribs = *(umugu_attrib_info **)dlsym(hnd, "attribs");
-    info->attrib_count = *(int32_t *)dlsym(hnd, "attrib_count");
-    info->plug_handle = hnd;
-
-#ifdef UMUGU_VERBOSE
-    ctx->io.log("Node plugged successfuly: %s\n", name->str);
-#endif
-    return ctx->nodes_info_next - 1;
+    /* Init can rewire the node inputs, schedule the definitive graph. */
+    return um_pipeline_compile(ctx);
 }
 
-void
-um_node_unplug(umugu_node_type_info *info)
+/* True if the device buffer has the layout of the direct slot this block: float in the same
+ * layout (any if mono), as many channels and frames, so the steps can write it as any other
+ * slot. */
+static inline bool
+um_plan_direct_output(const umugu_ctx *ctx)
 {
-    if (info && info->plug_handle) {
-        dlclose(info->plug_handle);
-        memset(info, 0, sizeof(*info));
-    }
+    const umugu_plan *plan = &ctx->plan;
+    const umugu_signal *out = &ctx->io.out_audio;
+    return plan->direct_slot >= 0 && out->samples.samples && out->format == UMUGU_TYPE_FLOAT &&
+           out->samples.channel_count == plan->slot_channels[plan->direct_slot] &&
+           (out->interleaved_channels == plan->direct_interleaved ||
+            out->samples.channel_count == 1) &&
+           out->samples.frame_count == ctx->pipeline.sig.samples.frame_count;
 }
 
-int
-um_pipeline_generate(umugu_ctx *ctx, const umugu_name *node_names, int node_count)
+static void
+um_plan_bind_slots(umugu_ctx *ctx)
 {
     UM_TRACE_ZONE();
-    UMUGU_ASSERT(ctx);
-    UMUGU_ASSERT(ctx->pipeline.node_count == 0);
-    ctx->pipeline.node_count = node_count;
-
-    int info_indices[64];
-    size_t pipeline_size = 0;
-
-    for (int i = 0; i < node_count; ++i) {
-        const umugu_node_type_info *ni = um_node_info_load(ctx, &node_names[i]);
-        if (!ni) {
-            ctx->io.log("Could not load node %s\n", node_names[i].str);
-            if (i == 0) {
-                umugu_name fallback_generator = {.str = "Oscillator"};
-                ni = um_node_info_load(ctx, &fallback_generator);
-                if (!ni) {
-                    ctx->io.fatal(
-                        UMUGU_ERR,
-                        "Failed to create both, the specified node and the fallback (Oscillator).",
-                        __FILE__, __LINE__);
-                    UMUGU_TRAP();
-                }
-            } else if (i == (node_count - 1)) {
-                ctx->io.log("Ignoring it since it is the last.\n");
-                --node_count;
-                --ctx->pipeline.node_count;
-                break;
-            } else {
-                umugu_name fallback_node = {.str = "Amplitude"};
-                ni = um_node_info_load(ctx, &fallback_node);
-                if (!ni) {
-                    ctx->io.fatal(
-                        UMUGU_ERR,
-                        "Failed to create both, the specified node and the fallback (Amplitude).",
-                        __FILE__, __LINE__);
-                    UMUGU_TRAP();
-                }
-            }
-        }
-
-        UMUGU_ASSERT(ni);
-        info_indices[i] = ni - &ctx->nodes_info[0];
-        pipeline_size += ni->size_bytes;
+    const umugu_plan *plan = &ctx->plan;
+    const int direct_slot = um_plan_direct_output(ctx) ? plan->direct_slot : -1;
+    if (!plan->slot_count) {
+        return;
     }
 
-    char *node_it = um_allocprs(ctx, pipeline_size);
+    /* The room of every channel is rounded up to cache lines, so the slots never share
+     * one. */
+    const size_t channel_bytes =
+        um_align_up(ctx->pipeline.sig.samples.frame_count * sizeof(float), UM_ARENA_ALIGN);
+    int pool_channels = plan->slot_first[plan->slot_count];
+    if (plan->direct_slot >= 0 && direct_slot < 0) {
+        pool_channels += plan->slot_channels[plan->direct_slot];
+    }
+    uint8_t *pool = pool_channels ? um_alloctmp(ctx, pool_channels * channel_bytes) : NULL;
 
-    for (int i = 0; i < node_count; ++i) {
-        umugu_node *n = (void *)node_it;
-        ctx->pipeline.nodes[i] = n;
-        n->info_idx = info_indices[i];
-        n->prev_node = i - 1;
-        um_node_dispatch(ctx, n, UMUGU_FN_INIT, UMUGU_FN_INIT_DEFAULTS);
-        node_it += ctx->nodes_info[n->info_idx].size_bytes;
+    for (int s = 0; s < plan->step_count; ++s) {
+        umugu_samples *out = &plan->exec_node[s]->out_pipe;
+        const int slot = plan->exec_slot[s];
+        if (slot < 0) {
+            out->channel_capacity = 0;
+            continue;
+        }
+        out->samples = slot == direct_slot
+                           ? ctx->io.out_audio.samples.samples
+                           : (float *)(pool + plan->slot_first[slot] * channel_bytes);
+        out->channel_capacity = plan->slot_channels[slot];
     }
-    return UMUGU_SUCCESS;
 }
 
 /*  ***  UMUGU INTERNAL  ***  */
@@ -543,7 +1921,9 @@ um_oscillator_sine(um_oscillator *self, umugu_samples *sig, int sample_rate)
 
     float b1 = 2.0f * cosf(w);
     sig->samples[0] = sinf(self->phase);
-    sig->samples[1] = sinf(self->phase + w);
+    if (count > 1) {
+        sig->samples[1] = sinf(self->phase + w);
+    }
     for (int i = 2; i < count; ++i) {
         sig->samples[i] = b1 * sig->samples[i - 1] - sig->samples[i - 2];
     }
@@ -877,7 +2257,7 @@ um_load_config(umugu_ctx *ctx, const char *filename)
             return UMUGU_ERR_MEM;
         }
     } else {
-        ctx->arena_tail += required_size;
+        ctx->arena_tail += um_align_up(required_size, UM_ARENA_ALIGN);
     }
 
     um_confmap configs = um_confmap_create_zeroed();
@@ -950,25 +2330,28 @@ um_load_config(umugu_ctx *ctx, const char *filename)
     return UMUGU_SUCCESS;
 }
 
+/* Canonical (44 bytes) wav header. */
+typedef struct {
+    char riff[4]; /* "RIFF" */
+    /* Total wave data size + header (44) - current index (8) */
+    int32_t bytes_remaining;
+    char wave[4];       /* "WAVE" */
+    char fmt[4];        /* "fmt " mind the space (0x20 char) */
+    int32_t num16;      /* just assign the number 16 */
+    int16_t sample_fmt; /* 1: Int, 3: Float */
+    int16_t channels;
+    int32_t sample_rate;
+    int32_t bytes_per_sec;   /* sample_rate * sample_size * number_channels */
+    int16_t bytes_per_frame; /* sample_size * number_channels */
+    int16_t bits_per_sample; /* i.e. sample_size * 8 */
+    char data[4];            /* "data" */
+    int32_t data_size;
+} um_wav_hdr;
+
 void
 um_signal_wav_header(umugu_signal *sig, size_t wav_data_size, void *out_buffer)
 {
-    struct wav_hdr {
-        char riff[4]; /* "RIFF" */
-        /* Total wave data size + header (44) - current index (8) */
-        int32_t bytes_remaining;
-        char wave[4];       /* "WAVE" */
-        char fmt[4];        /* "fmt " mind the space (0x20 char) */
-        int32_t num16;      /* just assign the number 16 */
-        int16_t sample_fmt; /* 1: Int, 3: Float */
-        int16_t channels;
-        int32_t sample_rate;
-        int32_t bytes_per_sec;   /* sample_rate * sample_size * number_channels */
-        int16_t bytes_per_frame; /* sample_size * number_channels */
-        int16_t bits_per_sample; /* i.e. sample_size * 8 */
-        char data[4];            /* "data" */
-        int32_t data_size;
-    } hdr = {
+    um_wav_hdr hdr = {
         .riff = "RIFF",
         .bytes_remaining = wav_data_size + 36,
         .wave = "WAVE",
@@ -986,7 +2369,139 @@ um_signal_wav_header(umugu_signal *sig, size_t wav_data_size, void *out_buffer)
 
     /* 44 is the specified size of the .wav header */
     UMUGU_ASSERT(sizeof(hdr) == 44);
-    *(struct wav_hdr *)out_buffer = hdr;
+    *(um_wav_hdr *)out_buffer = hdr;
+}
+
+static inline uint32_t
+um_read_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint16_t
+um_read_le16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+enum {
+    UM_WAV_FORMAT_PCM = 1,
+    UM_WAV_FORMAT_FLOAT = 3,
+    UM_WAV_FORMAT_EXTENSIBLE = 0xFFFE,
+};
+
+int
+um_signal_wav_parse(umugu_signal *sig, const void *file, size_t size, size_t file_size)
+{
+    const uint8_t *bytes = file;
+    if (size < 12 || memcmp(bytes, "RIFF", 4) || memcmp(bytes + 8, "WAVE", 4)) {
+        return UMUGU_ERR_FILE;
+    }
+
+    const uint8_t *fmt = NULL;
+    const uint8_t *data = NULL;
+    size_t data_size = 0;
+    /* Chunks are word aligned: odd sizes are followed by a pad byte. */
+    for (size_t at = 12; at + 8 <= size;) {
+        const uint8_t *chunk = bytes + at;
+        const size_t chunk_size = um_read_le32(chunk + 4);
+        if (!memcmp(chunk, "fmt ", 4) && chunk_size >= 16 && chunk_size <= size - at - 8) {
+            fmt = chunk + 8;
+        } else if (!memcmp(chunk, "data", 4)) {
+            /* Streaming writers leave the size unset (0 or ~0): take the rest of the file. */
+            const size_t available = file_size - at - 8;
+            data = chunk + 8;
+            data_size = (chunk_size && chunk_size <= available) ? chunk_size : available;
+            if (fmt) {
+                break;
+            }
+        }
+        at += 8 + chunk_size + (chunk_size & 1);
+    }
+
+    if (!fmt || !data) {
+        return UMUGU_ERR_FILE;
+    }
+
+    int tag = um_read_le16(fmt);
+    const int channels = um_read_le16(fmt + 2);
+    const int bits = um_read_le16(fmt + 14);
+    if (tag == UM_WAV_FORMAT_EXTENSIBLE && um_read_le16(fmt + 16) >= 22) {
+        /* The first two bytes of the subformat GUID are the actual format tag. */
+        tag = um_read_le16(fmt + 24);
+    }
+
+    if (tag == UM_WAV_FORMAT_PCM && bits == 8) {
+        sig->format = UMUGU_TYPE_UINT8;
+    } else if (tag == UM_WAV_FORMAT_PCM && bits == 16) {
+        sig->format = UMUGU_TYPE_INT16;
+    } else if (tag == UM_WAV_FORMAT_PCM && bits == 32) {
+        sig->format = UMUGU_TYPE_INT32;
+    } else if (tag == UM_WAV_FORMAT_FLOAT && bits == 32) {
+        sig->format = UMUGU_TYPE_FLOAT;
+    } else {
+        return UMUGU_ERR_FILE;
+    }
+
+    if (channels <= 0) {
+        return UMUGU_ERR_FILE;
+    }
+
+    const size_t frames = data_size / ((size_t)(bits / 8) * channels);
+    if (frames > INT32_MAX) {
+        return UMUGU_ERR_FILE;
+    }
+
+    sig->interleaved_channels = true;
+    sig->sample_rate = (int32_t)um_read_le32(fmt + 4);
+    sig->samples.samples = (float *)data;
+    sig->samples.channel_count = channels;
+    sig->samples.frame_count = (int32_t)frames;
+    return (int)frames;
+}
+
+int
+um_wav_map(const char *filename, umugu_signal *sig, void **map, size_t *map_size)
+{
+    UM_TRACE_ZONE();
+    const int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return UMUGU_ERR_FILE;
+    }
+
+    struct stat st;
+    void *addr = MAP_FAILED;
+    if (!fstat(fd, &st) && st.st_size > 0) {
+        addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    /* The mapping keeps its own reference to the file. */
+    close(fd);
+    if (addr == MAP_FAILED) {
+        return UMUGU_ERR_FILE;
+    }
+
+    const int frames = um_signal_wav_parse(sig, addr, st.st_size, st.st_size);
+    if (frames < UMUGU_SUCCESS) {
+        munmap(addr, st.st_size);
+        return frames;
+    }
+
+    /* Read-ahead for the whole file and prefetch of the first pages, so the audio callback
+     * does not start with page faults on a cold cache. */
+    const size_t prefetch = 1 << 20;
+    madvise(addr, st.st_size, MADV_SEQUENTIAL);
+    madvise(addr, (size_t)st.st_size < prefetch ? (size_t)st.st_size : prefetch, MADV_WILLNEED);
+    *map = addr;
+    *map_size = st.st_size;
+    return frames;
+}
+
+void
+um_wav_unmap(void *map, size_t map_size)
+{
+    if (map) {
+        munmap(map, map_size);
+    }
 }
 
 /* ## BUILT-IN NODES INFO ## */
@@ -1008,6 +2523,35 @@ const umugu_attrib_info um_oscil_attribs[] = {
 const int um_oscil_size = (int)sizeof(um_oscil);
 const int um_oscil_attrib_count = UM_ARRAY_SIZE(um_oscil_attribs);
 
+/*  OSCILLATOR BANK  */
+const umugu_attrib_info um_oscbank_attribs[] = {
+    {.name = {.str = "Voices"},
+     .offset_bytes = offsetof(um_oscbank, voice_count),
+     .type = UMUGU_TYPE_INT32,
+     .count = 1,
+     .misc.rangei.min = 0,
+     .misc.rangei.max = UM_OSCBANK_MAX_VOICES},
+    {.name = {.str = "Waveform"},
+     .offset_bytes = offsetof(um_oscbank, waveform),
+     .type = UMUGU_TYPE_INT32,
+     .count = 1,
+     .misc.rangei.min = 0,
+     .misc.rangei.max = UMUGU_WAVEFORM_COUNT},
+    {.name = {.str = "Frequencies"},
+     .offset_bytes = offsetof(um_oscbank, voices) + offsetof(um_voices, freq),
+     .type = UMUGU_TYPE_FLOAT,
+     .count = UM_OSCBANK_MAX_VOICES,
+     .misc.rangef.min = 1,
+     .misc.rangef.max = 8372},
+    {.name = {.str = "Amplitudes"},
+     .offset_bytes = offsetof(um_oscbank, voices) + offsetof(um_voices, amp),
+     .type = UMUGU_TYPE_FLOAT,
+     .count = UM_OSCBANK_MAX_VOICES,
+     .misc.rangef.min = 0,
+     .misc.rangef.max = 1}};
+const int um_oscbank_size = (int)sizeof(um_oscbank);
+const int um_oscbank_attrib_count = UM_ARRAY_SIZE(um_oscbank_attribs);
+
 /*  WAV FILE PLAYER  */
 const umugu_attrib_info um_wavplayer_attribs[] = {
     {.name = {.str = "Channels"},
@@ -1030,7 +2574,48 @@ const umugu_attrib_info um_wavplayer_attribs[] = {
     {.name = {.str = "Filename"},
      .offset_bytes = offsetof(um_wavplayer, filename),
      .type = UMUGU_TYPE_TEXT,
-     .count = UMUGU_PATH_LEN}};
+     .count = UMUGU_PATH_LEN},
+    {.name = {.str = "Frames"},
+     .offset_bytes =
+         offsetof(um_wavplayer, wav) + offsetof(umugu_signal, samples) +
+         offsetof(umugu_samples, frame_count),
+     .type = UMUGU_TYPE_INT32,
+     .count = 1,
+     .flags = UMUGU_ATTR_RDONLY},
+    {.name = {.str = "Position"},
+     .offset_bytes = offsetof(um_wavplayer, position),
+     .type = UMUGU_TYPE_INT32,
+     .count = 1,
+     .flags = UMUGU_ATTR_RDONLY},
+    {.name = {.str = "Seek"},
+     .offset_bytes = offsetof(um_wavplayer, seek),
+     .type = UMUGU_TYPE_INT32,
+     .count = 1,
+     .misc.rangei.min = -1,
+     .misc.rangei.max = INT32_MAX},
+    {.name = {.str = "Loop"},
+     .offset_bytes = offsetof(um_wavplayer, loop),
+     .type = UMUGU_TYPE_BOOL,
+     .count = 1,
+     .misc.rangei.min = 0,
+     .misc.rangei.max = 1},
+    {.name = {.str = "Stream"},
+     .offset_bytes = offsetof(um_wavplayer, streaming),
+     .type = UMUGU_TYPE_BOOL,
+     .count = 1,
+     .misc.rangei.min = 0,
+     .misc.rangei.max = 1},
+    {.name = {.str = "Underruns"},
+     .offset_bytes = offsetof(um_wavplayer, underruns),
+     .type = UMUGU_TYPE_INT32,
+     .count = 1,
+     .flags = UMUGU_ATTR_RDONLY},
+    {.name = {.str = "Quality"},
+     .offset_bytes = offsetof(um_wavplayer, quality),
+     .type = UMUGU_TYPE_INT32,
+     .count = 1,
+     .misc.rangei.min = 0,
+     .misc.rangei.max = UM_RESAMPLE_QUALITY_COUNT - 1}};
 const int um_wavplayer_size = (int)sizeof(um_wavplayer);
 const int um_wavplayer_attrib_count = UM_ARRAY_SIZE(um_wavplayer_attribs);
 
@@ -1074,7 +2659,8 @@ const umugu_attrib_info um_mixer_attribs[] = {
      .offset_bytes = offsetof(um_mixer, extra_pipe_in_node_idx),
      .type = UMUGU_TYPE_INT16,
      .count = UMUGU_MIXER_MAX_INPUTS,
-     .misc.rangei.min = 0,
+     .flags = UMUGU_ATTR_INPUT,
+     .misc.rangei.min = -1,
      .misc.rangei.max = 9999},
     {.name = {.str = "ExtraInputPipeChannel"},
      .offset_bytes = offsetof(um_mixer, extra_pipe_in_channel),
@@ -1085,6 +2671,48 @@ const umugu_attrib_info um_mixer_attribs[] = {
 const int um_mixer_size = (int)sizeof(um_mixer);
 const int um_mixer_attrib_count = UM_ARRAY_SIZE(um_mixer_attribs);
 
+/*  CONVOLVER  */
+const umugu_attrib_info um_convolver_attribs[] = {
+    {.name = {.str = "Filename"},
+     .offset_bytes = offsetof(um_convolver, filename),
+     .type = UMUGU_TYPE_TEXT,
+     .count = UMUGU_PATH_LEN},
+    {.name = {.str = "Partition size"},
+     .offset_bytes = offsetof(um_convolver, partition_size),
+     .type = UMUGU_TYPE_INT32,
+     .count = 1,
+     .misc.rangei.min = 0,
+     .misc.rangei.max = UM_CONVOLVER_MAX_PARTITION},
+    {.name = {.str = "Gain"},
+     .offset_bytes = offsetof(um_convolver, gain),
+     .type = UMUGU_TYPE_FLOAT,
+     .count = 1,
+     .misc.rangef.min = 0.0f,
+     .misc.rangef.max = 5.0f},
+    {.name = {.str = "Partitions"},
+     .offset_bytes = offsetof(um_convolver, partition_count),
+     .type = UMUGU_TYPE_INT32,
+     .count = 1,
+     .flags = UMUGU_ATTR_RDONLY}};
+const int um_convolver_size = (int)sizeof(um_convolver);
+const int um_convolver_attrib_count = UM_ARRAY_SIZE(um_convolver_attribs);
+
+/*  RESAMPLER  */
+const umugu_attrib_info um_resample_attribs[] = {
+    {.name = {.str = "Quality"},
+     .offset_bytes = offsetof(um_resample, quality),
+     .type = UMUGU_TYPE_INT32,
+     .count = 1,
+     .misc.rangei.min = 0,
+     .misc.rangei.max = UM_RESAMPLE_QUALITY_COUNT - 1},
+    {.name = {.str = "Output rate"},
+     .offset_bytes = offsetof(um_resample, out_rate),
+     .type = UMUGU_TYPE_INT32,
+     .count = 1,
+     .flags = UMUGU_ATTR_RDONLY}};
+const int um_resample_size = (int)sizeof(um_resample);
+const int um_resample_attrib_count = UM_ARRAY_SIZE(um_resample_attribs);
+
 /*  OUTPUT  */
 const umugu_attrib_info um_output_attribs[] = {
     {.name = {.str = "Input node"},
@@ -1097,17 +2725,36 @@ const umugu_attrib_info um_output_attribs[] = {
 const int um_output_size = (int)sizeof(um_output);
 const int um_output_attrib_count = UM_ARRAY_SIZE(um_output_attribs);
 
+/*  LAYOUT  */
+const umugu_attrib_info um_layout_attribs[] = {
+    {.name = {.str = "Interleaved"},
+     .offset_bytes = offsetof(um_layout, interleaved),
+     .type = UMUGU_TYPE_BOOL,
+     .count = 1}};
+const int um_layout_size = (int)sizeof(um_layout);
+const int um_layout_attrib_count = UM_ARRAY_SIZE(um_layout_attribs);
+
 static const umugu_node_type_info um_builtin_ninfo[] = {
     {.name = {"Oscillator"},
      .size_bytes = um_oscil_size,
      .attrib_count = um_oscil_attrib_count,
+     .flags = UMUGU_NODE_PLANNED_OUTPUT | UMUGU_NODE_EVENTS,
      .getfn = um_oscil_getfn,
      .attribs = um_oscil_attribs,
      .plug_handle = NULL},
 
+    {.name = {"OscillatorBank"},
+     .size_bytes = um_oscbank_size,
+     .attrib_count = um_oscbank_attrib_count,
+     .flags = UMUGU_NODE_PLANNED_OUTPUT | UMUGU_NODE_EVENTS,
+     .getfn = um_oscbank_getfn,
+     .attribs = um_oscbank_attribs,
+     .plug_handle = NULL},
+
     {.name = {"WavFilePlayer"},
      .size_bytes = um_wavplayer_size,
      .attrib_count = um_wavplayer_attrib_count,
+     .flags = UMUGU_NODE_PLANNED_OUTPUT,
      .getfn = um_wavplayer_getfn,
      .attribs = um_wavplayer_attribs,
      .plug_handle = NULL},
@@ -1115,6 +2762,7 @@ static const umugu_node_type_info um_builtin_ninfo[] = {
     {.name = {"Mixer"},
      .size_bytes = um_mixer_size,
      .attrib_count = um_mixer_attrib_count,
+     .flags = UMUGU_NODE_PLANNED_OUTPUT,
      .getfn = um_mixer_getfn,
      .attribs = um_mixer_attribs,
      .plug_handle = NULL},
@@ -1122,6 +2770,7 @@ static const umugu_node_type_info um_builtin_ninfo[] = {
     {.name = {"Amplitude"},
      .size_bytes = um_amplitude_size,
      .attrib_count = um_amplitude_attrib_count,
+     .flags = UMUGU_NODE_PLANNED_OUTPUT | UMUGU_NODE_INPLACE | UMUGU_NODE_EVENTS,
      .getfn = um_amplitude_getfn,
      .attribs = um_amplitude_attribs,
      .plug_handle = NULL},
@@ -1129,16 +2778,42 @@ static const umugu_node_type_info um_builtin_ninfo[] = {
     {.name = {"Limiter"},
      .size_bytes = um_limiter_size,
      .attrib_count = um_limiter_attrib_count,
+     .flags = UMUGU_NODE_PLANNED_OUTPUT | UMUGU_NODE_INPLACE | UMUGU_NODE_ANY_LAYOUT,
      .getfn = um_limiter_getfn,
      .attribs = um_limiter_attribs,
      .plug_handle = NULL},
 
+    {.name = {"Convolver"},
+     .size_bytes = um_convolver_size,
+     .attrib_count = um_convolver_attrib_count,
+     .flags = UMUGU_NODE_PLANNED_OUTPUT,
+     .getfn = um_convolver_getfn,
+     .attribs = um_convolver_attribs,
+     .plug_handle = NULL},
+
+    {.name = {"Resampler"},
+     .size_bytes = um_resample_size,
+     .attrib_count = um_resample_attrib_count,
+     .flags = UMUGU_NODE_FLAG_NONE,
+     .getfn = um_resample_getfn,
+     .attribs = um_resample_attribs,
+     .plug_handle = NULL},
+
     {.name = {"Output"},
      .size_bytes = um_output_size,
      .attrib_count = um_output_attrib_count,
+     .flags = UMUGU_NODE_DEVICE_OUTPUT | UMUGU_NODE_ANY_LAYOUT,
      .getfn = um_output_getfn,
      .attribs = um_output_attribs,
      .plug_handle = NULL},
+
+    {.name = {"Layout"},
+     .size_bytes = um_layout_size,
+     .attrib_count = um_layout_attrib_count,
+     .flags = UMUGU_NODE_PLANNED_OUTPUT,
+     .getfn = um_layout_getfn,
+     .attribs = um_layout_attribs,
+     .plug_handle = NULL},
 };
 
 static const umugu_node_type_info *
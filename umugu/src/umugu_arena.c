@@ -0,0 +1,106 @@
+#include "umugu.h"
+
+#include "umugu_internal.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+/* Arena provisioning. The pages of a malloc'd arena are faulted in by the first blocks
+ * that reach them, inside the audio callback, and each 4KiB page takes its own TLB entry.
+ * The provisioned arena is backed by 2MiB pages when possible (reserved hugetlbfs pages
+ * or transparent huge pages), locked and faulted in before the context is loaded. */
+
+#define UM_ARENA_HUGE_PAGE (2 * 1024 * 1024)
+
+static void
+um_arena_log(const umugu_config *cfg, const char *fmt, size_t size)
+{
+    if (cfg->log_fn) {
+        cfg->log_fn(fmt, size);
+    }
+}
+
+/* Reserved huge pages, NULL if there are not enough (or the kernel has none). */
+static uint8_t *
+um_arena_map_hugetlb(size_t size)
+{
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+    void *mem = mmap(
+        NULL, size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (21 << MAP_HUGE_SHIFT), -1, 0);
+    return mem != MAP_FAILED ? mem : NULL;
+#else
+    UM_UNUSED(size);
+    return NULL;
+#endif
+}
+
+/* Regular pages starting at an align boundary, so transparent huge pages can back the
+ * whole region. The unaligned head and the tail of the mapping are returned. */
+static uint8_t *
+um_arena_map_aligned(size_t size, size_t align)
+{
+    uint8_t *mem =
+        mmap(NULL, size + align, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        return NULL;
+    }
+    uint8_t *arena = um_align_ptr(mem, align);
+    if (arena > mem) {
+        munmap(mem, arena - mem);
+    }
+    munmap(arena + size, mem + size + align - (arena + size));
+    return arena;
+}
+
+int
+umugu_arena_map(umugu_config *cfg, size_t size, umugu_arena_flags flags)
+{
+    UM_TRACE_ZONE();
+    UMUGU_ASSERT(cfg && size);
+    const size_t page = sysconf(_SC_PAGESIZE);
+    const bool huge = flags & UMUGU_ARENA_HUGE_PAGES;
+    size = um_align_up(size, huge ? UM_ARENA_HUGE_PAGE : page);
+
+    int ret = UMUGU_SUCCESS;
+    uint8_t *arena = huge ? um_arena_map_hugetlb(size) : NULL;
+    if (!arena) {
+        arena = um_arena_map_aligned(size, huge ? UM_ARENA_HUGE_PAGE : page);
+        if (!arena) {
+            um_arena_log(cfg, "[ERR] Arena: could not map %zu bytes.\n", size);
+            return UMUGU_ERR_MEM;
+        }
+        /* Without reserved huge pages (vm.nr_hugepages) ask for transparent ones. */
+        if (huge && madvise(arena, size, MADV_HUGEPAGE)) {
+            um_arena_log(cfg, "[WARN] Arena: no huge pages for %zu bytes.\n", size);
+            ret = UMUGU_NOOP;
+        }
+    }
+
+    if ((flags & UMUGU_ARENA_LOCK) && mlock(arena, size)) {
+        um_arena_log(cfg, "[WARN] Arena: could not lock %zu bytes (RLIMIT_MEMLOCK).\n", size);
+        ret = UMUGU_NOOP;
+    }
+
+    /* Write faults: reading would map the shared zero page and fault again on write. The
+     * pages are already resident if they were locked. */
+    if (flags & UMUGU_ARENA_PREFAULT) {
+        volatile uint8_t *it = arena;
+        for (size_t i = 0; i < size; i += page) {
+            it[i] = 0;
+        }
+    }
+
+    cfg->arena = arena;
+    cfg->arena_size = size;
+    return ret;
+}
+
+void
+umugu_arena_unmap(void *arena, size_t size)
+{
+    UM_TRACE_ZONE();
+    if (arena) {
+        munmap(arena, size);
+    }
+}
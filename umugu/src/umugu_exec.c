@@ -0,0 +1,342 @@
+#define _GNU_SOURCE /* pthread_setaffinity_np */
+#include "umugu.h"
+
+#include "umugu_internal.h"
+
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* Spin iterations of an idle worker before sleeping in the futex. */
+#define UM_EXEC_SPIN 4096
+#define UM_EXEC_EMPTY -1
+
+#if defined(__x86_64__) || defined(__i386__)
+#define UM_CPU_RELAX() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define UM_CPU_RELAX() __asm__ __volatile__("yield")
+#else
+#define UM_CPU_RELAX() ((void)0)
+#endif
+
+/* Chase-Lev work-stealing deque of step indices. The owner pushes and pops at the
+ * bottom, thieves take from the top. Indices grow monotonically (never reset) so a
+ * late thief can not observe a recycled slot. */
+typedef struct {
+    int64_t top;
+    char pad0[56];
+    int64_t bottom;
+    char pad1[56];
+    int32_t *items;
+    int64_t mask;
+} um_deque;
+
+typedef struct {
+    um_deque deque;
+    struct um_exec_pool *pool;
+    pthread_t thread;
+    uint32_t rng;
+    int32_t idx;
+} __attribute__((aligned(64))) um_worker;
+
+struct um_exec_pool {
+    umugu_ctx *ctx;
+    um_worker *workers;   /* workers[0] is the thread calling umugu_process. */
+    int32_t worker_count; /* Including the caller. */
+    int32_t capacity;     /* Max steps. */
+    int32_t *pending;     /* Inputs not processed yet, per step. */
+    int32_t remaining;    /* Steps left before the join. */
+    int32_t error;        /* First process error of the block. */
+    uint32_t generation;  /* Block counter, futex word for sleeping workers. */
+    int32_t sleepers;
+    int32_t quit;
+};
+
+static inline void
+um_deque_push(um_deque *d, int32_t item)
+{
+    int64_t b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+    d->items[b & d->mask] = item;
+    __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELEASE);
+}
+
+static inline int32_t
+um_deque_pop(um_deque *d)
+{
+    int64_t b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&d->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t t = __atomic_load_n(&d->top, __ATOMIC_RELAXED);
+    if (t > b) {
+        __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+        return UM_EXEC_EMPTY;
+    }
+
+    int32_t item = d->items[b & d->mask];
+    if (t == b) {
+        /* Last item, race against the thieves. */
+        if (!__atomic_compare_exchange_n(
+                &d->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            item = UM_EXEC_EMPTY;
+        }
+        __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+    return item;
+}
+
+static inline int32_t
+um_deque_steal(um_deque *d)
+{
+    int64_t t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t b = __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
+    if (t >= b) {
+        return UM_EXEC_EMPTY;
+    }
+
+    int32_t item = d->items[t & d->mask];
+    if (!__atomic_compare_exchange_n(
+            &d->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        return UM_EXEC_EMPTY;
+    }
+    return item;
+}
+
+static inline long
+um_futex(uint32_t *word, int op, uint32_t value)
+{
+    return syscall(SYS_futex, word, op, value, NULL, NULL, 0);
+}
+
+/* Runs a step and releases the consumers that were waiting only for it. */
+static inline void
+um_exec_run_step(struct um_exec_pool *pool, um_worker *self, int32_t s)
+{
+    umugu_ctx *ctx = pool->ctx;
+    const umugu_plan *plan = &ctx->plan;
+    const umugu_exec_step *step = &plan->steps[s];
+    const int32_t join = plan->step_count - 1;
+
+    int err = um_step_process(ctx, s);
+    if (err < UMUGU_SUCCESS) {
+        int32_t expected = UMUGU_SUCCESS;
+        __atomic_compare_exchange_n(
+            &pool->error, &expected, err, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    }
+
+    const uint16_t *consumers = plan->consumers + step->consumer_first;
+    for (int i = 0; i < step->consumer_count; ++i) {
+        const int32_t c = consumers[i];
+        if (c != join && !__atomic_sub_fetch(&pool->pending[c], 1, __ATOMIC_ACQ_REL)) {
+            um_deque_push(&self->deque, c);
+        }
+    }
+
+    __atomic_sub_fetch(&pool->remaining, 1, __ATOMIC_ACQ_REL);
+}
+
+/* Processes steps (own first, then stolen) until every step before the join is done. */
+static void
+um_exec_drain(struct um_exec_pool *pool, um_worker *self)
+{
+    while (__atomic_load_n(&pool->remaining, __ATOMIC_ACQUIRE) > 0) {
+        int32_t s = um_deque_pop(&self->deque);
+        for (int i = 1; s == UM_EXEC_EMPTY && i < pool->worker_count; ++i) {
+            /* xorshift for picking the victims in a different order every time. */
+            self->rng ^= self->rng << 13;
+            self->rng ^= self->rng >> 17;
+            self->rng ^= self->rng << 5;
+            const int victim = self->idx + 1 + self->rng % (pool->worker_count - 1);
+            s = um_deque_steal(&pool->workers[victim % pool->worker_count].deque);
+        }
+
+        if (s == UM_EXEC_EMPTY) {
+            UM_CPU_RELAX();
+            continue;
+        }
+        um_exec_run_step(pool, self, s);
+    }
+}
+
+static void *
+um_exec_worker_main(void *arg)
+{
+    um_worker *self = arg;
+    struct um_exec_pool *pool = self->pool;
+    /* Not the current value: the thread may be scheduled after some blocks (or the quit)
+     * were already signaled, and it has to see them as new. */
+    uint32_t seen = 0;
+
+    for (;;) {
+        uint32_t gen = seen;
+        for (int spin = 0; gen == seen && spin < UM_EXEC_SPIN; ++spin) {
+            UM_CPU_RELAX();
+            gen = __atomic_load_n(&pool->generation, __ATOMIC_ACQUIRE);
+        }
+
+        while (gen == seen) {
+            __atomic_add_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+            if (__atomic_load_n(&pool->generation, __ATOMIC_SEQ_CST) == seen) {
+                um_futex(&pool->generation, FUTEX_WAIT_PRIVATE, seen);
+            }
+            __atomic_sub_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+            gen = __atomic_load_n(&pool->generation, __ATOMIC_ACQUIRE);
+        }
+        seen = gen;
+
+        if (__atomic_load_n(&pool->quit, __ATOMIC_ACQUIRE)) {
+            return NULL;
+        }
+        um_exec_drain(pool, self);
+    }
+}
+
+static void
+um_exec_configure_thread(umugu_ctx *ctx, pthread_t thread, int cpu, int rt_priority)
+{
+    const long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpu_count > 1) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu % cpu_count, &set);
+        if (pthread_setaffinity_np(thread, sizeof(set), &set)) {
+            ctx->io.log("Worker thread could not be pinned to cpu %d.\n", (int)(cpu % cpu_count));
+        }
+    }
+
+    if (rt_priority > 0) {
+        struct sched_param param = {.sched_priority = rt_priority};
+        if (pthread_setschedparam(thread, SCHED_FIFO, &param)) {
+            ctx->io.log("Worker thread real-time priority denied (SCHED_FIFO %d).\n", rt_priority);
+        }
+    }
+}
+
+struct um_exec_pool *
+um_exec_pool_create(umugu_ctx *ctx, int worker_count, int rt_priority)
+{
+    UM_TRACE_ZONE();
+    UMUGU_ASSERT(ctx && worker_count > 0);
+
+    struct um_exec_pool *pool = um_allocprs(ctx, sizeof(struct um_exec_pool));
+    pool->ctx = ctx;
+    pool->worker_count = worker_count + 1;
+    pool->capacity = 0;
+    pool->remaining = 0;
+    pool->error = UMUGU_SUCCESS;
+    pool->generation = 0;
+    pool->sleepers = 0;
+    pool->quit = 0;
+
+    pool->workers = um_allocprs(ctx, pool->worker_count * sizeof(um_worker));
+    for (int i = 0; i < pool->worker_count; ++i) {
+        um_worker *w = &pool->workers[i];
+        w->deque.top = 0;
+        w->deque.bottom = 0;
+        w->deque.mask = 0;
+        w->deque.items = NULL;
+        w->pool = pool;
+        w->idx = i;
+        w->rng = 0x9E3779B9u * (i + 1);
+    }
+    um_exec_pool_reserve(ctx, pool, ctx->pipeline_capacity);
+
+    for (int i = 1; i < pool->worker_count; ++i) {
+        um_worker *w = &pool->workers[i];
+        if (pthread_create(&w->thread, NULL, um_exec_worker_main, w)) {
+            ctx->io.log("Could not create the worker thread %d. Processing serially.\n", i);
+            pool->worker_count = i;
+            break;
+        }
+        um_exec_configure_thread(ctx, w->thread, i, rt_priority);
+    }
+
+    if (pool->worker_count == 1) {
+        return NULL;
+    }
+
+#ifdef UMUGU_VERBOSE
+    ctx->io.log("Parallel executor running with %d worker threads.\n", pool->worker_count - 1);
+#endif
+    return pool;
+}
+
+void
+um_exec_pool_reserve(umugu_ctx *ctx, struct um_exec_pool *pool, int capacity)
+{
+    if (capacity <= pool->capacity) {
+        return;
+    }
+
+    int64_t deque_size = 1;
+    while (deque_size < capacity) {
+        deque_size <<= 1;
+    }
+
+    /* The deques are empty between blocks: thieves only read the items after the bottom
+     * (released by the push of the next block) says there is one. */
+    pool->pending = um_allocprs(ctx, capacity * sizeof(int32_t));
+    for (int i = 0; i < pool->worker_count; ++i) {
+        um_worker *w = &pool->workers[i];
+        w->deque.items = um_allocprs(ctx, deque_size * sizeof(int32_t));
+        w->deque.mask = deque_size - 1;
+    }
+    pool->capacity = capacity;
+}
+
+void
+um_exec_pool_destroy(struct um_exec_pool *pool)
+{
+    UM_TRACE_ZONE();
+    if (!pool) {
+        return;
+    }
+
+    __atomic_store_n(&pool->quit, 1, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&pool->generation, 1, __ATOMIC_SEQ_CST);
+    um_futex(&pool->generation, FUTEX_WAKE_PRIVATE, INT32_MAX);
+    for (int i = 1; i < pool->worker_count; ++i) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+    pool->worker_count = 1;
+}
+
+int
+um_exec_pool_process(struct um_exec_pool *pool)
+{
+    UM_TRACE_ZONE();
+    umugu_ctx *ctx = pool->ctx;
+    const umugu_plan *plan = &ctx->plan;
+    const int32_t join = plan->step_count - 1;
+    UMUGU_ASSERT(join > 0 && plan->step_count <= pool->capacity);
+    um_worker *self = &pool->workers[0];
+
+    pool->error = UMUGU_SUCCESS;
+    for (int32_t s = 0; s < join; ++s) {
+        pool->pending[s] = plan->steps[s].port_count;
+    }
+    __atomic_store_n(&pool->remaining, join, __ATOMIC_RELEASE);
+
+    for (int32_t s = 0; s < join; ++s) {
+        if (!plan->steps[s].port_count) {
+            um_deque_push(&self->deque, s);
+        }
+    }
+
+    __atomic_add_fetch(&pool->generation, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&pool->sleepers, __ATOMIC_SEQ_CST)) {
+        um_futex(&pool->generation, FUTEX_WAKE_PRIVATE, INT32_MAX);
+    }
+
+    um_exec_drain(pool, self);
+
+    /* Every other step is done here, so the last one (the output) runs deterministically
+     * on the calling thread. */
+    int err = um_step_process(ctx, join);
+    if (err < UMUGU_SUCCESS) {
+        return err;
+    }
+    return __atomic_load_n(&pool->error, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,141 @@
+#include "umugu.h"
+
+#include "umugu_internal.h"
+
+#include <math.h>
+
+#define UM_FFT_PI 3.14159265358979323846
+
+static inline um_complex
+um_fft_twiddle(int k, int n)
+{
+    const double a = -2.0 * UM_FFT_PI * k / n;
+    return (um_complex){(float)cos(a), (float)sin(a)};
+}
+
+um_fft_plan *
+um_fft_plan_create(umugu_ctx *ctx, int n)
+{
+    UM_TRACE_ZONE();
+    UMUGU_ASSERT(n >= 4 && !(n & (n - 1)) && "FFT size must be a power of two.");
+    um_fft_plan *plan = um_allocprs(ctx, sizeof(um_fft_plan));
+    plan->n = n;
+    plan->log2n = __builtin_ctz(n);
+    plan->kernels = ctx->kernels;
+    plan->bitrev = um_allocprs(ctx, sizeof(plan->bitrev[0]) * n);
+    plan->twiddles = um_allocprs(ctx, sizeof(plan->twiddles[0]) * 3 * (n / 2 - 1));
+    plan->rtwiddles = um_allocprs(ctx, sizeof(plan->rtwiddles[0]) * n / 2);
+
+    plan->bitrev[0] = 0;
+    for (int i = 1; i < n; ++i) {
+        plan->bitrev[i] = (plan->bitrev[i >> 1] >> 1) | ((i & 1) << (plan->log2n - 1));
+    }
+
+    for (int h = 1; h <= n / 4; h *= 2) {
+        um_complex *tw = plan->twiddles + 3 * (h - 1);
+        for (int k = 0; k < h; ++k) {
+            tw[k] = um_fft_twiddle(k, 4 * h);
+            tw[h + k] = um_fft_twiddle(2 * k, 4 * h);
+            tw[2 * h + k] = um_fft_twiddle(3 * k, 4 * h);
+        }
+    }
+
+    for (int k = 0; k < n / 2; ++k) {
+        plan->rtwiddles[k] = um_fft_twiddle(k, n);
+    }
+    return plan;
+}
+
+/* Complex transform of 2^log2m points, log2m <= plan->log2n. The bit-reversed indices of
+ * the smaller size are the plan ones without the lowest bit(s). */
+static void
+um_fft_run(const um_fft_plan *plan, um_complex *v, int log2m, int inverse)
+{
+    UM_TRACE_ZONE();
+    const int m = 1 << log2m;
+    const int shift = plan->log2n - log2m;
+    for (int i = 0; i < m; ++i) {
+        const int j = plan->bitrev[i] >> shift;
+        if (i < j) {
+            const um_complex tmp = v[i];
+            v[i] = v[j];
+            v[j] = tmp;
+        }
+    }
+
+    int h = 1;
+    if (log2m & 1) {
+        for (int i = 0; i < m; i += 2) {
+            const um_complex a = v[i];
+            const um_complex b = v[i + 1];
+            v[i] = (um_complex){a.real + b.real, a.imag + b.imag};
+            v[i + 1] = (um_complex){a.real - b.real, a.imag - b.imag};
+        }
+        h = 2;
+    }
+
+    for (; h < m; h *= 4) {
+        plan->kernels->fft_radix4(v, m, h, plan->twiddles + 3 * (h - 1), inverse);
+    }
+}
+
+void
+um_fft_forward(const um_fft_plan *plan, um_complex *v)
+{
+    um_fft_run(plan, v, plan->log2n, 0);
+}
+
+void
+um_fft_inverse(const um_fft_plan *plan, um_complex *v)
+{
+    um_fft_run(plan, v, plan->log2n, 1);
+}
+
+/* The even and odd samples are the real and imaginary parts of a half size transform
+ * Z. With m = n / 2, the spectra of both halves are
+ * E[k] = (Z[k] + conj(Z[m - k])) / 2 and O[k] = -i (Z[k] - conj(Z[m - k])) / 2,
+ * X[k] = E[k] + W_n^k O[k] and X[m - k] = conj(E[k] - W_n^k O[k]). */
+void
+um_fft_real_forward(const um_fft_plan *plan, const float *in, um_complex *out)
+{
+    UM_TRACE_ZONE();
+    const int m = plan->n / 2;
+    memcpy(out, in, sizeof(float) * plan->n);
+    um_fft_run(plan, out, plan->log2n - 1, 0);
+
+    const um_complex z0 = out[0];
+    out[0] = (um_complex){z0.real + z0.imag, 0.0f};
+    out[m] = (um_complex){z0.real - z0.imag, 0.0f};
+    for (int k = 1; k <= m / 2; ++k) {
+        const um_complex a = out[k];
+        const um_complex b = out[m - k];
+        const um_complex e = {0.5f * (a.real + b.real), 0.5f * (a.imag - b.imag)};
+        const um_complex o = {0.5f * (a.imag + b.imag), -0.5f * (a.real - b.real)};
+        const um_complex wo = um_cmul(plan->rtwiddles[k], o);
+        out[k] = (um_complex){e.real + wo.real, e.imag + wo.imag};
+        out[m - k] = (um_complex){e.real - wo.real, wo.imag - e.imag};
+    }
+}
+
+/* Inverse of the split above, without the 1/2 factors: the half size inverse transform
+ * scales by m, so the samples end scaled by n like the complex inverse. */
+void
+um_fft_real_inverse(const um_fft_plan *plan, const um_complex *in, float *out)
+{
+    UM_TRACE_ZONE();
+    const int m = plan->n / 2;
+    um_complex *z = (um_complex *)out;
+    z[0] = (um_complex){in[0].real + in[m].real, in[0].real - in[m].real};
+    for (int k = 1; k <= m / 2; ++k) {
+        const um_complex a = in[k];
+        const um_complex b = in[m - k];
+        const um_complex e = {a.real + b.real, a.imag - b.imag};
+        const um_complex d = {a.real - b.real, a.imag + b.imag};
+        const um_complex w = plan->rtwiddles[k];
+        const um_complex o = um_cmul((um_complex){w.real, -w.imag}, d);
+        /* Z[k] = E + i O and Z[m - k] = conj(E) + i conj(O). */
+        z[k] = (um_complex){e.real - o.imag, e.imag + o.real};
+        z[m - k] = (um_complex){e.real + o.imag, o.real - e.imag};
+    }
+    um_fft_run(plan, z, plan->log2n - 1, 1);
+}
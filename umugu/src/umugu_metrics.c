@@ -0,0 +1,248 @@
+#include "umugu.h"
+
+#include "umugu_internal.h"
+
+#include <sched.h>
+
+/* Processing times. Every step accumulates its time in a histogram of the current window
+ * (written only by the thread running the step, the executor join orders them), and the
+ * audio thread summarizes the window into a snapshot every UMUGU_METRICS_WINDOW blocks.
+ * The snapshot is published with a seqlock: the sequence is odd while it is written, so
+ * readers copy it and retry if the sequence changed in between. The audio thread never
+ * waits for them. The tables by node grow with umugu_ctx.pipeline_capacity. */
+
+/* Four buckets per octave of nanoseconds, up to 2^33ns. */
+#define UM_METRICS_BUCKETS 128
+
+typedef struct {
+    int64_t min;
+    int64_t max;
+    int64_t sum;
+    int32_t count;
+    uint16_t hist[UM_METRICS_BUCKETS];
+} __attribute__((aligned(64))) um_timing_acc;
+
+struct um_metrics {
+    uint64_t seq; /* Odd while the snapshot is written. */
+    char pad0[56];
+    umugu_metrics snapshot; /* Read by any thread. */
+    umugu_metrics next;     /* Audio thread. */
+    umugu_timing *snapshot_nodes; /* Replaced by a larger one when the tables grow. */
+    umugu_timing *next_nodes;
+    int32_t node_capacity;
+    umugu_node *const *plan_nodes; /* Plan measured by the window. */
+    int32_t window_blocks;
+    bool paused;
+    um_timing_acc block;
+    um_timing_acc *nodes;
+};
+
+um_metrics *
+um_metrics_create(umugu_ctx *ctx)
+{
+    UM_TRACE_ZONE();
+    const int capacity = ctx->pipeline_capacity;
+    um_metrics *m = um_allocprs(ctx, sizeof(um_metrics));
+    memset(m, 0, sizeof(um_metrics));
+    m->node_capacity = capacity;
+    m->snapshot_nodes = um_allocprs(ctx, capacity * sizeof(umugu_timing));
+    m->next_nodes = um_allocprs(ctx, capacity * sizeof(umugu_timing));
+    m->nodes = um_allocprs(ctx, capacity * sizeof(um_timing_acc));
+    memset(m->snapshot_nodes, 0, capacity * sizeof(umugu_timing));
+    memset(m->nodes, 0, capacity * sizeof(um_timing_acc));
+    UM_TRACE_PLOT_CONFIG("Callback headroom", TracyPlotFormatPercentage, false, true, 0);
+    return m;
+}
+
+void
+um_metrics_reserve(umugu_ctx *ctx, int capacity)
+{
+    UM_TRACE_ZONE();
+    um_metrics *m = ctx->metrics;
+    if (capacity <= m->node_capacity) {
+        return;
+    }
+
+    umugu_timing *snapshot = um_allocprs(ctx, capacity * sizeof(umugu_timing));
+    memset(snapshot, 0, capacity * sizeof(umugu_timing));
+    memcpy(snapshot, m->snapshot_nodes, m->node_capacity * sizeof(umugu_timing));
+    m->next_nodes = um_allocprs(ctx, capacity * sizeof(umugu_timing));
+    m->nodes = um_allocprs(ctx, capacity * sizeof(um_timing_acc));
+    memset(m->nodes, 0, capacity * sizeof(um_timing_acc));
+    /* Readers load the capacity first: the snapshot array they load after holds at least
+     * that many (the old one stays valid in the arena). */
+    __atomic_store_n(&m->snapshot_nodes, snapshot, __ATOMIC_RELEASE);
+    __atomic_store_n(&m->node_capacity, capacity, __ATOMIC_RELEASE);
+}
+
+static inline int
+um_metrics_bucket(int64_t ns)
+{
+    if (ns < 4) {
+        return ns > 0 ? (int)ns : 0;
+    }
+    const int octave = 63 - __builtin_clzll(ns);
+    const int bucket = 4 * (octave - 1) + (int)((ns >> (octave - 2)) & 3);
+    return bucket < UM_METRICS_BUCKETS ? bucket : UM_METRICS_BUCKETS - 1;
+}
+
+/* Largest value that falls in the bucket. */
+static inline int64_t
+um_metrics_bucket_max(int bucket)
+{
+    if (bucket < 4) {
+        return bucket;
+    }
+    const int octave = bucket / 4 + 1;
+    return ((int64_t)(4 + bucket % 4 + 1) << (octave - 2)) - 1;
+}
+
+static inline void
+um_timing_add(um_timing_acc *acc, int64_t ns)
+{
+    if (!acc->count || ns < acc->min) {
+        acc->min = ns;
+    }
+    if (ns > acc->max) {
+        acc->max = ns;
+    }
+    acc->sum += ns;
+    acc->count++;
+    acc->hist[um_metrics_bucket(ns)]++;
+}
+
+static umugu_timing
+um_timing_summary(const um_timing_acc *acc)
+{
+    if (!acc->count) {
+        return (umugu_timing){0};
+    }
+
+    const int32_t rank = (acc->count * 99 + 99) / 100;
+    int64_t p99 = acc->max;
+    for (int b = 0, seen = 0; b < UM_METRICS_BUCKETS; ++b) {
+        seen += acc->hist[b];
+        if (seen >= rank) {
+            p99 = um_metrics_bucket_max(b);
+            break;
+        }
+    }
+    return (umugu_timing){
+        .min_ns = acc->min,
+        .avg_ns = acc->sum / acc->count,
+        .p99_ns = p99 < acc->max ? p99 : acc->max,
+        .max_ns = acc->max};
+}
+
+/* Word by word, so the copies racing with the writer are never torn. */
+static inline void
+um_metrics_store(void *dst, const void *src, size_t bytes)
+{
+    for (size_t i = 0; i < bytes / sizeof(int64_t); ++i) {
+        __atomic_store_n((int64_t *)dst + i, ((const int64_t *)src)[i], __ATOMIC_RELAXED);
+    }
+}
+
+static inline void
+um_metrics_load(void *dst, const void *src, size_t bytes)
+{
+    for (size_t i = 0; i < bytes / sizeof(int64_t); ++i) {
+        ((int64_t *)dst)[i] = __atomic_load_n((const int64_t *)src + i, __ATOMIC_RELAXED);
+    }
+}
+
+static void
+um_metrics_publish(um_metrics *m)
+{
+    const uint64_t seq = m->seq;
+    __atomic_store_n(&m->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    um_metrics_store(&m->snapshot, &m->next, sizeof(umugu_metrics));
+    um_metrics_store(m->snapshot_nodes, m->next_nodes, m->next.node_count * sizeof(umugu_timing));
+    __atomic_store_n(&m->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+void
+um_metrics_node(umugu_ctx *ctx, int node_idx, um_nanosec elapsed)
+{
+    um_metrics *m = ctx->metrics;
+    UMUGU_ASSERT(node_idx < m->node_capacity);
+    if (!m->paused) {
+        um_timing_add(&m->nodes[node_idx], elapsed);
+    }
+}
+
+void
+um_metrics_pause(umugu_ctx *ctx, bool paused)
+{
+    ctx->metrics->paused = paused;
+}
+
+void
+um_metrics_block(umugu_ctx *ctx, um_nanosec elapsed, int frames)
+{
+    UM_TRACE_ZONE();
+    um_metrics *m = ctx->metrics;
+    umugu_metrics *next = &m->next;
+    const int rate = ctx->io.out_audio.sample_rate > 0 ? ctx->io.out_audio.sample_rate
+                                                       : ctx->pipeline.sig.sample_rate;
+    next->blocks++;
+    next->budget_ns = rate > 0 ? (int64_t)frames * 1000000000 / rate : 0;
+    next->deadline_misses += !ctx->offline && elapsed > next->budget_ns;
+    next->stream_underruns = ctx->stream_underruns;
+    next->arena_high_water = ctx->arena_high_water;
+    next->arena_overflows = ctx->arena_overflows;
+    um_timing_add(&m->block, elapsed);
+    UM_TRACE_PLOTF(
+        "Callback headroom",
+        next->budget_ns > 0 ? 100.0f * (next->budget_ns - elapsed) / next->budget_ns : 0.0f);
+
+    /* The node indices of another pipeline (swapped in) do not match the window. */
+    if (m->plan_nodes != ctx->plan.exec_node) {
+        m->plan_nodes = ctx->plan.exec_node;
+        memset(m->nodes, 0, m->node_capacity * sizeof(um_timing_acc));
+    }
+
+    if (++m->window_blocks < UMUGU_METRICS_WINDOW) {
+        return;
+    }
+
+    next->block = um_timing_summary(&m->block);
+    next->node_count = ctx->pipeline.node_count;
+    for (int i = 0; i < ctx->pipeline.node_count; ++i) {
+        m->next_nodes[i] = um_timing_summary(&m->nodes[i]);
+    }
+    um_metrics_publish(m);
+
+    m->window_blocks = 0;
+    memset(&m->block, 0, sizeof(m->block));
+    memset(m->nodes, 0, ctx->pipeline.node_count * sizeof(um_timing_acc));
+}
+
+int
+umugu_metrics_read(
+    const umugu_ctx *ctx, umugu_metrics *out, umugu_timing *nodes, int node_capacity)
+{
+    UM_TRACE_ZONE();
+    UMUGU_ASSERT(ctx && out && (nodes || !node_capacity));
+    const um_metrics *m = ctx->metrics;
+    uint64_t seq;
+    for (;;) {
+        seq = __atomic_load_n(&m->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            sched_yield(); /* Being written. */
+            continue;
+        }
+        um_metrics_load(out, &m->snapshot, sizeof(umugu_metrics));
+        /* The count could be torn too, the sequence check discards it. */
+        const int capacity = __atomic_load_n(&m->node_capacity, __ATOMIC_ACQUIRE);
+        const umugu_timing *snapshot = __atomic_load_n(&m->snapshot_nodes, __ATOMIC_ACQUIRE);
+        const int count = um_mini(um_mini(out->node_count, node_capacity), capacity);
+        um_metrics_load(nodes, snapshot, (count > 0 ? count : 0) * sizeof(umugu_timing));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&m->seq, __ATOMIC_RELAXED) == seq) {
+            break;
+        }
+    }
+    return seq ? UMUGU_SUCCESS : UMUGU_NOOP;
+}
@@ -1,14 +1,18 @@
 #include "umugu.h"
 #include "umugu_internal.h"
 
-#include <stdio.h> /* TODO: Use callback funcs */
+#include <sys/stat.h>
 
 umugu_node_func um_amplitude_getfn(umugu_fn fn);
 umugu_node_func um_limiter_getfn(umugu_fn fn);
 umugu_node_func um_mixer_getfn(umugu_fn fn);
+umugu_node_func um_convolver_getfn(umugu_fn fn);
 umugu_node_func um_oscil_getfn(umugu_fn fn);
+umugu_node_func um_oscbank_getfn(umugu_fn fn);
 umugu_node_func um_wavplayer_getfn(umugu_fn fn);
+umugu_node_func um_resample_getfn(umugu_fn fn);
 umugu_node_func um_output_getfn(umugu_fn fn);
+umugu_node_func um_layout_getfn(umugu_fn fn);
 
 /* NODE FUNCTIONS IMPLEMENTATION */
 enum { UM_EMPTY_COUNT = 128 };
@@ -28,6 +32,29 @@ um_amplitude_init(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
     return UMUGU_SUCCESS;
 }
 
+/* Frames [from, from + count) of every channel, gliding if the multiplier ramps. */
+static void
+um_amplitude_render(
+    umugu_ctx *ctx, um_amplitude *self, const umugu_samples *in, float *out, int from,
+    int count)
+{
+    const int frames = in->frame_count;
+    float gain;
+    int ramp_frames;
+    const float step =
+        um_param_ramp(ctx, &self->node, &self->multiplier, from, &gain, &ramp_frames);
+    const int ramp = um_mini(ramp_frames, count);
+    const float end = gain + step * ramp;
+    for (int ch = 0; ch < in->channel_count; ++ch) {
+        float *dst = out + ch * frames + from;
+        const float *src = in->samples + ch * frames + from;
+        for (int i = 0; i < ramp; ++i) {
+            dst[i] = src[i] * (gain + step * (i + 1));
+        }
+        ctx->kernels->gain(dst + ramp, src + ramp, end, count - ramp);
+    }
+}
+
 static inline int
 um_amplitude_process(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
 {
@@ -36,13 +63,17 @@ um_amplitude_process(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
     const umugu_node *input = um_node_get_input(ctx, node);
     node->out_pipe.channel_count = input->out_pipe.channel_count;
     float *out = um_alloc_samples(ctx, &node->out_pipe);
+    UMUGU_ASSERT(node->out_pipe.frame_count * node->out_pipe.channel_count > 0);
 
-    const int size = node->out_pipe.frame_count * node->out_pipe.channel_count;
-    UMUGU_ASSERT(size > 0);
-    for (int i = 0; i < size; ++i) {
-        out[i] = input->out_pipe.samples[i] * self->multiplier;
+    /* Split at the multiplier changes so they land on their exact frame. */
+    const int frames = node->out_pipe.frame_count;
+    um_event_cursor events = um_node_events(ctx, node);
+    const umugu_event *at;
+    int at_count;
+    for (int from = 0, n; (n = um_event_segment(ctx, &events, from, frames, &at, &at_count));
+         from += n) {
+        um_amplitude_render(ctx, self, &input->out_pipe, out, from, n);
     }
-
     return UMUGU_SUCCESS;
 }
 
@@ -84,10 +115,9 @@ um_limiter_process(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
     node->out_pipe.channel_count = input->out_pipe.channel_count;
     float *out = um_alloc_samples(ctx, &node->out_pipe);
 
-    for (int i = 0; i < node->out_pipe.frame_count * node->out_pipe.channel_count; ++i) {
-        out[i] = um_minf(input->out_pipe.samples[i], self->max);
-        out[i] = um_maxf(input->out_pipe.samples[i], self->min);
-    }
+    /* out and input can be the same buffer (UMUGU_NODE_INPLACE). */
+    const int size = node->out_pipe.frame_count * node->out_pipe.channel_count;
+    ctx->kernels->clamp(out, input->out_pipe.samples, self->min, self->max, size);
 
     return UMUGU_SUCCESS;
 }
@@ -110,11 +140,16 @@ static inline int
 um_mixer_init(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
 {
     UM_UNUSED(ctx);
+    um_mixer *self = (void *)node;
     if (flags & UMUGU_FN_INIT_DEFAULTS) {
-        um_mixer *self = (void *)node;
         self->extra_pipe_in_node_idx[0] = 0;
         self->input_count = 2;
     }
+
+    /* Disconnect the unused inputs so they are not taken as graph edges. */
+    for (int i = um_maxi(self->input_count - 1, 0); i < UMUGU_MIXER_MAX_INPUTS; ++i) {
+        self->extra_pipe_in_node_idx[i] = UMUGU_BADIDX;
+    }
     node->out_pipe.samples = NULL;
     node->out_pipe.frame_count = 0;
     node->out_pipe.channel_count = 1;
@@ -124,45 +159,40 @@ um_mixer_init(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
 static inline int
 um_mixer_process(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
 {
+    UM_UNUSED(flags);
     um_mixer *self = (void *)node;
     float *out = um_alloc_samples(ctx, &node->out_pipe);
     const int sample_count = node->out_pipe.frame_count;
+    const float *in_samples[UMUGU_MIXER_MAX_INPUTS + 1];
+    int input_count = 0;
     int signals = 0;
 
     const umugu_node *input = um_node_get_input(ctx, node);
-
-    float *in_samples = um_signal_get_channel(&input->out_pipe, node->input_channel);
-
+    in_samples[input_count++] = um_signal_get_channel(&input->out_pipe, node->input_channel);
     ++signals;
-    memcpy(out, in_samples, sizeof(float) * sample_count);
 
     for (int i = 0; i < self->input_count - 1; ++i) {
-        umugu_node *in = ctx->pipeline.nodes[self->extra_pipe_in_node_idx[i]];
-        if (!in->out_pipe.samples) {
-            um_node_dispatch(ctx, node, UMUGU_FN_PROCESS, flags);
-            assert(in->out_pipe.samples);
+        /* The pipeline schedule guarantees that the inputs have been processed. */
+        const int idx = self->extra_pipe_in_node_idx[i];
+        if (idx < 0 || idx >= ctx->pipeline.node_count) {
+            continue;
         }
+        const umugu_node *in = ctx->pipeline.nodes[idx];
 
-        float *in_samples = um_signal_get_channel(&in->out_pipe, self->extra_pipe_in_channel[i]);
+        const float *samples = um_signal_get_channel(&in->out_pipe, self->extra_pipe_in_channel[i]);
         if (memcmp(
-                in_samples, UM_EMPTY_SAMPLES,
+                samples, UM_EMPTY_SAMPLES,
                 sizeof(float) *
                     (in->out_pipe.frame_count < UM_EMPTY_COUNT
                          ? in->out_pipe.frame_count
                          : UM_EMPTY_COUNT))) {
             ++signals;
         }
-
-        for (int j = 0; j < sample_count; ++j) {
-            out[j] += in_samples[j];
-        }
+        in_samples[input_count++] = samples;
     }
 
-    /* Normalize */
-    const float inv_count = 1.0f / signals;
-    for (int i = 0; i < sample_count; i++) {
-        out[i] *= inv_count;
-    }
+    /* Sum and normalize in a single pass. */
+    ctx->kernels->mix(out, in_samples, input_count, 1.0f / signals, sample_count);
 
     return UMUGU_SUCCESS;
 }
@@ -190,41 +220,57 @@ um_oscil_init(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
         self->waveform = UMUGU_WAVEFORM_SINE;
         self->osc.freq = 440.f;
     }
+    node->prev_node = UMUGU_NO_INPUT;
     node->out_pipe.samples = NULL;
     node->out_pipe.channel_count = 1;
     node->out_pipe.frame_count = 0;
     return UMUGU_SUCCESS;
 }
 
-static inline int
-um_oscil_process(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
+static void
+um_oscil_render(um_oscil *self, umugu_samples *sig, int sample_rate)
 {
-    UM_UNUSED(flags);
-    um_oscil *self = (void *)node;
-    um_alloc_samples(ctx, &node->out_pipe);
-    const int sample_rate = ctx->pipeline.sig.sample_rate;
-
     switch (self->waveform) {
     case UMUGU_WAVEFORM_SINE:
-        um_oscillator_sine(&self->osc, &node->out_pipe, sample_rate);
+        um_oscillator_sine(&self->osc, sig, sample_rate);
         break;
     case UMUGU_WAVEFORM_SAWSIN:
-        um_oscillator_sawsin(&self->osc, &node->out_pipe);
+        um_oscillator_sawsin(&self->osc, sig);
         break;
     case UMUGU_WAVEFORM_SAW:
-        um_oscillator_saw(&self->osc, &node->out_pipe, sample_rate);
+        um_oscillator_saw(&self->osc, sig, sample_rate);
         break;
     case UMUGU_WAVEFORM_TRIANGLE:
-        um_oscillator_triangle(&self->osc, &node->out_pipe, sample_rate);
+        um_oscillator_triangle(&self->osc, sig, sample_rate);
         break;
     case UMUGU_WAVEFORM_SQUARE:
-        um_oscillator_square(&self->osc, &node->out_pipe, sample_rate);
+        um_oscillator_square(&self->osc, sig, sample_rate);
         break;
     case UMUGU_WAVEFORM_WHITE_NOISE:
-        um_noisegen_white(&self->noise, &node->out_pipe);
+        um_noisegen_white(&self->noise, sig);
         break;
     }
+}
 
+static inline int
+um_oscil_process(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
+{
+    UM_UNUSED(flags);
+    um_oscil *self = (void *)node;
+    float *out = um_alloc_samples(ctx, &node->out_pipe);
+    const int sample_rate = ctx->pipeline.sig.sample_rate;
+
+    /* A frequency or waveform event starts a new segment at its frame. */
+    um_event_cursor events = um_node_events(ctx, node);
+    const umugu_event *at;
+    int at_count;
+    const int frames = node->out_pipe.frame_count;
+    for (int from = 0, n; (n = um_event_segment(ctx, &events, from, frames, &at, &at_count));
+         from += n) {
+        umugu_samples segment = {.samples = out + from, .frame_count = n, .channel_count = 1};
+        um_oscil_render(self, &segment, sample_rate);
+    }
+    node->out_pipe.channel_count = 1;
     return UMUGU_SUCCESS;
 }
 
@@ -241,11 +287,106 @@ um_oscil_getfn(umugu_fn fn)
     }
 }
 
+/* OSCILLATOR BANK */
+static inline int
+um_oscbank_init(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
+{
+    UM_UNUSED(ctx);
+    um_oscbank *self = (void *)node;
+    if (flags & UMUGU_FN_INIT_DEFAULTS) {
+        self->voice_count = 1;
+        self->waveform = UMUGU_WAVEFORM_SAW;
+        for (int i = 0; i < UM_OSCBANK_MAX_VOICES; ++i) {
+            self->voices.freq[i] = 440.0f;
+            self->voices.amp[i] = 1.0f;
+        }
+    }
+    memset(self->voices.phase, 0, sizeof(self->voices.phase));
+    node->prev_node = UMUGU_NO_INPUT;
+    node->out_pipe.samples = NULL;
+    node->out_pipe.channel_count = 1;
+    node->out_pipe.frame_count = 0;
+    return UMUGU_SUCCESS;
+}
+
+/* Note on takes the first silent voice (or steals the last one), note off silences every
+ * voice playing that note. */
+static void
+um_oscbank_note(um_oscbank *self, int voice_count, const umugu_event *ev)
+{
+    const float freq = um_note_freq(ev->note);
+    if (ev->kind == UMUGU_EVENT_NOTE_ON) {
+        int voice = voice_count - 1;
+        for (int i = 0; i < voice_count; ++i) {
+            if (self->voices.amp[i] == 0.0f) {
+                voice = i;
+                break;
+            }
+        }
+        if (voice >= 0) {
+            self->voices.freq[voice] = freq;
+            self->voices.amp[voice] = ev->velocity / 127.0f;
+        }
+    } else if (ev->kind == UMUGU_EVENT_NOTE_OFF) {
+        for (int i = 0; i < voice_count; ++i) {
+            if (self->voices.freq[i] == freq) {
+                self->voices.amp[i] = 0.0f;
+            }
+        }
+    }
+}
+
+static inline int
+um_oscbank_process(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
+{
+    UM_UNUSED(flags);
+    um_oscbank *self = (void *)node;
+    float *out = um_alloc_samples(ctx, &node->out_pipe);
+    const float inv_rate = 1.0f / ctx->pipeline.sig.sample_rate;
+
+    um_event_cursor events = um_node_events(ctx, node);
+    const umugu_event *at;
+    int at_count;
+    const int frames = node->out_pipe.frame_count;
+    for (int from = 0, n; (n = um_event_segment(ctx, &events, from, frames, &at, &at_count));
+         from += n) {
+        const int count = um_maxi(um_mini(self->voice_count, UM_OSCBANK_MAX_VOICES), 0);
+        for (int i = 0; i < at_count; ++i) {
+            um_oscbank_note(self, count, &at[i]);
+        }
+        ctx->kernels->oscbank(out + from, &self->voices, count, self->waveform, inv_rate, n);
+    }
+    return UMUGU_SUCCESS;
+}
+
+umugu_node_func
+um_oscbank_getfn(umugu_fn fn)
+{
+    switch (fn) {
+    case UMUGU_FN_INIT:
+        return um_oscbank_init;
+    case UMUGU_FN_PROCESS:
+        return um_oscbank_process;
+    default:
+        return NULL;
+    }
+}
+
 /* WAV_PLAYER */
 static inline void
 um_wavplayer_defaults(umugu_ctx *ctx, um_wavplayer *self)
 {
     self->node.out_pipe.samples = NULL;
+    self->map = NULL;
+    self->map_size = 0;
+    self->stream = NULL;
+    self->position = 0;
+    self->seek = -1;
+    self->underruns = 0;
+    self->quality = UM_RESAMPLE_BALANCED;
+    self->resampler = NULL;
+    self->loop = false;
+    self->streaming = false;
     if (!*ctx->fallback_wav_file) {
         strncpy(self->filename, "../assets/audio/pirri.wav", UMUGU_PATH_LEN); // src Pirri.wav
     } else {
@@ -253,82 +394,227 @@ um_wavplayer_defaults(umugu_ctx *ctx, um_wavplayer *self)
     }
 }
 
+static int
+um_wavplayer_open_stream(umugu_ctx *ctx, um_wavplayer *self)
+{
+    const int ring_frames =
+        um_maxi(UM_WAVPLAYER_STREAM_FRAMES, 4 * ctx->pipeline.sig.samples.frame_count);
+    self->stream = um_stream_open(ctx, self->filename, &self->wav, &self->loop, ring_frames);
+    if (!self->stream) {
+        return UMUGU_ERR_FILE;
+    }
+
+    if (self->wav.samples.channel_count > UM_WAVPLAYER_MAX_CHANNELS) {
+        ctx->io.log("WavPlayer: too many channels (%d)\n", self->wav.samples.channel_count);
+        um_stream_close(self->stream);
+        self->stream = NULL;
+        return UMUGU_ERR_FILE;
+    }
+
+    if (self->position > 0) {
+        um_stream_seek(self->stream, um_mini(self->position, self->wav.samples.frame_count));
+    }
+    return self->wav.samples.frame_count;
+}
+
+/* Files at another rate are converted to the pipeline one as they are read. */
+static int
+um_wavplayer_init_resampler(umugu_ctx *ctx, um_wavplayer *self)
+{
+    if (self->wav.sample_rate == ctx->pipeline.sig.sample_rate) {
+        return UMUGU_SUCCESS;
+    }
+    self->resampler = um_resampler_create(
+        ctx, self->wav.sample_rate, ctx->pipeline.sig.sample_rate,
+        self->wav.samples.channel_count, self->quality);
+    return self->resampler ? UMUGU_SUCCESS : UMUGU_ERR_STREAM;
+}
+
+/* Files are mapped at init: the process function decodes straight from the mapped pages,
+ * so looping and seeking are pointer arithmetic (no syscalls or locks in the audio
+ * callback). Streaming (forced or for big files) reads them ahead in a background thread.
+ * The defaults init only reads the format for the attributes. */
 static inline int
 um_wavplayer_init(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
 {
     um_wavplayer *self = (um_wavplayer *)node;
+    node->prev_node = UMUGU_NO_INPUT;
+    self->map = NULL;
+    self->stream = NULL;
+    self->resampler = NULL;
 
     if (!*self->filename || (flags & UMUGU_FN_INIT_DEFAULTS)) {
         um_wavplayer_defaults(ctx, self);
     }
 
-    self->file_handle = fopen(self->filename, "rb");
-    if (!self->file_handle) {
-        ctx->io.log("Couldn't open %s\n", self->filename);
+    struct stat st;
+    if (!stat(self->filename, &st) && st.st_size > UM_WAVPLAYER_MAP_MAX_BYTES) {
+        self->streaming = true;
+    }
+
+    if (self->streaming && !(flags & UMUGU_FN_INIT_DEFAULTS)) {
+        const int frames = um_wavplayer_open_stream(ctx, self);
+        if (frames < UMUGU_SUCCESS) {
+            return frames;
+        }
+        self->position = um_mini(um_maxi(self->position, 0), frames);
+        node->out_pipe.channel_count = self->wav.samples.channel_count;
+        return um_wavplayer_init_resampler(ctx, self);
+    }
+
+    void *map = NULL;
+    size_t map_size = 0;
+    const int frames = um_wav_map(self->filename, &self->wav, &map, &map_size);
+    if (frames < UMUGU_SUCCESS) {
+        ctx->io.log("Couldn't open or unsupported wav format: %s\n", self->filename);
         return UMUGU_ERR_FILE;
     }
 
-    /* Advance the file read ptr to where the waveform data starts.
-     * While I'm here I'm going to assign the signal format from the header. */
-    char header[44];
-    fread(header, 44, 1, self->file_handle);
-    self->wav.interleaved_channels = true;
-    self->wav.samples.frame_count = 0;
-    self->wav.samples.channel_count = *(int16_t *)(header + 22);
-    self->wav.sample_rate = *(int *)(header + 24);
-
-    const int sample_size = header[34] / 8;
-    if (sample_size == 2) {
-        self->wav.format = UMUGU_TYPE_INT16;
-    } else if (sample_size == 4) {
-        self->wav.format = UMUGU_TYPE_FLOAT;
-    } else if (sample_size == 1) {
-        self->wav.format = UMUGU_TYPE_UINT8;
-    } else {
-        assert(0 && "Unexpected sample_size.");
+    if (self->wav.samples.channel_count > UM_WAVPLAYER_MAX_CHANNELS) {
+        ctx->io.log("WavPlayer: too many channels (%d)\n", self->wav.samples.channel_count);
+        um_wav_unmap(map, map_size);
+        return UMUGU_ERR_FILE;
     }
 
+    self->position = um_mini(um_maxi(self->position, 0), frames);
     node->out_pipe.channel_count = self->wav.samples.channel_count;
-    return UMUGU_SUCCESS;
+    if (flags & UMUGU_FN_INIT_DEFAULTS) {
+        um_wav_unmap(map, map_size);
+        self->wav.samples.samples = NULL;
+        return UMUGU_SUCCESS;
+    }
+
+    self->map = map;
+    self->map_size = map_size;
+    return um_wavplayer_init_resampler(ctx, self);
+}
+
+/* Decodes from the mapping. Returns the frames written. */
+static inline int
+um_wavplayer_read_map(umugu_ctx *ctx, um_wavplayer *self, float *out, int count, int32_t seek)
+{
+    const int channels = self->node.out_pipe.channel_count;
+    const int total = self->wav.samples.frame_count;
+    const size_t frame_bytes = um_signal_stride(&self->wav);
+    if (seek >= 0) {
+        self->position = um_mini(seek, total);
+    }
+
+    float *dst[UM_WAVPLAYER_MAX_CHANNELS];
+    int done = 0;
+    while (done < count) {
+        if (self->position >= total) {
+            if (!self->loop || !total) {
+                break;
+            }
+            self->position = 0;
+        }
+
+        const int frames = um_mini(count - done, total - self->position);
+        for (int ch = 0; ch < channels; ++ch) {
+            dst[ch] = out + ch * count + done;
+        }
+        const uint8_t *src =
+            (const uint8_t *)self->wav.samples.samples + self->position * frame_bytes;
+        ctx->kernels->decode[self->wav.format](dst, src, channels, frames);
+        self->position += frames;
+        done += frames;
+    }
+    return done;
+}
+
+/* Decodes the frames already read ahead, never waits for the disk (but offline renders).
+ * Returns the frames written. */
+static inline int
+um_wavplayer_read_stream(umugu_ctx *ctx, um_wavplayer *self, float *out, int count, int32_t seek)
+{
+    const int channels = self->node.out_pipe.channel_count;
+    const int total = self->wav.samples.frame_count;
+    if (seek >= 0) {
+        self->position = um_mini(seek, total);
+        um_stream_seek(self->stream, self->position);
+    }
+
+    float *dst[UM_WAVPLAYER_MAX_CHANNELS];
+    const void *src;
+    int done = 0;
+    int frames;
+    while (done < count) {
+        if (!(frames = um_stream_peek(self->stream, &src, count - done))) {
+            if (ctx->offline && !um_stream_ready(self->stream, 1)) {
+                um_stream_wait(self->stream);
+                continue;
+            }
+            break;
+        }
+        for (int ch = 0; ch < channels; ++ch) {
+            dst[ch] = out + ch * count + done;
+        }
+        ctx->kernels->decode[self->wav.format](dst, src, channels, frames);
+        um_stream_consume(self->stream, frames);
+        /* The read ahead data wraps around the end of the file when looping, a read ending
+         * at the end leaves the position at the start. */
+        self->position += frames;
+        while (self->loop && self->position >= total) {
+            self->position -= total;
+        }
+        done += frames;
+    }
+
+    if (done < count && um_stream_starved(self->stream)) {
+        self->underruns++;
+        __atomic_fetch_add(&ctx->stream_underruns, 1, __ATOMIC_RELAXED);
+    }
+    return done;
+}
+
+/* Reads count frames of the file (planar, count per channel) with silence after its end
+ * (or while the stream catches up). */
+static inline void
+um_wavplayer_read(umugu_ctx *ctx, um_wavplayer *self, float *out, int count, int32_t seek)
+{
+    int done = 0;
+    if (self->stream) {
+        done = um_wavplayer_read_stream(ctx, self, out, count, seek);
+    } else if (self->map) {
+        done = um_wavplayer_read_map(ctx, self, out, count, seek);
+    }
+
+    for (int ch = 0; ch < self->node.out_pipe.channel_count && done < count; ++ch) {
+        memset(out + ch * count + done, 0, sizeof(float) * (count - done));
+    }
 }
 
-/* TODO: Implement this node type mmapping the wav. */
 static inline int
 um_wavplayer_process(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
 {
     UM_UNUSED(flags);
     um_wavplayer *self = (void *)node;
-    assert(
-        ((self->wav.samples.channel_count == 1) ||
-         ((self->wav.samples.channel_count == 2) && (self->wav.interleaved_channels))) &&
-        "Wav file with non-interleaved stereo signals?");
-
-    void *src = um_alloc_signal(ctx, &self->wav);
-    fread(
-        src,
-        um_type_sizeof(self->wav.format) * self->wav.samples.frame_count *
-            self->wav.samples.channel_count,
-        1, self->file_handle);
-
-    /* TODO: Sample rate conversor. */
-    const int sample_rate = ctx->pipeline.sig.sample_rate;
-    if (self->wav.sample_rate != sample_rate) {
-        ctx->io.log("[ERR] WavPlayer: sample rate must be %d.", sample_rate);
-        return UMUGU_ERR_STREAM;
-    }
-
     float *restrict out = um_alloc_samples(ctx, &node->out_pipe);
     const int count = node->out_pipe.frame_count;
-    for (int i = 0; i < count; ++i) {
-        for (int ch = 0; ch < node->out_pipe.channel_count; ++ch) {
-            out[ch * count + i] = um_signal_samplef(&self->wav, i, ch);
-            ctx->io.log("{%.2f, %.2f} ");
-            if (!ch && !(i % 6)) {
-                ctx->io.log("\n");
-            }
-        }
+    const int32_t seek = __atomic_exchange_n(&self->seek, -1, __ATOMIC_ACQUIRE);
+    if (!self->resampler) {
+        um_wavplayer_read(ctx, self, out, count, seek);
+        return UMUGU_SUCCESS;
     }
 
+    /* The history before a seek would blend the old position into the new one. */
+    if (seek >= 0) {
+        um_resampler_reset(self->resampler);
+    }
+
+    const int channels = node->out_pipe.channel_count;
+    const int in_count = um_resampler_input_frames(self->resampler, count);
+    float *in = um_alloctmp(ctx, sizeof(float) * in_count * channels);
+    um_wavplayer_read(ctx, self, in, in_count, seek);
+
+    const float *src[UM_WAVPLAYER_MAX_CHANNELS];
+    float *dst[UM_WAVPLAYER_MAX_CHANNELS];
+    for (int ch = 0; ch < channels; ++ch) {
+        src[ch] = in + ch * in_count;
+        dst[ch] = out + ch * count;
+    }
+    um_resampler_process(self->resampler, src, dst, count);
     return UMUGU_SUCCESS;
 }
 
@@ -337,9 +623,11 @@ um_wavplayer_destroy(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
 {
     UM_UNUSED(ctx), UM_UNUSED(flags);
     um_wavplayer *self = (void *)node;
-    if (self->file_handle) {
-        fclose(self->file_handle);
-        self->file_handle = NULL;
+    um_wav_unmap(self->map, self->map_size);
+    self->map = NULL;
+    if (self->stream) {
+        um_stream_close(self->stream);
+        self->stream = NULL;
     }
     return UMUGU_SUCCESS;
 }
@@ -359,6 +647,294 @@ um_wavplayer_getfn(umugu_fn fn)
     }
 }
 
+/* CONVOLVER */
+static inline int
+um_convolver_partition_size(umugu_ctx *ctx, const um_convolver *self)
+{
+    int size = self->partition_size;
+    if (size <= 0) {
+        size = ctx->pipeline.sig.samples.frame_count ? ctx->pipeline.sig.samples.frame_count : 512;
+    }
+    size = um_maxi(um_mini(size, UM_CONVOLVER_MAX_PARTITION), 2);
+    int pow2 = 2;
+    while (pow2 < size) {
+        pow2 *= 2;
+    }
+    return pow2;
+}
+
+/* Maps the impulse response and keeps the spectra of its partitions. */
+static int
+um_convolver_load(umugu_ctx *ctx, um_convolver *self, const umugu_node *input)
+{
+    void *map = NULL;
+    size_t map_size = 0;
+    umugu_signal ir;
+    const int ir_frames = um_wav_map(self->filename, &ir, &map, &map_size);
+    if (ir_frames <= 0) {
+        ctx->io.log("Convolver: couldn't open, unsupported or empty wav %s\n", self->filename);
+        um_wav_unmap(map, map_size);
+        return UMUGU_ERR_FILE;
+    }
+    if (ir.sample_rate != ctx->pipeline.sig.sample_rate) {
+        ctx->io.log(
+            "[WARN] Convolver: impulse response sample rate %d, pipeline %d.\n", ir.sample_rate,
+            ctx->pipeline.sig.sample_rate);
+    }
+
+    const int size = um_convolver_partition_size(ctx, self);
+    const int bins = size + 1;
+    const int count = (ir_frames + size - 1) / size;
+    const int ir_channels = um_mini(ir.samples.channel_count, UM_CONVOLVER_MAX_CHANNELS);
+    const int channels = um_mini(
+        um_maxi(ir_channels, input ? input->out_pipe.channel_count : 1),
+        UM_CONVOLVER_MAX_CHANNELS);
+
+    self->partition_size = size;
+    self->partition_count = count;
+    self->ir_channels = ir_channels;
+    self->channels = channels;
+    self->plan = um_fft_plan_create(ctx, 2 * size);
+    self->ir = um_allocprs(ctx, sizeof(um_complex) * bins * count * ir_channels);
+    self->fdl = um_allocprs(ctx, sizeof(um_complex) * bins * count * channels);
+    self->acc = um_allocprs(ctx, sizeof(um_complex) * bins);
+    self->window = um_allocprs(ctx, sizeof(float) * 2 * size * channels);
+    self->out = um_allocprs(ctx, sizeof(float) * size * channels);
+    self->tmp = um_allocprs(ctx, sizeof(float) * 2 * size);
+
+    /* The inverse transform is not normalized. */
+    const float scale = 1.0f / (2 * size);
+    const size_t frame_bytes = um_signal_stride(&ir);
+    const uint8_t *data = (const uint8_t *)ir.samples.samples;
+    for (int p = 0; p < count; ++p) {
+        ir.samples.samples = (float *)(data + (size_t)p * size * frame_bytes);
+        ir.samples.frame_count = um_mini(size, ir_frames - p * size);
+        for (int ch = 0; ch < ir_channels; ++ch) {
+            memset(self->tmp, 0, sizeof(float) * 2 * size);
+            for (int i = 0; i < ir.samples.frame_count; ++i) {
+                self->tmp[i] = um_signal_samplef(&ir, i, ch) * scale;
+            }
+            um_fft_real_forward(self->plan, self->tmp, self->ir + (size_t)(ch * count + p) * bins);
+        }
+    }
+    um_wav_unmap(map, map_size);
+
+    memset(self->fdl, 0, sizeof(um_complex) * bins * count * channels);
+    memset(self->window, 0, sizeof(float) * 2 * size * channels);
+    memset(self->out, 0, sizeof(float) * size * channels);
+    self->fdl_head = 0;
+    self->fill = 0;
+    return UMUGU_SUCCESS;
+}
+
+static inline int
+um_convolver_init(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
+{
+    um_convolver *self = (void *)node;
+    self->plan = NULL;
+    self->partition_count = 0;
+    self->channels = 0;
+    if (flags & UMUGU_FN_INIT_DEFAULTS) {
+        memset(self->filename, 0, UMUGU_PATH_LEN);
+        self->partition_size = 0;
+        self->gain = 1.0f;
+        node->out_pipe.samples = NULL;
+        node->out_pipe.channel_count = 1;
+        return UMUGU_SUCCESS;
+    }
+
+    const umugu_node *input = um_node_get_input(ctx, node);
+    if (!input) {
+        ctx->io.log("Convolver: no input node.\n");
+        return UMUGU_ERR_GRAPH;
+    }
+    int err = *self->filename ? um_convolver_load(ctx, self, input) : UMUGU_SUCCESS;
+    node->out_pipe.channel_count = self->channels ? self->channels : input->out_pipe.channel_count;
+    return err;
+}
+
+/* Convolves the buffered partition: its spectrum enters the delay line, which is
+ * multiplied partition by partition with the impulse response ones. The last half of
+ * the inverse transform is the linear convolution (overlap-save). */
+static void
+um_convolver_partition(umugu_ctx *ctx, um_convolver *self)
+{
+    UM_TRACE_ZONE();
+    const int size = self->partition_size;
+    const int bins = size + 1;
+    const int count = self->partition_count;
+    for (int ch = 0; ch < self->channels; ++ch) {
+        float *window = self->window + (size_t)ch * 2 * size;
+        um_complex *fdl = self->fdl + (size_t)ch * count * bins;
+        const um_complex *ir =
+            self->ir + (size_t)um_mini(ch, self->ir_channels - 1) * count * bins;
+        um_fft_real_forward(self->plan, window, fdl + (size_t)self->fdl_head * bins);
+
+        memset(self->acc, 0, sizeof(um_complex) * bins);
+        for (int p = 0, slot = self->fdl_head; p < count; ++p) {
+            ctx->kernels->cmac(self->acc, fdl + (size_t)slot * bins, ir + (size_t)p * bins, bins);
+            slot = slot ? slot - 1 : count - 1;
+        }
+
+        um_fft_real_inverse(self->plan, self->acc, self->tmp);
+        memcpy(self->out + (size_t)ch * size, self->tmp + size, sizeof(float) * size);
+        memcpy(window, window + size, sizeof(float) * size);
+    }
+    self->fdl_head = (self->fdl_head + 1) % count;
+}
+
+static inline int
+um_convolver_process(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
+{
+    UM_UNUSED(flags);
+    um_convolver *self = (void *)node;
+    const umugu_node *input = um_node_get_input(ctx, node);
+    if (!input) { /* Not connected: silence. */
+        float *out = um_alloc_samples(ctx, &node->out_pipe);
+        memset(out, 0, sizeof(float) * node->out_pipe.frame_count * node->out_pipe.channel_count);
+        return UMUGU_SUCCESS;
+    }
+    const umugu_samples *in = &input->out_pipe;
+    if (!self->plan) { /* No impulse response: dry signal. */
+        node->out_pipe.channel_count = in->channel_count;
+        float *out = um_alloc_samples(ctx, &node->out_pipe);
+        memcpy(out, in->samples, sizeof(float) * in->frame_count * in->channel_count);
+        return UMUGU_SUCCESS;
+    }
+
+    node->out_pipe.channel_count = self->channels;
+    float *out = um_alloc_samples(ctx, &node->out_pipe);
+    const int frames = node->out_pipe.frame_count;
+    const int size = self->partition_size;
+    const bool direct = !self->fill && !(frames % size);
+    for (int pos = 0; pos < frames;) {
+        const int n = um_mini(frames - pos, size - self->fill);
+        const int offset = direct ? 0 : self->fill;
+        for (int ch = 0; ch < self->channels; ++ch) {
+            const float *src = in->samples + (size_t)um_mini(ch, in->channel_count - 1) * frames;
+            memcpy(
+                self->window + (size_t)ch * 2 * size + size + self->fill, src + pos,
+                sizeof(float) * n);
+            if (!direct) { /* One partition of latency. */
+                memcpy(out + ch * frames + pos, self->out + ch * size + offset, sizeof(float) * n);
+            }
+        }
+
+        self->fill += n;
+        if (self->fill == size) {
+            um_convolver_partition(ctx, self);
+            self->fill = 0;
+        }
+
+        for (int ch = 0; direct && ch < self->channels; ++ch) {
+            memcpy(out + ch * frames + pos, self->out + ch * size, sizeof(float) * n);
+        }
+        pos += n;
+    }
+
+    ctx->kernels->gain(out, out, self->gain, frames * self->channels);
+    return UMUGU_SUCCESS;
+}
+
+umugu_node_func
+um_convolver_getfn(umugu_fn fn)
+{
+    switch (fn) {
+    case UMUGU_FN_INIT:
+        return um_convolver_init;
+    case UMUGU_FN_PROCESS:
+        return um_convolver_process;
+    default:
+        return NULL;
+    }
+}
+
+/* RESAMPLE */
+enum { UM_RESAMPLE_MAX_CHANNELS = 32 };
+
+/* Device channels, missing input ones are repeated like the Output node does. */
+static inline int
+um_resample_channels(const umugu_ctx *ctx)
+{
+    return um_maxi(um_mini(ctx->io.out_audio.samples.channel_count, UM_RESAMPLE_MAX_CHANNELS), 1);
+}
+
+static inline int
+um_resample_init(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
+{
+    um_resample *self = (void *)node;
+    node->out_pipe.samples = NULL;
+    node->out_pipe.frame_count = 0;
+    self->resampler = NULL;
+    if (flags & UMUGU_FN_INIT_DEFAULTS) {
+        self->quality = UM_RESAMPLE_BALANCED;
+        self->out_rate = ctx->io.out_audio.sample_rate;
+        return UMUGU_SUCCESS;
+    }
+
+    /* The rate of the output when the pipeline is initialized (see um_pipeline_init). */
+    self->out_rate = ctx->io.out_audio.sample_rate;
+    if (self->out_rate == ctx->pipeline.sig.sample_rate) {
+        return UMUGU_SUCCESS;
+    }
+
+    /* Only one conversion drives the pipeline block size. This also keeps the converter
+     * when the inits run again (um_pipeline_init after setting up the nodes). */
+    if (ctx->resampler) {
+        self->resampler = ctx->resampler;
+        return UMUGU_SUCCESS;
+    }
+
+    self->resampler = um_resampler_create(
+        ctx, ctx->pipeline.sig.sample_rate, self->out_rate, um_resample_channels(ctx),
+        self->quality);
+    if (!self->resampler) {
+        return UMUGU_ERR_STREAM;
+    }
+    ctx->resampler = self->resampler;
+    return UMUGU_SUCCESS;
+}
+
+static inline int
+um_resample_process(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
+{
+    UM_UNUSED(flags);
+    um_resample *self = (void *)node;
+    const umugu_node *input = um_node_get_input(ctx, node);
+    if (!self->resampler) {
+        node->out_pipe = input->out_pipe;
+        return UMUGU_SUCCESS;
+    }
+
+    const int channels = um_resample_channels(ctx);
+    node->out_pipe.channel_count = channels;
+    node->out_pipe.frame_count = ctx->out_frames;
+    node->out_pipe.samples = um_alloctmp(ctx, sizeof(float) * ctx->out_frames * channels);
+
+    const umugu_samples *in = &input->out_pipe;
+    const float *src[UM_RESAMPLE_MAX_CHANNELS];
+    float *dst[UM_RESAMPLE_MAX_CHANNELS];
+    for (int ch = 0; ch < channels; ++ch) {
+        src[ch] = um_signal_get_channel(in, ch < in->channel_count ? ch : in->channel_count - 1);
+        dst[ch] = node->out_pipe.samples + ch * ctx->out_frames;
+    }
+    um_resampler_process(self->resampler, src, dst, ctx->out_frames);
+    return UMUGU_SUCCESS;
+}
+
+umugu_node_func
+um_resample_getfn(umugu_fn fn)
+{
+    switch (fn) {
+    case UMUGU_FN_INIT:
+        return um_resample_init;
+    case UMUGU_FN_PROCESS:
+        return um_resample_process;
+    default:
+        return NULL;
+    }
+}
+
 /* OUTPUT */
 static inline int
 um_output_init(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
@@ -369,6 +945,15 @@ um_output_init(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
     return UMUGU_SUCCESS;
 }
 
+enum { UM_OUTPUT_MAX_CHANNELS = 32 };
+
+/* Channels missing in the input (e.g. mono into a stereo device) repeat its last one. */
+static inline const float *
+um_output_channel(const umugu_samples *in, int ch)
+{
+    return um_signal_get_channel(in, ch < in->channel_count ? ch : in->channel_count - 1);
+}
+
 static inline int
 um_output_process(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
 {
@@ -377,96 +962,57 @@ um_output_process(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
 
     umugu_signal sigout = ctx->io.out_audio;
     node->out_pipe.samples = sigout.samples.samples;
-    /* TODO: SampleRate conversion if the output is different. */
-    switch (sigout.format) {
-    case UMUGU_TYPE_FLOAT: {
-        float *out = sigout.samples.samples;
-        if (sigout.interleaved_channels) {
-            for (int i = 0; i < sigout.samples.frame_count; ++i) {
-                for (int ch = 0; ch < sigout.samples.channel_count; ++ch) {
-                    *out++ = um_signal_get_channel(&input->out_pipe, ch)[i];
-                }
-            }
-        } else {
-            for (int ch = 0; ch < sigout.samples.channel_count; ++ch) {
-                for (int i = 0; i < sigout.samples.frame_count; ++i) {
-                    *out++ = um_signal_get_channel(&input->out_pipe, ch)[i];
-                }
-            }
-        }
-        break;
+    /* Expects the device rate: a Resampler node before it converts the pipeline one. */
+    um_convert_fn convert = ctx->kernels->convert[sigout.format];
+    if (!convert) {
+        ctx->io.log("[ERR] Output: invalid sample data type.");
+        return UMUGU_SUCCESS;
     }
-    case UMUGU_TYPE_INT32: {
-        int32_t *out = (void *)sigout.samples.samples;
-        if (sigout.interleaved_channels) {
-            for (int i = 0; i < sigout.samples.frame_count; ++i) {
-                for (int ch = 0; ch < sigout.samples.channel_count; ++ch) {
-                    *out++ = um_signal_get_channel(&input->out_pipe, ch)[i] * 2147483648.0f;
-                }
-            }
-        } else {
-            for (int ch = 0; ch < sigout.samples.channel_count; ++ch) {
-                for (int i = 0; i < sigout.samples.frame_count; ++i) {
-                    *out++ = um_signal_get_channel(&input->out_pipe, ch)[i] * 2147483648.0f;
-                }
+
+    const int channels = sigout.samples.channel_count;
+    const int frames = sigout.samples.frame_count;
+    umugu_samples in = input->out_pipe;
+    if (in.interleaved && in.channel_count > 1) {
+        /* Same layout as the device: it only needs a copy, if the plan did not render the
+         * input straight into the device buffer. The crossfades mix planar channels. */
+        if (!ctx->swap && sigout.format == UMUGU_TYPE_FLOAT && sigout.interleaved_channels &&
+            channels == in.channel_count) {
+            if (in.samples != (float *)sigout.samples.samples) {
+                memcpy(sigout.samples.samples, in.samples, sizeof(float) * frames * channels);
             }
+            return UMUGU_SUCCESS;
         }
-        break;
-    }
-    case UMUGU_TYPE_INT16: {
-        int16_t *out = (void *)sigout.samples.samples;
-        if (sigout.interleaved_channels) {
-            for (int i = 0; i < sigout.samples.frame_count; ++i) {
-                for (int ch = 0; ch < sigout.samples.channel_count; ++ch) {
-                    *out++ = um_signal_get_channel(&input->out_pipe, ch)[i] * 32768.0f;
-                }
-            }
-        } else {
-            for (int ch = 0; ch < sigout.samples.channel_count; ++ch) {
-                for (int i = 0; i < sigout.samples.frame_count; ++i) {
-                    *out++ = um_signal_get_channel(&input->out_pipe, ch)[i] * 32768.0f;
-                }
-            }
+        in.samples = um_alloctmp(ctx, sizeof(float) * in.frame_count * in.channel_count);
+        in.interleaved = false;
+        float *planar[in.channel_count];
+        for (int ch = 0; ch < in.channel_count; ++ch) {
+            planar[ch] = in.samples + ch * in.frame_count;
         }
-        break;
+        ctx->kernels->decode[UMUGU_TYPE_FLOAT](
+            planar, input->out_pipe.samples, in.channel_count, in.frame_count);
     }
-    case UMUGU_TYPE_INT8: {
-        int8_t *out = (void *)sigout.samples.samples;
-        if (sigout.interleaved_channels) {
-            for (int i = 0; i < sigout.samples.frame_count; ++i) {
-                for (int ch = 0; ch < sigout.samples.channel_count; ++ch) {
-                    *out++ = um_signal_get_channel(&input->out_pipe, ch)[i] * 128.0f;
-                }
-            }
-        } else {
-            for (int ch = 0; ch < sigout.samples.channel_count; ++ch) {
-                for (int i = 0; i < sigout.samples.frame_count; ++i) {
-                    *out++ = um_signal_get_channel(&input->out_pipe, ch)[i] * 128.0f;
-                }
-            }
-        }
-        break;
+
+    const float *src[UM_OUTPUT_MAX_CHANNELS];
+    UMUGU_ASSERT(channels <= UM_OUTPUT_MAX_CHANNELS);
+    for (int ch = 0; ch < channels; ++ch) {
+        src[ch] = um_output_channel(&in, ch);
     }
-    case UMUGU_TYPE_UINT8: {
-        uint8_t *out = (void *)sigout.samples.samples;
-        if (sigout.interleaved_channels) {
-            for (int i = 0; i < sigout.samples.frame_count; ++i) {
-                for (int ch = 0; ch < sigout.samples.channel_count; ++ch) {
-                    *out++ = (um_signal_get_channel(&input->out_pipe, ch)[i] + 1.0f) * 128.0f;
-                }
-            }
-        } else {
-            for (int ch = 0; ch < sigout.samples.channel_count; ++ch) {
-                for (int i = 0; i < sigout.samples.frame_count; ++i) {
-                    *out++ = (um_signal_get_channel(&input->out_pipe, ch)[i] + 1.0f) * 128.0f;
-                }
-            }
-        }
-        break;
+    /* While a swapped out pipeline fades out, both outputs are mixed. */
+    if (ctx->swap && um_swap_output(ctx, src, channels, frames)) {
+        return UMUGU_SUCCESS;
     }
-    default:
-        ctx->io.log("[ERR] Output: invalid sample data type.");
-        break;
+    /* Zero-copy: the plan rendered the input straight into the device buffer. */
+    if (src[0] == (const float *)sigout.samples.samples) {
+        return UMUGU_SUCCESS;
+    }
+
+    if (sigout.interleaved_channels) {
+        convert(sigout.samples.samples, src, channels, frames);
+    } else {
+        const size_t channel_bytes = (size_t)frames * um_type_sizeof(sigout.format);
+        for (int ch = 0; ch < channels; ++ch) {
+            convert((uint8_t *)sigout.samples.samples + ch * channel_bytes, &src[ch], 1, frames);
+        }
     }
 
     return UMUGU_SUCCESS;
@@ -484,3 +1030,47 @@ um_output_getfn(umugu_fn fn)
         return NULL;
     }
 }
+
+/* LAYOUT */
+static inline int
+um_layout_process(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
+{
+    UM_UNUSED(flags);
+    um_layout *self = (void *)node;
+    const umugu_node *input = um_node_get_input(ctx, node);
+    const umugu_samples *in = &input->out_pipe;
+    node->out_pipe.channel_count = in->channel_count;
+    node->out_pipe.interleaved = self->interleaved;
+    float *out = um_alloc_samples(ctx, &node->out_pipe);
+    const int channels = in->channel_count;
+    const int frames = node->out_pipe.frame_count;
+
+    /* Mono or already in the layout (placed by hand): a plain copy. */
+    if (channels == 1 || in->interleaved == self->interleaved) {
+        memcpy(out, in->samples, sizeof(float) * frames * channels);
+        return UMUGU_SUCCESS;
+    }
+
+    float *planar[channels];
+    for (int ch = 0; ch < channels; ++ch) {
+        planar[ch] = (self->interleaved ? in->samples : out) + ch * frames;
+    }
+    if (self->interleaved) {
+        const float *const *src = (const float *const *)planar;
+        ctx->kernels->convert[UMUGU_TYPE_FLOAT](out, src, channels, frames);
+    } else {
+        ctx->kernels->decode[UMUGU_TYPE_FLOAT](planar, in->samples, channels, frames);
+    }
+    return UMUGU_SUCCESS;
+}
+
+umugu_node_func
+um_layout_getfn(umugu_fn fn)
+{
+    switch (fn) {
+    case UMUGU_FN_PROCESS:
+        return um_layout_process;
+    default:
+        return NULL;
+    }
+}
@@ -0,0 +1,575 @@
+#include "umugu.h"
+
+#include "umugu_internal.h"
+
+/* Events from any thread to the audio one. The queue is a bounded MPSC ring of sequenced
+ * cells (the producers claim a cell moving the tail with a CAS, the cell sequence
+ * publishes it). The audio thread drains it at the start of every block into the
+ * pending events (sorted by frame), together with the ones of the automation curves.
+ * The events due in the block are grouped by node: nodes with UMUGU_NODE_EVENTS apply
+ * them while rendering (um_event_segment), the others before the block starts. Node
+ * memory is only written while nothing else reads it. */
+
+typedef struct {
+    uint64_t seq; /* Position of the cell + 1 when published, + capacity when free. */
+    umugu_event ev;
+} um_event_cell;
+
+/* Float attribute glide. Its value after the frame i of the block (i >= start) is
+ * base + step * min(i - start + 1, remaining). */
+typedef struct {
+    float *param;
+    float base;
+    float target;
+    float step;
+    int32_t start; /* Block frame where it starts, 0 for the ramps of previous blocks. */
+    int32_t remaining;
+} um_param_ramp_state;
+
+/* Delta encoded points, 8 bytes each. */
+typedef struct {
+    uint32_t delta; /* Frames after the previous point. */
+    float value;
+} um_automation_point;
+
+typedef struct {
+    uint16_t node;
+    uint16_t attrib;
+    int32_t element;
+    int32_t count;
+    int32_t next; /* Next point to emit. */
+    int64_t next_frame;
+    bool started; /* The first point emitted also sets the value. */
+    um_automation_point *points;
+} um_automation;
+
+struct um_params {
+    uint64_t tail; /* Producers. */
+    char pad0[56];
+    uint64_t head; /* Audio thread. */
+    char pad1[56];
+    um_event_cell *cells;
+    int32_t pending_count;
+    int32_t block_count;
+    int32_t automation_count;
+    umugu_event pending[UM_EVENT_PENDING_CAPACITY]; /* Sorted by frame. */
+    umugu_event block[UM_EVENT_BLOCK_CAPACITY];     /* Due this block, by node and frame. */
+    umugu_event due[UM_EVENT_BLOCK_CAPACITY];
+    uint16_t *node_first; /* By node, of node_capacity. */
+    uint16_t *node_count;
+    /* Pipeline the producers check the events against (see um_params_publish). */
+    const umugu_pipeline *live;
+    umugu_pipeline loaded; /* Copy of the context one, live until a swap. */
+    /* Glides by node (UM_NODE_MAX_RAMPS each): nodes processed in parallel only touch
+     * their own. */
+    um_param_ramp_state *ramps;
+    uint8_t *ramp_count;
+    int32_t node_capacity;
+    um_automation automation[UM_AUTOMATION_MAX_CURVES];
+};
+
+um_params *
+um_params_create(umugu_ctx *ctx)
+{
+    UM_TRACE_ZONE();
+    um_params *p = um_allocprs(ctx, sizeof(um_params));
+    memset(p, 0, sizeof(um_params));
+    p->node_capacity = ctx->pipeline_capacity;
+    p->live = &p->loaded;
+    p->node_first = um_allocprs(ctx, p->node_capacity * sizeof(uint16_t));
+    p->node_count = um_allocprs(ctx, p->node_capacity * sizeof(uint16_t));
+    p->ramps =
+        um_allocprs(ctx, p->node_capacity * UM_NODE_MAX_RAMPS * sizeof(um_param_ramp_state));
+    p->ramp_count = um_allocprs(ctx, p->node_capacity * sizeof(uint8_t));
+    memset(p->ramp_count, 0, p->node_capacity * sizeof(uint8_t));
+    p->cells = um_allocprs(ctx, sizeof(um_event_cell) * UM_PARAM_QUEUE_CAPACITY);
+    for (int i = 0; i < UM_PARAM_QUEUE_CAPACITY; ++i) {
+        p->cells[i].seq = i;
+    }
+    return p;
+}
+
+void
+um_params_reserve(umugu_ctx *ctx, int capacity)
+{
+    um_params *p = ctx->params;
+    if (capacity > p->node_capacity) {
+        p->node_first = um_allocprs(ctx, capacity * sizeof(uint16_t));
+        p->node_count = um_allocprs(ctx, capacity * sizeof(uint16_t));
+        /* The running glides are kept. */
+        const size_t ramps = UM_NODE_MAX_RAMPS * sizeof(um_param_ramp_state);
+        um_param_ramp_state *ramp = um_allocprs(ctx, capacity * ramps);
+        uint8_t *ramp_count = um_allocprs(ctx, capacity * sizeof(uint8_t));
+        memcpy(ramp, p->ramps, p->node_capacity * ramps);
+        memcpy(ramp_count, p->ramp_count, p->node_capacity * sizeof(uint8_t));
+        memset(ramp_count + p->node_capacity, 0, capacity - p->node_capacity);
+        p->ramps = ramp;
+        p->ramp_count = ramp_count;
+        p->node_capacity = capacity;
+    }
+}
+
+static bool
+um_params_push(um_params *p, const umugu_event *ev)
+{
+    um_event_cell *cell;
+    uint64_t pos = __atomic_load_n(&p->tail, __ATOMIC_RELAXED);
+    for (;;) {
+        cell = &p->cells[pos & (UM_PARAM_QUEUE_CAPACITY - 1)];
+        const uint64_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        const int64_t diff = (int64_t)(seq - pos);
+        if (!diff) {
+            if (__atomic_compare_exchange_n(
+                    &p->tail, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false; /* Full: the audio thread has not drained the cell yet. */
+        } else {
+            pos = __atomic_load_n(&p->tail, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->ev = *ev;
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static const umugu_event *
+um_params_peek(const um_params *p)
+{
+    const um_event_cell *cell = &p->cells[p->head & (UM_PARAM_QUEUE_CAPACITY - 1)];
+    return __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) == p->head + 1 ? &cell->ev : NULL;
+}
+
+static void
+um_params_pop(um_params *p)
+{
+    um_event_cell *cell = &p->cells[p->head & (UM_PARAM_QUEUE_CAPACITY - 1)];
+    __atomic_store_n(&cell->seq, p->head + UM_PARAM_QUEUE_CAPACITY, __ATOMIC_RELEASE);
+    p->head++;
+}
+
+void
+um_params_publish(umugu_ctx *ctx, const umugu_pipeline *pipeline)
+{
+    um_params *p = ctx->params;
+    if (!pipeline) {
+        p->loaded = ctx->pipeline;
+        pipeline = &p->loaded;
+    }
+    __atomic_store_n(&p->live, pipeline, __ATOMIC_RELEASE);
+}
+
+/* Pipeline of the producers: ctx->pipeline is rewritten by the audio thread while a
+ * swapped out pipeline fades. */
+static inline const umugu_pipeline *
+um_params_live(const umugu_ctx *ctx)
+{
+    return __atomic_load_n(&ctx->params->live, __ATOMIC_ACQUIRE);
+}
+
+/* Attribute of the attribute events to the pipeline, NULL if it can not be written that
+ * way. */
+static const umugu_attrib_info *
+um_params_attrib(
+    const umugu_ctx *ctx, const umugu_pipeline *pipeline, int node_idx, int attrib_idx,
+    int element)
+{
+    if (node_idx < 0 || node_idx >= pipeline->node_count) {
+        return NULL;
+    }
+    const umugu_node *node = pipeline->nodes[node_idx];
+    const umugu_node_type_info *info = &ctx->nodes_info[node->info_idx];
+    if (attrib_idx < 0 || attrib_idx >= info->attrib_count) {
+        return NULL;
+    }
+
+    /* Text and plot buffers are not values, and inputs change the graph (recompile). */
+    const umugu_attrib_info *attrib = &info->attribs[attrib_idx];
+    const umugu_attrib_flags invalid =
+        UMUGU_ATTR_RDONLY | UMUGU_ATTR_PLOTLINE | UMUGU_ATTR_INPUT;
+    if ((attrib->flags & invalid) || attrib->type == UMUGU_TYPE_TEXT ||
+        attrib->type <= UMUGU_TYPE_VOID || attrib->type >= UMUGU_TYPE_BIT || element < 0 ||
+        element >= um_maxi(attrib->count, 1)) {
+        return NULL;
+    }
+    return attrib;
+}
+
+static bool
+um_event_valid(const umugu_ctx *ctx, const umugu_pipeline *pipeline, const umugu_event *ev)
+{
+    const umugu_attrib_info *attrib;
+    switch (ev->kind) {
+    case UMUGU_EVENT_SET:
+        return um_params_attrib(ctx, pipeline, ev->node, ev->attrib, ev->element);
+    case UMUGU_EVENT_RAMP:
+        attrib = um_params_attrib(ctx, pipeline, ev->node, ev->attrib, ev->element);
+        return attrib && attrib->type == UMUGU_TYPE_FLOAT && ev->ramp_frames >= 0;
+    case UMUGU_EVENT_NOTE_ON:
+    case UMUGU_EVENT_NOTE_OFF:
+        return ev->node < pipeline->node_count && ev->note < UMUGU_NOTE_COUNT;
+    default:
+        return false;
+    }
+}
+
+UMUGU_API int
+umugu_event_push(umugu_ctx *ctx, const umugu_event *ev)
+{
+    UMUGU_ASSERT(ctx && ev);
+    if (!um_event_valid(ctx, um_params_live(ctx), ev)) {
+        return UMUGU_ERR_ARGS;
+    }
+    return um_params_push(ctx->params, ev) ? UMUGU_SUCCESS : UMUGU_ERR_FULL_STORAGE;
+}
+
+UMUGU_API int
+umugu_attrib_set(
+    umugu_ctx *ctx, int node_idx, int attrib_idx, int element, const void *value,
+    int ramp_frames)
+{
+    UMUGU_ASSERT(ctx && value);
+    const umugu_attrib_info *attrib =
+        um_params_attrib(ctx, um_params_live(ctx), node_idx, attrib_idx, element);
+    if (!attrib) {
+        return UMUGU_ERR_ARGS;
+    }
+
+    const bool ramp = attrib->type == UMUGU_TYPE_FLOAT && ramp_frames > 0;
+    umugu_event ev = {
+        .frame = 0,
+        .kind = ramp ? UMUGU_EVENT_RAMP : UMUGU_EVENT_SET,
+        .node = node_idx,
+        .attrib = attrib_idx,
+        .element = element,
+        .ramp_frames = ramp ? ramp_frames : 0};
+    memcpy(ev.value.bytes, value, um_type_sizeof(attrib->type));
+    return um_params_push(ctx->params, &ev) ? UMUGU_SUCCESS : UMUGU_ERR_FULL_STORAGE;
+}
+
+UMUGU_API int
+umugu_automation_set(
+    umugu_ctx *ctx, int node_idx, int attrib_idx, int element,
+    const umugu_automation_point *points, int count)
+{
+    UM_TRACE_ZONE();
+    const umugu_attrib_info *attrib =
+        um_params_attrib(ctx, &ctx->pipeline, node_idx, attrib_idx, element);
+    if (!attrib || attrib->type != UMUGU_TYPE_FLOAT || count < 0 || (count && !points)) {
+        return UMUGU_ERR_ARGS;
+    }
+    for (int i = 1; i < count; ++i) {
+        const int64_t delta = points[i].frame - points[i - 1].frame;
+        if (delta < 0 || delta > UINT32_MAX) {
+            return UMUGU_ERR_ARGS;
+        }
+    }
+
+    um_params *p = ctx->params;
+    um_automation *curve = NULL;
+    for (int i = 0; i < p->automation_count; ++i) {
+        um_automation *a = &p->automation[i];
+        if (a->node == node_idx && a->attrib == attrib_idx && a->element == element) {
+            curve = a;
+            break;
+        }
+    }
+    if (!count) {
+        if (curve) {
+            *curve = p->automation[--p->automation_count];
+        }
+        return UMUGU_SUCCESS;
+    }
+    if (!curve) {
+        if (p->automation_count == UM_AUTOMATION_MAX_CURVES) {
+            return UMUGU_ERR_FULL_TABLE;
+        }
+        curve = &p->automation[p->automation_count++];
+    }
+
+    /* The points of a replaced curve stay in the (persistent) arena. */
+    um_automation_point *packed = um_allocprs(ctx, sizeof(um_automation_point) * count);
+    packed[0] = (um_automation_point){.delta = 0, .value = points[0].value};
+    for (int i = 1; i < count; ++i) {
+        packed[i] = (um_automation_point){
+            .delta = (uint32_t)(points[i].frame - points[i - 1].frame),
+            .value = points[i].value};
+    }
+
+    /* Segments already over are skipped. */
+    int next = 0;
+    int64_t frame = points[0].frame;
+    while (next + 1 < count && points[next + 1].frame <= ctx->frame_clock) {
+        frame += packed[++next].delta;
+    }
+    *curve = (um_automation){
+        .node = node_idx,
+        .attrib = attrib_idx,
+        .element = element,
+        .count = count,
+        .next = next,
+        .next_frame = frame,
+        .started = false,
+        .points = packed};
+    return UMUGU_SUCCESS;
+}
+
+/* Inserts after the events of the same frame (keeps the push order). */
+static bool
+um_params_insert_pending(um_params *p, const umugu_event *ev)
+{
+    if (p->pending_count == UM_EVENT_PENDING_CAPACITY) {
+        return false;
+    }
+    int i = p->pending_count;
+    while (i > 0 && p->pending[i - 1].frame > ev->frame) {
+        p->pending[i] = p->pending[i - 1];
+        --i;
+    }
+    p->pending[i] = *ev;
+    p->pending_count++;
+    return true;
+}
+
+/* Events of the curve points before end: the first one emitted sets its value, then
+ * every point ramps (or jumps) to the next one. */
+static void
+um_automation_emit(um_params *p, um_automation *a, int64_t end)
+{
+    umugu_event ev = {.node = a->node, .attrib = a->attrib, .element = a->element};
+    while (a->next < a->count && a->next_frame < end &&
+           p->pending_count + 2 <= UM_EVENT_PENDING_CAPACITY) {
+        ev.frame = a->next_frame;
+        if (!a->started) {
+            ev.kind = UMUGU_EVENT_SET;
+            ev.value.f = a->points[a->next].value;
+            um_params_insert_pending(p, &ev);
+            a->started = true;
+        }
+        if (a->next + 1 < a->count) {
+            const um_automation_point *to = &a->points[a->next + 1];
+            ev.kind = to->delta ? UMUGU_EVENT_RAMP : UMUGU_EVENT_SET;
+            ev.ramp_frames = to->delta;
+            ev.value.f = to->value;
+            um_params_insert_pending(p, &ev);
+            a->next_frame += to->delta;
+        }
+        a->next++;
+    }
+}
+
+static um_param_ramp_state *
+um_params_find_ramp(const um_params *p, int node, const float *param)
+{
+    um_param_ramp_state *ramps = p->ramps + node * UM_NODE_MAX_RAMPS;
+    for (int i = 0; i < p->ramp_count[node]; ++i) {
+        if (ramps[i].param == param) {
+            return &ramps[i];
+        }
+    }
+    return NULL;
+}
+
+/* Frames of the ramp done before the block frame. */
+static inline int
+um_ramp_done(const um_param_ramp_state *r, int frame)
+{
+    return um_mini(um_maxi(frame - r->start, 0), r->remaining);
+}
+
+static inline float
+um_ramp_value(const um_param_ramp_state *r, int frame)
+{
+    const int done = um_ramp_done(r, frame);
+    return done == r->remaining ? r->target : r->base + r->step * done;
+}
+
+/* Writes an attribute event happening at the block frame offset. Only the glides of the
+ * event node change, nodes running in parallel apply their own events. */
+static void
+um_event_apply(umugu_ctx *ctx, const umugu_event *ev, int offset)
+{
+    if (ev->kind != UMUGU_EVENT_SET && ev->kind != UMUGU_EVENT_RAMP) {
+        return;
+    }
+
+    um_params *p = ctx->params;
+    const umugu_attrib_info *attrib =
+        um_params_attrib(ctx, &ctx->pipeline, ev->node, ev->attrib, ev->element);
+    const int size = um_type_sizeof(attrib->type);
+    uint8_t *dst = (uint8_t *)ctx->pipeline.nodes[ev->node] + attrib->offset_bytes +
+                   (size_t)ev->element * size;
+    float *param = (float *)dst;
+    um_param_ramp_state *ramps = p->ramps + ev->node * UM_NODE_MAX_RAMPS;
+    uint8_t *ramp_count = &p->ramp_count[ev->node];
+    um_param_ramp_state *r = um_params_find_ramp(p, ev->node, param);
+    if (ev->kind == UMUGU_EVENT_SET || !ev->ramp_frames) {
+        if (r) {
+            *r = ramps[--*ramp_count];
+        }
+        memcpy(dst, ev->value.bytes, size);
+        return;
+    }
+
+    /* Starts (or retargets) the glide from the value at the offset. */
+    const float from = r ? um_ramp_value(r, offset) : *param;
+    if (!r) {
+        if (*ramp_count == UM_NODE_MAX_RAMPS) {
+            *param = ev->value.f; /* No room, jumps. */
+            return;
+        }
+        r = &ramps[(*ramp_count)++];
+    }
+    *param = from;
+    *r = (um_param_ramp_state){
+        .param = param,
+        .base = from,
+        .target = ev->value.f,
+        .step = (ev->value.f - from) / ev->ramp_frames,
+        .start = offset,
+        .remaining = ev->ramp_frames};
+}
+
+void
+um_params_apply(umugu_ctx *ctx, int frames)
+{
+    UM_TRACE_ZONE();
+    um_params *p = ctx->params;
+    const int64_t clock = ctx->frame_clock;
+    const int64_t end = clock + frames;
+
+    /* Bounded: producers can not keep the audio thread here. A full pending list leaves
+     * the events in the queue (the producers get UMUGU_ERR_FULL_STORAGE). */
+    const umugu_event *ev;
+    for (int n = 0; n < UM_PARAM_QUEUE_CAPACITY && (ev = um_params_peek(p)); ++n) {
+        if (!um_params_insert_pending(p, ev)) {
+            break;
+        }
+        um_params_pop(p);
+    }
+    for (int i = 0; i < p->automation_count; ++i) {
+        um_automation_emit(p, &p->automation[i], end);
+    }
+
+    int due = 0;
+    while (due < p->pending_count && due < UM_EVENT_BLOCK_CAPACITY &&
+           p->pending[due].frame < end) {
+        ++due;
+    }
+
+    /* The pipeline could have changed since the events were pushed. */
+    memset(p->node_count, 0, ctx->pipeline.node_count * sizeof(uint16_t));
+    int kept = 0;
+    for (int i = 0; i < due; ++i) {
+        umugu_event *e = &p->pending[i];
+        e->frame = e->frame > clock ? e->frame : clock;
+        if (!um_event_valid(ctx, &ctx->pipeline, e)) {
+            continue;
+        }
+        const umugu_node *node = ctx->pipeline.nodes[e->node];
+        if (ctx->nodes_info[node->info_idx].flags & UMUGU_NODE_EVENTS) {
+            p->due[kept++] = *e;
+            p->node_count[e->node]++;
+        } else {
+            um_event_apply(ctx, e, 0);
+        }
+    }
+    p->pending_count -= due;
+    memmove(p->pending, p->pending + due, sizeof(umugu_event) * p->pending_count);
+
+    /* Grouped by node, keeping the frame order: node_first starts at the end of each group
+     * and the events are placed backwards. */
+    int last = 0;
+    for (int i = 0; i < ctx->pipeline.node_count; ++i) {
+        last += p->node_count[i];
+        p->node_first[i] = last;
+    }
+    for (int i = kept - 1; i >= 0; --i) {
+        p->block[--p->node_first[p->due[i].node]] = p->due[i];
+    }
+    p->block_count = kept;
+}
+
+void
+um_params_advance(umugu_ctx *ctx, int frames)
+{
+    um_params *p = ctx->params;
+    for (int node = 0; node < ctx->pipeline.node_count; ++node) {
+        um_param_ramp_state *ramps = p->ramps + node * UM_NODE_MAX_RAMPS;
+        for (int i = 0; i < p->ramp_count[node];) {
+            um_param_ramp_state *r = &ramps[i];
+            const int n = um_ramp_done(r, frames);
+            r->remaining -= n;
+            r->start = 0;
+            if (r->remaining) {
+                r->base += r->step * n;
+                *r->param = r->base;
+                ++i;
+            } else {
+                *r->param = r->target;
+                *r = ramps[--p->ramp_count[node]];
+            }
+        }
+    }
+    p->block_count = 0;
+    ctx->frame_clock += frames;
+}
+
+void
+um_params_reset(umugu_ctx *ctx)
+{
+    um_params *p = ctx->params;
+    memset(p->ramp_count, 0, p->node_capacity * sizeof(uint8_t));
+    p->pending_count = 0;
+    p->block_count = 0;
+}
+
+float
+um_param_ramp(
+    const umugu_ctx *ctx, const umugu_node *node, const float *param, int frame, float *value,
+    int *frames)
+{
+    const um_params *p = ctx->params;
+    /* Nodes of a pipeline fading out can be past the tables, they have no glides. */
+    const um_param_ramp_state *r =
+        node->idx < p->node_capacity ? um_params_find_ramp(p, node->idx, param) : NULL;
+    if (!r) {
+        *value = *param;
+        *frames = 0;
+        return 0.0f;
+    }
+    *value = um_ramp_value(r, frame);
+    *frames = r->remaining - um_ramp_done(r, frame);
+    return r->step;
+}
+
+um_event_cursor
+um_node_events(umugu_ctx *ctx, const umugu_node *node)
+{
+    const um_params *p = ctx->params;
+    um_event_cursor c = {.events = NULL, .count = 0, .next = 0, .clock = ctx->frame_clock};
+    if (p->block_count) {
+        UMUGU_ASSERT(ctx->pipeline.nodes[node->idx] == node && "Node not compiled.");
+        c.events = p->block + p->node_first[node->idx];
+        c.count = p->node_count[node->idx];
+    }
+    return c;
+}
+
+int
+um_event_segment(
+    umugu_ctx *ctx, um_event_cursor *c, int from, int frames, const umugu_event **at,
+    int *at_count)
+{
+    const int first = c->next;
+    while (c->next < c->count && c->events[c->next].frame - c->clock <= from) {
+        um_event_apply(ctx, &c->events[c->next], from);
+        c->next++;
+    }
+    *at = c->events + first;
+    *at_count = c->next - first;
+    const int next = c->next < c->count ? (int)(c->events[c->next].frame - c->clock) : frames;
+    return um_mini(next, frames) - from;
+}
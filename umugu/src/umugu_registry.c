@@ -0,0 +1,117 @@
+#include "umugu.h"
+
+#include "umugu_internal.h"
+
+/* Node type lookup by name. A hash table (open addressing, linear probing) of the names of
+ * ctx->nodes_info with their um_name_hash precomputed, so a probe compares 8 bytes and
+ * only the matching hash compares the whole name. Every type is indexed when it is
+ * appended (um_node_info_add), so lookups only read: the audio thread can look up while
+ * the thread appending types (e.g. a pipeline swap) inserts, entries are published by
+ * their hash. The names that are neither built in nor a plug are kept as missing
+ * entries: the next nodes of that type do not dlopen the plug again. */
+
+typedef struct {
+    uint64_t hash; /* um_name_hash of the name, 0 if the entry is empty. */
+    umugu_name name;
+    int32_t info_idx; /* In ctx->nodes_info, or UM_REGISTRY_MISSING. */
+} um_registry_entry;
+
+struct um_registry {
+    um_registry_entry *entries;
+    uint32_t mask;
+    int32_t missing_count;
+    int32_t missing_capacity;
+};
+
+um_registry *
+um_registry_create(umugu_ctx *ctx)
+{
+    UM_TRACE_ZONE();
+    /* As many missing names as types, at most half full. */
+    uint32_t size = 1;
+    while (size < 4 * (uint32_t)ctx->nodes_info_capacity) {
+        size <<= 1;
+    }
+
+    um_registry *r = um_allocprs(ctx, sizeof(um_registry));
+    r->entries = um_allocprs(ctx, size * sizeof(um_registry_entry));
+    memset(r->entries, 0, size * sizeof(um_registry_entry));
+    r->mask = size - 1;
+    r->missing_count = 0;
+    r->missing_capacity = ctx->nodes_info_capacity;
+    return r;
+}
+
+void
+um_registry_copy(um_registry *dst, const um_registry *src)
+{
+    UMUGU_ASSERT(dst->mask == src->mask && "Registries of different capacity.");
+    memcpy(dst->entries, src->entries, (src->mask + 1) * sizeof(um_registry_entry));
+    dst->missing_count = src->missing_count;
+}
+
+static inline uint64_t
+um_registry_hash(const umugu_name *name)
+{
+    const uint64_t hash = um_name_hash(name);
+    return hash ? hash : 1;
+}
+
+/* Entry of the name, or the empty one where it goes. */
+static um_registry_entry *
+um_registry_probe(const um_registry *r, const umugu_name *name, uint64_t hash)
+{
+    uint32_t i = hash & r->mask;
+    for (;; i = (i + 1) & r->mask) {
+        const uint64_t h = __atomic_load_n(&r->entries[i].hash, __ATOMIC_ACQUIRE);
+        if (!h || (h == hash && um_name_equals(&r->entries[i].name, name))) {
+            return &r->entries[i];
+        }
+    }
+}
+
+static void
+um_registry_insert(um_registry *r, const umugu_name *name, int32_t info_idx)
+{
+    const uint64_t hash = um_registry_hash(name);
+    um_registry_entry *e = um_registry_probe(r, name, hash);
+    if (!e->hash) {
+        e->name = *name;
+        e->info_idx = info_idx;
+        __atomic_store_n(&e->hash, hash, __ATOMIC_RELEASE);
+        r->missing_count += info_idx == UM_REGISTRY_MISSING;
+    } else if (e->info_idx == UM_REGISTRY_MISSING && info_idx != UM_REGISTRY_MISSING) {
+        /* Missing, then loaded after all (e.g. appended by the user). Otherwise the first
+         * info of a name is the one found. */
+        __atomic_store_n(&e->info_idx, info_idx, __ATOMIC_RELEASE);
+        r->missing_count--;
+    }
+}
+
+int
+um_registry_find(const umugu_ctx *ctx, const umugu_name *name)
+{
+    UM_TRACE_ZONE();
+    const um_registry_entry *e = um_registry_probe(ctx->registry, name, um_registry_hash(name));
+    return __atomic_load_n(&e->hash, __ATOMIC_RELAXED)
+               ? __atomic_load_n(&e->info_idx, __ATOMIC_ACQUIRE)
+               : UM_REGISTRY_UNKNOWN;
+}
+
+void
+um_registry_add(umugu_ctx *ctx, int info_idx)
+{
+    const umugu_name *name = &ctx->nodes_info[info_idx].name;
+    if (!um_name_empty(name)) {
+        um_registry_insert(ctx->registry, name, info_idx);
+    }
+}
+
+void
+um_registry_missing(umugu_ctx *ctx, const umugu_name *name)
+{
+    um_registry *r = ctx->registry;
+    if (r->missing_count < r->missing_capacity) {
+        um_registry_insert(r, name, UM_REGISTRY_MISSING);
+    }
+}
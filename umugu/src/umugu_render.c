@@ -0,0 +1,116 @@
+#include "umugu.h"
+
+#include "umugu_internal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* Rendered bytes gathered before each write (whole blocks). */
+#define UM_RENDER_WRITE_BYTES (128 * 1024)
+/* Block size of the offline renders when not specified. */
+#define UM_RENDER_BLOCK_FRAMES 4096
+/* Size of the wav header, written last with the final data size. */
+#define UM_RENDER_HEADER_BYTES 44
+
+/* Writes every byte at offset, retrying the short writes. */
+static bool
+um_render_write(int fd, const void *data, size_t bytes, off_t offset)
+{
+    while (bytes) {
+        const ssize_t written = pwrite(fd, data, bytes, offset);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        data = (const uint8_t *)data + written;
+        bytes -= written;
+        offset += written;
+    }
+    return true;
+}
+
+int
+umugu_render(umugu_ctx *ctx, const char *filename, int64_t frames, int block_frames)
+{
+    UM_TRACE_ZONE();
+    UMUGU_ASSERT(ctx);
+    umugu_signal *out = &ctx->io.out_audio;
+    const umugu_signal user_out = *out;
+    if (!out->samples.channel_count) {
+        out->samples.channel_count = 2;
+        out->format = UMUGU_TYPE_FLOAT;
+    }
+    if (!out->sample_rate) {
+        out->sample_rate = ctx->pipeline.sig.sample_rate;
+    }
+    out->interleaved_channels = true;
+
+    const int frame_bytes = um_signal_stride(out);
+    const int max_block = UM_RENDER_WRITE_BYTES / frame_bytes;
+    block_frames = block_frames > 0 ? block_frames : UM_RENDER_BLOCK_FRAMES;
+    block_frames = um_mini(block_frames, max_block);
+    const uint64_t data_bytes = (uint64_t)(frames > 0 ? frames : 0) * frame_bytes;
+    if (data_bytes > UINT32_MAX - UM_RENDER_HEADER_BYTES) {
+        ctx->io.log("Render: %ld frames do not fit in a wav file.\n", (long)frames);
+        *out = user_out;
+        return UMUGU_ERR_ARGS;
+    }
+
+    const int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        ctx->io.log("Render: couldn't open %s for writing.\n", filename);
+        *out = user_out;
+        return UMUGU_ERR_FILE;
+    }
+
+    const um_nanosec start = um_time_now();
+    float buffer[UM_RENDER_WRITE_BYTES / sizeof(float)]; /* Aligned for every format. */
+    off_t offset = UM_RENDER_HEADER_BYTES;
+    size_t used = 0;
+    int err = UMUGU_SUCCESS;
+    ctx->offline = true;
+    for (int64_t left = frames; left > 0 && err >= UMUGU_SUCCESS;) {
+        const int count = left < block_frames ? (int)left : block_frames;
+        const size_t bytes = (size_t)count * frame_bytes;
+        if (used + bytes > sizeof(buffer)) {
+            err = um_render_write(fd, buffer, used, offset) ? err : UMUGU_ERR_FILE;
+            offset += used;
+            used = 0;
+        }
+        /* Pipelines without output nodes render silence. */
+        memset((uint8_t *)buffer + used, 0, bytes);
+        out->samples.samples = (void *)((uint8_t *)buffer + used);
+        out->samples.frame_count = count;
+        const int ret = umugu_process(ctx, count);
+        err = ret < UMUGU_SUCCESS ? ret : err;
+        used += bytes;
+        left -= count;
+    }
+    ctx->offline = false;
+    const int sample_rate = out->sample_rate;
+
+    uint8_t header[UM_RENDER_HEADER_BYTES];
+    um_signal_wav_header(out, data_bytes, header);
+    if (err >= UMUGU_SUCCESS && (!um_render_write(fd, buffer, used, offset) ||
+                                 !um_render_write(fd, header, sizeof(header), 0))) {
+        err = UMUGU_ERR_FILE;
+    }
+    if (close(fd) && err >= UMUGU_SUCCESS) {
+        err = UMUGU_ERR_FILE;
+    }
+    *out = user_out;
+
+    if (err < UMUGU_SUCCESS) {
+        ctx->io.log("Render: failed writing %s (error %d).\n", filename, err);
+        return err;
+    }
+
+    const float elapsed = um_time_sec(um_time_elapsed(start));
+    ctx->io.log(
+        "Rendered %s: %ld frames in %.3fs (%.1fx realtime).\n", filename, (long)frames, elapsed,
+        (float)frames / sample_rate / (elapsed > 0.0f ? elapsed : 1e-9f));
+    return UMUGU_SUCCESS;
+}
@@ -0,0 +1,200 @@
+#include "umugu.h"
+
+#include "umugu_internal.h"
+
+#include <math.h>
+
+#define UM_RESAMPLE_PI 3.14159265358979323846
+
+/* Output frames per pass through the work buffers. */
+enum { UM_RESAMPLER_CHUNK = 256 };
+
+static const struct {
+    int taps;
+    double beta;   /* Kaiser window. */
+    double cutoff; /* Of the Nyquist frequency (of the lower rate). */
+} UM_RESAMPLE_PRESETS[UM_RESAMPLE_QUALITY_COUNT] = {
+    [UM_RESAMPLE_FAST] = {16, 6.0, 0.80},
+    [UM_RESAMPLE_BALANCED] = {32, 8.0, 0.88},
+    [UM_RESAMPLE_BEST] = {64, 10.0, 0.92},
+};
+
+struct um_resampler {
+    const um_kernels *kernels;
+    int channels;
+    int taps;             /* Multiple of 8. */
+    uint32_t l;           /* Output rate / gcd. */
+    uint32_t m;           /* Input rate / gcd. */
+    uint32_t step;        /* Whole input frames per output, m / l. */
+    uint32_t step_rem;    /* m % l. */
+    uint32_t phase;       /* Position of the next output between two input frames, over l. */
+    bool interpolate;     /* Table of UM_RESAMPLER_TABLE_PHASES + 1 phases instead of l. */
+    float phase_scale;    /* Table phases per phase when interpolating. */
+    const float *coeffs;  /* Rows of taps coefficients, one per phase. */
+    float *work;          /* Per channel: taps frames of history followed by the new input. */
+    int work_stride;
+};
+
+static uint32_t
+um_gcd(uint32_t a, uint32_t b)
+{
+    while (b) {
+        const uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/* Zeroth order modified Bessel function of the first kind (Kaiser window). */
+static double
+um_bessel_i0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 50 && term > 1e-12 * sum; ++k) {
+        const double t = x / (2.0 * k);
+        term *= t * t;
+        sum += term;
+    }
+    return sum;
+}
+
+/* Filter row of a fractional delay frac (in input frames) between the center taps. */
+static void
+um_resampler_design(float *row, int taps, double frac, double cutoff, double beta)
+{
+    const double half = taps / 2;
+    double sum = 0.0;
+    double h[UM_RESAMPLER_MAX_TAPS];
+    for (int k = 0; k < taps; ++k) {
+        const double t = k - (half - 1.0) - frac;
+        const double x = t / half;
+        const double window = fabs(x) < 1.0 ? um_bessel_i0(beta * sqrt(1.0 - x * x)) : 0.0;
+        const double a = UM_RESAMPLE_PI * cutoff * t;
+        h[k] = (fabs(a) < 1e-9 ? 1.0 : sin(a) / a) * window;
+        sum += h[k];
+    }
+    /* Unity gain at DC for every phase. */
+    for (int k = 0; k < taps; ++k) {
+        row[k] = (float)(h[k] / sum);
+    }
+}
+
+um_resampler *
+um_resampler_create(
+    umugu_ctx *ctx, int in_rate, int out_rate, int channels, um_resample_quality quality)
+{
+    UM_TRACE_ZONE();
+    if (in_rate <= 0 || out_rate <= 0 || channels <= 0) {
+        ctx->io.log("[ERR] Resampler: invalid conversion %d -> %d.\n", in_rate, out_rate);
+        return NULL;
+    }
+    quality = quality < UM_RESAMPLE_QUALITY_COUNT ? quality : UM_RESAMPLE_BEST;
+
+    um_resampler *r = um_allocprs(ctx, sizeof(um_resampler));
+    const uint32_t g = um_gcd(in_rate, out_rate);
+    r->kernels = ctx->kernels;
+    r->channels = channels;
+    r->l = out_rate / g;
+    r->m = in_rate / g;
+    r->step = r->m / r->l;
+    r->step_rem = r->m % r->l;
+    r->phase = 0;
+
+    /* Decimation narrows the band (and widens the filter) by the ratio. */
+    const double ratio = in_rate > out_rate ? (double)in_rate / out_rate : 1.0;
+    const double cutoff = UM_RESAMPLE_PRESETS[quality].cutoff / ratio;
+    int taps = (int)ceil(UM_RESAMPLE_PRESETS[quality].taps * ratio);
+    taps = um_mini((taps + 7) & ~7, UM_RESAMPLER_MAX_TAPS);
+    r->taps = taps;
+
+    r->interpolate = r->l > UM_RESAMPLER_MAX_PHASES;
+    const int rows = r->interpolate ? UM_RESAMPLER_TABLE_PHASES + 1 : (int)r->l;
+    const int row_phases = r->interpolate ? UM_RESAMPLER_TABLE_PHASES : (int)r->l;
+    r->phase_scale = (float)UM_RESAMPLER_TABLE_PHASES / r->l;
+    float *coeffs = um_allocprs(ctx, sizeof(float) * taps * rows);
+    for (int p = 0; p < rows; ++p) {
+        um_resampler_design(
+            coeffs + p * taps, taps, (double)p / row_phases, cutoff,
+            UM_RESAMPLE_PRESETS[quality].beta);
+    }
+    r->coeffs = coeffs;
+
+    r->work_stride = taps + (int)(((uint64_t)UM_RESAMPLER_CHUNK * r->m) / r->l) + 1;
+    r->work = um_allocprs(ctx, sizeof(float) * r->work_stride * channels);
+    um_resampler_reset(r);
+    return r;
+}
+
+void
+um_resampler_reset(um_resampler *r)
+{
+    for (int ch = 0; ch < r->channels; ++ch) {
+        memset(r->work + ch * r->work_stride, 0, sizeof(float) * r->taps);
+    }
+}
+
+/* The first output is centered on the frame half - 1 of the (initially silent) history. */
+int
+um_resampler_latency(const um_resampler *r)
+{
+    return r->taps / 2 + 1;
+}
+
+int
+um_resampler_input_frames(const um_resampler *r, int out_frames)
+{
+    return (int)((r->phase + (uint64_t)out_frames * r->m) / r->l);
+}
+
+/* One channel of a chunk: out[j] is the filter at work + position (whole input frames
+ * after the history start) with the phase row of its fraction. */
+static void
+um_resampler_channel(const um_resampler *r, const float *work, float *out, int count)
+{
+    const int taps = r->taps;
+    uint32_t pos = 0;
+    uint32_t phase = r->phase;
+    for (int j = 0; j < count; ++j) {
+        const float *x = work + pos;
+        if (!r->interpolate) {
+            out[j] = r->kernels->dot(x, r->coeffs + phase * taps, taps);
+        } else {
+            const float t = phase * r->phase_scale;
+            const int row = (int)t;
+            const float y0 = r->kernels->dot(x, r->coeffs + row * taps, taps);
+            const float y1 = r->kernels->dot(x, r->coeffs + (row + 1) * taps, taps);
+            out[j] = y0 + (t - row) * (y1 - y0);
+        }
+
+        pos += r->step;
+        phase += r->step_rem;
+        if (phase >= r->l) {
+            phase -= r->l;
+            ++pos;
+        }
+    }
+}
+
+void
+um_resampler_process(um_resampler *r, const float *const *in, float *const *out, int out_frames)
+{
+    UM_TRACE_ZONE();
+    const int taps = r->taps;
+    int in_done = 0;
+    for (int done = 0; done < out_frames;) {
+        const int count = um_mini(out_frames - done, UM_RESAMPLER_CHUNK);
+        const uint64_t end = r->phase + (uint64_t)count * r->m;
+        const int in_count = (int)(end / r->l);
+        for (int ch = 0; ch < r->channels; ++ch) {
+            float *work = r->work + ch * r->work_stride;
+            memcpy(work + taps, in[ch] + in_done, sizeof(float) * in_count);
+            um_resampler_channel(r, work, out[ch] + done, count);
+            /* The last taps frames are the history of the next chunk. */
+            memmove(work, work + in_count, sizeof(float) * taps);
+        }
+        r->phase = (uint32_t)(end % r->l);
+        in_done += in_count;
+        done += count;
+    }
+}
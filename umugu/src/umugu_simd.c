@@ -0,0 +1,1102 @@
+#include "umugu.h"
+
+#include "umugu_internal.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define UM_SIMD_X86
+#include <immintrin.h>
+#define UM_TARGET_SSE2 __attribute__((target("sse2")))
+#define UM_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#define UM_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+/* Float to integer quantization: trunc(clamp(x * scale + bias, lo, hi)). The upper
+ * limit of int32 is the greatest float below 2^31. */
+typedef struct {
+    float scale;
+    float bias;
+    float lo;
+    float hi;
+} um_quant;
+
+static const um_quant UM_QUANT_I32 = {2147483648.0f, 0.0f, -2147483648.0f, 2147483520.0f};
+static const um_quant UM_QUANT_I16 = {32768.0f, 0.0f, -32768.0f, 32767.0f};
+static const um_quant UM_QUANT_I8 = {128.0f, 0.0f, -128.0f, 127.0f};
+static const um_quant UM_QUANT_U8 = {128.0f, 128.0f, 0.0f, 255.0f};
+
+/* ## OSCILLATOR BANK ## */
+
+/* Written once with the compiler vector extensions: every table below instantiates it
+ * for its own target, one lane per voice (8 voices per vector). */
+typedef float um_v8f __attribute__((vector_size(32)));
+typedef int32_t um_v8i __attribute__((vector_size(32)));
+
+#define UM_ALWAYS_INLINE static inline __attribute__((always_inline))
+
+enum { UM_OSCBANK_CHUNK = 64 }; /* Frames per accumulation pass (2KB of stack). */
+
+UM_ALWAYS_INLINE um_v8f
+um_v8_load(const float *src)
+{
+    um_v8f v;
+    memcpy(&v, src, sizeof(v));
+    return v;
+}
+
+UM_ALWAYS_INLINE um_v8f
+um_v8_set1(float x)
+{
+    return (um_v8f){x, x, x, x, x, x, x, x};
+}
+
+UM_ALWAYS_INLINE void
+um_v8_store(float *dst, um_v8f v)
+{
+    memcpy(dst, &v, sizeof(v));
+}
+
+/* mask ? a : b, masks are the result of vector comparisons (lanes all ones or zero). */
+UM_ALWAYS_INLINE um_v8f
+um_v8_select(um_v8i mask, um_v8f a, um_v8f b)
+{
+    return (um_v8f)((mask & (um_v8i)a) | (~mask & (um_v8i)b));
+}
+
+/* Fixed reduction order, so every target sums the voices exactly the same way. */
+UM_ALWAYS_INLINE float
+um_v8_sum(um_v8f v)
+{
+    return ((v[0] + v[4]) + (v[1] + v[5])) + ((v[2] + v[6]) + (v[3] + v[7]));
+}
+
+/* sin(2 * pi * t) for t in [0, 1): odd polynomial in [-pi/2, pi/2] (error < 4e-6). */
+UM_ALWAYS_INLINE um_v8f
+um_v8_sine(um_v8f t)
+{
+    um_v8f x = 0.5f - t; /* sin(2pi t) = sin(2pi (0.5 - t)), x in (-0.5, 0.5]. */
+    x = um_v8_select(x > 0.25f, 0.5f - x, x);
+    x = um_v8_select(x < -0.25f, -0.5f - x, x);
+    const um_v8f y = x * 6.28318531f;
+    const um_v8f y2 = y * y;
+    um_v8f p = um_v8_set1(2.75573192e-6f);
+    p = p * y2 - 1.98412698e-4f;
+    p = p * y2 + 8.33333333e-3f;
+    p = p * y2 - 1.66666667e-1f;
+    return y + y * y2 * p;
+}
+
+/* Band-limited step residual for a discontinuity at t = 0 of height 2. */
+UM_ALWAYS_INLINE um_v8f
+um_v8_polyblep(um_v8f t, um_v8f dt, um_v8f inv_dt)
+{
+    const um_v8f a = t * inv_dt;          /* Just after: t < dt. */
+    const um_v8f b = (t - 1.0f) * inv_dt; /* Just before: t > 1 - dt. */
+    const um_v8f zero = um_v8_set1(0.0f);
+    return um_v8_select(t < dt, a + a - a * a - 1.0f, zero) +
+           um_v8_select(t > 1.0f - dt, b * b + b + b + 1.0f, zero);
+}
+
+/* Band-limited ramp residual for a unit slope change (per sample) at t = 0. */
+UM_ALWAYS_INLINE um_v8f
+um_v8_polyblamp(um_v8f t, um_v8f dt, um_v8f inv_dt)
+{
+    const um_v8f a = 1.0f - t * inv_dt;          /* Just after. */
+    const um_v8f b = 1.0f + (t - 1.0f) * inv_dt; /* Just before. */
+    const um_v8f zero = um_v8_set1(0.0f);
+    return um_v8_select(t < dt, a * a * a * (1.0f / 6), zero) +
+           um_v8_select(t > 1.0f - dt, b * b * b * (1.0f / 6), zero);
+}
+
+UM_ALWAYS_INLINE um_v8f
+um_v8_wave(const umugu_waveform waveform, um_v8f t, um_v8f dt, um_v8f inv_dt)
+{
+    const um_v8i half_mask = t >= 0.5f;
+    const um_v8f half = t + um_v8_select(half_mask, um_v8_set1(-0.5f), um_v8_set1(0.5f));
+    switch (waveform) {
+    case UMUGU_WAVEFORM_SAW:
+        return t + t - 1.0f - um_v8_polyblep(t, dt, inv_dt);
+    case UMUGU_WAVEFORM_SQUARE:
+        return um_v8_select(half_mask, um_v8_set1(-1.0f), um_v8_set1(1.0f)) +
+               um_v8_polyblep(t, dt, inv_dt) - um_v8_polyblep(half, dt, inv_dt);
+    case UMUGU_WAVEFORM_TRIANGLE: {
+        /* Corners at 0 (slope -4 to +4 per cycle) and 0.5 (+4 to -4). */
+        const um_v8f naive = um_v8_select(half_mask, 3.0f - 4.0f * t, 4.0f * t - 1.0f);
+        return naive + 8.0f * dt * (um_v8_polyblamp(t, dt, inv_dt) -
+                                    um_v8_polyblamp(half, dt, inv_dt));
+    }
+    default:
+        return um_v8_sine(t);
+    }
+}
+
+UM_ALWAYS_INLINE void
+um_oscbank_render(
+    float *dst, um_voices *v, int count, const umugu_waveform waveform, float inv_sample_rate,
+    int frames)
+{
+    const um_v8i lane = {0, 1, 2, 3, 4, 5, 6, 7};
+    um_v8f acc[UM_OSCBANK_CHUNK];
+    for (int f0 = 0; f0 < frames; f0 += UM_OSCBANK_CHUNK) {
+        const int n = um_mini(UM_OSCBANK_CHUNK, frames - f0);
+        memset(acc, 0, sizeof(acc[0]) * n);
+        for (int g = 0; g < count; g += UM_OSCBANK_LANES) {
+            /* Lanes past count are zeroed: amp 0 silences them and a stale (or NaN)
+             * phase can not leak into the sum. */
+            const um_v8i active = (lane + g) < count;
+            const um_v8f zero = um_v8_set1(0.0f);
+            um_v8f t = um_v8_select(active, um_v8_load(v->phase + g), zero);
+            const um_v8f amp = um_v8_select(active, um_v8_load(v->amp + g), zero);
+            um_v8f dt = um_v8_load(v->freq + g) * inv_sample_rate;
+            dt = um_v8_select(dt > 0.0f, dt, zero); /* Rejects negative and NaN. */
+            dt = um_v8_select(dt < 0.499f, dt, um_v8_set1(0.499f));
+            const um_v8f inv_dt = 1.0f / um_v8_select(dt > 1e-9f, dt, um_v8_set1(1e-9f));
+            for (int i = 0; i < n; ++i) {
+                acc[i] += amp * um_v8_wave(waveform, t, dt, inv_dt);
+                t += dt;
+                t -= um_v8_select(t >= 1.0f, um_v8_set1(1.0f), zero);
+            }
+            um_v8_store(v->phase + g, t);
+        }
+        for (int i = 0; i < n; ++i) {
+            dst[f0 + i] = um_v8_sum(acc[i]);
+        }
+    }
+}
+
+/* Instantiates the bank kernel for the given target, one specialization per waveform. */
+#define UM_OSCBANK_KERNEL(NAME, TARGET)                                                       \
+    TARGET static void NAME(                                                                  \
+        float *dst, um_voices *v, int count, umugu_waveform waveform, float inv_sample_rate,  \
+        int frames)                                                                           \
+    {                                                                                         \
+        switch (waveform) {                                                                   \
+        case UMUGU_WAVEFORM_SAW:                                                              \
+            um_oscbank_render(dst, v, count, UMUGU_WAVEFORM_SAW, inv_sample_rate, frames);    \
+            break;                                                                            \
+        case UMUGU_WAVEFORM_SQUARE:                                                           \
+            um_oscbank_render(dst, v, count, UMUGU_WAVEFORM_SQUARE, inv_sample_rate, frames); \
+            break;                                                                            \
+        case UMUGU_WAVEFORM_TRIANGLE:                                                         \
+            um_oscbank_render(                                                                \
+                dst, v, count, UMUGU_WAVEFORM_TRIANGLE, inv_sample_rate, frames);             \
+            break;                                                                            \
+        default:                                                                              \
+            um_oscbank_render(dst, v, count, UMUGU_WAVEFORM_SINE, inv_sample_rate, frames);   \
+            break;                                                                            \
+        }                                                                                     \
+    }
+
+/* ## FFT ## */
+
+/* Four interleaved complex numbers per vector. */
+UM_ALWAYS_INLINE um_v8f
+um_v8_cmul(um_v8f a, um_v8f w)
+{
+    const um_v8i re = {0, 0, 2, 2, 4, 4, 6, 6};
+    const um_v8i im = {1, 1, 3, 3, 5, 5, 7, 7};
+    const um_v8i swap = {1, 0, 3, 2, 5, 4, 7, 6};
+    const um_v8f sign = {-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f};
+    return a * __builtin_shuffle(w, re) +
+           __builtin_shuffle(a, swap) * __builtin_shuffle(w, im) * sign;
+}
+
+/* Radix-4 decimation in time pass over bit-reversed data: merges groups of four h-point
+ * transforms (at j, j + h, j + 2h and j + 3h) into 4h-point ones. tw holds the h
+ * twiddles W_4h^k, then W_4h^2k and W_4h^3k. The inverse pass uses the conjugates. */
+UM_ALWAYS_INLINE void
+um_fft_radix4_pass(um_complex *v, int n, int h, const um_complex *tw, int inverse)
+{
+    const um_complex *tw2 = tw + h;
+    const um_complex *tw3 = tw + 2 * h;
+    if (h < 4) { /* Narrower than a vector. */
+        const float s = inverse ? -1.0f : 1.0f;
+        for (int j = 0; j < n; j += 4 * h) {
+            um_complex *x = v + j;
+            for (int k = 0; k < h; ++k) {
+                const um_complex w1 = {tw[k].real, s * tw[k].imag};
+                const um_complex w2 = {tw2[k].real, s * tw2[k].imag};
+                const um_complex w3 = {tw3[k].real, s * tw3[k].imag};
+                const um_complex t0 = x[k];
+                const um_complex t1 = um_cmul(x[k + h], w2);
+                const um_complex t2 = um_cmul(x[k + 2 * h], w1);
+                const um_complex t3 = um_cmul(x[k + 3 * h], w3);
+                const um_complex a = {t0.real + t1.real, t0.imag + t1.imag};
+                const um_complex b = {t0.real - t1.real, t0.imag - t1.imag};
+                const um_complex c = {t2.real + t3.real, t2.imag + t3.imag};
+                /* -i (t2 - t3), or +i for the inverse. */
+                const um_complex d = {s * (t2.imag - t3.imag), -s * (t2.real - t3.real)};
+                x[k] = (um_complex){a.real + c.real, a.imag + c.imag};
+                x[k + h] = (um_complex){b.real + d.real, b.imag + d.imag};
+                x[k + 2 * h] = (um_complex){a.real - c.real, a.imag - c.imag};
+                x[k + 3 * h] = (um_complex){b.real - d.real, b.imag - d.imag};
+            }
+        }
+        return;
+    }
+
+    const um_v8i swap = {1, 0, 3, 2, 5, 4, 7, 6};
+    const float s = inverse ? -1.0f : 1.0f;
+    const um_v8f conj = {1.0f, s, 1.0f, s, 1.0f, s, 1.0f, s};
+    const um_v8f rot = {s, -s, s, -s, s, -s, s, -s};
+    for (int j = 0; j < n; j += 4 * h) {
+        float *x = (float *)(v + j);
+        for (int k = 0; k < h; k += 4) {
+            const um_v8f w1 = um_v8_load((const float *)(tw + k)) * conj;
+            const um_v8f w2 = um_v8_load((const float *)(tw2 + k)) * conj;
+            const um_v8f w3 = um_v8_load((const float *)(tw3 + k)) * conj;
+            const um_v8f t0 = um_v8_load(x + 2 * k);
+            const um_v8f t1 = um_v8_cmul(um_v8_load(x + 2 * (k + h)), w2);
+            const um_v8f t2 = um_v8_cmul(um_v8_load(x + 2 * (k + 2 * h)), w1);
+            const um_v8f t3 = um_v8_cmul(um_v8_load(x + 2 * (k + 3 * h)), w3);
+            const um_v8f a = t0 + t1;
+            const um_v8f b = t0 - t1;
+            const um_v8f c = t2 + t3;
+            const um_v8f d = __builtin_shuffle(t2 - t3, swap) * rot;
+            um_v8_store(x + 2 * k, a + c);
+            um_v8_store(x + 2 * (k + h), b + d);
+            um_v8_store(x + 2 * (k + 2 * h), a - c);
+            um_v8_store(x + 2 * (k + 3 * h), b - d);
+        }
+    }
+}
+
+/* acc += a * b, complex. */
+UM_ALWAYS_INLINE void
+um_cmac(um_complex *acc, const um_complex *a, const um_complex *b, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float *dst = (float *)(acc + i);
+        const um_v8f va = um_v8_load((const float *)(a + i));
+        const um_v8f vb = um_v8_load((const float *)(b + i));
+        um_v8_store(dst, um_v8_load(dst) + um_v8_cmul(va, vb));
+    }
+    for (; i < count; ++i) {
+        const um_complex p = um_cmul(a[i], b[i]);
+        acc[i].real += p.real;
+        acc[i].imag += p.imag;
+    }
+}
+
+#define UM_FFT_KERNEL(NAME, TARGET)                                                       \
+    TARGET static void NAME(um_complex *v, int n, int h, const um_complex *tw, int inverse) \
+    {                                                                                     \
+        um_fft_radix4_pass(v, n, h, tw, inverse);                                         \
+    }
+
+#define UM_CMAC_KERNEL(NAME, TARGET)                                                           \
+    TARGET static void NAME(um_complex *acc, const um_complex *a, const um_complex *b, int count) \
+    {                                                                                          \
+        um_cmac(acc, a, b, count);                                                             \
+    }
+
+/* ## RESAMPLING ## */
+
+/* Inner product of the polyphase filters, count is a multiple of 8. Two accumulators
+ * hide the add latency. */
+UM_ALWAYS_INLINE float
+um_dot(const float *a, const float *b, int count)
+{
+    um_v8f acc0 = um_v8_set1(0.0f);
+    um_v8f acc1 = um_v8_set1(0.0f);
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        acc0 += um_v8_load(a + i) * um_v8_load(b + i);
+        acc1 += um_v8_load(a + i + 8) * um_v8_load(b + i + 8);
+    }
+    if (i < count) {
+        acc0 += um_v8_load(a + i) * um_v8_load(b + i);
+    }
+    return um_v8_sum(acc0 + acc1);
+}
+
+#define UM_DOT_KERNEL(NAME, TARGET)                                   \
+    TARGET static float NAME(const float *a, const float *b, int count) \
+    {                                                                 \
+        return um_dot(a, b, count);                                   \
+    }
+
+/* ## SAMPLE DECODING ## */
+
+/* Interleaved file samples to planar float, written with the same generic vectors. The
+ * scaling matches um_signal_samplef exactly: the integer scales are powers of two and
+ * uint8 keeps its division. */
+typedef int16_t um_v8s __attribute__((vector_size(16)));
+typedef uint8_t um_v8b __attribute__((vector_size(8)));
+
+UM_ALWAYS_INLINE um_v8f
+um_v8_decode(umugu_type type, const void *src)
+{
+    switch (type) {
+    case UMUGU_TYPE_UINT8: {
+        um_v8b v;
+        memcpy(&v, src, sizeof(v));
+        return (__builtin_convertvector(v, um_v8f) / um_v8_set1(255.0f)) * um_v8_set1(2.0f) -
+               um_v8_set1(1.0f);
+    }
+    case UMUGU_TYPE_INT16: {
+        um_v8s v;
+        memcpy(&v, src, sizeof(v));
+        return __builtin_convertvector(v, um_v8f) * um_v8_set1(1.0f / 32768.0f);
+    }
+    case UMUGU_TYPE_INT32: {
+        um_v8i v;
+        memcpy(&v, src, sizeof(v));
+        return __builtin_convertvector(v, um_v8f) * um_v8_set1(1.0f / 2147483648.0f);
+    }
+    default:
+        return um_v8_load(src);
+    }
+}
+
+UM_ALWAYS_INLINE void
+um_decode(umugu_type type, float *const *dst, const void *src, int channels, int frames)
+{
+    const uint8_t *in = src;
+    const int size = um_type_sizeof(type);
+    int i = 0;
+    if (channels == 1) {
+        for (; i + 8 <= frames; i += 8) {
+            um_v8_store(dst[0] + i, um_v8_decode(type, in + i * size));
+        }
+    } else if (channels == 2) {
+        const um_v8i even = {0, 2, 4, 6, 8, 10, 12, 14};
+        const um_v8i odd = {1, 3, 5, 7, 9, 11, 13, 15};
+        for (; i + 8 <= frames; i += 8) {
+            const um_v8f a = um_v8_decode(type, in + 2 * i * size);
+            const um_v8f b = um_v8_decode(type, in + (2 * i + 8) * size);
+            um_v8_store(dst[0] + i, __builtin_shuffle(a, b, even));
+            um_v8_store(dst[1] + i, __builtin_shuffle(a, b, odd));
+        }
+    }
+
+    const umugu_signal sig = {
+        .samples = {.samples = (float *)in, .frame_count = frames, .channel_count = channels},
+        .interleaved_channels = true,
+        .format = type};
+    for (; i < frames; ++i) {
+        for (int ch = 0; ch < channels; ++ch) {
+            dst[ch][i] = um_signal_samplef(&sig, i, ch);
+        }
+    }
+}
+
+#define UM_DECODE_KERNELS(NAME, TARGET)                                                         \
+    TARGET static void NAME##_f32(float *const *dst, const void *src, int channels, int frames) \
+    {                                                                                           \
+        um_decode(UMUGU_TYPE_FLOAT, dst, src, channels, frames);                                \
+    }                                                                                           \
+    TARGET static void NAME##_i32(float *const *dst, const void *src, int channels, int frames) \
+    {                                                                                           \
+        um_decode(UMUGU_TYPE_INT32, dst, src, channels, frames);                                \
+    }                                                                                           \
+    TARGET static void NAME##_i16(float *const *dst, const void *src, int channels, int frames) \
+    {                                                                                           \
+        um_decode(UMUGU_TYPE_INT16, dst, src, channels, frames);                                \
+    }                                                                                           \
+    TARGET static void NAME##_u8(float *const *dst, const void *src, int channels, int frames)  \
+    {                                                                                           \
+        um_decode(UMUGU_TYPE_UINT8, dst, src, channels, frames);                                \
+    }
+
+#define UM_DECODE_TABLE(NAME)                                                                   \
+    {                                                                                           \
+        [UMUGU_TYPE_FLOAT] = NAME##_f32, [UMUGU_TYPE_INT32] = NAME##_i32,                       \
+        [UMUGU_TYPE_INT16] = NAME##_i16, [UMUGU_TYPE_UINT8] = NAME##_u8                         \
+    }
+
+/* ## SCALAR ## */
+
+static void
+um_gain_scalar(float *dst, const float *src, float gain, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        dst[i] = src[i] * gain;
+    }
+}
+
+static void
+um_clamp_scalar(float *dst, const float *src, float min, float max, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        dst[i] = um_maxf(um_minf(src[i], max), min);
+    }
+}
+
+static void
+um_mix_scalar(float *dst, const float *const *src, int n, float scale, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        float sum = src[0][i];
+        for (int k = 1; k < n; ++k) {
+            sum += src[k][i];
+        }
+        dst[i] = sum * scale;
+    }
+}
+
+static inline int32_t
+um_quantize(float x, const um_quant *q)
+{
+    return (int32_t)um_maxf(um_minf(x * q->scale + q->bias, q->hi), q->lo);
+}
+
+static void
+um_to_f32_scalar(void *dst, const float *const *src, int channels, int frames)
+{
+    float *out = dst;
+    for (int i = 0; i < frames; ++i) {
+        for (int ch = 0; ch < channels; ++ch) {
+            *out++ = src[ch][i];
+        }
+    }
+}
+
+static void
+um_to_i32_scalar(void *dst, const float *const *src, int channels, int frames)
+{
+    int32_t *out = dst;
+    for (int i = 0; i < frames; ++i) {
+        for (int ch = 0; ch < channels; ++ch) {
+            *out++ = um_quantize(src[ch][i], &UM_QUANT_I32);
+        }
+    }
+}
+
+static void
+um_to_i16_scalar(void *dst, const float *const *src, int channels, int frames)
+{
+    int16_t *out = dst;
+    for (int i = 0; i < frames; ++i) {
+        for (int ch = 0; ch < channels; ++ch) {
+            *out++ = um_quantize(src[ch][i], &UM_QUANT_I16);
+        }
+    }
+}
+
+static void
+um_to_i8_scalar(void *dst, const float *const *src, int channels, int frames)
+{
+    int8_t *out = dst;
+    for (int i = 0; i < frames; ++i) {
+        for (int ch = 0; ch < channels; ++ch) {
+            *out++ = um_quantize(src[ch][i], &UM_QUANT_I8);
+        }
+    }
+}
+
+static void
+um_to_u8_scalar(void *dst, const float *const *src, int channels, int frames)
+{
+    uint8_t *out = dst;
+    for (int i = 0; i < frames; ++i) {
+        for (int ch = 0; ch < channels; ++ch) {
+            *out++ = um_quantize(src[ch][i], &UM_QUANT_U8);
+        }
+    }
+}
+
+/* Generic vectors: lowered to the baseline instruction set (or scalar code) by the compiler. */
+UM_OSCBANK_KERNEL(um_oscbank_scalar, )
+UM_FFT_KERNEL(um_fft_radix4_scalar, )
+UM_CMAC_KERNEL(um_cmac_scalar, )
+UM_DECODE_KERNELS(um_decode_scalar, )
+UM_DOT_KERNEL(um_dot_scalar, )
+
+static const um_kernels um_kernels_scalar = {
+    .isa = "scalar",
+    .gain = um_gain_scalar,
+    .clamp = um_clamp_scalar,
+    .mix = um_mix_scalar,
+    .convert = {
+        [UMUGU_TYPE_FLOAT] = um_to_f32_scalar,
+        [UMUGU_TYPE_INT32] = um_to_i32_scalar,
+        [UMUGU_TYPE_INT16] = um_to_i16_scalar,
+        [UMUGU_TYPE_INT8] = um_to_i8_scalar,
+        [UMUGU_TYPE_UINT8] = um_to_u8_scalar},
+    .decode = UM_DECODE_TABLE(um_decode_scalar),
+    .oscbank = um_oscbank_scalar,
+    .fft_radix4 = um_fft_radix4_scalar,
+    .cmac = um_cmac_scalar,
+    .dot = um_dot_scalar};
+
+/* The vector kernels below convert mono and stereo only (the common case) and process
+ * the remaining frames of a block, or any other channel count, with the scalar ones. */
+static inline void
+um_convert_tail(
+    umugu_type type, void *dst, const float *const *src, int channels, int frames, int done)
+{
+    if (done == frames) {
+        return;
+    }
+    const float *tail[channels];
+    for (int ch = 0; ch < channels; ++ch) {
+        tail[ch] = src[ch] + done;
+    }
+    const size_t offset = (size_t)done * channels * um_type_sizeof(type);
+    um_kernels_scalar.convert[type]((uint8_t *)dst + offset, tail, channels, frames - done);
+}
+
+#ifdef UM_SIMD_X86
+/* ## SSE2 ## */
+
+UM_TARGET_SSE2 static void
+um_gain_sse2(float *dst, const float *src, float gain, int count)
+{
+    const __m128 g = _mm_set1_ps(gain);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(src + i), g));
+    }
+    um_gain_scalar(dst + i, src + i, gain, count - i);
+}
+
+UM_TARGET_SSE2 static void
+um_clamp_sse2(float *dst, const float *src, float min, float max, int count)
+{
+    const __m128 lo = _mm_set1_ps(min);
+    const __m128 hi = _mm_set1_ps(max);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(dst + i, _mm_max_ps(_mm_min_ps(_mm_loadu_ps(src + i), hi), lo));
+    }
+    um_clamp_scalar(dst + i, src + i, min, max, count - i);
+}
+
+UM_TARGET_SSE2 static void
+um_mix_sse2(float *dst, const float *const *src, int n, float scale, int count)
+{
+    const __m128 s = _mm_set1_ps(scale);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 sum = _mm_loadu_ps(src[0] + i);
+        for (int k = 1; k < n; ++k) {
+            sum = _mm_add_ps(sum, _mm_loadu_ps(src[k] + i));
+        }
+        _mm_storeu_ps(dst + i, _mm_mul_ps(sum, s));
+    }
+
+    const float *tail[n];
+    for (int k = 0; k < n; ++k) {
+        tail[k] = src[k] + i;
+    }
+    um_mix_scalar(dst + i, tail, n, scale, count - i);
+}
+
+UM_TARGET_SSE2 static void
+um_to_f32_sse2(void *dst, const float *const *src, int channels, int frames)
+{
+    float *out = dst;
+    int i = 0;
+    if (channels == 1) {
+        memcpy(out, src[0], frames * sizeof(float));
+        return;
+    } else if (channels == 2) {
+        for (; i + 4 <= frames; i += 4) {
+            const __m128 l = _mm_loadu_ps(src[0] + i);
+            const __m128 r = _mm_loadu_ps(src[1] + i);
+            _mm_storeu_ps(out + i * 2, _mm_unpacklo_ps(l, r));
+            _mm_storeu_ps(out + i * 2 + 4, _mm_unpackhi_ps(l, r));
+        }
+    }
+    um_convert_tail(UMUGU_TYPE_FLOAT, dst, src, channels, frames, i);
+}
+
+UM_TARGET_SSE2 static inline __m128i
+um_quantize_sse2(const float *src, const um_quant *q)
+{
+    __m128 x = _mm_mul_ps(_mm_loadu_ps(src), _mm_set1_ps(q->scale));
+    x = _mm_add_ps(x, _mm_set1_ps(q->bias));
+    x = _mm_max_ps(_mm_min_ps(x, _mm_set1_ps(q->hi)), _mm_set1_ps(q->lo));
+    return _mm_cvttps_epi32(x);
+}
+
+/* Quantizes 16 samples interleaving mono (16 frames) or stereo (8 frames) input. */
+UM_TARGET_SSE2 static inline void
+um_quantize16_sse2(__m128i v[4], const float *const *src, int channels, int i, const um_quant *q)
+{
+    if (channels == 1) {
+        for (int j = 0; j < 4; ++j) {
+            v[j] = um_quantize_sse2(src[0] + i + j * 4, q);
+        }
+    } else {
+        for (int j = 0; j < 2; ++j) {
+            const __m128i l = um_quantize_sse2(src[0] + i + j * 4, q);
+            const __m128i r = um_quantize_sse2(src[1] + i + j * 4, q);
+            v[j * 2] = _mm_unpacklo_epi32(l, r);
+            v[j * 2 + 1] = _mm_unpackhi_epi32(l, r);
+        }
+    }
+}
+
+UM_TARGET_SSE2 static inline void
+um_convert_sse2(umugu_type type, void *dst, const float *const *src, int channels, int frames)
+{
+    const um_quant *q = type == UMUGU_TYPE_INT32   ? &UM_QUANT_I32
+                        : type == UMUGU_TYPE_INT16 ? &UM_QUANT_I16
+                        : type == UMUGU_TYPE_INT8  ? &UM_QUANT_I8
+                                                   : &UM_QUANT_U8;
+    const int step = 16 / channels;
+    int i = 0;
+    for (; channels <= 2 && i + step <= frames; i += step) {
+        __m128i v[4];
+        um_quantize16_sse2(v, src, channels, i, q);
+        const size_t at = (size_t)i * channels;
+        switch (type) {
+        case UMUGU_TYPE_INT32:
+            for (int j = 0; j < 4; ++j) {
+                _mm_storeu_si128((__m128i *)((int32_t *)dst + at) + j, v[j]);
+            }
+            break;
+        case UMUGU_TYPE_INT16:
+            _mm_storeu_si128((__m128i *)((int16_t *)dst + at), _mm_packs_epi32(v[0], v[1]));
+            _mm_storeu_si128((__m128i *)((int16_t *)dst + at) + 1, _mm_packs_epi32(v[2], v[3]));
+            break;
+        case UMUGU_TYPE_INT8:
+            _mm_storeu_si128(
+                (__m128i *)((int8_t *)dst + at),
+                _mm_packs_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3])));
+            break;
+        default:
+            _mm_storeu_si128(
+                (__m128i *)((uint8_t *)dst + at),
+                _mm_packus_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3])));
+            break;
+        }
+    }
+    um_convert_tail(type, dst, src, channels, frames, i);
+}
+
+UM_TARGET_SSE2 static void
+um_to_i32_sse2(void *dst, const float *const *src, int channels, int frames)
+{
+    um_convert_sse2(UMUGU_TYPE_INT32, dst, src, channels, frames);
+}
+
+UM_TARGET_SSE2 static void
+um_to_i16_sse2(void *dst, const float *const *src, int channels, int frames)
+{
+    um_convert_sse2(UMUGU_TYPE_INT16, dst, src, channels, frames);
+}
+
+UM_TARGET_SSE2 static void
+um_to_i8_sse2(void *dst, const float *const *src, int channels, int frames)
+{
+    um_convert_sse2(UMUGU_TYPE_INT8, dst, src, channels, frames);
+}
+
+UM_TARGET_SSE2 static void
+um_to_u8_sse2(void *dst, const float *const *src, int channels, int frames)
+{
+    um_convert_sse2(UMUGU_TYPE_UINT8, dst, src, channels, frames);
+}
+
+UM_OSCBANK_KERNEL(um_oscbank_sse2, UM_TARGET_SSE2)
+UM_FFT_KERNEL(um_fft_radix4_sse2, UM_TARGET_SSE2)
+UM_CMAC_KERNEL(um_cmac_sse2, UM_TARGET_SSE2)
+UM_DECODE_KERNELS(um_decode_sse2, UM_TARGET_SSE2)
+UM_DOT_KERNEL(um_dot_sse2, UM_TARGET_SSE2)
+
+static const um_kernels um_kernels_sse2 = {
+    .isa = "sse2",
+    .gain = um_gain_sse2,
+    .clamp = um_clamp_sse2,
+    .mix = um_mix_sse2,
+    .convert = {
+        [UMUGU_TYPE_FLOAT] = um_to_f32_sse2,
+        [UMUGU_TYPE_INT32] = um_to_i32_sse2,
+        [UMUGU_TYPE_INT16] = um_to_i16_sse2,
+        [UMUGU_TYPE_INT8] = um_to_i8_sse2,
+        [UMUGU_TYPE_UINT8] = um_to_u8_sse2},
+    .decode = UM_DECODE_TABLE(um_decode_sse2),
+    .oscbank = um_oscbank_sse2,
+    .fft_radix4 = um_fft_radix4_sse2,
+    .cmac = um_cmac_sse2,
+    .dot = um_dot_sse2};
+
+/* ## AVX2 ## */
+
+UM_TARGET_AVX2 static void
+um_gain_avx2(float *dst, const float *src, float gain, int count)
+{
+    const __m256 g = _mm256_set1_ps(gain);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(src + i), g));
+    }
+    um_gain_scalar(dst + i, src + i, gain, count - i);
+}
+
+UM_TARGET_AVX2 static void
+um_clamp_avx2(float *dst, const float *src, float min, float max, int count)
+{
+    const __m256 lo = _mm256_set1_ps(min);
+    const __m256 hi = _mm256_set1_ps(max);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_max_ps(_mm256_min_ps(_mm256_loadu_ps(src + i), hi), lo));
+    }
+    um_clamp_scalar(dst + i, src + i, min, max, count - i);
+}
+
+UM_TARGET_AVX2 static void
+um_mix_avx2(float *dst, const float *const *src, int n, float scale, int count)
+{
+    const __m256 s = _mm256_set1_ps(scale);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 sum = _mm256_loadu_ps(src[0] + i);
+        for (int k = 1; k < n; ++k) {
+            sum = _mm256_add_ps(sum, _mm256_loadu_ps(src[k] + i));
+        }
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(sum, s));
+    }
+
+    const float *tail[n];
+    for (int k = 0; k < n; ++k) {
+        tail[k] = src[k] + i;
+    }
+    um_mix_scalar(dst + i, tail, n, scale, count - i);
+}
+
+UM_TARGET_AVX2 static void
+um_to_f32_avx2(void *dst, const float *const *src, int channels, int frames)
+{
+    float *out = dst;
+    int i = 0;
+    if (channels == 1) {
+        memcpy(out, src[0], frames * sizeof(float));
+        return;
+    } else if (channels == 2) {
+        for (; i + 8 <= frames; i += 8) {
+            const __m256 l = _mm256_loadu_ps(src[0] + i);
+            const __m256 r = _mm256_loadu_ps(src[1] + i);
+            /* unpack works per 128-bit lane: {l0 r0 l1 r1 | l4 r4 l5 r5} {l2 r2 l3 r3 | ...} */
+            const __m256 lo = _mm256_unpacklo_ps(l, r);
+            const __m256 hi = _mm256_unpackhi_ps(l, r);
+            _mm256_storeu_ps(out + i * 2, _mm256_permute2f128_ps(lo, hi, 0x20));
+            _mm256_storeu_ps(out + i * 2 + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+        }
+    }
+    um_convert_tail(UMUGU_TYPE_FLOAT, dst, src, channels, frames, i);
+}
+
+UM_TARGET_AVX2 static inline __m256i
+um_quantize_avx2(const float *src, const um_quant *q)
+{
+    __m256 x = _mm256_add_ps(
+        _mm256_mul_ps(_mm256_loadu_ps(src), _mm256_set1_ps(q->scale)), _mm256_set1_ps(q->bias));
+    x = _mm256_max_ps(_mm256_min_ps(x, _mm256_set1_ps(q->hi)), _mm256_set1_ps(q->lo));
+    return _mm256_cvttps_epi32(x);
+}
+
+UM_TARGET_AVX2 static inline void
+um_convert_avx2(umugu_type type, void *dst, const float *const *src, int channels, int frames)
+{
+    const um_quant *q = type == UMUGU_TYPE_INT32   ? &UM_QUANT_I32
+                        : type == UMUGU_TYPE_INT16 ? &UM_QUANT_I16
+                        : type == UMUGU_TYPE_INT8  ? &UM_QUANT_I8
+                                                   : &UM_QUANT_U8;
+    const int step = 16 / channels;
+    int i = 0;
+    for (; channels <= 2 && i + step <= frames; i += step) {
+        /* 16 samples, interleaved if stereo. */
+        __m256i v0, v1;
+        if (channels == 1) {
+            v0 = um_quantize_avx2(src[0] + i, q);
+            v1 = um_quantize_avx2(src[0] + i + 8, q);
+        } else {
+            const __m256i l = um_quantize_avx2(src[0] + i, q);
+            const __m256i r = um_quantize_avx2(src[1] + i, q);
+            const __m256i lo = _mm256_unpacklo_epi32(l, r);
+            const __m256i hi = _mm256_unpackhi_epi32(l, r);
+            v0 = _mm256_permute2x128_si256(lo, hi, 0x20);
+            v1 = _mm256_permute2x128_si256(lo, hi, 0x31);
+        }
+
+        const size_t at = (size_t)i * channels;
+        if (type == UMUGU_TYPE_INT32) {
+            _mm256_storeu_si256((__m256i *)((int32_t *)dst + at), v0);
+            _mm256_storeu_si256((__m256i *)((int32_t *)dst + at) + 1, v1);
+            continue;
+        }
+
+        /* packs also works per lane, restore the order of the 64-bit blocks. */
+        const __m256i v16 = _mm256_permute4x64_epi64(_mm256_packs_epi32(v0, v1), 0xD8);
+        if (type == UMUGU_TYPE_INT16) {
+            _mm256_storeu_si256((__m256i *)((int16_t *)dst + at), v16);
+        } else {
+            const __m128i a = _mm256_castsi256_si128(v16);
+            const __m128i b = _mm256_extracti128_si256(v16, 1);
+            _mm_storeu_si128(
+                (__m128i *)((uint8_t *)dst + at),
+                type == UMUGU_TYPE_INT8 ? _mm_packs_epi16(a, b) : _mm_packus_epi16(a, b));
+        }
+    }
+    um_convert_tail(type, dst, src, channels, frames, i);
+}
+
+UM_TARGET_AVX2 static void
+um_to_i32_avx2(void *dst, const float *const *src, int channels, int frames)
+{
+    um_convert_avx2(UMUGU_TYPE_INT32, dst, src, channels, frames);
+}
+
+UM_TARGET_AVX2 static void
+um_to_i16_avx2(void *dst, const float *const *src, int channels, int frames)
+{
+    um_convert_avx2(UMUGU_TYPE_INT16, dst, src, channels, frames);
+}
+
+UM_TARGET_AVX2 static void
+um_to_i8_avx2(void *dst, const float *const *src, int channels, int frames)
+{
+    um_convert_avx2(UMUGU_TYPE_INT8, dst, src, channels, frames);
+}
+
+UM_TARGET_AVX2 static void
+um_to_u8_avx2(void *dst, const float *const *src, int channels, int frames)
+{
+    um_convert_avx2(UMUGU_TYPE_UINT8, dst, src, channels, frames);
+}
+
+UM_OSCBANK_KERNEL(um_oscbank_avx2, UM_TARGET_AVX2)
+UM_FFT_KERNEL(um_fft_radix4_avx2, UM_TARGET_AVX2)
+UM_CMAC_KERNEL(um_cmac_avx2, UM_TARGET_AVX2)
+UM_DECODE_KERNELS(um_decode_avx2, UM_TARGET_AVX2)
+UM_DOT_KERNEL(um_dot_avx2, UM_TARGET_AVX2)
+
+static const um_kernels um_kernels_avx2 = {
+    .isa = "avx2",
+    .gain = um_gain_avx2,
+    .clamp = um_clamp_avx2,
+    .mix = um_mix_avx2,
+    .convert = {
+        [UMUGU_TYPE_FLOAT] = um_to_f32_avx2,
+        [UMUGU_TYPE_INT32] = um_to_i32_avx2,
+        [UMUGU_TYPE_INT16] = um_to_i16_avx2,
+        [UMUGU_TYPE_INT8] = um_to_i8_avx2,
+        [UMUGU_TYPE_UINT8] = um_to_u8_avx2},
+    .decode = UM_DECODE_TABLE(um_decode_avx2),
+    .oscbank = um_oscbank_avx2,
+    .fft_radix4 = um_fft_radix4_avx2,
+    .cmac = um_cmac_avx2,
+    .dot = um_dot_avx2};
+#endif /* UM_SIMD_X86 */
+
+#ifdef UM_SIMD_NEON
+/* ## NEON ## */
+
+static void
+um_gain_neon(float *dst, const float *src, float gain, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(dst + i, vmulq_n_f32(vld1q_f32(src + i), gain));
+    }
+    um_gain_scalar(dst + i, src + i, gain, count - i);
+}
+
+static void
+um_clamp_neon(float *dst, const float *src, float min, float max, int count)
+{
+    const float32x4_t lo = vdupq_n_f32(min);
+    const float32x4_t hi = vdupq_n_f32(max);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(dst + i, vmaxq_f32(vminq_f32(vld1q_f32(src + i), hi), lo));
+    }
+    um_clamp_scalar(dst + i, src + i, min, max, count - i);
+}
+
+static void
+um_mix_neon(float *dst, const float *const *src, int n, float scale, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t sum = vld1q_f32(src[0] + i);
+        for (int k = 1; k < n; ++k) {
+            sum = vaddq_f32(sum, vld1q_f32(src[k] + i));
+        }
+        vst1q_f32(dst + i, vmulq_n_f32(sum, scale));
+    }
+
+    const float *tail[n];
+    for (int k = 0; k < n; ++k) {
+        tail[k] = src[k] + i;
+    }
+    um_mix_scalar(dst + i, tail, n, scale, count - i);
+}
+
+static void
+um_to_f32_neon(void *dst, const float *const *src, int channels, int frames)
+{
+    float *out = dst;
+    int i = 0;
+    if (channels == 1) {
+        memcpy(out, src[0], frames * sizeof(float));
+        return;
+    } else if (channels == 2) {
+        for (; i + 4 <= frames; i += 4) {
+            const float32x4x2_t lr = {{vld1q_f32(src[0] + i), vld1q_f32(src[1] + i)}};
+            vst2q_f32(out + i * 2, lr);
+        }
+    }
+    um_convert_tail(UMUGU_TYPE_FLOAT, dst, src, channels, frames, i);
+}
+
+static inline int32x4_t
+um_quantize_neon(const float *src, const um_quant *q)
+{
+    float32x4_t x = vaddq_f32(vmulq_n_f32(vld1q_f32(src), q->scale), vdupq_n_f32(q->bias));
+    x = vmaxq_f32(vminq_f32(x, vdupq_n_f32(q->hi)), vdupq_n_f32(q->lo));
+    return vcvtq_s32_f32(x);
+}
+
+/* 8 frames per iteration, the interleaving stores (vst2) do the stereo shuffle. */
+static inline void
+um_convert_neon(umugu_type type, void *dst, const float *const *src, int channels, int frames)
+{
+    const um_quant *q = type == UMUGU_TYPE_INT32   ? &UM_QUANT_I32
+                        : type == UMUGU_TYPE_INT16 ? &UM_QUANT_I16
+                        : type == UMUGU_TYPE_INT8  ? &UM_QUANT_I8
+                                                   : &UM_QUANT_U8;
+    int i = 0;
+    for (; channels <= 2 && i + 8 <= frames; i += 8) {
+        const int c = channels - 1;
+        const int32x4_t l0 = um_quantize_neon(src[0] + i, q);
+        const int32x4_t l1 = um_quantize_neon(src[0] + i + 4, q);
+        const int32x4_t r0 = um_quantize_neon(src[c] + i, q);
+        const int32x4_t r1 = um_quantize_neon(src[c] + i + 4, q);
+        const int16x8_t l16 = vcombine_s16(vqmovn_s32(l0), vqmovn_s32(l1));
+        const int16x8_t r16 = vcombine_s16(vqmovn_s32(r0), vqmovn_s32(r1));
+        const size_t at = (size_t)i * channels;
+
+        switch (type) {
+        case UMUGU_TYPE_INT32: {
+            int32_t *out = (int32_t *)dst + at;
+            if (c) {
+                vst2q_s32(out, (int32x4x2_t){{l0, r0}});
+                vst2q_s32(out + 8, (int32x4x2_t){{l1, r1}});
+            } else {
+                vst1q_s32(out, l0);
+                vst1q_s32(out + 4, l1);
+            }
+            break;
+        }
+        case UMUGU_TYPE_INT16: {
+            int16_t *out = (int16_t *)dst + at;
+            if (c) {
+                vst2q_s16(out, (int16x8x2_t){{l16, r16}});
+            } else {
+                vst1q_s16(out, l16);
+            }
+            break;
+        }
+        case UMUGU_TYPE_INT8: {
+            int8_t *out = (int8_t *)dst + at;
+            if (c) {
+                vst2_s8(out, (int8x8x2_t){{vqmovn_s16(l16), vqmovn_s16(r16)}});
+            } else {
+                vst1_s8(out, vqmovn_s16(l16));
+            }
+            break;
+        }
+        default: {
+            uint8_t *out = (uint8_t *)dst + at;
+            if (c) {
+                vst2_u8(out, (uint8x8x2_t){{vqmovun_s16(l16), vqmovun_s16(r16)}});
+            } else {
+                vst1_u8(out, vqmovun_s16(l16));
+            }
+            break;
+        }
+        }
+    }
+    um_convert_tail(type, dst, src, channels, frames, i);
+}
+
+static void
+um_to_i32_neon(void *dst, const float *const *src, int channels, int frames)
+{
+    um_convert_neon(UMUGU_TYPE_INT32, dst, src, channels, frames);
+}
+
+static void
+um_to_i16_neon(void *dst, const float *const *src, int channels, int frames)
+{
+    um_convert_neon(UMUGU_TYPE_INT16, dst, src, channels, frames);
+}
+
+static void
+um_to_i8_neon(void *dst, const float *const *src, int channels, int frames)
+{
+    um_convert_neon(UMUGU_TYPE_INT8, dst, src, channels, frames);
+}
+
+static void
+um_to_u8_neon(void *dst, const float *const *src, int channels, int frames)
+{
+    um_convert_neon(UMUGU_TYPE_UINT8, dst, src, channels, frames);
+}
+
+UM_OSCBANK_KERNEL(um_oscbank_neon, )
+UM_FFT_KERNEL(um_fft_radix4_neon, )
+UM_CMAC_KERNEL(um_cmac_neon, )
+UM_DECODE_KERNELS(um_decode_neon, )
+UM_DOT_KERNEL(um_dot_neon, )
+
+static const um_kernels um_kernels_neon = {
+    .isa = "neon",
+    .gain = um_gain_neon,
+    .clamp = um_clamp_neon,
+    .mix = um_mix_neon,
+    .convert = {
+        [UMUGU_TYPE_FLOAT] = um_to_f32_neon,
+        [UMUGU_TYPE_INT32] = um_to_i32_neon,
+        [UMUGU_TYPE_INT16] = um_to_i16_neon,
+        [UMUGU_TYPE_INT8] = um_to_i8_neon,
+        [UMUGU_TYPE_UINT8] = um_to_u8_neon},
+    .decode = UM_DECODE_TABLE(um_decode_neon),
+    .oscbank = um_oscbank_neon,
+    .fft_radix4 = um_fft_radix4_neon,
+    .cmac = um_cmac_neon,
+    .dot = um_dot_neon};
+#endif /* UM_SIMD_NEON */
+
+int
+um_kernels_available(const um_kernels **out, int capacity)
+{
+    int count = 0;
+    if (count < capacity) {
+        out[count++] = &um_kernels_scalar;
+    }
+#if defined(UM_SIMD_X86)
+    __builtin_cpu_init();
+    if (count < capacity && __builtin_cpu_supports("sse2")) {
+        out[count++] = &um_kernels_sse2;
+    }
+    if (count < capacity && __builtin_cpu_supports("avx2")) {
+        out[count++] = &um_kernels_avx2;
+    }
+#elif defined(UM_SIMD_NEON)
+    if (count < capacity) {
+        out[count++] = &um_kernels_neon;
+    }
+#endif
+    return count;
+}
+
+const um_kernels *
+um_kernels_select(void)
+{
+    UM_TRACE_ZONE();
+    /* The tables are ordered from the most portable to the fastest. */
+    const um_kernels *available[4];
+    const int count = um_kernels_available(available, sizeof(available) / sizeof(*available));
+    return available[count - 1];
+}
@@ -0,0 +1,251 @@
+#include "umugu.h"
+
+#include "umugu_internal.h"
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Bytes read from the file per pread (rounded down to whole frames). */
+#define UM_STREAM_CHUNK_BYTES (64 * 1024)
+/* Wav header prefix parsed when opening, the chunks before the data have to fit. */
+#define UM_STREAM_HEADER_BYTES (16 * 1024)
+/* Sleep of the reader when the ring is full or the file ended. */
+#define UM_STREAM_IDLE_NS (2 * 1000 * 1000)
+
+struct um_stream {
+    um_ring ring;
+    int fd;
+    uint32_t frame_bytes;
+    uint64_t data_offset;  /* File offset of the first frame. */
+    uint32_t frame_count;
+    uint32_t next_frame;   /* Reader: next frame to read from the file. */
+    const bool *loop;      /* Read by the reader at the end of the file. */
+    uint64_t seek_request; /* Consumer: (sequence << 32) | frame. */
+    uint32_t seek_seq;     /* Consumer: last sequence requested. */
+    uint32_t seek_pending; /* Consumer: sequence not acknowledged yet, 0 if none. */
+    uint32_t seek_ack;     /* Reader: last sequence applied... */
+    uint64_t seek_head;    /* ...and the ring position where its data starts. */
+    uint64_t end_head;     /* Ring position of the end of the file, UINT64_MAX if not there. */
+    uint32_t wake;         /* Futex word of the reader. */
+    int32_t quit;
+    pthread_t thread;
+};
+
+static inline long
+um_stream_futex_wait(uint32_t *word, uint32_t value, long timeout_ns)
+{
+    struct timespec timeout = {.tv_sec = 0, .tv_nsec = timeout_ns};
+    return syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, value, &timeout, NULL, 0);
+}
+
+/* Applies a seek request. Returns true if there was a new one. */
+static bool
+um_stream_apply_seek(um_stream *s)
+{
+    const uint64_t request = __atomic_load_n(&s->seek_request, __ATOMIC_ACQUIRE);
+    const uint32_t seq = (uint32_t)(request >> 32);
+    if (seq == s->seek_ack) {
+        return false;
+    }
+
+    const uint32_t frame = (uint32_t)request;
+    s->next_frame = frame < s->frame_count ? frame : s->frame_count;
+    __atomic_store_n(&s->end_head, UINT64_MAX, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->seek_head, s->ring.head, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->seek_ack, seq, __ATOMIC_RELEASE);
+    return true;
+}
+
+/* Fills the ring with the next chunk of the file. Returns false if there was nothing
+ * to do (ring full or end of the file). */
+static bool
+um_stream_fill(um_stream *s)
+{
+    if (s->next_frame >= s->frame_count) {
+        if (!__atomic_load_n(s->loop, __ATOMIC_RELAXED) || !s->frame_count) {
+            if (__atomic_load_n(&s->end_head, __ATOMIC_RELAXED) == UINT64_MAX) {
+                __atomic_store_n(&s->end_head, s->ring.head, __ATOMIC_RELEASE);
+            }
+            return false;
+        }
+        s->next_frame = 0;
+        __atomic_store_n(&s->end_head, UINT64_MAX, __ATOMIC_RELAXED);
+    }
+
+    void *region;
+    uint64_t bytes = um_ring_write_region(&s->ring, &region);
+    const uint64_t chunk = UM_STREAM_CHUNK_BYTES - UM_STREAM_CHUNK_BYTES % s->frame_bytes;
+    const uint64_t left = (uint64_t)(s->frame_count - s->next_frame) * s->frame_bytes;
+    bytes = bytes < chunk ? bytes : chunk;
+    bytes = bytes < left ? bytes : left;
+    bytes -= bytes % s->frame_bytes;
+    if (!bytes) {
+        return false;
+    }
+
+    const off_t offset = s->data_offset + (uint64_t)s->next_frame * s->frame_bytes;
+    const ssize_t got = pread(s->fd, region, bytes, offset);
+    if (got < (ssize_t)s->frame_bytes) {
+        /* Read error or truncated file: it ends here. */
+        s->frame_count = s->next_frame;
+        return true;
+    }
+
+    const uint32_t frames = (uint32_t)got / s->frame_bytes;
+    s->next_frame += frames;
+    um_ring_commit(&s->ring, (uint64_t)frames * s->frame_bytes);
+    return true;
+}
+
+static void *
+um_stream_main(void *arg)
+{
+    um_stream *s = arg;
+    while (!__atomic_load_n(&s->quit, __ATOMIC_ACQUIRE)) {
+        const uint32_t wake = __atomic_load_n(&s->wake, __ATOMIC_ACQUIRE);
+        const bool seeked = um_stream_apply_seek(s);
+        if (!um_stream_fill(s) && !seeked) {
+            um_stream_futex_wait(&s->wake, wake, UM_STREAM_IDLE_NS);
+        }
+    }
+    return NULL;
+}
+
+um_stream *
+um_stream_open(
+    umugu_ctx *ctx, const char *filename, umugu_signal *sig, const bool *loop, int ring_frames)
+{
+    UM_TRACE_ZONE();
+    UMUGU_ASSERT(ring_frames > 0);
+    const int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        ctx->io.log("Stream: couldn't open %s\n", filename);
+        return NULL;
+    }
+
+    struct stat st;
+    uint8_t header[UM_STREAM_HEADER_BYTES];
+    const ssize_t header_size = fstat(fd, &st) ? -1 : pread(fd, header, sizeof(header), 0);
+    const int frames =
+        header_size > 0 ? um_signal_wav_parse(sig, header, header_size, st.st_size) : -1;
+    if (frames < UMUGU_SUCCESS) {
+        ctx->io.log("Stream: unsupported wav format %s\n", filename);
+        close(fd);
+        return NULL;
+    }
+
+    um_stream *s = um_allocprs(ctx, sizeof(um_stream));
+    s->fd = fd;
+    s->frame_bytes = um_signal_stride(sig);
+    s->data_offset = (const uint8_t *)sig->samples.samples - header;
+    s->frame_count = frames;
+    s->next_frame = 0;
+    s->loop = loop;
+    s->seek_request = 0;
+    s->seek_seq = 0;
+    s->seek_pending = 0;
+    s->seek_ack = 0;
+    s->seek_head = 0;
+    s->end_head = UINT64_MAX;
+    s->wake = 0;
+    s->quit = 0;
+    const uint64_t capacity = (uint64_t)ring_frames * s->frame_bytes;
+    um_ring_init(&s->ring, um_allocprs(ctx, capacity), capacity);
+    sig->samples.samples = NULL;
+
+    /* Starts full: the first blocks do not depend on how soon the reader gets the cpu. */
+    posix_fadvise(fd, s->data_offset, 0, POSIX_FADV_SEQUENTIAL);
+    while (um_stream_fill(s)) {
+    }
+
+    if (pthread_create(&s->thread, NULL, um_stream_main, s)) {
+        ctx->io.log("Stream: could not create the reader thread.\n");
+        close(fd);
+        return NULL;
+    }
+    return s;
+}
+
+void
+um_stream_close(um_stream *s)
+{
+    UM_TRACE_ZONE();
+    __atomic_store_n(&s->quit, 1, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&s->wake, 1, __ATOMIC_RELEASE);
+    syscall(SYS_futex, &s->wake, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+    pthread_join(s->thread, NULL);
+    close(s->fd);
+}
+
+void
+um_stream_wait(um_stream *s)
+{
+    __atomic_add_fetch(&s->wake, 1, __ATOMIC_RELEASE);
+    syscall(SYS_futex, &s->wake, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+    sched_yield();
+}
+
+/* Drops the frames before the acknowledged seek. Returns false while it is pending. */
+static inline bool
+um_stream_sync_seek(um_stream *s)
+{
+    if (!s->seek_pending) {
+        return true;
+    }
+    if (__atomic_load_n(&s->seek_ack, __ATOMIC_ACQUIRE) != s->seek_pending) {
+        return false;
+    }
+    um_ring_consume_to(&s->ring, __atomic_load_n(&s->seek_head, __ATOMIC_RELAXED));
+    s->seek_pending = 0;
+    return true;
+}
+
+int
+um_stream_peek(um_stream *s, const void **frames, int max_frames)
+{
+    if (!um_stream_sync_seek(s)) {
+        return 0;
+    }
+    const uint64_t ready = um_ring_read_region(&s->ring, frames) / s->frame_bytes;
+    return ready < (uint64_t)max_frames ? (int)ready : max_frames;
+}
+
+void
+um_stream_consume(um_stream *s, int frames)
+{
+    um_ring_consume_to(&s->ring, s->ring.tail + (uint64_t)frames * s->frame_bytes);
+}
+
+void
+um_stream_seek(um_stream *s, uint32_t frame)
+{
+    s->seek_pending = ++s->seek_seq ? s->seek_seq : ++s->seek_seq; /* 0 means none. */
+    __atomic_store_n(
+        &s->seek_request, ((uint64_t)s->seek_pending << 32) | frame, __ATOMIC_RELEASE);
+}
+
+bool
+um_stream_ready(um_stream *s, int frames)
+{
+    if (!um_stream_sync_seek(s)) {
+        return false;
+    }
+    const uint64_t tail = s->ring.tail;
+    const uint64_t ready = __atomic_load_n(&s->ring.head, __ATOMIC_ACQUIRE) - tail;
+    return ready >= (uint64_t)frames * s->frame_bytes ||
+           tail == __atomic_load_n(&s->end_head, __ATOMIC_ACQUIRE);
+}
+
+bool
+um_stream_starved(um_stream *s)
+{
+    const uint64_t tail = s->ring.tail;
+    return !s->seek_pending && __atomic_load_n(&s->ring.head, __ATOMIC_ACQUIRE) == tail &&
+           tail != __atomic_load_n(&s->end_head, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,344 @@
+#include "umugu.h"
+
+#include "umugu_internal.h"
+
+/* Pipeline hot-swap. The current pipeline is the one in umugu_ctx (pipeline, plan and
+ * resampler), the others are kept in scenes. A control thread builds the next pipeline
+ * in a free region of the arena through a staging context placed at the start of the
+ * region (a ctx of its own, so um_allocprs works as usual and never touches the arena
+ * the audio thread is allocating from), then publishes its scene (staged). The audio
+ * thread exchanges it with the current one at the start of a block and keeps processing
+ * the old one while it fades out. When the fade is over the old scene is handed back
+ * (retired) and the control thread releases its nodes and frees its region.
+ * The pipeline loaded by umugu_load lives in the arena, so it is released but its
+ * memory stays there: only the pipelines of the regions come and go. */
+
+enum { UM_SWAP_REGIONS = 2 };
+
+typedef struct {
+    umugu_pipeline pipeline;
+    umugu_plan plan;
+    um_resampler *resampler;
+    int32_t region;      /* Of the pipeline memory, -1 if it is the one of umugu_load. */
+    int32_t fade_frames; /* Crossfade when it is swapped in. */
+} um_scene;
+
+struct um_swap {
+    um_scene *staged; /* Published by the control thread, taken by the audio thread. */
+    char pad0[56];
+    um_scene *retired; /* Published by the audio thread, taken by the control thread. */
+    char pad1[56];
+
+    /* Audio thread. */
+    um_scene *fading;     /* The previous pipeline while it fades out (or waits to retire). */
+    int32_t live_region;  /* Region of the current pipeline. */
+    int32_t fade_pos;     /* Frames of the crossfade done. */
+    int32_t fade_frames;  /* Crossfade length. */
+    bool capturing;       /* Processing the pipeline fading out. */
+    const float *capture; /* Its (planar) output in this block, faded out. */
+    int32_t capture_channels;
+
+    /* Control thread. */
+    umugu_ctx *regions[UM_SWAP_REGIONS]; /* Staging contexts at the start of the regions. */
+    bool region_used[UM_SWAP_REGIONS];
+    bool scene_used[UM_SWAP_REGIONS];
+    um_scene scenes[UM_SWAP_REGIONS];
+    size_t region_size;
+    umugu_signal sig; /* Pipeline signal of the loaded configuration. */
+};
+
+um_swap *
+um_swap_create(umugu_ctx *ctx, size_t region_size)
+{
+    UM_TRACE_ZONE();
+    region_size = um_align_up(region_size, UM_ARENA_ALIGN);
+    if (region_size < 2 * sizeof(umugu_ctx) +
+                          ctx->nodes_info_capacity * sizeof(umugu_node_type_info)) {
+        ctx->io.log("[ERR] Pipeline swap: regions of %zu bytes are too small.\n", region_size);
+        return NULL;
+    }
+
+    um_swap *sw = um_allocprs(ctx, sizeof(um_swap));
+    memset(sw, 0, sizeof(um_swap));
+    sw->live_region = -1;
+    sw->region_size = region_size;
+    sw->sig = ctx->pipeline.sig;
+    sw->sig.samples.samples = NULL;
+    sw->sig.samples.frame_count = 0;
+
+    uint8_t *mem = um_allocprs(ctx, region_size * UM_SWAP_REGIONS);
+    for (int r = 0; r < UM_SWAP_REGIONS; ++r) {
+        sw->regions[r] = (umugu_ctx *)(mem + r * region_size);
+    }
+    return sw;
+}
+
+/* Empty context for building a pipeline in the region: shares the io config, kernels
+ * and node types of ctx, allocates from the region. */
+static umugu_ctx *
+um_swap_stage(umugu_ctx *ctx, um_swap *sw, int region)
+{
+    umugu_ctx *stage = sw->regions[region];
+    memset(stage, 0, sizeof(umugu_ctx));
+    stage->state = UMUGU_STATE_LOADING;
+
+    /* Field by field: the audio thread keeps writing the buffers of ctx->io. */
+    stage->io.log = ctx->io.log;
+    stage->io.file_read = ctx->io.file_read;
+    stage->io.fatal = ctx->io.fatal;
+    stage->io.out_audio.format = ctx->io.out_audio.format;
+    stage->io.out_audio.interleaved_channels = ctx->io.out_audio.interleaved_channels;
+    stage->io.out_audio.sample_rate = ctx->io.out_audio.sample_rate;
+    stage->io.out_audio.samples.channel_count = ctx->io.out_audio.samples.channel_count;
+    stage->pipeline.sig = sw->sig;
+    stage->kernels = ctx->kernels;
+    stage->pipeline_capacity = ctx->pipeline_capacity;
+
+    stage->arena_head = (uint8_t *)stage;
+    stage->arena_capacity = sw->region_size;
+    stage->arena_pers_end = um_align_ptr(stage->arena_head + sizeof(umugu_ctx), UM_ARENA_ALIGN);
+    stage->arena_tail = stage->arena_pers_end;
+
+    /* Same capacity, the node types it loads are appended to the ones of ctx. */
+    stage->nodes_info_capacity = ctx->nodes_info_capacity;
+    stage->nodes_info =
+        um_allocprs(stage, stage->nodes_info_capacity * sizeof(umugu_node_type_info));
+    stage->nodes_info_next = ctx->nodes_info_next;
+    memcpy(stage->nodes_info, ctx->nodes_info, sizeof(ctx->nodes_info[0]) * ctx->nodes_info_next);
+    stage->registry = um_registry_create(stage);
+    um_registry_copy(stage->registry, ctx->registry);
+    memcpy(stage->fallback_wav_file, ctx->fallback_wav_file, sizeof(ctx->fallback_wav_file));
+    memcpy(
+        stage->fallback_soundfont2_file, ctx->fallback_soundfont2_file,
+        sizeof(ctx->fallback_soundfont2_file));
+    memcpy(
+        stage->fallback_midi_device, ctx->fallback_midi_device,
+        sizeof(ctx->fallback_midi_device));
+    stage->state = UMUGU_STATE_IDLE;
+    return stage;
+}
+
+static void
+um_scene_release(umugu_ctx *ctx, um_scene *s)
+{
+    for (int i = 0; i < s->plan.step_count; ++i) {
+        const umugu_exec_step *step = &s->plan.steps[i];
+        if (step->release) {
+            step->release(ctx, s->plan.exec_node[i], UMUGU_NOFLAG);
+        }
+    }
+}
+
+UMUGU_API int
+umugu_pipeline_collect(umugu_ctx *ctx)
+{
+    UM_TRACE_ZONE();
+    um_swap *sw = ctx->swap;
+    um_scene *s = sw ? __atomic_exchange_n(&sw->retired, NULL, __ATOMIC_ACQUIRE) : NULL;
+    if (!s) {
+        return UMUGU_NOOP;
+    }
+
+    um_scene_release(ctx, s);
+    if (s->region >= 0) {
+        sw->region_used[s->region] = false;
+    }
+    sw->scene_used[s - sw->scenes] = false;
+    return UMUGU_SUCCESS;
+}
+
+UMUGU_API int
+umugu_pipeline_swap(umugu_ctx *ctx, const char *filename, int fade_frames)
+{
+    UM_TRACE_ZONE();
+    um_swap *sw = ctx->swap;
+    if (!sw) {
+        ctx->io.log("[ERR] Pipeline swap: no regions (umugu_config.pipeline_region_size).\n");
+        return UMUGU_ERR_MEM;
+    }
+    if (!filename || fade_frames < 0) {
+        return UMUGU_ERR_ARGS;
+    }
+
+    umugu_pipeline_collect(ctx);
+    int region = -1, scene = -1;
+    for (int i = UM_SWAP_REGIONS - 1; i >= 0; --i) {
+        region = sw->region_used[i] ? region : i;
+        scene = sw->scene_used[i] ? scene : i;
+    }
+    if (region < 0 || scene < 0 || __atomic_load_n(&sw->staged, __ATOMIC_ACQUIRE)) {
+        return UMUGU_ERR_BUSY;
+    }
+
+    umugu_ctx *stage = um_swap_stage(ctx, sw, region);
+    int err = umugu_pipeline_import(stage, filename);
+    if (err < UMUGU_SUCCESS) {
+        /* The nodes are initialized when only the compilation fails. */
+        if (err == UMUGU_ERR_GRAPH || err == UMUGU_ERR_NULL) {
+            for (int i = 0; i < stage->pipeline.node_count; ++i) {
+                um_node_dispatch(stage, stage->pipeline.nodes[i], UMUGU_FN_RELEASE, UMUGU_NOFLAG);
+            }
+        }
+        ctx->io.log("[ERR] Pipeline swap: could not build %s (%d).\n", filename, err);
+        return err;
+    }
+
+    /* Node types loaded by the new pipeline (e.g. plugs) are appended to the context
+     * ones, at the same indices: the audio thread does not look past nodes_info_next. */
+    for (int i = ctx->nodes_info_next; i < stage->nodes_info_next; ++i) {
+        const int idx = um_node_info_add(ctx, &stage->nodes_info[i]);
+        UMUGU_ASSERT(idx == i && "Node types appended while staging.");
+        (void)idx;
+    }
+
+    um_scene *s = &sw->scenes[scene];
+    s->pipeline = stage->pipeline;
+    s->plan = stage->plan;
+    s->resampler = stage->resampler;
+    s->region = region;
+    s->fade_frames = fade_frames;
+    sw->region_used[region] = true;
+    sw->scene_used[scene] = true;
+    __atomic_store_n(&sw->staged, s, __ATOMIC_RELEASE);
+
+#ifdef UMUGU_VERBOSE
+    ctx->io.log(
+        "Pipeline %s staged: %d nodes, %td bytes of region %d.\n", filename,
+        (int)s->pipeline.node_count, stage->arena_pers_end - stage->arena_head, region);
+#endif
+    return UMUGU_SUCCESS;
+}
+
+/* Makes the scene pipeline the current one and stores the current one in the scene. */
+static void
+um_scene_exchange(umugu_ctx *ctx, um_swap *sw, um_scene *s)
+{
+    const um_scene live = {
+        .pipeline = ctx->pipeline,
+        .plan = ctx->plan,
+        .resampler = ctx->resampler,
+        .region = sw->live_region};
+    ctx->pipeline = s->pipeline;
+    ctx->plan = s->plan;
+    ctx->resampler = s->resampler;
+    sw->live_region = s->region;
+    s->pipeline = live.pipeline;
+    s->plan = live.plan;
+    s->resampler = live.resampler;
+    s->region = live.region;
+}
+
+/* Frames of the pipeline in a block of frames of the output. */
+static inline void
+um_swap_block_frames(umugu_ctx *ctx, int frames)
+{
+    ctx->pipeline.sig.samples.frame_count =
+        ctx->resampler ? um_resampler_input_frames(ctx->resampler, frames) : frames;
+}
+
+void
+um_swap_process(umugu_ctx *ctx, int frames)
+{
+    UM_TRACE_ZONE();
+    um_swap *sw = ctx->swap;
+    sw->capture = NULL;
+    if (!sw->fading) {
+        um_scene *s = __atomic_exchange_n(&sw->staged, NULL, __ATOMIC_ACQUIRE);
+        if (!s) {
+            return;
+        }
+        sw->fade_frames = s->fade_frames;
+        sw->fade_pos = 0;
+        um_scene_exchange(ctx, sw, s);
+        sw->fading = s;
+        um_params_reset(ctx);
+        um_params_publish(ctx, &sw->regions[sw->live_region]->pipeline);
+    }
+
+    if (sw->fade_pos < sw->fade_frames) {
+        um_scene_exchange(ctx, sw, sw->fading);
+        um_swap_block_frames(ctx, frames);
+        ctx->state = UMUGU_STATE_PROCESSING;
+        sw->capturing = true;
+        um_metrics_pause(ctx, true);
+        um_plan_run(ctx);
+        um_metrics_pause(ctx, false);
+        sw->capturing = false;
+        ctx->state = UMUGU_STATE_IDLE;
+        um_scene_exchange(ctx, sw, sw->fading);
+    }
+    um_swap_block_frames(ctx, frames);
+}
+
+void
+um_swap_advance(umugu_ctx *ctx, int frames)
+{
+    um_swap *sw = ctx->swap;
+    if (!sw->fading) {
+        return;
+    }
+    sw->fade_pos = um_mini(sw->fade_pos + frames, sw->fade_frames);
+    if (sw->fade_pos == sw->fade_frames && !__atomic_load_n(&sw->retired, __ATOMIC_ACQUIRE)) {
+        __atomic_store_n(&sw->retired, sw->fading, __ATOMIC_RELEASE);
+        sw->fading = NULL;
+    }
+}
+
+bool
+um_swap_output(umugu_ctx *ctx, const float **src, int channels, int frames)
+{
+    um_swap *sw = ctx->swap;
+    if (!sw->fading || sw->fade_pos >= sw->fade_frames) {
+        return false;
+    }
+
+    /* Linear crossfade, the new pipeline weights (fade_pos + i + 1) / fade_frames. */
+    const float inv_len = 1.0f / sw->fade_frames;
+    const int fade = um_mini(sw->fade_frames - sw->fade_pos, frames);
+    if (sw->capturing) {
+        float *capture = um_alloctmp(ctx, sizeof(float) * frames * channels);
+        for (int ch = 0; ch < channels; ++ch) {
+            float *dst = capture + ch * frames;
+            for (int i = 0; i < fade; ++i) {
+                dst[i] = src[ch][i] * (1.0f - (sw->fade_pos + i + 1) * inv_len);
+            }
+            memset(dst + fade, 0, sizeof(float) * (frames - fade));
+        }
+        sw->capture = capture;
+        sw->capture_channels = channels;
+        return true;
+    }
+
+    float *mix = um_alloctmp(ctx, sizeof(float) * frames * channels);
+    for (int ch = 0; ch < channels; ++ch) {
+        float *dst = mix + ch * frames;
+        for (int i = 0; i < fade; ++i) {
+            dst[i] = src[ch][i] * ((sw->fade_pos + i + 1) * inv_len);
+        }
+        memcpy(dst + fade, src[ch] + fade, sizeof(float) * (frames - fade));
+        if (sw->capture) {
+            const float *old = sw->capture + um_mini(ch, sw->capture_channels - 1) * frames;
+            for (int i = 0; i < fade; ++i) {
+                dst[i] += old[i];
+            }
+        }
+        src[ch] = dst;
+    }
+    return false;
+}
+
+void
+um_swap_release(umugu_ctx *ctx)
+{
+    UM_TRACE_ZONE();
+    um_swap *sw = ctx->swap;
+    um_scene *left[] = {
+        __atomic_exchange_n(&sw->staged, NULL, __ATOMIC_ACQUIRE),
+        __atomic_exchange_n(&sw->retired, NULL, __ATOMIC_ACQUIRE), sw->fading};
+    for (int i = 0; i < (int)(sizeof(left) / sizeof(left[0])); ++i) {
+        if (left[i]) {
+            um_scene_release(ctx, left[i]);
+        }
+    }
+    sw->fading = NULL;
+}
@@ -0,0 +1,441 @@
+#include "bench.h"
+
+#include <umugu/umugu.h>
+#include <umugu/umugu_internal.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+enum {
+    BENCH_ARENA_SIZE = 32 * 1024 * 1024,
+    BENCH_FRAMES = 256,
+    BENCH_WARMUP = 64,
+    BENCH_ITERATIONS = 2000,
+    BENCH_VOICE_GROUPS = 4,
+    BENCH_GROUP_VOICES = 7, /* Mixer inputs: prev_node + the extra ones. */
+};
+
+static int
+bench_silent_log(const char *fmt, ...)
+{
+    UM_UNUSED(fmt);
+    return 0;
+}
+
+static int
+bench_cmp_ns(const void *a, const void *b)
+{
+    um_nanosec x = *(const um_nanosec *)a;
+    um_nanosec y = *(const um_nanosec *)b;
+    return (x > y) - (x < y);
+}
+
+/* Groups of oscillators summed by a mixer each, then mixed together into the output:
+ * Osc x7 -> Mixer \
+ * Osc x7 -> Mixer  |-> Mixer -> Amplitude -> Output
+ * ...             / */
+static umugu_ctx *
+bench_voices_ctx(const umugu_config *base, int worker_count)
+{
+    umugu_config cfg = *base;
+    cfg.arena = malloc(BENCH_ARENA_SIZE);
+    cfg.arena_size = BENCH_ARENA_SIZE;
+    cfg.fallback_ppln_node_count = 0;
+    cfg.worker_count = worker_count;
+    cfg.log_fn = bench_silent_log;
+    memset(cfg.arena, 0, BENCH_ARENA_SIZE);
+
+    enum { GROUP_SIZE = BENCH_GROUP_VOICES + 1 };
+    enum { NODE_COUNT = BENCH_VOICE_GROUPS * GROUP_SIZE + 3 };
+    umugu_name names[NODE_COUNT];
+    for (int g = 0; g < BENCH_VOICE_GROUPS; ++g) {
+        for (int v = 0; v < BENCH_GROUP_VOICES; ++v) {
+            um_name_strcpy(&names[g * GROUP_SIZE + v], "Oscillator");
+        }
+        um_name_strcpy(&names[g * GROUP_SIZE + BENCH_GROUP_VOICES], "Mixer");
+    }
+    um_name_strcpy(&names[NODE_COUNT - 3], "Mixer");
+    um_name_strcpy(&names[NODE_COUNT - 2], "Amplitude");
+    um_name_strcpy(&names[NODE_COUNT - 1], "Output");
+
+    /* The pool is created at load, so the plan capacity is already there for the pipeline. */
+    umugu_ctx *ctx = umugu_load(&cfg);
+    um_pipeline_generate(ctx, names, NODE_COUNT);
+
+    um_mixer *master = (void *)ctx->pipeline.nodes[NODE_COUNT - 3];
+    master->input_count = BENCH_VOICE_GROUPS;
+    master->node.prev_node = BENCH_GROUP_VOICES;
+    for (int g = 0; g < BENCH_VOICE_GROUPS; ++g) {
+        um_mixer *mixer = (void *)ctx->pipeline.nodes[g * GROUP_SIZE + BENCH_GROUP_VOICES];
+        mixer->input_count = BENCH_GROUP_VOICES;
+        mixer->node.prev_node = g * GROUP_SIZE;
+        for (int v = 1; v < BENCH_GROUP_VOICES; ++v) {
+            mixer->extra_pipe_in_node_idx[v - 1] = g * GROUP_SIZE + v;
+            um_oscil *osc = (void *)ctx->pipeline.nodes[g * GROUP_SIZE + v];
+            osc->waveform = UMUGU_WAVEFORM_SAWSIN;
+            osc->osc.freq = 0.01f * (g * GROUP_SIZE + v);
+        }
+        if (g) {
+            master->extra_pipe_in_node_idx[g - 1] = g * GROUP_SIZE + BENCH_GROUP_VOICES;
+        }
+    }
+    ctx->io.out_audio.samples.channel_count = 1;
+    um_pipeline_init(ctx);
+    return ctx;
+}
+
+static void
+bench_process_latency(umugu_ctx *ctx, const char *title)
+{
+    static float out[BENCH_FRAMES * 2];
+    static um_nanosec times[BENCH_ITERATIONS];
+    ctx->io.out_audio.format = UMUGU_TYPE_FLOAT;
+
+    for (int i = 0; i < BENCH_WARMUP + BENCH_ITERATIONS; ++i) {
+        ctx->io.out_audio.samples.samples = out;
+        ctx->io.out_audio.samples.frame_count = BENCH_FRAMES;
+        um_nanosec start = um_time_now();
+        umugu_process(ctx, BENCH_FRAMES);
+        if (i >= BENCH_WARMUP) {
+            times[i - BENCH_WARMUP] = um_time_elapsed(start);
+        }
+    }
+
+    um_nanosec sum = 0;
+    for (int i = 0; i < BENCH_ITERATIONS; ++i) {
+        sum += times[i];
+    }
+    qsort(times, BENCH_ITERATIONS, sizeof(times[0]), bench_cmp_ns);
+    printf(
+        "%-24s min %7.2fus  avg %7.2fus  p99 %7.2fus  max %7.2fus\n", title,
+        times[0] / 1000.0, sum / (1000.0 * BENCH_ITERATIONS),
+        times[BENCH_ITERATIONS * 99 / 100] / 1000.0, times[BENCH_ITERATIONS - 1] / 1000.0);
+}
+
+static void
+bench_parallel_pipeline(const umugu_config *cfg)
+{
+    const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    const int workers = um_maxi(um_mini(cpus - 1, BENCH_VOICE_GROUPS * 2), 1);
+    printf(
+        "\n # Pipeline process latency: %d oscillators, %d frames per callback #\n",
+        BENCH_VOICE_GROUPS * BENCH_GROUP_VOICES, BENCH_FRAMES);
+
+    umugu_ctx *ctx = bench_voices_ctx(cfg, 0);
+    bench_process_latency(ctx, "Serial");
+    umugu_unload(ctx);
+    free(ctx);
+
+    char title[64];
+    for (int w = 1; w <= workers; w *= 2) {
+        ctx = bench_voices_ctx(cfg, w);
+        snprintf(title, sizeof(title), "Parallel (%d workers)", w);
+        bench_process_latency(ctx, title);
+        umugu_unload(ctx);
+        free(ctx);
+    }
+}
+
+enum {
+    BENCH_KERNEL_FRAMES = 1024, /* Stereo buffers fit in L1. */
+    BENCH_KERNEL_REPS = 4000,
+    BENCH_MIX_INPUTS = 4,
+};
+
+typedef enum {
+    BENCH_GAIN,
+    BENCH_CLAMP,
+    BENCH_MIX,
+    BENCH_CONVERT,
+    BENCH_DECODE,
+} bench_kernel;
+
+/* Returns processed samples per nanosecond. */
+static double
+bench_kernel_run(const um_kernels *k, bench_kernel kernel, umugu_type format, int channels)
+{
+    static float in[BENCH_MIX_INPUTS][BENCH_KERNEL_FRAMES];
+    static float out[BENCH_KERNEL_FRAMES * 2];
+    const float *src[BENCH_MIX_INPUTS];
+    for (int c = 0; c < BENCH_MIX_INPUTS; ++c) {
+        src[c] = in[c];
+        for (int i = 0; i < BENCH_KERNEL_FRAMES; ++i) {
+            in[c][i] = (float)((i * 7 + c * 13) % 200) / 100.0f - 1.0f;
+        }
+    }
+
+    const int n = BENCH_KERNEL_FRAMES;
+    float *const planar[2] = {out, out + n};
+    um_nanosec start = um_time_now();
+    for (int r = 0; r < BENCH_KERNEL_REPS; ++r) {
+        switch (kernel) {
+        case BENCH_GAIN:
+            k->gain(out, in[0], 0.5f, n);
+            break;
+        case BENCH_CLAMP:
+            k->clamp(out, in[0], -0.5f, 0.5f, n);
+            break;
+        case BENCH_MIX:
+            k->mix(out, src, BENCH_MIX_INPUTS, 1.0f / BENCH_MIX_INPUTS, n);
+            break;
+        case BENCH_CONVERT:
+            k->convert[format](out, src, channels, n);
+            break;
+        case BENCH_DECODE:
+            k->decode[format](planar, in, channels, n);
+            break;
+        }
+        __asm__ __volatile__("" : : "r"(out) : "memory"); /* Keep every repetition. */
+    }
+    um_nanosec elapsed = um_time_elapsed(start);
+    const double samples =
+        (double)n * BENCH_KERNEL_REPS * (kernel >= BENCH_CONVERT ? channels : 1);
+    return samples / (double)(elapsed > 0 ? elapsed : 1);
+}
+
+static void
+bench_kernels(void)
+{
+    static const struct {
+        const char *name;
+        umugu_type format;
+    } formats[] = {
+        {"float", UMUGU_TYPE_FLOAT},
+        {"int32", UMUGU_TYPE_INT32},
+        {"int16", UMUGU_TYPE_INT16},
+        {"int8", UMUGU_TYPE_INT8},
+        {"uint8", UMUGU_TYPE_UINT8}};
+
+    const um_kernels *k[4];
+    const int count = um_kernels_available(k, 4);
+    printf("\n # Sample kernels (samples/ns, %d frames) #\n%-20s", BENCH_KERNEL_FRAMES, "");
+    for (int v = 0; v < count; ++v) {
+        printf("%10s", k[v]->isa);
+    }
+
+    printf("\n%-20s", "gain");
+    for (int v = 0; v < count; ++v) {
+        printf("%10.2f", bench_kernel_run(k[v], BENCH_GAIN, UMUGU_TYPE_VOID, 1));
+    }
+    printf("\n%-20s", "clamp");
+    for (int v = 0; v < count; ++v) {
+        printf("%10.2f", bench_kernel_run(k[v], BENCH_CLAMP, UMUGU_TYPE_VOID, 1));
+    }
+    printf("\nmix (%d inputs)      ", BENCH_MIX_INPUTS);
+    for (int v = 0; v < count; ++v) {
+        printf("%10.2f", bench_kernel_run(k[v], BENCH_MIX, UMUGU_TYPE_VOID, 1));
+    }
+
+    for (int f = 0; f < (int)(sizeof(formats) / sizeof(*formats)); ++f) {
+        for (int ch = 1; ch <= 2; ++ch) {
+            printf("\n%-8s %-11s", formats[f].name, ch == 1 ? "mono" : "interleave");
+            for (int v = 0; v < count; ++v) {
+                printf("%10.2f", bench_kernel_run(k[v], BENCH_CONVERT, formats[f].format, ch));
+            }
+        }
+    }
+
+    for (int f = 0; f < (int)(sizeof(formats) / sizeof(*formats)); ++f) {
+        if (!k[0]->decode[formats[f].format]) {
+            continue;
+        }
+        for (int ch = 1; ch <= 2; ++ch) {
+            printf("\n%-8s %-11s", formats[f].name, ch == 1 ? "decode" : "decode 2ch");
+            for (int v = 0; v < count; ++v) {
+                printf("%10.2f", bench_kernel_run(k[v], BENCH_DECODE, formats[f].format, ch));
+            }
+        }
+    }
+    printf("\n");
+}
+
+enum {
+    BENCH_BANK_VOICES = 256,
+    BENCH_BANK_RATE = 48000,
+    BENCH_BANK_REPS = 200,
+};
+
+/* Real-time voices per core: voice samples rendered per second / sample rate. */
+static double
+bench_voices_per_core(double voice_samples, um_nanosec elapsed)
+{
+    return voice_samples * 1e9 / ((double)(elapsed > 0 ? elapsed : 1) * BENCH_BANK_RATE);
+}
+
+static void
+bench_oscbank(void)
+{
+    static um_voices voices;
+    static float out[BENCH_FRAMES], voice[BENCH_FRAMES];
+    for (int v = 0; v < BENCH_BANK_VOICES; ++v) {
+        voices.freq[v] = 55.0f + 13.7f * v;
+        voices.amp[v] = 1.0f / BENCH_BANK_VOICES;
+    }
+    const double samples = (double)BENCH_BANK_VOICES * BENCH_FRAMES * BENCH_BANK_REPS;
+    printf(
+        "\n # Saw voices per core in real time (%d voices, %d frames, %d hz) #\n",
+        BENCH_BANK_VOICES, BENCH_FRAMES, BENCH_BANK_RATE);
+
+    /* Baseline: one (aliasing) single voice oscillator per voice, summed. */
+    um_oscillator osc[BENCH_BANK_VOICES];
+    for (int v = 0; v < BENCH_BANK_VOICES; ++v) {
+        osc[v] = (um_oscillator){.freq = voices.freq[v], .phase = 0.0f};
+    }
+    umugu_samples sig = {.samples = voice, .frame_count = BENCH_FRAMES, .channel_count = 1};
+    um_nanosec start = um_time_now();
+    for (int r = 0; r < BENCH_BANK_REPS; ++r) {
+        memset(out, 0, sizeof(out));
+        for (int v = 0; v < BENCH_BANK_VOICES; ++v) {
+            um_oscillator_saw(&osc[v], &sig, BENCH_BANK_RATE);
+            for (int i = 0; i < BENCH_FRAMES; ++i) {
+                out[i] += voice[i] * voices.amp[v];
+            }
+        }
+        __asm__ __volatile__("" : : "r"(out) : "memory");
+    }
+    printf(
+        "%-24s %10.0f\n", "Oscillator x voices",
+        bench_voices_per_core(samples, um_time_elapsed(start)));
+
+    const um_kernels *k[4];
+    const int count = um_kernels_available(k, 4);
+    for (int i = 0; i < count; ++i) {
+        start = um_time_now();
+        for (int r = 0; r < BENCH_BANK_REPS; ++r) {
+            k[i]->oscbank(
+                out, &voices, BENCH_BANK_VOICES, UMUGU_WAVEFORM_SAW, 1.0f / BENCH_BANK_RATE,
+                BENCH_FRAMES);
+            __asm__ __volatile__("" : : "r"(out) : "memory");
+        }
+        char title[64];
+        snprintf(title, sizeof(title), "OscillatorBank (%s)", k[i]->isa);
+        printf("%-24s %10.0f\n", title, bench_voices_per_core(samples, um_time_elapsed(start)));
+    }
+}
+
+enum {
+    BENCH_FFT_MIN = 64,
+    BENCH_FFT_MAX = 65536,
+    BENCH_FFT_POINTS = 1 << 18, /* Transformed points per size and implementation. */
+};
+
+/* Average nanoseconds per transform. */
+static double
+bench_fft_run(const um_fft_plan *plan, int kind, um_complex *v, um_complex *tmp, int n)
+{
+    const int reps = um_maxi(BENCH_FFT_POINTS / n, 2);
+    um_nanosec start = um_time_now();
+    for (int r = 0; r < reps; ++r) {
+        switch (kind) {
+        case 0:
+            um_fft(v, n, tmp);
+            break;
+        case 1:
+            um_fft_forward(plan, v);
+            break;
+        case 2:
+            um_fft_real_forward(plan, (const float *)tmp, v);
+            break;
+        }
+        __asm__ __volatile__("" : : "r"(v) : "memory");
+    }
+    return (double)um_time_elapsed(start) / reps;
+}
+
+static void
+bench_fft(const umugu_config *base)
+{
+    umugu_config cfg = *base;
+    cfg.arena = malloc(BENCH_ARENA_SIZE);
+    cfg.arena_size = BENCH_ARENA_SIZE;
+    cfg.fallback_ppln_node_count = 0;
+    cfg.log_fn = bench_silent_log;
+    memset(cfg.arena, 0, BENCH_ARENA_SIZE);
+    umugu_ctx *ctx = umugu_load(&cfg);
+    um_complex *v = malloc(sizeof(um_complex) * BENCH_FFT_MAX);
+    um_complex *tmp = malloc(sizeof(um_complex) * BENCH_FFT_MAX);
+
+    printf(
+        "\n # FFT forward transform (us) #\n%-8s %12s %12s %8s %12s\n", "N", "um_fft",
+        "plan", "speedup", "plan real");
+    for (int n = BENCH_FFT_MIN; n <= BENCH_FFT_MAX; n *= 2) {
+        const um_fft_plan *plan = um_fft_plan_create(ctx, n);
+        for (int i = 0; i < n; ++i) {
+            v[i] = (um_complex){(float)((i * 7) % 13) / 13.0f, 0.0f};
+            tmp[i] = v[i];
+        }
+        const double recursive = bench_fft_run(plan, 0, v, tmp, n);
+        const double iterative = bench_fft_run(plan, 1, v, tmp, n);
+        const double real = bench_fft_run(plan, 2, v, tmp, n);
+        printf(
+            "%-8d %12.2f %12.2f %7.1fx %12.2f\n", n, recursive / 1000.0, iterative / 1000.0,
+            recursive / iterative, real / 1000.0);
+    }
+
+    free(tmp);
+    free(v);
+    umugu_unload(ctx);
+    free(cfg.arena);
+}
+
+enum {
+    BENCH_RESAMPLE_BLOCKS = 2000,
+    BENCH_RESAMPLE_IN_MAX = BENCH_FRAMES * 2 + 1,
+};
+
+/* Stereo conversions of BENCH_FRAMES output blocks, in times faster than real time. */
+static void
+bench_resampler(const umugu_config *base)
+{
+    static const int rates[][2] = {{44100, 48000}, {48000, 44100}, {48000, 96000}};
+    static const char *quality[UM_RESAMPLE_QUALITY_COUNT] = {"fast", "balanced", "best"};
+    static float in[2][BENCH_RESAMPLE_IN_MAX], out[2][BENCH_FRAMES];
+    umugu_config cfg = *base;
+    cfg.arena = malloc(BENCH_ARENA_SIZE);
+    cfg.arena_size = BENCH_ARENA_SIZE;
+    cfg.fallback_ppln_node_count = 0;
+    cfg.log_fn = bench_silent_log;
+    memset(cfg.arena, 0, BENCH_ARENA_SIZE);
+    umugu_ctx *ctx = umugu_load(&cfg);
+    for (int i = 0; i < BENCH_RESAMPLE_IN_MAX; ++i) {
+        in[0][i] = in[1][i] = (float)((i * 7) % 200) / 100.0f - 1.0f;
+    }
+    const float *src[2] = {in[0], in[1]};
+    float *const dst[2] = {out[0], out[1]};
+
+    printf("\n # Stereo resampler (x real time, %d frames) #\n%-16s", BENCH_FRAMES, "");
+    for (int q = 0; q < UM_RESAMPLE_QUALITY_COUNT; ++q) {
+        printf("%10s", quality[q]);
+    }
+    for (int c = 0; c < (int)(sizeof(rates) / sizeof(*rates)); ++c) {
+        printf("\n%6d -> %-6d", rates[c][0], rates[c][1]);
+        for (int q = 0; q < UM_RESAMPLE_QUALITY_COUNT; ++q) {
+            um_resampler *r = um_resampler_create(ctx, rates[c][0], rates[c][1], 2, q);
+            um_nanosec start = um_time_now();
+            for (int b = 0; b < BENCH_RESAMPLE_BLOCKS; ++b) {
+                um_resampler_process(r, src, dst, BENCH_FRAMES);
+                __asm__ __volatile__("" : : "r"(out) : "memory");
+            }
+            const um_nanosec elapsed = um_time_elapsed(start);
+            const double seconds = (double)BENCH_FRAMES * BENCH_RESAMPLE_BLOCKS / rates[c][1];
+            printf("%10.0f", seconds * 1e9 / (double)(elapsed > 0 ? elapsed : 1));
+        }
+    }
+    printf("\n");
+
+    umugu_unload(ctx);
+    free(cfg.arena);
+}
+
+void
+app_run_benchmarks(const umugu_config *cfg)
+{
+    UM_TRACE_ZONE();
+    bench_kernels();
+    bench_oscbank();
+    bench_fft(cfg);
+    bench_resampler(cfg);
+    bench_parallel_pipeline(cfg);
+}
@@ -0,0 +1,9 @@
+#ifndef __UMUGU_BENCH_H__
+#define __UMUGU_BENCH_H__
+
+#include <umugu/umugu.h>
+
+/* Runs every benchmark with contexts created from (copies of) the given config. */
+void app_run_benchmarks(const umugu_config *cfg);
+
+#endif /* __UMUGU_BENCH_H__ */
@@ -1,4 +1,5 @@
 #include "../src/debugu.h"
+#include "bench.h"
 
 #include <umugu/umugu.h>
 #include <umugu/umugu_internal.h>
@@ -10,9 +11,14 @@
 #include <umugu/backends/umugu_stdout.h>
 
 #include <math.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <time.h>
 #include <unistd.h>
 
 static int
@@ -62,10 +68,14 @@ app_print_help(void)
     printf("Opts:\n");
     printf("\t-Cfpath \t\tConfig file, can be combined with other options.\n");
     printf("\t-T      \t\tUnit test pass, can be combined with other options.\n");
+    printf("\t-B      \t\tBenchmarks, can be combined with other options.\n");
     printf("\t-Sdevice\t\tSynth + midi controller, needs a valid midi device name.\n");
     printf("\t-Pfpath \t\tPlayback of the specified file using an audio backend.\n");
     printf("\t-Ofpath \t\tOutputs audio signal to stdout. Can be piped into a music player.\n");
     printf("\t\t\t\t       e.g. plumugu -Olittlewing.wav | aplay\n");
+    printf("\t-Rfpath \t\tOffline render of a pipeline file into fpath.wav, repeatable.\n");
+    printf("\t-Dsecs  \t\tDuration of the offline renders (default 10 seconds).\n");
+    printf("\t-Jcount \t\tOffline renders running at the same time (default 1).\n");
     printf("\nExample: load config, run tests and generate audio signal from midi events.\n");
     printf("\t\t\t\tplumugu -C../configs/synth.ucg -T -Sminilab3\n");
 }
@@ -80,8 +90,1995 @@ app_print_vector(const char *title, um_complex *x, int n)
     printf("\n");
 }
 
+static inline const umugu_attrib_info *
+app_find_node_attrib(umugu_ctx *ctx, const umugu_node *node, umugu_name attr_name)
+{
+    const size_t attrib_count = ctx->nodes_info[node->info_idx].attrib_count;
+    for (size_t i = 0; i < attrib_count; ++i) {
+        const umugu_attrib_info *attrib = &ctx->nodes_info[node->info_idx].attribs[i];
+        if (!memcmp(attrib->name.str, attr_name.str, UMUGU_NAME_LEN)) {
+            return attrib;
+        }
+    }
+    return NULL;
+}
+
+/* Every SIMD kernel table has to match the scalar one bit by bit. */
+static void
+app_test_kernels(void)
+{
+    enum { N = 1031 }; /* Odd size for covering the scalar tails too. */
+    static const umugu_type formats[] = {
+        UMUGU_TYPE_FLOAT, UMUGU_TYPE_INT32, UMUGU_TYPE_INT16, UMUGU_TYPE_INT8, UMUGU_TYPE_UINT8};
+    static float in[3][N], ref[N * 3], out[N * 3];
+    for (int ch = 0; ch < 3; ++ch) {
+        for (int i = 0; i < N; ++i) {
+            in[ch][i] = 1.2f * sinf(i * 0.37f + ch); /* Out of [-1, 1] too. */
+        }
+    }
+    const float *src[3] = {in[0], in[1], in[2]};
+
+    const um_kernels *k[4];
+    const int count = um_kernels_available(k, 4);
+    for (int v = 1; v < count; ++v) {
+        int fails = 0;
+        k[0]->gain(ref, in[0], 0.7f, N), k[v]->gain(out, in[0], 0.7f, N);
+        fails += !!memcmp(ref, out, sizeof(float) * N);
+        k[0]->clamp(ref, in[0], -0.5f, 0.8f, N), k[v]->clamp(out, in[0], -0.5f, 0.8f, N);
+        fails += !!memcmp(ref, out, sizeof(float) * N);
+        k[0]->mix(ref, src, 3, 1.0f / 3, N), k[v]->mix(out, src, 3, 1.0f / 3, N);
+        fails += !!memcmp(ref, out, sizeof(float) * N);
+        for (int f = 0; f < (int)(sizeof(formats) / sizeof(*formats)); ++f) {
+            for (int ch = 1; ch <= 3; ++ch) {
+                k[0]->convert[formats[f]](ref, src, ch, N);
+                k[v]->convert[formats[f]](out, src, ch, N);
+                fails += !!memcmp(ref, out, N * ch * um_type_sizeof(formats[f]));
+            }
+        }
+        static const umugu_type decoded[] = {
+            UMUGU_TYPE_FLOAT, UMUGU_TYPE_INT32, UMUGU_TYPE_INT16, UMUGU_TYPE_UINT8};
+        for (int f = 0; f < (int)(sizeof(decoded) / sizeof(*decoded)); ++f) {
+            for (int ch = 1; ch <= 3; ++ch) {
+                float *const ref_planar[3] = {ref, ref + N, ref + 2 * N};
+                float *const out_planar[3] = {out, out + N, out + 2 * N};
+                k[0]->decode[decoded[f]](ref_planar, in, ch, N);
+                k[v]->decode[decoded[f]](out_planar, in, ch, N);
+                fails += !!memcmp(ref, out, sizeof(float) * N * ch);
+            }
+        }
+        for (int w = 0; w < UMUGU_WAVEFORM_COUNT; ++w) {
+            static um_voices a, b;
+            for (int i = 0; i < UM_OSCBANK_MAX_VOICES; ++i) {
+                a.freq[i] = b.freq[i] = 50.0f + 97.3f * i;
+                a.amp[i] = b.amp[i] = 0.01f;
+                a.phase[i] = b.phase[i] = 0.0f;
+            }
+            /* Partial last group of voices. */
+            k[0]->oscbank(ref, &a, 37, w, 1.0f / 48000, N);
+            k[v]->oscbank(out, &b, 37, w, 1.0f / 48000, N);
+            fails += !!memcmp(ref, out, sizeof(float) * N) + !!memcmp(&a, &b, sizeof(a));
+        }
+        for (int h = 1; h <= 16; h *= 4) {
+            static um_complex tw[3 * 16], a[64], b[64];
+            for (int i = 0; i < 3 * h; ++i) {
+                tw[i] = (um_complex){cosf(i * 0.1f), -sinf(i * 0.1f)};
+            }
+            for (int inverse = 0; inverse < 2; ++inverse) {
+                memcpy(a, in[0], sizeof(a));
+                memcpy(b, in[0], sizeof(b));
+                k[0]->fft_radix4(a, 64, h, tw, inverse);
+                k[v]->fft_radix4(b, 64, h, tw, inverse);
+                fails += !!memcmp(a, b, sizeof(a));
+            }
+            const um_complex *spectrum = (const um_complex *)in[2];
+            memcpy(a, in[1], sizeof(a));
+            memcpy(b, in[1], sizeof(b));
+            k[0]->cmac(a, tw, spectrum, 3 * h), k[v]->cmac(b, tw, spectrum, 3 * h);
+            fails += !!memcmp(a, b, sizeof(a));
+        }
+        for (int taps = 8; taps <= 256; taps *= 2) {
+            const float a = k[0]->dot(in[0], in[1] + 3, taps);
+            const float b = k[v]->dot(in[0], in[1] + 3, taps);
+            fails += !!memcmp(&a, &b, sizeof(a));
+        }
+        printf("Kernels %s: %s.\n", k[v]->isa, fails ? "FAILED" : "OK");
+    }
+}
+
+/* The plan transforms against the recursive um_fft ones. Errors relative to the peak. */
+static void
+app_test_fft(umugu_ctx *ctx)
+{
+    enum { MAX_N = 4096 };
+    static um_complex x[MAX_N], ref[MAX_N], y[MAX_N], scratch[MAX_N];
+    static float real[MAX_N], real_out[MAX_N];
+    for (int n = 4; n <= MAX_N; n *= 2) {
+        const um_fft_plan *plan = um_fft_plan_create(ctx, n);
+        for (int i = 0; i < n; ++i) {
+            x[i] = (um_complex){sinf(i * 0.61f) + 0.3f * cosf(i * 2.9f), cosf(i * 1.37f)};
+            real[i] = x[i].real;
+        }
+
+        float peak = 0.0f, err_fwd = 0.0f, err_inv = 0.0f, err_real = 0.0f, err_rinv = 0.0f;
+        memcpy(ref, x, sizeof(x[0]) * n);
+        um_fft(ref, n, scratch);
+        memcpy(y, x, sizeof(x[0]) * n);
+        um_fft_forward(plan, y);
+        for (int i = 0; i < n; ++i) {
+            peak = um_maxf(peak, hypotf(ref[i].real, ref[i].imag));
+            err_fwd = um_maxf(err_fwd, hypotf(y[i].real - ref[i].real, y[i].imag - ref[i].imag));
+        }
+        um_fft_inverse(plan, y);
+        for (int i = 0; i < n; ++i) {
+            const float dr = y[i].real / n - x[i].real, di = y[i].imag / n - x[i].imag;
+            err_inv = um_maxf(err_inv, hypotf(dr, di));
+        }
+
+        for (int i = 0; i < n; ++i) {
+            ref[i] = (um_complex){real[i], 0.0f};
+        }
+        um_fft(ref, n, scratch);
+        um_fft_real_forward(plan, real, y);
+        for (int i = 0; i <= n / 2; ++i) {
+            err_real = um_maxf(err_real, hypotf(y[i].real - ref[i].real, y[i].imag - ref[i].imag));
+        }
+        um_fft_real_inverse(plan, y, real_out);
+        for (int i = 0; i < n; ++i) {
+            err_rinv = um_maxf(err_rinv, fabsf(real_out[i] / n - real[i]));
+        }
+
+        err_fwd /= peak, err_real /= peak;
+        const bool ok = err_fwd < 1e-5f && err_inv < 1e-5f && err_real < 1e-5f && err_rinv < 1e-5f;
+        printf(
+            "FFT plan n=%-5d fwd %.1e inv %.1e real %.1e real inv %.1e: %s.\n", n, err_fwd,
+            err_inv, err_real, err_rinv, ok ? "OK" : "FAILED");
+    }
+}
+
+/* Oscillator -> Convolver against the direct convolution of the oscillator signal, with
+ * and without partition buffering (latency). */
+static void
+app_test_convolver(const umugu_config *base)
+{
+    enum { IR_FRAMES = 3001, TOTAL = 8192, ARENA = 8 * 1024 * 1024 };
+    static const char *ir_file = "/tmp/plumugu_test_ir.wav";
+    static float ir[IR_FRAMES], x[TOTAL], y[TOTAL];
+    static const struct {
+        int frames;
+        int partition;
+        int latency;
+    } cases[] = {{256, 0, 0}, {100, 64, 64}, {512, 128, 0}};
+
+    umugu_config cfg = *base;
+    cfg.arena = malloc(ARENA);
+    cfg.arena_size = ARENA;
+    cfg.fallback_ppln_node_count = 0;
+    cfg.log_fn = um_print;
+
+    for (int c = 0; c < (int)(sizeof(cases) / sizeof(*cases)); ++c) {
+        memset(cfg.arena, 0, ARENA);
+        umugu_ctx *ctx = umugu_load(&cfg);
+        if (!c) {
+            for (int i = 0; i < IR_FRAMES; ++i) {
+                ir[i] = expf(-i / 600.0f) * sinf(i * 0.37f);
+            }
+            umugu_signal sig = {
+                .samples = {.channel_count = 1},
+                .sample_rate = ctx->pipeline.sig.sample_rate,
+                .format = UMUGU_TYPE_FLOAT};
+            char header[44];
+            um_signal_wav_header(&sig, sizeof(ir), header);
+            FILE *f = fopen(ir_file, "wb");
+            fwrite(header, sizeof(header), 1, f);
+            fwrite(ir, sizeof(ir), 1, f);
+            fclose(f);
+        }
+
+        umugu_name names[] = {{"Oscillator"}, {"Convolver"}};
+        um_pipeline_generate(ctx, names, 2);
+        um_oscil *osc = (void *)ctx->pipeline.nodes[0];
+        osc->waveform = UMUGU_WAVEFORM_SAWSIN;
+        osc->osc.freq = 0.05f;
+        um_convolver *conv = (void *)ctx->pipeline.nodes[1];
+        strncpy(conv->filename, ir_file, UMUGU_PATH_LEN);
+        conv->partition_size = cases[c].partition;
+        ctx->pipeline.sig.samples.frame_count = cases[c].frames; /* Sizes the partitions. */
+        um_pipeline_init(ctx);
+
+        const int frames = cases[c].frames;
+        for (int pos = 0; pos + frames <= TOTAL; pos += frames) {
+            umugu_process(ctx, frames);
+            memcpy(x + pos, osc->node.out_pipe.samples, sizeof(float) * frames);
+            memcpy(y + pos, conv->node.out_pipe.samples, sizeof(float) * frames);
+        }
+
+        float err = 0.0f, peak = 0.0f;
+        const int processed = TOTAL / frames * frames;
+        for (int n = 0; n < processed; ++n) {
+            double ref = 0.0;
+            for (int k = 0; k < IR_FRAMES && k <= n - cases[c].latency; ++k) {
+                ref += (double)ir[k] * x[n - cases[c].latency - k];
+            }
+            peak = um_maxf(peak, fabsf((float)ref));
+            err = um_maxf(err, fabsf(y[n] - (float)ref));
+        }
+        printf(
+            "Convolver %d frames, partition %d (%d partitions): error %.1e: %s.\n", frames,
+            conv->partition_size, conv->partition_count, err / peak,
+            err / peak < 1e-5f ? "OK" : "FAILED");
+        umugu_unload(ctx);
+    }
+
+    /* Not connected, it renders silence. */
+    memset(cfg.arena, 0, ARENA);
+    umugu_ctx *ctx = umugu_load(&cfg);
+    um_pipeline_generate(ctx, (umugu_name[]){{"Convolver"}}, 1);
+    int fails = umugu_process(ctx, 256) < UMUGU_SUCCESS;
+    const umugu_samples *out = &ctx->pipeline.nodes[0]->out_pipe;
+    for (int i = 0; i < out->frame_count * out->channel_count; ++i) {
+        fails += out->samples[i] != 0.0f;
+    }
+    printf("Convolver without input: %s.\n", fails ? "FAILED" : "OK");
+    umugu_unload(ctx);
+    remove(ir_file);
+    free(cfg.arena);
+}
+
+/* Sines against the analytic ones delayed by the latency (errors relative to the
+ * amplitude), in blocks that split the internal chunks. 44100 -> 48001 interpolates the
+ * filter phases. Then a Resampler node driving the pipeline block size. */
+static void
+app_test_resampler(umugu_ctx *ctx, const umugu_config *base)
+{
+    enum { OUT_FRAMES = 4000, BLOCK = 300, ARENA = 1024 * 1024 };
+    static const int rates[][2] = {{44100, 48000}, {48000, 44100}, {48000, 96000}, {44100, 48001}};
+    static const float max_err[UM_RESAMPLE_QUALITY_COUNT] = {2e-3f, 2e-4f, 2e-5f};
+    static float in[OUT_FRAMES * 2], out[OUT_FRAMES];
+    const double freq = 1000.0;
+
+    for (int c = 0; c < (int)(sizeof(rates) / sizeof(*rates)); ++c) {
+        for (int q = 0; q < UM_RESAMPLE_QUALITY_COUNT; ++q) {
+            const double in_rate = rates[c][0], out_rate = rates[c][1];
+            um_resampler *r = um_resampler_create(ctx, in_rate, out_rate, 1, q);
+            int in_pos = 0;
+            for (int i = 0; i < OUT_FRAMES * 2; ++i) {
+                in[i] = (float)sin(2.0 * M_PI * freq * i / in_rate);
+            }
+            for (int pos = 0; pos < OUT_FRAMES; pos += BLOCK) {
+                const int frames = um_mini(BLOCK, OUT_FRAMES - pos);
+                const int need = um_resampler_input_frames(r, frames);
+                const float *src = in + in_pos;
+                float *dst = out + pos;
+                um_resampler_process(r, &src, &dst, frames);
+                in_pos += need;
+            }
+
+            float err = 0.0f;
+            const double delay = um_resampler_latency(r);
+            for (int j = 256; j < OUT_FRAMES; ++j) {
+                const double t = j * in_rate / out_rate - delay;
+                err = um_maxf(err, fabsf(out[j] - (float)sin(2.0 * M_PI * freq * t / in_rate)));
+            }
+            printf(
+                "Resampler %5.0f -> %5.0f quality %d: error %.1e: %s.\n", in_rate, out_rate, q,
+                err, err < max_err[q] ? "OK" : "FAILED");
+        }
+    }
+
+    umugu_config cfg = *base;
+    cfg.arena = malloc(ARENA);
+    cfg.arena_size = ARENA;
+    cfg.fallback_ppln_node_count = 0;
+    memset(cfg.arena, 0, ARENA);
+    umugu_ctx *node_ctx = umugu_load(&cfg);
+    umugu_name names[] = {{"Oscillator"}, {"Resampler"}};
+    um_pipeline_generate(node_ctx, names, 2);
+    node_ctx->io.out_audio.sample_rate = 44100;
+    um_pipeline_init(node_ctx);
+    int fails = 0;
+    for (int block = 0; block < 4; ++block) {
+        umugu_process(node_ctx, 441);
+        const umugu_node *node = node_ctx->pipeline.nodes[1];
+        fails += node->out_pipe.frame_count != 441 || node->out_pipe.channel_count < 1;
+        fails += node_ctx->pipeline.sig.samples.frame_count != 480;
+    }
+    printf(
+        "Resampler node %d -> %d: %s.\n", node_ctx->pipeline.sig.sample_rate,
+        node_ctx->io.out_audio.sample_rate, fails ? "FAILED" : "OK");
+    umugu_unload(node_ctx);
+
+    /* A 44100 file played by a 48000 pipeline. */
+    static const char *wav_file = "/tmp/plumugu_test_rate.wav";
+    umugu_signal sig = {
+        .samples = {.channel_count = 1}, .sample_rate = 44100, .format = UMUGU_TYPE_FLOAT};
+    char header[44];
+    um_signal_wav_header(&sig, sizeof(float) * OUT_FRAMES * 2, header);
+    for (int i = 0; i < OUT_FRAMES * 2; ++i) {
+        in[i] = (float)sin(2.0 * M_PI * freq * i / sig.sample_rate);
+    }
+    FILE *f = fopen(wav_file, "wb");
+    fwrite(header, sizeof(header), 1, f);
+    fwrite(in, sizeof(float), OUT_FRAMES * 2, f);
+    fclose(f);
+
+    memset(cfg.arena, 0, ARENA);
+    node_ctx = umugu_load(&cfg);
+    umugu_name player_names[] = {{"WavFilePlayer"}};
+    um_pipeline_generate(node_ctx, player_names, 1);
+    um_wavplayer *player = (void *)node_ctx->pipeline.nodes[0];
+    strncpy(player->filename, wav_file, UMUGU_PATH_LEN);
+    um_pipeline_init(node_ctx);
+    const double rate = node_ctx->pipeline.sig.sample_rate;
+    float err = 0.0f;
+    for (int pos = 0; pos < OUT_FRAMES; pos += BLOCK) {
+        umugu_process(node_ctx, BLOCK);
+        const double delay = um_resampler_latency(player->resampler);
+        for (int j = pos ? 0 : 256; j < BLOCK; ++j) {
+            const double t = (pos + j) * sig.sample_rate / rate - delay;
+            const float ref = (float)sin(2.0 * M_PI * freq * t / sig.sample_rate);
+            err = um_maxf(err, fabsf(player->node.out_pipe.samples[j] - ref));
+        }
+    }
+    printf(
+        "WavFilePlayer %d -> %.0f: error %.1e: %s.\n", sig.sample_rate, rate, err,
+        err < max_err[player->quality] ? "OK" : "FAILED");
+    umugu_unload(node_ctx);
+    remove(wav_file);
+    free(cfg.arena);
+}
+
+/* Extensible int16 stereo wav with an odd sized chunk before the data: looping, seeking
+ * and the silence after the end, mapped and streamed. The streamed seeks take a block. */
+static void
+app_test_wavplayer(const umugu_config *base)
+{
+    enum { FRAMES = 1001, BLOCK = 256, ARENA = 1024 * 1024 };
+    static const char *wav_file = "/tmp/plumugu_test.wav";
+    static int16_t pcm[FRAMES * 2];
+    for (int i = 0; i < FRAMES * 2; ++i) {
+        pcm[i] = (int16_t)(i * 7919 % 65536 - 32768);
+    }
+
+    umugu_config cfg = *base;
+    cfg.arena = malloc(ARENA);
+    cfg.arena_size = ARENA;
+    cfg.fallback_ppln_node_count = 0;
+
+    for (int streaming = 0; streaming < 2; ++streaming) {
+        memset(cfg.arena, 0, ARENA);
+        umugu_ctx *ctx = umugu_load(&cfg);
+        if (!streaming) {
+            struct __attribute__((packed)) {
+                char riff[4];
+                int32_t riff_size;
+                char wave_fmt[8];
+                int32_t fmt_size;
+                int16_t tag, channels;
+                int32_t rate, byte_rate;
+                int16_t block_align, bits, ext_size, valid_bits;
+                int32_t channel_mask;
+                uint16_t subformat[8];
+                char list[4];
+                int32_t list_size;
+                char list_data[6]; /* 5 + pad byte. */
+                char data[4];
+                int32_t data_size;
+            } hdr = {
+                .riff = "RIFF",
+                .riff_size = sizeof(hdr) - 8 + sizeof(pcm),
+                .wave_fmt = "WAVEfmt ",
+                .fmt_size = 40,
+                .tag = (int16_t)0xFFFE,
+                .channels = 2,
+                .rate = ctx->pipeline.sig.sample_rate,
+                .byte_rate = ctx->pipeline.sig.sample_rate * 4,
+                .block_align = 4,
+                .bits = 16,
+                .ext_size = 22,
+                .valid_bits = 16,
+                .channel_mask = 3,
+                .subformat = {1, 0, 0x10, 0x8000, 0xAA00, 0x3800, 0x9B71},
+                .list = "LIST",
+                .list_size = 5,
+                .list_data = "info",
+                .data = "data",
+                .data_size = sizeof(pcm)};
+            FILE *f = fopen(wav_file, "wb");
+            fwrite(&hdr, sizeof(hdr), 1, f);
+            fwrite(pcm, sizeof(pcm), 1, f);
+            fclose(f);
+        }
+
+        umugu_name names[] = {{"WavFilePlayer"}};
+        um_pipeline_generate(ctx, names, 1);
+        um_wavplayer *player = (void *)ctx->pipeline.nodes[0];
+        strncpy(player->filename, wav_file, UMUGU_PATH_LEN);
+        player->loop = true;
+        player->streaming = streaming;
+        um_pipeline_init(ctx);
+
+        int fails = 0, expected = 0;
+        for (int block = 0; block < 12; ++block) {
+            bool seeking = false;
+            if (block == 8) {
+                /* The next block ends at the end of the file. */
+                player->seek = FRAMES - BLOCK;
+                expected = FRAMES - BLOCK;
+                seeking = streaming;
+            } else if (block == 10) {
+                player->loop = false;
+                player->seek = FRAMES - 100;
+                expected = FRAMES - 100;
+                seeking = streaming;
+            }
+            /* Gives the reader thread the time a real callback period would. */
+            for (int i = 0; player->stream && !um_stream_ready(player->stream, BLOCK) && i < 1000;
+                 ++i) {
+                nanosleep(&(struct timespec){.tv_nsec = 100000}, NULL);
+            }
+
+            umugu_process(ctx, BLOCK);
+            const float *out = player->node.out_pipe.samples;
+            for (int i = 0; i < BLOCK; ++i) {
+                const bool ended = !player->loop && expected >= FRAMES;
+                const int frame = expected % FRAMES;
+                for (int ch = 0; ch < 2; ++ch) {
+                    const float ref = (ended || seeking) ? 0.0f : pcm[frame * 2 + ch] / 32768.0f;
+                    fails += out[ch * BLOCK + i] != ref;
+                }
+                expected += !seeking;
+            }
+            /* The position wraps with the frames read, also when they end at the end. */
+            fails += streaming && player->loop && player->position != expected % FRAMES;
+        }
+
+        fails += player->underruns + (int)ctx->stream_underruns;
+        printf(
+            "WavFilePlayer %s %d frames, %d channels: %s.\n", streaming ? "streamed" : "mapped",
+            player->wav.samples.frame_count, player->wav.samples.channel_count,
+            (fails || player->wav.samples.frame_count != FRAMES) ? "FAILED" : "OK");
+        umugu_unload(ctx);
+    }
+    remove(wav_file);
+    free(cfg.arena);
+}
+
+/* Immediate and ramped changes of an Amplitude against a twin pipeline that keeps the
+ * input, then producer threads racing the audio thread on an OscillatorBank: every
+ * change arrives, in order per producer. */
+enum { APP_PARAM_PRODUCERS = 4, APP_PARAM_CHANGES = 20000 };
+
+typedef struct {
+    umugu_ctx *ctx;
+    int attrib;
+    int element;
+    int full;
+} app_param_producer;
+
+static void *
+app_param_produce(void *arg)
+{
+    app_param_producer *p = arg;
+    for (int v = 1; v <= APP_PARAM_CHANGES; ++v) {
+        const float value = (float)v;
+        while (umugu_attrib_set(p->ctx, 0, p->attrib, p->element, &value, 0) ==
+               UMUGU_ERR_FULL_STORAGE) {
+            p->full++;
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void
+app_test_params(const umugu_config *base)
+{
+    enum { BLOCK = 256, RAMP = 600, ARENA = 1024 * 1024 };
+    umugu_config cfg = *base;
+    cfg.arena_size = ARENA;
+    cfg.fallback_ppln_node_count = 0;
+    umugu_ctx *ctx[2];
+    for (int i = 0; i < 2; ++i) {
+        cfg.arena = calloc(1, ARENA);
+        ctx[i] = umugu_load(&cfg);
+        umugu_name names[] = {{"Oscillator"}, {"Amplitude"}};
+        um_pipeline_generate(ctx[i], names, 2);
+    }
+
+    um_amplitude *amp = (void *)ctx[1]->pipeline.nodes[1];
+    const int multiplier =
+        app_find_node_attrib(ctx[1], &amp->node, (umugu_name){"Multiplier"}) -
+        ctx[1]->nodes_info[amp->node.info_idx].attribs;
+    const float half = 0.5f, target = 1.5f;
+    int fails = umugu_attrib_set(ctx[1], 1, multiplier, 0, &half, 0) != UMUGU_SUCCESS;
+    fails += umugu_attrib_set(ctx[1], 1, multiplier, 1, &half, 0) != UMUGU_ERR_ARGS;
+    fails += umugu_attrib_set(ctx[1], 2, multiplier, 0, &half, 0) != UMUGU_ERR_ARGS;
+    for (int block = 0; block < 4; ++block) {
+        if (block == 1) {
+            fails += umugu_attrib_set(ctx[1], 1, multiplier, 0, &target, RAMP) != UMUGU_SUCCESS;
+        }
+        umugu_process(ctx[0], BLOCK);
+        umugu_process(ctx[1], BLOCK);
+        const float *in = ctx[0]->pipeline.nodes[1]->out_pipe.samples;
+        const float *out = amp->node.out_pipe.samples;
+        for (int i = 0; i < BLOCK; ++i) {
+            const int t = (block - 1) * BLOCK + i + 1; /* Frames into the ramp. */
+            const float gain =
+                block ? half + (target - half) * um_mini(t, RAMP) / RAMP : half;
+            fails += fabsf(out[i] - in[i] * gain) > 1e-5f;
+        }
+    }
+    fails += amp->multiplier != target;
+    printf("Attribute changes (ramp %d frames): %s.\n", RAMP, fails ? "FAILED" : "OK");
+    for (int i = 0; i < 2; ++i) {
+        umugu_unload(ctx[i]);
+        free(ctx[i]); /* The context is at the start of its arena. */
+    }
+
+    cfg.arena = calloc(1, ARENA);
+    umugu_ctx *bank_ctx = umugu_load(&cfg);
+    umugu_name names[] = {{"OscillatorBank"}};
+    um_pipeline_generate(bank_ctx, names, 1);
+    um_oscbank *bank = (void *)bank_ctx->pipeline.nodes[0];
+    const int amps = app_find_node_attrib(bank_ctx, &bank->node, (umugu_name){"Amplitudes"}) -
+                     bank_ctx->nodes_info[bank->node.info_idx].attribs;
+    fails = 0;
+    for (int i = 0; i <= UM_PARAM_QUEUE_CAPACITY; ++i) {
+        const float zero = 0.0f;
+        const int expected = i < UM_PARAM_QUEUE_CAPACITY ? UMUGU_SUCCESS : UMUGU_ERR_FULL_STORAGE;
+        fails += umugu_attrib_set(bank_ctx, 0, amps, 0, &zero, 0) != expected;
+    }
+
+    pthread_t threads[APP_PARAM_PRODUCERS];
+    app_param_producer producers[APP_PARAM_PRODUCERS];
+    for (int t = 0; t < APP_PARAM_PRODUCERS; ++t) {
+        producers[t] = (app_param_producer){.ctx = bank_ctx, .attrib = amps, .element = t};
+        pthread_create(&threads[t], NULL, app_param_produce, &producers[t]);
+    }
+    float last[APP_PARAM_PRODUCERS] = {0};
+    int blocks = 0, done = 0;
+    while (done < APP_PARAM_PRODUCERS) {
+        umugu_process(bank_ctx, 64);
+        ++blocks;
+        done = 0;
+        for (int t = 0; t < APP_PARAM_PRODUCERS; ++t) {
+            const float value = bank->voices.amp[t];
+            fails += value < last[t];
+            last[t] = value;
+            done += value == APP_PARAM_CHANGES;
+        }
+    }
+    int full = 0;
+    for (int t = 0; t < APP_PARAM_PRODUCERS; ++t) {
+        pthread_join(threads[t], NULL);
+        full += producers[t].full;
+    }
+    printf(
+        "Attribute queue %d producers x %d changes in %d blocks (%d retries): %s.\n",
+        APP_PARAM_PRODUCERS, APP_PARAM_CHANGES, blocks, full, fails ? "FAILED" : "OK");
+    umugu_unload(bank_ctx);
+    free(bank_ctx); /* The context is at the start of its arena. */
+}
+
+/* Multiplier of app_test_events at a pipeline frame. */
+static float
+app_events_gain(int64_t f)
+{
+    if (f < 300) {
+        return 1.0f;
+    } else if (f < 700) {
+        return 0.25f;
+    } else if (f < 800) {
+        return 0.25f + 0.75f * (f - 700 + 1) / 100.0f;
+    } else if (f < 1024) {
+        return 1.0f;
+    } else if (f < 1200) {
+        return 0.5f; /* Pushed late (at frame 10), lands at the start of the next block. */
+    } else if (f < 1300) {
+        return 2.0f * (f - 1200 + 1) / 100.0f; /* Automation 0 -> 2 from 1200 to 1300. */
+    }
+    return 2.0f;
+}
+
+/* Events in the middle of the blocks land on their exact frame: multiplier changes and
+ * automation of an Amplitude against a twin pipeline, and notes of an OscillatorBank. */
+static void
+app_test_events(const umugu_config *base)
+{
+    enum { BLOCK = 256, BLOCKS = 6, ARENA = 1024 * 1024 };
+    umugu_config cfg = *base;
+    cfg.arena_size = ARENA;
+    cfg.fallback_ppln_node_count = 0;
+    umugu_ctx *ctx[2];
+    for (int i = 0; i < 2; ++i) {
+        cfg.arena = calloc(1, ARENA);
+        ctx[i] = umugu_load(&cfg);
+        umugu_name names[] = {{"Oscillator"}, {"Amplitude"}};
+        um_pipeline_generate(ctx[i], names, 2);
+    }
+
+    um_amplitude *amp = (void *)ctx[1]->pipeline.nodes[1];
+    const int multiplier =
+        app_find_node_attrib(ctx[1], &amp->node, (umugu_name){"Multiplier"}) -
+        ctx[1]->nodes_info[amp->node.info_idx].attribs;
+    umugu_event ev = {.kind = UMUGU_EVENT_SET, .node = 1, .attrib = multiplier};
+    ev.frame = 300;
+    ev.value.f = 0.25f;
+    int fails = umugu_event_push(ctx[1], &ev) != UMUGU_SUCCESS;
+    ev.frame = 700;
+    ev.kind = UMUGU_EVENT_RAMP;
+    ev.ramp_frames = 100;
+    ev.value.f = 1.0f;
+    fails += umugu_event_push(ctx[1], &ev) != UMUGU_SUCCESS;
+    ev.kind = UMUGU_EVENT_NOTE_ON + 8;
+    fails += umugu_event_push(ctx[1], &ev) != UMUGU_ERR_ARGS;
+
+    for (int block = 0; block < BLOCKS; ++block) {
+        if (block == 4) {
+            ev = (umugu_event){.frame = 10, .kind = UMUGU_EVENT_SET, .node = 1};
+            ev.attrib = multiplier;
+            ev.value.f = 0.5f;
+            fails += umugu_event_push(ctx[1], &ev) != UMUGU_SUCCESS;
+            const umugu_automation_point curve[] = {{1200, 0.0f}, {1300, 2.0f}};
+            fails += umugu_automation_set(ctx[1], 1, multiplier, 0, curve, 2) != UMUGU_SUCCESS;
+        }
+        const int64_t clock = ctx[1]->frame_clock;
+        umugu_process(ctx[0], BLOCK);
+        umugu_process(ctx[1], BLOCK);
+        const float *in = ctx[0]->pipeline.nodes[1]->out_pipe.samples;
+        const float *out = amp->node.out_pipe.samples;
+        for (int i = 0; i < BLOCK; ++i) {
+            fails += fabsf(out[i] - in[i] * app_events_gain(clock + i)) > 1e-5f;
+        }
+    }
+    fails += ctx[1]->frame_clock != BLOCK * BLOCKS;
+    printf("Events and automation on exact frames: %s.\n", fails ? "FAILED" : "OK");
+    for (int i = 0; i < 2; ++i) {
+        umugu_unload(ctx[i]);
+        free(ctx[i]); /* The context is at the start of its arena. */
+    }
+
+    /* A4 from frame 100 to 400 on a silent bank. */
+    cfg.arena = calloc(1, ARENA);
+    umugu_ctx *bank_ctx = umugu_load(&cfg);
+    umugu_name names[] = {{"OscillatorBank"}};
+    um_pipeline_generate(bank_ctx, names, 1);
+    um_oscbank *bank = (void *)bank_ctx->pipeline.nodes[0];
+    bank->voice_count = 2;
+    bank->voices.amp[0] = bank->voices.amp[1] = 0.0f;
+    fails = 0;
+    ev = (umugu_event){.frame = 100, .kind = UMUGU_EVENT_NOTE_ON, .note = 69, .velocity = 127};
+    fails += umugu_event_push(bank_ctx, &ev) != UMUGU_SUCCESS;
+    ev = (umugu_event){.frame = 400, .kind = UMUGU_EVENT_NOTE_OFF, .note = 69};
+    fails += umugu_event_push(bank_ctx, &ev) != UMUGU_SUCCESS;
+    ev.note = UMUGU_NOTE_COUNT;
+    fails += umugu_event_push(bank_ctx, &ev) != UMUGU_ERR_ARGS;
+    int sounding = 0;
+    for (int block = 0; block < 2; ++block) {
+        umugu_process(bank_ctx, BLOCK);
+        const float *out = bank->node.out_pipe.samples;
+        for (int i = 0; i < BLOCK; ++i) {
+            const int frame = block * BLOCK + i;
+            const bool on = frame >= 100 && frame < 400;
+            fails += !on && out[i] != 0.0f;
+            sounding += on && out[i] != 0.0f;
+        }
+        if (block == 0) {
+            fails += bank->voices.freq[0] != 440.0f || bank->voices.amp[0] != 1.0f;
+        }
+    }
+    fails += sounding < 290 || bank->voices.amp[0] != 0.0f;
+    printf("Note events on exact frames (%d frames sounding): %s.\n", sounding,
+           fails ? "FAILED" : "OK");
+    umugu_unload(bank_ctx);
+    free(bank_ctx); /* The context is at the start of its arena. */
+}
+
+/* Pipeline file of the swap tests: an oscillator at freq through the names. */
+static void
+app_swap_export(
+    const umugu_config *base, const umugu_name *names, int count, float freq, const char *file)
+{
+    umugu_config cfg = *base;
+    cfg.arena = calloc(1, cfg.arena_size);
+    umugu_ctx *ctx = umugu_load(&cfg);
+    um_pipeline_generate(ctx, names, count);
+    ((um_oscil *)ctx->pipeline.nodes[0])->osc.freq = freq;
+    umugu_pipeline_export(ctx, file);
+    umugu_unload(ctx);
+    free(cfg.arena);
+}
+
+/* Interleaved float output at the rate of the pipeline. */
+static void
+app_output_float(umugu_ctx *ctx, float *out, int frames, int channels)
+{
+    ctx->io.out_audio = (umugu_signal){
+        .samples = {.samples = out, .frame_count = frames, .channel_count = channels},
+        .interleaved_channels = true,
+        .format = UMUGU_TYPE_FLOAT,
+        .sample_rate = ctx->pipeline.sig.sample_rate};
+}
+
+static umugu_ctx *
+app_swap_load(const umugu_config *cfg, const char *file, float *out, int frames)
+{
+    umugu_ctx *ctx = umugu_load(cfg);
+    app_output_float(ctx, out, frames, 1);
+    umugu_pipeline_import(ctx, file);
+    return ctx;
+}
+
+enum { APP_SWAP_COUNT = 200 };
+
+typedef struct {
+    umugu_ctx *ctx;
+    const char *files[2];
+    int waveform; /* Attrib of the oscillators, written while waiting. */
+    int swapped;
+    int busy;
+    int rejected;
+    int finished;
+} app_swap_control;
+
+static void *
+app_swap_control_run(void *arg)
+{
+    app_swap_control *c = arg;
+    const int32_t sine = UMUGU_WAVEFORM_SINE;
+    for (int i = 0; i < APP_SWAP_COUNT; ++i) {
+        int err;
+        while ((err = umugu_pipeline_swap(c->ctx, c->files[i & 1], 64)) == UMUGU_ERR_BUSY) {
+            c->busy++;
+            /* Checked against the pipeline swapped in, not the one the audio thread is
+             * exchanging to fade it out. */
+            c->rejected +=
+                umugu_attrib_set(c->ctx, 0, c->waveform, 0, &sine, 0) == UMUGU_ERR_ARGS;
+            sched_yield();
+        }
+        c->swapped += err == UMUGU_SUCCESS;
+    }
+    __atomic_store_n(&c->finished, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/* A swap crossfades the old and the new pipeline sample by sample (against twin contexts
+ * running each one), then a control thread swaps over and over (and writes attributes)
+ * while the audio thread processes: every swap lands and the arena does not grow. */
+static void
+app_test_swap(const umugu_config *base)
+{
+    enum { BLOCK = 256, FADE = 300, ARENA = 2 * 1024 * 1024 };
+    static const char *files[] = {"/tmp/plumugu_swap_a.bin", "/tmp/plumugu_swap_b.bin"};
+    umugu_config cfg = *base;
+    cfg.arena_size = ARENA;
+    cfg.fallback_ppln_node_count = 0;
+    const umugu_name names_a[] = {{"Oscillator"}, {"Output"}};
+    const umugu_name names_b[] = {{"Oscillator"}, {"Amplitude"}, {"Output"}};
+    app_swap_export(&cfg, names_a, 2, 440.0f, files[0]);
+    app_swap_export(&cfg, names_b, 3, 220.0f, files[1]);
+
+    float out[3][BLOCK];
+    umugu_ctx *ref[2];
+    for (int i = 0; i < 2; ++i) {
+        cfg.arena = calloc(1, ARENA);
+        ref[i] = app_swap_load(&cfg, files[i], out[i], BLOCK);
+    }
+    cfg.arena = calloc(1, ARENA);
+    cfg.pipeline_region_size = 256 * 1024;
+    umugu_ctx *ctx = app_swap_load(&cfg, files[0], out[2], BLOCK);
+
+    int fails = 0;
+    uint8_t *arena_used = NULL;
+    for (int block = 0; block < 6; ++block) {
+        if (block == 2) {
+            arena_used = ctx->arena_pers_end;
+            fails += umugu_pipeline_swap(ctx, files[1], FADE) != UMUGU_SUCCESS;
+            fails += umugu_pipeline_swap(ctx, files[0], FADE) != UMUGU_ERR_BUSY;
+        }
+        umugu_process(ref[0], BLOCK);
+        if (block >= 2) {
+            umugu_process(ref[1], BLOCK);
+        }
+        umugu_process(ctx, BLOCK);
+        for (int i = 0; i < BLOCK; ++i) {
+            const int t = (block - 2) * BLOCK + i; /* Frames into the fade. */
+            const float g = block < 2 ? 0.0f : (float)um_mini(t + 1, FADE) / FADE;
+            const float expected = out[0][i] * (1.0f - g) + (block < 2 ? 0.0f : out[1][i] * g);
+            fails += fabsf(out[2][i] - expected) > 1e-5f;
+        }
+    }
+    fails += ctx->pipeline.node_count != 3 || ctx->plan.step_count != 3;
+    fails += umugu_pipeline_collect(ctx) != UMUGU_SUCCESS;
+    fails += umugu_pipeline_collect(ctx) != UMUGU_NOOP;
+    printf("Pipeline swap (crossfade %d frames): %s.\n", FADE, fails ? "FAILED" : "OK");
+
+    fails = 0;
+    const umugu_node *osc = ctx->pipeline.nodes[0];
+    app_swap_control control = {.ctx = ctx, .files = {files[0], files[1]}};
+    control.waveform = app_find_node_attrib(ctx, osc, (umugu_name){"Waveform"}) -
+                       ctx->nodes_info[osc->info_idx].attribs;
+    pthread_t thread;
+    pthread_create(&thread, NULL, app_swap_control_run, &control);
+    int blocks = 0;
+    while (!__atomic_load_n(&control.finished, __ATOMIC_ACQUIRE)) {
+        umugu_process(ctx, BLOCK);
+        ++blocks;
+    }
+    pthread_join(thread, NULL);
+    for (int i = 0; i < 4; ++i) {
+        umugu_process(ctx, BLOCK);
+    }
+    umugu_pipeline_collect(ctx);
+    fails += control.swapped != APP_SWAP_COUNT || ctx->arena_pers_end != arena_used;
+    fails += control.rejected;
+    fails += ctx->pipeline.node_count != 3; /* The last file is the second one. */
+    printf(
+        "Pipeline swaps %d while processing %d blocks (%d busy): %s.\n", control.swapped,
+        blocks, control.busy, fails ? "FAILED" : "OK");
+
+    for (int i = 0; i < 2; ++i) {
+        umugu_unload(ref[i]);
+        free(ref[i]); /* The context is at the start of its arena. */
+        remove(files[i]);
+    }
+    umugu_unload(ctx);
+    free(ctx);
+}
+
+enum { APP_CONTEXT_COUNT = 6, APP_CONTEXT_BLOCKS = 64, APP_CONTEXT_BLOCK = 256 };
+
+typedef struct {
+    umugu_config cfg;
+    const umugu_name *names;
+    int node_count;
+    float freq;
+    umugu_waveform waveform;
+    float out[APP_CONTEXT_BLOCKS * APP_CONTEXT_BLOCK];
+} app_context_job;
+
+/* Whole life of a context: load, build, render every block and unload. */
+static void *
+app_context_run(void *arg)
+{
+    app_context_job *job = arg;
+    memset(job->cfg.arena, 0, job->cfg.arena_size);
+    umugu_ctx *ctx = umugu_load(&job->cfg);
+    um_pipeline_generate(ctx, job->names, job->node_count);
+    um_oscil *osc = (um_oscil *)ctx->pipeline.nodes[0];
+    osc->osc.freq = job->freq;
+    osc->waveform = job->waveform;
+    app_output_float(ctx, NULL, APP_CONTEXT_BLOCK, 1);
+    for (int block = 0; block < APP_CONTEXT_BLOCKS; ++block) {
+        ctx->io.out_audio.samples.samples = job->out + block * APP_CONTEXT_BLOCK;
+        umugu_process(ctx, APP_CONTEXT_BLOCK);
+    }
+    umugu_unload(ctx);
+    return NULL;
+}
+
+/* Independent contexts rendered one after the other and then all at the same time, one
+ * thread each: the concurrent output is bit-identical to the serial one. */
+static void
+app_test_contexts(const umugu_config *base)
+{
+    enum { ARENA = 1024 * 1024 };
+    static const umugu_name names_a[] = {{"Oscillator"}, {"Output"}};
+    static const umugu_name names_b[] = {{"Oscillator"}, {"Amplitude"}, {"Output"}};
+    static const umugu_waveform waveforms[] = {
+        UMUGU_WAVEFORM_SINE, UMUGU_WAVEFORM_SAW, UMUGU_WAVEFORM_SQUARE,
+        UMUGU_WAVEFORM_WHITE_NOISE};
+    app_context_job *jobs = calloc(APP_CONTEXT_COUNT, sizeof(*jobs));
+    for (int i = 0; i < APP_CONTEXT_COUNT; ++i) {
+        jobs[i].cfg = *base;
+        jobs[i].cfg.arena = malloc(ARENA);
+        jobs[i].cfg.arena_size = ARENA;
+        jobs[i].cfg.fallback_ppln_node_count = 0;
+        jobs[i].cfg.worker_count = i == 1; /* One of them with its own worker. */
+        jobs[i].names = i & 1 ? names_b : names_a;
+        jobs[i].node_count = i & 1 ? 3 : 2;
+        jobs[i].freq = 110.0f * (i + 1);
+        jobs[i].waveform = waveforms[i % (sizeof(waveforms) / sizeof(*waveforms))];
+    }
+
+    float(*serial)[APP_CONTEXT_BLOCKS * APP_CONTEXT_BLOCK] =
+        malloc(APP_CONTEXT_COUNT * sizeof(*serial));
+    for (int i = 0; i < APP_CONTEXT_COUNT; ++i) {
+        app_context_run(&jobs[i]);
+        memcpy(serial[i], jobs[i].out, sizeof(jobs[i].out));
+        memset(jobs[i].out, 0, sizeof(jobs[i].out));
+    }
+
+    pthread_t threads[APP_CONTEXT_COUNT];
+    for (int i = 0; i < APP_CONTEXT_COUNT; ++i) {
+        pthread_create(&threads[i], NULL, app_context_run, &jobs[i]);
+    }
+
+    int fails = 0;
+    for (int i = 0; i < APP_CONTEXT_COUNT; ++i) {
+        pthread_join(threads[i], NULL);
+        fails += memcmp(serial[i], jobs[i].out, sizeof(jobs[i].out)) != 0;
+        fails += jobs[i].out[APP_CONTEXT_BLOCK] == 0.0f; /* Not silence. */
+        free(jobs[i].cfg.arena);
+    }
+    printf(
+        "Concurrent contexts (%d threads, %d blocks): %s.\n", APP_CONTEXT_COUNT,
+        APP_CONTEXT_BLOCKS, fails ? "FAILED" : "OK");
+    free(serial);
+    free(jobs);
+}
+
+/* The offline render writes the same samples as processing the blocks by hand, behind a
+ * wav header with the final size, and gives io.out_audio back. */
+static void
+app_test_render(const umugu_config *base)
+{
+    enum { BLOCK = 1000, FRAMES = 10500, ARENA = 1024 * 1024, HEADER = 44 };
+    static const char *ppln_file = "/tmp/plumugu_render.bin";
+    static const char *wav_file = "/tmp/plumugu_render.wav";
+    static float ref[FRAMES], out[FRAMES + HEADER / sizeof(float)];
+    umugu_config cfg = *base;
+    cfg.arena_size = ARENA;
+    cfg.fallback_ppln_node_count = 0;
+    const umugu_name names[] = {{"Oscillator"}, {"Amplitude"}, {"Output"}};
+    app_swap_export(&cfg, names, 3, 330.0f, ppln_file);
+
+    cfg.arena = calloc(1, ARENA);
+    umugu_ctx *ref_ctx = app_swap_load(&cfg, ppln_file, ref, BLOCK);
+    for (int done = 0; done < FRAMES; done += BLOCK) {
+        ref_ctx->io.out_audio.samples.samples = ref + done;
+        ref_ctx->io.out_audio.samples.frame_count = um_mini(BLOCK, FRAMES - done);
+        umugu_process(ref_ctx, ref_ctx->io.out_audio.samples.frame_count);
+    }
+
+    cfg.arena = calloc(1, ARENA);
+    umugu_ctx *ctx = app_swap_load(&cfg, ppln_file, out, 0);
+    int fails = umugu_render(ctx, wav_file, FRAMES, BLOCK) != UMUGU_SUCCESS;
+    fails += ctx->io.out_audio.samples.samples != out || ctx->io.out_audio.samples.frame_count;
+
+    FILE *f = fopen(wav_file, "rb");
+    const size_t size = f ? fread(out, 1, sizeof(out), f) : 0;
+    fails += !f || size != sizeof(out);
+    uint32_t data_size;
+    memcpy(&data_size, (char *)out + HEADER - 4, 4);
+    fails += data_size != sizeof(ref) || memcmp((char *)out + HEADER, ref, sizeof(ref));
+    printf("Offline render (%d frames): %s.\n", FRAMES, fails ? "FAILED" : "OK");
+
+    if (f) {
+        fclose(f);
+    }
+    remove(wav_file);
+    remove(ppln_file);
+    umugu_unload(ref_ctx);
+    free(ref_ctx);
+    umugu_unload(ctx);
+    free(ctx);
+}
+
+/* A mono float device buffer is the last slot of the plan (the nodes render straight into
+ * it), with the same samples as a stereo interleaved one that goes through the copy. */
+static void
+app_test_direct_output(const umugu_config *base)
+{
+    enum { BLOCK = 512, ARENA = 1024 * 1024 };
+    static const char *file = "/tmp/plumugu_direct.bin";
+    static float mono[BLOCK], stereo[2 * BLOCK];
+    umugu_config cfg = *base;
+    cfg.arena_size = ARENA;
+    cfg.fallback_ppln_node_count = 0;
+    const umugu_name names[] = {{"Oscillator"}, {"Amplitude"}, {"Output"}};
+    app_swap_export(&cfg, names, 3, 440.0f, file);
+
+    cfg.arena = calloc(1, ARENA);
+    umugu_ctx *direct = app_swap_load(&cfg, file, mono, BLOCK);
+    cfg.arena = calloc(1, ARENA);
+    umugu_ctx *copied = app_swap_load(&cfg, file, stereo, BLOCK);
+    copied->io.out_audio.samples.channel_count = 2;
+
+    int fails = 0;
+    for (int block = 0; block < 4; ++block) {
+        umugu_process(direct, BLOCK);
+        umugu_process(copied, BLOCK);
+        fails += direct->pipeline.nodes[1]->out_pipe.samples != mono;
+        fails += copied->pipeline.nodes[1]->out_pipe.samples == (float *)stereo;
+        for (int i = 0; i < BLOCK; ++i) {
+            fails += memcmp(&mono[i], &stereo[2 * i], sizeof(float)) != 0;
+            fails += memcmp(&mono[i], &stereo[2 * i + 1], sizeof(float)) != 0;
+        }
+    }
+    printf("Zero-copy output: %s.\n", fails ? "FAILED" : "OK");
+
+    remove(file);
+    umugu_unload(direct);
+    free(direct);
+    umugu_unload(copied);
+    free(copied);
+}
+
+/* Test node types: a planar mono to stereo one (R at half gain) and an interleaved one that
+ * swaps L and R, so reading the wrong layout shows in the output. */
+static int
+app_stereo_init(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
+{
+    UM_UNUSED(ctx);
+    UM_UNUSED(flags);
+    node->out_pipe.channel_count = 2;
+    return UMUGU_SUCCESS;
+}
+
+static int
+app_stereo_process(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
+{
+    UM_UNUSED(flags);
+    const float *in = um_node_get_input(ctx, node)->out_pipe.samples;
+    float *out = um_alloc_samples(ctx, &node->out_pipe);
+    const int frames = node->out_pipe.frame_count;
+    for (int i = 0; i < frames; ++i) {
+        out[i] = in[i];
+        out[frames + i] = 0.5f * in[i];
+    }
+    return UMUGU_SUCCESS;
+}
+
+static umugu_node_func
+app_stereo_getfn(int fn)
+{
+    return fn == UMUGU_FN_INIT ? app_stereo_init
+           : fn == UMUGU_FN_PROCESS ? app_stereo_process
+                                    : NULL;
+}
+
+static int
+app_swaplr_process(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
+{
+    UM_UNUSED(flags);
+    const umugu_samples *in = &um_node_get_input(ctx, node)->out_pipe;
+    node->out_pipe.channel_count = 2;
+    float *out = um_alloc_samples(ctx, &node->out_pipe);
+    for (int i = 0; i < node->out_pipe.frame_count; ++i) {
+        out[2 * i] = in->samples[2 * i + 1];
+        out[2 * i + 1] = in->samples[2 * i];
+    }
+    return UMUGU_SUCCESS;
+}
+
+static umugu_node_func
+app_swaplr_getfn(int fn)
+{
+    return fn == UMUGU_FN_PROCESS ? app_swaplr_process : NULL;
+}
+
+static umugu_ctx *
+app_layout_load(const umugu_config *cfg, const umugu_name *names, int count, float *out)
+{
+    umugu_ctx *ctx = umugu_load(cfg);
+    um_node_info_add(
+        ctx, &(umugu_node_type_info){
+                 .name = {"AppStereo"},
+                 .size_bytes = sizeof(umugu_node),
+                 .flags = UMUGU_NODE_PLANNED_OUTPUT,
+                 .getfn = app_stereo_getfn});
+    um_node_info_add(
+        ctx, &(umugu_node_type_info){
+                 .name = {"AppSwapLR"},
+                 .size_bytes = sizeof(umugu_node),
+                 .flags = UMUGU_NODE_PLANNED_OUTPUT | UMUGU_NODE_INTERLEAVED,
+                 .getfn = app_swaplr_getfn});
+    um_pipeline_generate(ctx, names, count);
+    app_output_float(ctx, out, 512, 1);
+    return ctx;
+}
+
+/* The compiler converts only between nodes of different layouts: planar to interleaved
+ * before the swap node, and back before Amplitude. Output and Limiter take any layout, so
+ * the interleaved signal goes straight into an interleaved device buffer. */
+static void
+app_test_layouts(const umugu_config *base)
+{
+    enum { BLOCK = 512, ARENA = 1024 * 1024 };
+    static float mono[BLOCK], planar_out[2 * BLOCK], direct_out[2 * BLOCK];
+    umugu_config cfg = *base;
+    cfg.arena_size = ARENA;
+    cfg.fallback_ppln_node_count = 0;
+    const umugu_name ref_names[] = {{"Oscillator"}, {"Output"}};
+    const umugu_name planar_names[] = {
+        {"Oscillator"}, {"AppStereo"}, {"AppSwapLR"}, {"Amplitude"}, {"Output"}};
+    const umugu_name direct_names[] = {
+        {"Oscillator"}, {"AppStereo"}, {"AppSwapLR"}, {"Limiter"}, {"Output"}};
+
+    cfg.arena = calloc(1, ARENA);
+    umugu_ctx *ref = app_layout_load(&cfg, ref_names, 2, mono);
+    cfg.arena = calloc(1, ARENA);
+    umugu_ctx *planar = app_layout_load(&cfg, planar_names, 5, planar_out);
+    planar->io.out_audio.samples.channel_count = 2;
+    cfg.arena = calloc(1, ARENA);
+    umugu_ctx *direct = app_layout_load(&cfg, direct_names, 5, direct_out);
+    direct->io.out_audio.samples.channel_count = 2;
+    um_limiter *limiter = (void *)direct->pipeline.nodes[3];
+    limiter->min = -2.0f; /* The sine can overshoot 1 by a few ulps. */
+    limiter->max = 2.0f;
+
+    int fails = (planar->pipeline.node_count != 7) + (direct->pipeline.node_count != 6);
+    for (int block = 0; block < 4; ++block) {
+        umugu_process(ref, BLOCK);
+        umugu_process(planar, BLOCK);
+        umugu_process(direct, BLOCK);
+        fails += direct->pipeline.nodes[3]->out_pipe.samples != direct_out;
+        for (int i = 0; i < BLOCK; ++i) {
+            const float half = 0.5f * mono[i];
+            fails += planar_out[2 * i] != half || planar_out[2 * i + 1] != mono[i];
+            fails += direct_out[2 * i] != half || direct_out[2 * i + 1] != mono[i];
+        }
+    }
+    printf("Layout negotiation: %s.\n", fails ? "FAILED" : "OK");
+
+    umugu_ctx *ctxs[] = {ref, planar, direct};
+    for (int i = 0; i < 3; ++i) {
+        umugu_unload(ctxs[i]);
+        free(ctxs[i]);
+    }
+}
+
+/* Slots of overlapping lifetimes: an amplitude read by two others, mixed. The first one
+ * works in place of the oscillator, its readers need a slot each while it is alive and the
+ * Mixer takes it back. Renders like the pipeline without planned outputs (a buffer by node
+ * and block), serially and with workers. */
+static void
+app_test_slots(const umugu_config *base)
+{
+    enum { BLOCK = 256, BLOCKS = 32, RUNS = 3, ARENA = 1024 * 1024 };
+    static float out[RUNS][BLOCK];
+    const umugu_name names[] = {{"Oscillator"}, {"Amplitude"}, {"Amplitude"},
+                                {"Amplitude"},  {"Mixer"},     {"Output"}};
+    umugu_config cfg = *base;
+    cfg.arena_size = ARENA;
+    cfg.fallback_ppln_node_count = 0;
+    umugu_ctx *ctx[RUNS];
+    int fails = 0;
+    for (int i = 0; i < RUNS; ++i) {
+        cfg.arena = calloc(1, ARENA);
+        cfg.worker_count = i == 2 ? 2 : 0;
+        ctx[i] = umugu_load(&cfg);
+        um_pipeline_generate(ctx[i], names, 6);
+        if (!i) {
+            for (int t = 0; t < ctx[i]->nodes_info_next; ++t) {
+                ctx[i]->nodes_info[t].flags &= ~(UMUGU_NODE_PLANNED_OUTPUT | UMUGU_NODE_INPLACE);
+            }
+        }
+        umugu_node **nodes = ctx[i]->pipeline.nodes;
+        nodes[3]->prev_node = 1;
+        ((um_amplitude *)nodes[1])->multiplier = 0.5f;
+        ((um_amplitude *)nodes[2])->multiplier = 0.25f;
+        ((um_amplitude *)nodes[3])->multiplier = 2.0f;
+        um_mixer *mixer = (void *)nodes[4];
+        mixer->node.prev_node = 2;
+        mixer->extra_pipe_in_node_idx[0] = 3;
+        mixer->input_count = 2;
+        fails += um_pipeline_init(ctx[i]) != UMUGU_SUCCESS;
+        app_output_float(ctx[i], out[i], BLOCK, 1);
+        fails += ctx[i]->plan.slot_count != (i ? 3 : 0);
+    }
+    const umugu_plan *plan = &ctx[1]->plan;
+    fails += plan->exec_slot[1] != plan->exec_slot[0] || plan->exec_slot[4] != plan->exec_slot[1];
+    fails += plan->exec_slot[2] == plan->exec_slot[1] || plan->exec_slot[3] == plan->exec_slot[1];
+    fails += plan->exec_slot[2] == plan->exec_slot[3];
+
+    for (int block = 0; block < BLOCKS; ++block) {
+        for (int i = 0; i < RUNS; ++i) {
+            fails += umugu_process(ctx[i], BLOCK) != UMUGU_SUCCESS;
+        }
+        for (int i = 1; i < RUNS; ++i) {
+            fails += memcmp(out[0], out[i], sizeof(out[0])) != 0;
+        }
+    }
+    fails += out[0][BLOCK / 2] == 0.0f;
+    printf("Slots of overlapping lifetimes (%d slots): %s.\n", plan->slot_count,
+           fails ? "FAILED" : "OK");
+    for (int i = 0; i < RUNS; ++i) {
+        umugu_unload(ctx[i]);
+        free(ctx[i]); /* The context is at the start of its arena. */
+    }
+}
+
+/* Oscillators at different frequencies through amplitudes, mixed: the branches the workers
+ * run in parallel. The branch b is the oscillator 2 * b and the amplitude 2 * b + 1. */
+static umugu_ctx *
+app_branches_generate(const umugu_config *cfg, int branches, float *out, int frames)
+{
+    umugu_name names[2 * UMUGU_MIXER_MAX_INPUTS + 2];
+    for (int b = 0; b < branches; ++b) {
+        names[2 * b] = (umugu_name){"Oscillator"};
+        names[2 * b + 1] = (umugu_name){"Amplitude"};
+    }
+    names[2 * branches] = (umugu_name){"Mixer"};
+    names[2 * branches + 1] = (umugu_name){"Output"};
+    umugu_ctx *ctx = umugu_load(cfg);
+    um_pipeline_generate(ctx, names, 2 * branches + 2);
+    um_mixer *mixer = (void *)ctx->pipeline.nodes[2 * branches];
+    for (int b = 0; b < branches; ++b) {
+        ((um_oscil *)ctx->pipeline.nodes[2 * b])->osc.freq = 220.0f + 110.0f * b;
+        ((um_amplitude *)ctx->pipeline.nodes[2 * b + 1])->multiplier = 1.0f / branches;
+        if (b) {
+            mixer->extra_pipe_in_node_idx[b - 1] = 2 * b + 1;
+        }
+    }
+    mixer->node.prev_node = 1;
+    mixer->input_count = branches;
+    um_pipeline_init(ctx);
+    app_output_float(ctx, out, frames, 1);
+    return ctx;
+}
+
+/* A mix of branches processed by one to three workers renders every block like the serial
+ * loop. */
+static void
+app_test_parallel(const umugu_config *base)
+{
+    enum { BLOCK = 256, BLOCKS = 200, RUNS = 4, ARENA = 1024 * 1024 };
+    static float out[RUNS][BLOCK];
+    umugu_config cfg = *base;
+    cfg.arena_size = ARENA;
+    cfg.fallback_ppln_node_count = 0;
+    umugu_ctx *ctx[RUNS];
+    for (int i = 0; i < RUNS; ++i) {
+        cfg.arena = calloc(1, ARENA);
+        cfg.worker_count = i;
+        ctx[i] = app_branches_generate(&cfg, UMUGU_MIXER_MAX_INPUTS, out[i], BLOCK);
+    }
+
+    int fails = 0;
+    for (int block = 0; block < BLOCKS; ++block) {
+        for (int i = 0; i < RUNS; ++i) {
+            fails += umugu_process(ctx[i], BLOCK) != UMUGU_SUCCESS;
+        }
+        for (int i = 1; i < RUNS; ++i) {
+            fails += memcmp(out[0], out[i], sizeof(out[0])) != 0;
+        }
+    }
+    fails += out[0][BLOCK / 2] == 0.0f; /* Not silence. */
+    printf(
+        "Parallel mix of %d branches (%d blocks, up to %d workers): %s.\n",
+        UMUGU_MIXER_MAX_INPUTS, BLOCKS, RUNS - 1, fails ? "FAILED" : "OK");
+    for (int i = 0; i < RUNS; ++i) {
+        umugu_unload(ctx[i]);
+        free(ctx[i]); /* The context is at the start of its arena. */
+    }
+}
+
+/* Glides and changes on every branch at once, processed by the workers, render like the
+ * same events processed serially. */
+static void
+app_test_parallel_events(const umugu_config *base)
+{
+    enum { BLOCK = 128, BLOCKS = 64, BRANCHES = 4, ARENA = 1024 * 1024 };
+    static float out[2][BLOCK];
+    umugu_config cfg = *base;
+    cfg.arena_size = ARENA;
+    cfg.fallback_ppln_node_count = 0;
+    umugu_ctx *ctx[2];
+    int fails = 0;
+    for (int i = 0; i < 2; ++i) {
+        cfg.arena = calloc(1, ARENA);
+        cfg.worker_count = 2 * i;
+        ctx[i] = app_branches_generate(&cfg, BRANCHES, out[i], BLOCK);
+        const umugu_node *amp = ctx[i]->pipeline.nodes[1];
+        const int multiplier =
+            app_find_node_attrib(ctx[i], amp, (umugu_name){"Multiplier"}) -
+            ctx[i]->nodes_info[amp->info_idx].attribs;
+        /* Every branch starts gliding on the same frames, some retargeted midway. */
+        for (int k = 0; k < 24; ++k) {
+            for (int b = 0; b < BRANCHES; ++b) {
+                umugu_event ev = {.node = 2 * b + 1, .attrib = multiplier};
+                ev.frame = k * 300 + (k % 3) * b * 37;
+                ev.kind = k % 4 == 3 ? UMUGU_EVENT_SET : UMUGU_EVENT_RAMP;
+                ev.ramp_frames = ev.kind == UMUGU_EVENT_RAMP ? 150 + 50 * b : 0;
+                ev.value.f = (float)((k + b) % 5) / (5 * BRANCHES);
+                fails += umugu_event_push(ctx[i], &ev) != UMUGU_SUCCESS;
+            }
+        }
+    }
+
+    for (int block = 0; block < BLOCKS; ++block) {
+        for (int i = 0; i < 2; ++i) {
+            fails += umugu_process(ctx[i], BLOCK) != UMUGU_SUCCESS;
+        }
+        fails += memcmp(out[0], out[1], sizeof(out[0])) != 0;
+    }
+    printf("Events on parallel branches: %s.\n", fails ? "FAILED" : "OK");
+    for (int i = 0; i < 2; ++i) {
+        umugu_unload(ctx[i]);
+        free(ctx[i]); /* The context is at the start of its arena. */
+    }
+}
+
+static int app_graph_runs;
+
+/* Test source node: counts its runs and writes a ramp. */
+static int
+app_count_init(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
+{
+    UM_UNUSED(ctx);
+    UM_UNUSED(flags);
+    node->prev_node = UMUGU_NO_INPUT;
+    node->out_pipe.channel_count = 1;
+    return UMUGU_SUCCESS;
+}
+
+static int
+app_count_process(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
+{
+    UM_UNUSED(flags);
+    __atomic_add_fetch(&app_graph_runs, 1, __ATOMIC_RELAXED);
+    float *out = um_alloc_samples(ctx, &node->out_pipe);
+    for (int i = 0; i < node->out_pipe.frame_count; ++i) {
+        out[i] = (float)i / node->out_pipe.frame_count;
+    }
+    return UMUGU_SUCCESS;
+}
+
+static umugu_node_func
+app_count_getfn(int fn)
+{
+    return fn == UMUGU_FN_INIT ? app_count_init
+           : fn == UMUGU_FN_PROCESS ? app_count_process
+                                    : NULL;
+}
+
+/* Pipelines scheduled as graphs: connections with a cycle do not compile, a node read by
+ * two others runs once per block (serially and with workers), and a Mixer input placed
+ * after the Mixer is processed before it. */
+static void
+app_test_graph(const umugu_config *base)
+{
+    enum { BLOCK = 256, BLOCKS = 16, ARENA = 1024 * 1024 };
+    static float out[2][BLOCK];
+    umugu_config cfg = *base;
+    cfg.arena_size = ARENA;
+    cfg.fallback_ppln_node_count = 0;
+    cfg.worker_count = 0;
+
+    /* Two amplitudes reading each other. */
+    const umugu_name chain[] = {{"Oscillator"}, {"Amplitude"}, {"Amplitude"}, {"Output"}};
+    cfg.arena = calloc(1, ARENA);
+    umugu_ctx *ctx = umugu_load(&cfg);
+    int fails = um_pipeline_generate(ctx, chain, 4) != UMUGU_SUCCESS;
+    app_output_float(ctx, out[0], BLOCK, 1);
+    ctx->pipeline.nodes[1]->prev_node = 2;
+    fails += um_pipeline_init(ctx) != UMUGU_ERR_GRAPH;
+    fails += umugu_process(ctx, BLOCK) != UMUGU_ERR_GRAPH;
+    umugu_unload(ctx);
+    free(ctx); /* The context is at the start of its arena. */
+
+    /* One source into two amplitudes, mixed. */
+    const umugu_name fan[] = {
+        {"AppCount"}, {"Amplitude"}, {"Amplitude"}, {"Mixer"}, {"Output"}};
+    for (int i = 0; i < 2; ++i) {
+        cfg.arena = calloc(1, ARENA);
+        cfg.worker_count = 2 * i;
+        ctx = umugu_load(&cfg);
+        um_node_info_add(
+            ctx, &(umugu_node_type_info){
+                     .name = {"AppCount"},
+                     .size_bytes = sizeof(umugu_node),
+                     .flags = UMUGU_NODE_PLANNED_OUTPUT,
+                     .getfn = app_count_getfn});
+        um_pipeline_generate(ctx, fan, 5);
+        ctx->pipeline.nodes[2]->prev_node = 0;
+        ((um_amplitude *)ctx->pipeline.nodes[2])->multiplier = 0.25f;
+        um_mixer *mixer = (void *)ctx->pipeline.nodes[3];
+        mixer->node.prev_node = 1;
+        mixer->extra_pipe_in_node_idx[0] = 2;
+        mixer->input_count = 2;
+        um_pipeline_init(ctx);
+        app_output_float(ctx, out[i], BLOCK, 1);
+
+        app_graph_runs = 0;
+        for (int block = 0; block < BLOCKS; ++block) {
+            fails += umugu_process(ctx, BLOCK) != UMUGU_SUCCESS;
+        }
+        fails += app_graph_runs != BLOCKS;
+        for (int f = 0; f < BLOCK; ++f) {
+            fails += fabsf(out[i][f] - 0.5f * 1.25f * f / BLOCK) > 1e-6f;
+        }
+        umugu_unload(ctx);
+        free(ctx);
+    }
+
+    /* The second oscillator of the mix after the Output, against the usual order. */
+    const umugu_name late[] = {
+        {"Oscillator"}, {"Amplitude"}, {"Mixer"}, {"Output"}, {"Oscillator"}};
+    const umugu_name ordered[] = {
+        {"Oscillator"}, {"Amplitude"}, {"Oscillator"}, {"Mixer"}, {"Output"}};
+    umugu_ctx *ctxs[2];
+    for (int i = 0; i < 2; ++i) {
+        cfg.arena = calloc(1, ARENA);
+        cfg.worker_count = 0;
+        ctxs[i] = umugu_load(&cfg);
+        um_pipeline_generate(ctxs[i], i ? late : ordered, 5);
+        const int osc = i ? 4 : 2;
+        ((um_oscil *)ctxs[i]->pipeline.nodes[osc])->osc.freq = 660.0f;
+        um_mixer *mixer = (void *)ctxs[i]->pipeline.nodes[i ? 2 : 3];
+        mixer->node.prev_node = 1;
+        mixer->extra_pipe_in_node_idx[0] = osc;
+        mixer->input_count = 2;
+        fails += um_pipeline_init(ctxs[i]) != UMUGU_SUCCESS;
+        app_output_float(ctxs[i], out[i], BLOCK, 1);
+    }
+    const umugu_plan *plan = &ctxs[1]->plan;
+    int osc_step = -1, mixer_step = -1;
+    for (int s = 0; s < plan->step_count; ++s) {
+        osc_step = plan->exec_node_idx[s] == 4 ? s : osc_step;
+        mixer_step = plan->exec_node_idx[s] == 2 ? s : mixer_step;
+    }
+    fails += osc_step < 0 || osc_step > mixer_step || plan->exec_node_idx[4] != 3;
+    for (int block = 0; block < BLOCKS; ++block) {
+        for (int i = 0; i < 2; ++i) {
+            fails += umugu_process(ctxs[i], BLOCK) != UMUGU_SUCCESS;
+        }
+        fails += memcmp(out[0], out[1], sizeof(out[0])) != 0;
+    }
+    fails += out[1][BLOCK / 2] == 0.0f;
+    printf("Pipeline graphs (cycle, fan-out, late Mixer input): %s.\n", fails ? "FAILED" : "OK");
+    for (int i = 0; i < 2; ++i) {
+        umugu_unload(ctxs[i]);
+        free(ctxs[i]);
+    }
+}
+
+typedef struct {
+    const umugu_ctx *ctx;
+    int64_t reads;
+    int64_t torn; /* Snapshots that break the invariants of a consistent one. */
+    int finished;
+} app_metrics_reader;
+
+static bool
+app_timing_valid(const umugu_timing *t)
+{
+    return t->min_ns <= t->avg_ns && t->avg_ns <= t->max_ns && t->min_ns <= t->p99_ns &&
+           t->p99_ns <= t->max_ns;
+}
+
+/* Monitoring thread: reads the snapshots as fast as it can while the audio thread runs. */
+static void *
+app_metrics_read_run(void *arg)
+{
+    app_metrics_reader *r = arg;
+    umugu_metrics m;
+    umugu_timing nodes[64];
+    const int capacity = sizeof(nodes) / sizeof(nodes[0]);
+    while (!__atomic_load_n(&r->finished, __ATOMIC_ACQUIRE)) {
+        if (umugu_metrics_read(r->ctx, &m, nodes, capacity) != UMUGU_SUCCESS) {
+            continue;
+        }
+        __atomic_add_fetch(&r->reads, 1, __ATOMIC_RELAXED);
+        r->torn += m.blocks % UMUGU_METRICS_WINDOW != 0 || !app_timing_valid(&m.block);
+        for (int i = 0; i < m.node_count && i < capacity; ++i) {
+            r->torn += !app_timing_valid(&nodes[i]) || nodes[i].max_ns > m.block.max_ns;
+        }
+    }
+    return NULL;
+}
+
+/* Per node and block timings of a parallel pipeline, read by another thread while the
+ * audio one publishes them: every snapshot read is consistent and the counters add up. */
+static void
+app_test_metrics(const umugu_config *base)
+{
+    enum { BLOCK = 256, WINDOWS = 3, ARENA = 1024 * 1024 };
+    static float out[BLOCK];
+    umugu_config cfg = *base;
+    cfg.arena = calloc(1, ARENA);
+    cfg.arena_size = ARENA;
+    cfg.fallback_ppln_node_count = 0;
+    cfg.worker_count = 2;
+    const umugu_name names[] = {{"Oscillator"}, {"Amplitude"}, {"Output"}};
+    umugu_ctx *ctx = umugu_load(&cfg);
+    um_pipeline_generate(ctx, names, 3);
+    app_output_float(ctx, out, BLOCK, 1);
+
+    umugu_metrics m;
+    umugu_timing nodes[3];
+    int fails = umugu_metrics_read(ctx, &m, NULL, 0) != UMUGU_NOOP;
+    app_metrics_reader reader = {.ctx = ctx};
+    pthread_t thread;
+    pthread_create(&thread, NULL, app_metrics_read_run, &reader);
+    /* Whole windows, until the reader has raced with a few publications. */
+    int64_t blocks = 0;
+    while (blocks < WINDOWS * UMUGU_METRICS_WINDOW ||
+           __atomic_load_n(&reader.reads, __ATOMIC_RELAXED) < 1000 ||
+           blocks % UMUGU_METRICS_WINDOW) {
+        umugu_process(ctx, BLOCK);
+        blocks++;
+    }
+    __atomic_store_n(&reader.finished, 1, __ATOMIC_RELEASE);
+    pthread_join(thread, NULL);
+
+    fails += umugu_metrics_read(ctx, &m, nodes, 3) != UMUGU_SUCCESS || reader.torn;
+    fails += m.blocks != blocks || m.node_count != 3;
+    fails += m.budget_ns != (int64_t)BLOCK * 1000000000 / 48000;
+    for (int i = 0; i < 3; ++i) {
+        fails += nodes[i].min_ns <= 0 || nodes[i].max_ns > m.block.max_ns;
+    }
+    printf(
+        "Metrics (%ld blocks, %ld snapshots read): block avg %ldns p99 %ldns, misses %ld: %s.\n",
+        (long)blocks, (long)reader.reads, (long)m.block.avg_ns, (long)m.block.p99_ns,
+        (long)m.deadline_misses, fails ? "FAILED" : "OK");
+
+    umugu_unload(ctx);
+    free(cfg.arena);
+}
+
+/* Two oscillators mixed, through an amplitude: the pipeline of the file format test. */
+static umugu_ctx *
+app_file_generate(const umugu_config *cfg, float *out, int frames)
+{
+    const umugu_name names[] = {
+        {"Oscillator"}, {"Oscillator"}, {"Mixer"}, {"Amplitude"}, {"Output"}};
+    umugu_ctx *ctx = umugu_load(cfg);
+    um_pipeline_generate(ctx, names, 5);
+    ((um_oscil *)ctx->pipeline.nodes[1])->osc.freq = 660.0f;
+    um_mixer *mixer = (void *)ctx->pipeline.nodes[2];
+    mixer->node.prev_node = 0;
+    mixer->extra_pipe_in_node_idx[0] = 1;
+    mixer->input_count = 2;
+    ((um_amplitude *)ctx->pipeline.nodes[3])->multiplier = 0.5f;
+    um_pipeline_init(ctx);
+    app_output_float(ctx, out, frames, 1);
+    return ctx;
+}
+
+static size_t
+app_file_read(const char *file, uint8_t *buf, size_t size)
+{
+    FILE *f = fopen(file, "rb");
+    const size_t bytes = f ? fread(buf, 1, size, f) : 0;
+    if (f) {
+        fclose(f);
+    }
+    return bytes;
+}
+
+/* A pipeline exported while running: the file has none of its pointers, importing it
+ * renders like the generated pipeline, exporting it again gives the same file and
+ * truncated files are rejected. */
+static void
+app_test_pipeline_file(const umugu_config *base)
+{
+    enum { BLOCK = 512, ARENA = 1024 * 1024, FILE_SIZE = 4096 };
+    static const char *file = "/tmp/plumugu_file.bin";
+    static const char *again = "/tmp/plumugu_file_again.bin";
+    static float ref_out[BLOCK], out[BLOCK];
+    static uint8_t bytes[FILE_SIZE], bytes_again[FILE_SIZE];
+    umugu_config cfg = *base;
+    cfg.arena_size = ARENA;
+    cfg.fallback_ppln_node_count = 0;
+
+    cfg.arena = calloc(1, ARENA);
+    umugu_ctx *src = app_file_generate(&cfg, out, BLOCK);
+    umugu_process(src, BLOCK);
+    int fails = umugu_pipeline_export(src, file) != UMUGU_SUCCESS;
+    const size_t size = app_file_read(file, bytes, FILE_SIZE);
+    fails += !size || size == FILE_SIZE;
+    for (int i = 0; i < src->pipeline.node_count; ++i) {
+        const uintptr_t ptr = (uintptr_t)src->pipeline.nodes[i]->out_pipe.samples;
+        for (size_t at = 0; ptr && at + sizeof(ptr) <= size; at += sizeof(ptr)) {
+            fails += !memcmp(bytes + at, &ptr, sizeof(ptr));
+        }
+    }
+
+    cfg.arena = calloc(1, ARENA);
+    umugu_ctx *ref = app_file_generate(&cfg, ref_out, BLOCK);
+    cfg.arena = calloc(1, ARENA);
+    umugu_ctx *ctx = umugu_load(&cfg);
+    ctx->io.out_audio = ref->io.out_audio;
+    ctx->io.out_audio.samples.samples = out;
+    const um_nanosec start = um_time_now();
+    fails += umugu_pipeline_import(ctx, file) != UMUGU_SUCCESS;
+    const um_nanosec elapsed = um_time_elapsed(start);
+    fails += ctx->pipeline.node_count != 5;
+    for (int block = 0; block < 4; ++block) {
+        umugu_process(ref, BLOCK);
+        umugu_process(ctx, BLOCK);
+        fails += memcmp(ref_out, out, sizeof(out)) != 0;
+    }
+
+    fails += umugu_pipeline_export(ctx, again) != UMUGU_SUCCESS;
+    fails += app_file_read(again, bytes_again, FILE_SIZE) != size;
+    fails += memcmp(bytes, bytes_again, size) != 0;
+
+    FILE *f = fopen(again, "wb");
+    fwrite(bytes, 1, size / 2, f);
+    fclose(f);
+    cfg.arena = calloc(1, ARENA);
+    umugu_ctx *bad = umugu_load(&cfg);
+    fails += umugu_pipeline_import(bad, again) != UMUGU_ERR_FILE || bad->pipeline.node_count;
+
+    /* More types in the file than the context takes. */
+    cfg.arena = calloc(1, ARENA);
+    cfg.node_info_capacity = 3;
+    umugu_ctx *small = umugu_load(&cfg);
+    fails += umugu_pipeline_import(small, file) != UMUGU_ERR_FILE || small->pipeline.node_count;
+
+    printf(
+        "Pipeline file (%d bytes) imported in %ldus: %s.\n", (int)size,
+        (long)um_time_micro(elapsed), fails ? "FAILED" : "OK");
+
+    remove(file);
+    remove(again);
+    umugu_ctx *ctxs[] = {src, ref, ctx, bad, small};
+    for (int i = 0; i < 5; ++i) {
+        umugu_unload(ctxs[i]);
+        free(ctxs[i]);
+    }
+}
+
+/* Two versions of a plug node type. The second moves the fields, widens the label, keeps
+ * the gain as a double, drops the mode and adds a count. */
+typedef struct {
+    umugu_node node;
+    float gain;
+    int32_t mode;
+    char label[16];
+    int32_t state; /* Not an attrib, set by the defaults. */
+} app_schema_v1;
+
+typedef struct {
+    umugu_node node;
+    int32_t count;
+    char label[32];
+    double gain;
+} app_schema_v2;
+
+static const umugu_attrib_info app_schema_v1_attribs[] = {
+    {.name = {"Gain"},
+     .offset_bytes = offsetof(app_schema_v1, gain),
+     .type = UMUGU_TYPE_FLOAT,
+     .count = 1},
+    {.name = {"Mode"},
+     .offset_bytes = offsetof(app_schema_v1, mode),
+     .type = UMUGU_TYPE_INT32,
+     .count = 1},
+    {.name = {"Label"},
+     .offset_bytes = offsetof(app_schema_v1, label),
+     .type = UMUGU_TYPE_TEXT,
+     .count = 16}};
+
+static const umugu_attrib_info app_schema_v2_attribs[] = {
+    {.name = {"Count"},
+     .offset_bytes = offsetof(app_schema_v2, count),
+     .type = UMUGU_TYPE_INT32,
+     .count = 1},
+    {.name = {"Label"},
+     .offset_bytes = offsetof(app_schema_v2, label),
+     .type = UMUGU_TYPE_TEXT,
+     .count = 32},
+    {.name = {"Gain"},
+     .offset_bytes = offsetof(app_schema_v2, gain),
+     .type = UMUGU_TYPE_DOUBLE,
+     .count = 1}};
+
+static int
+app_schema_init(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
+{
+    if (flags & UMUGU_FN_INIT_DEFAULTS) {
+        const bool v2 = ctx->nodes_info[node->info_idx].attribs == app_schema_v2_attribs;
+        if (v2) {
+            app_schema_v2 *self = (void *)node;
+            self->count = 7;
+            self->gain = 1.0;
+            strcpy(self->label, "default label of the schema");
+        } else {
+            ((app_schema_v1 *)node)->state = 42;
+        }
+    }
+    return UMUGU_SUCCESS;
+}
+
+static int
+app_schema_process(umugu_ctx *ctx, umugu_node *node, umugu_fn_flags flags)
+{
+    UM_UNUSED(flags);
+    node->out_pipe = um_node_get_input(ctx, node)->out_pipe;
+    return UMUGU_SUCCESS;
+}
+
+static umugu_node_func
+app_schema_getfn(int fn)
+{
+    return fn == UMUGU_FN_INIT ? app_schema_init
+           : fn == UMUGU_FN_PROCESS ? app_schema_process
+                                    : NULL;
+}
+
+static umugu_ctx *
+app_schema_load(const umugu_config *cfg, bool v2)
+{
+    umugu_ctx *ctx = umugu_load(cfg);
+    um_node_info_add(
+        ctx, &(umugu_node_type_info){
+                 .name = {"AppSchema"},
+                 .size_bytes = v2 ? sizeof(app_schema_v2) : sizeof(app_schema_v1),
+                 .attrib_count = 3,
+                 .getfn = app_schema_getfn,
+                 .attribs = v2 ? app_schema_v2_attribs : app_schema_v1_attribs});
+    return ctx;
+}
+
+/* A pipeline saved with the first version of a node type loads in the second one: the
+ * fields are matched by name and converted, the new one keeps its default. The state that
+ * is not an attrib gets the defaults of the type, not the one of the exporter. */
+static void
+app_test_pipeline_schema(const umugu_config *base)
+{
+    enum { ARENA = 1024 * 1024 };
+    static const char *file = "/tmp/plumugu_schema.bin";
+    umugu_config cfg = *base;
+    cfg.arena_size = ARENA;
+    cfg.fallback_ppln_node_count = 0;
+    const umugu_name names[] = {{"Oscillator"}, {"AppSchema"}, {"Output"}};
+
+    cfg.arena = calloc(1, ARENA);
+    umugu_ctx *src = app_schema_load(&cfg, false);
+    um_pipeline_generate(src, names, 3);
+    app_schema_v1 *v1 = (void *)src->pipeline.nodes[1];
+    v1->gain = 0.25f;
+    v1->mode = 3;
+    strcpy(v1->label, "saved");
+    v1->state = 3;
+    int fails = umugu_pipeline_export(src, file) != UMUGU_SUCCESS;
+
+    cfg.arena = calloc(1, ARENA);
+    umugu_ctx *same = app_schema_load(&cfg, false);
+    fails += umugu_pipeline_import(same, file) != UMUGU_SUCCESS;
+    const app_schema_v1 *loaded_v1 = (void *)same->pipeline.nodes[1];
+    fails += same->pipeline.node_count != 3 || loaded_v1->gain != 0.25f ||
+             loaded_v1->mode != 3 || strcmp(loaded_v1->label, "saved") ||
+             loaded_v1->state != 42;
+
+    cfg.arena = calloc(1, ARENA);
+    umugu_ctx *evolved = app_schema_load(&cfg, true);
+    fails += umugu_pipeline_import(evolved, file) != UMUGU_SUCCESS;
+    const app_schema_v2 *v2 = (void *)evolved->pipeline.nodes[1];
+    fails += evolved->pipeline.node_count != 3 || v2->node.prev_node != 0;
+    fails += v2->gain != 0.25 || v2->count != 7 || strcmp(v2->label, "saved");
+    printf("Pipeline file schema changes: %s.\n", fails ? "FAILED" : "OK");
+
+    remove(file);
+    umugu_ctx *ctxs[] = {src, same, evolved};
+    for (int i = 0; i < 3; ++i) {
+        umugu_unload(ctxs[i]);
+        free(ctxs[i]);
+    }
+}
+
+/* Arena in a misaligned buffer: every allocation is aligned, each block reuses the same
+ * temporary memory, an iteration that does not fit is reported and counted, and with
+ * UMUGU_DEBUG the temporary allocations are poisoned and guarded. */
+static void
+app_test_arena(const umugu_config *base)
+{
+    enum { BLOCK = 256, ARENA = 1024 * 1024 };
+    static float out[BLOCK];
+    umugu_config cfg = *base;
+    uint8_t *buffer = calloc(1, ARENA + 8);
+    cfg.arena = buffer + 8;
+    cfg.arena_size = ARENA;
+    cfg.fallback_ppln_node_count = 0;
+    umugu_ctx *ctx = app_file_generate(&cfg, out, BLOCK);
+
+    int fails = (uintptr_t)um_allocprs(ctx, 24) % UM_ARENA_ALIGN != 0;
+    for (int i = 0; i < ctx->pipeline.node_count; ++i) {
+        fails += (uintptr_t)ctx->pipeline.nodes[i] % UM_NODE_ALIGN != 0;
+    }
+
+    /* The blocks allocate no persistent memory, the first one neither. */
+    const uint8_t *pers_end = ctx->arena_pers_end;
+    fails += umugu_process(ctx, BLOCK) != UMUGU_SUCCESS;
+    const float *slot = ctx->pipeline.nodes[0]->out_pipe.samples;
+    for (int i = 0; i < 4; ++i) {
+        fails += umugu_process(ctx, BLOCK) != UMUGU_SUCCESS;
+    }
+    fails += ctx->pipeline.nodes[0]->out_pipe.samples != slot || ctx->arena_pers_end != pers_end;
+    fails += (uintptr_t)slot % UM_ARENA_ALIGN != 0;
+    const int64_t persistent = ctx->arena_pers_end - ctx->arena_head;
+    fails += ctx->arena_high_water <= persistent || ctx->arena_overflows;
+
+    um_arena_frame_begin(ctx);
+    float *tmp = um_alloctmp(ctx, 3 * sizeof(float));
+    fails += (uintptr_t)tmp % UM_ARENA_ALIGN != 0;
+#ifdef UMUGU_DEBUG
+    fails += !isnan(tmp[0]) || !isnan(tmp[2]);
+    tmp[3] = 0.0f; /* Out of bounds. */
+    fails += um_arena_frame_end(ctx) != UMUGU_ERR_MEM;
+    um_arena_frame_begin(ctx);
+#endif
+    const size_t available = ctx->arena_capacity - persistent;
+    um_alloctmp(ctx, available * 6 / 10);
+    um_alloctmp(ctx, available * 6 / 10);
+    fails += um_arena_frame_end(ctx) != UMUGU_ERR_MEM || ctx->arena_overflows != 1;
+    fails += ctx->arena_high_water != ctx->arena_capacity;
+
+    /* The next blocks are fine again, the metrics report the overflow. */
+    umugu_metrics m;
+    for (int i = 5; i < UMUGU_METRICS_WINDOW; ++i) {
+        fails += umugu_process(ctx, BLOCK) != UMUGU_SUCCESS;
+    }
+    fails += umugu_metrics_read(ctx, &m, NULL, 0) != UMUGU_SUCCESS;
+    fails += m.arena_overflows != 1 || m.arena_high_water != ctx->arena_high_water;
+
+    /* A pipeline changed without um_pipeline_init is not compiled by the block. */
+    ctx->pipeline.node_count--;
+    fails += umugu_process(ctx, BLOCK) != UMUGU_ERR_GRAPH;
+    ctx->pipeline.node_count++;
+    fails += umugu_process(ctx, BLOCK) != UMUGU_SUCCESS;
+    printf(
+        "Arena (%ld bytes persistent, %ld per block): %s.\n", (long)persistent,
+        (long)ctx->ppln_it_allocated, fails ? "FAILED" : "OK");
+
+    umugu_unload(ctx);
+    free(buffer);
+}
+
+/* A provisioned arena is rounded to whole huge pages, aligned to them and resident before
+ * the first block. Huge pages and locking depend on the system, they are only reported. */
+static void
+app_test_arena_map(const umugu_config *base)
+{
+    enum { BLOCK = 256, HUGE_PAGE = 2 * 1024 * 1024 };
+    static float out[BLOCK];
+    umugu_config cfg = *base;
+    cfg.fallback_ppln_node_count = 0;
+    const int ret = umugu_arena_map(&cfg, 1024 * 1024 + 1, UMUGU_ARENA_REALTIME);
+    int fails = ret < UMUGU_SUCCESS || cfg.arena_size != HUGE_PAGE;
+    fails += (uintptr_t)cfg.arena % HUGE_PAGE != 0;
+    if (fails) {
+        printf("Arena provisioning: FAILED.\n");
+        return;
+    }
+
+    const size_t page = sysconf(_SC_PAGESIZE);
+    unsigned char resident[HUGE_PAGE / 4096];
+    fails += cfg.arena_size / page > sizeof(resident) ||
+             mincore(cfg.arena, cfg.arena_size, resident) != 0;
+    for (size_t i = 0; !fails && i < cfg.arena_size / page; ++i) {
+        fails += !(resident[i] & 1);
+    }
+
+    umugu_ctx *ctx = app_file_generate(&cfg, out, BLOCK);
+    for (int i = 0; i < 4; ++i) {
+        fails += umugu_process(ctx, BLOCK) != UMUGU_SUCCESS;
+    }
+    umugu_unload(ctx);
+    umugu_arena_unmap(cfg.arena, cfg.arena_size);
+    printf(
+        "Arena provisioning (%zu bytes%s): %s.\n", cfg.arena_size,
+        ret == UMUGU_SUCCESS ? ", huge pages and locked" : "", fails ? "FAILED" : "OK");
+}
+
+/* Oscillator, a long chain of unity Amplitudes and Output, past the default capacity:
+ * every array by node is exactly the pipeline size and it sounds as the short chain. */
+static void
+app_test_large_pipeline(const umugu_config *base)
+{
+    enum { BLOCK = 256, NODES = 299, ARENA = 4 * 1024 * 1024 };
+    static float ref_out[BLOCK];
+    static float out[BLOCK];
+    umugu_name names[NODES];
+    names[0] = (umugu_name){"Oscillator"};
+    for (int i = 1; i < NODES - 1; ++i) {
+        names[i] = (umugu_name){"Amplitude"};
+    }
+    names[NODES - 1] = (umugu_name){"Output"};
+    const umugu_name short_names[] = {{"Oscillator"}, {"Amplitude"}, {"Output"}};
+
+    umugu_config cfg = *base;
+    cfg.fallback_ppln_node_count = 0;
+    cfg.worker_count = 0;
+    cfg.arena_size = ARENA;
+    cfg.arena = calloc(1, ARENA);
+    void *ref_arena = cfg.arena;
+    umugu_ctx *ref = umugu_load(&cfg);
+    int fails = um_pipeline_generate(ref, short_names, 3) < UMUGU_SUCCESS;
+
+    /* The tables by node are sized for the pipeline loaded and its layout conversions. */
+    cfg.arena = calloc(1, ARENA);
+    umugu_ctx *ctx = umugu_load(&cfg);
+    fails += ctx->pipeline_capacity != 0 || ref->pipeline_capacity != 6;
+    fails += um_pipeline_generate(ctx, names, NODES) < UMUGU_SUCCESS;
+    fails += ctx->pipeline_capacity != 2 * NODES;
+
+    app_output_float(ref, ref_out, BLOCK, 1);
+    app_output_float(ctx, out, BLOCK, 1);
+    for (int b = 0; b < UMUGU_METRICS_WINDOW; ++b) {
+        fails += umugu_process(ref, BLOCK) != UMUGU_SUCCESS;
+        fails += umugu_process(ctx, BLOCK) != UMUGU_SUCCESS;
+        fails += memcmp(ref_out, out, sizeof(out)) != 0;
+    }
+
+    const umugu_plan *plan = &ctx->plan;
+    fails += ctx->pipeline.node_capacity != 2 * NODES || plan->step_capacity != 2 * NODES;
+    for (int s = 0; s < plan->step_count; ++s) {
+        fails += plan->exec_node[s] != ctx->pipeline.nodes[plan->exec_node_idx[s]];
+    }
+
+    umugu_metrics m;
+    umugu_timing nodes[NODES];
+    fails += umugu_metrics_read(ctx, &m, nodes, NODES) != UMUGU_SUCCESS || m.node_count != NODES;
+    for (int i = 0; i < NODES; ++i) {
+        fails += !app_timing_valid(&nodes[i]);
+    }
+    printf(
+        "Large pipeline (%d nodes, %d steps, %d slots): %s.\n", (int)ctx->pipeline.node_count,
+        plan->step_count, plan->slot_count, fails ? "FAILED" : "OK");
+
+    umugu_unload(ctx);
+    umugu_unload(ref);
+    free(cfg.arena);
+    free(ref_arena);
+}
+
+static int app_registry_logs;
+
+static int
+app_registry_log(const char *fmt, ...)
+{
+    UM_UNUSED(fmt);
+    return ++app_registry_logs;
+}
+
+/* Node types found by name among many: built in, appended by the user and missing ones,
+ * whose plug is looked for only once. */
+static void
+app_test_registry(const umugu_config *base)
+{
+    enum { TYPES = 200, ARENA = 1024 * 1024 };
+    umugu_config cfg = *base;
+    cfg.fallback_ppln_node_count = 0;
+    cfg.worker_count = 0;
+    cfg.node_info_capacity = TYPES + 3; /* And Layout, loaded with the context. */
+    cfg.arena_size = ARENA;
+    cfg.arena = calloc(1, ARENA);
+    umugu_ctx *ctx = umugu_load(&cfg);
+
+    const umugu_name osc = {"Oscillator"};
+    const umugu_node_type_info *info = um_node_info_load(ctx, &osc);
+    int fails = !info || um_node_info_load(ctx, &osc) != info;
+    const int first = ctx->nodes_info_next;
+    for (int i = 0; i < TYPES; ++i) {
+        umugu_node_type_info t = {.size_bytes = sizeof(umugu_node), .getfn = app_stereo_getfn};
+        snprintf(t.name.str, UMUGU_NAME_LEN, "AppType%d", i);
+        fails += um_node_info_add(ctx, &t) != first + i;
+    }
+    for (int i = TYPES - 1; i >= 0; --i) {
+        umugu_name name = {{0}};
+        snprintf(name.str, UMUGU_NAME_LEN, "AppType%d", i);
+        fails += um_node_info_load(ctx, &name) != &ctx->nodes_info[first + i];
+    }
+
+    /* Only the first lookup of a missing type tries to plug it (and logs it). */
+    const umugu_name missing = {"AppMissing"};
+    ctx->io.log = app_registry_log;
+    fails += um_node_info_load(ctx, &missing) != NULL;
+    const int logs = app_registry_logs;
+    for (int i = 0; i < 100; ++i) {
+        fails += um_node_info_load(ctx, &missing) != NULL;
+    }
+    fails += !logs || app_registry_logs != logs || ctx->nodes_info_next != first + TYPES;
+    ctx->io.log = cfg.log_fn;
+
+    /* Unless it is set afterwards. */
+    const int set = um_node_info_add(
+        ctx, &(umugu_node_type_info){.name = missing, .size_bytes = sizeof(umugu_node)});
+    fails += um_node_info_load(ctx, &missing) != &ctx->nodes_info[set];
+    printf("Node type registry (%d types): %s.\n", ctx->nodes_info_next, fails ? "FAILED" : "OK");
+
+    umugu_unload(ctx);
+    free(cfg.arena);
+}
+
 static inline void
-app_run_unit_test(void)
+app_run_unit_test(umugu_ctx *ctx, const umugu_config *cfg)
 {
     UM_TRACE_ZONE();
     static const int N = 1 << 3; /* N-point FFT, iFFT */
@@ -109,6 +2106,30 @@ app_run_unit_test(void)
     app_print_vector(" FFT", v1, N);
     um_ifft(v1, N, scratch);
     app_print_vector("iFFT", v1, N);
+
+    app_test_kernels();
+    app_test_fft(ctx);
+    app_test_resampler(ctx, cfg);
+    app_test_convolver(cfg);
+    app_test_wavplayer(cfg);
+    app_test_params(cfg);
+    app_test_events(cfg);
+    app_test_swap(cfg);
+    app_test_contexts(cfg);
+    app_test_render(cfg);
+    app_test_direct_output(cfg);
+    app_test_layouts(cfg);
+    app_test_graph(cfg);
+    app_test_slots(cfg);
+    app_test_parallel(cfg);
+    app_test_parallel_events(cfg);
+    app_test_metrics(cfg);
+    app_test_pipeline_file(cfg);
+    app_test_pipeline_schema(cfg);
+    app_test_arena(cfg);
+    app_test_arena_map(cfg);
+    app_test_large_pipeline(cfg);
+    app_test_registry(cfg);
 }
 
 static inline void
@@ -147,30 +2168,83 @@ app_midi_synth_demo(umugu_ctx *ctx)
     umugu_audio_backend_stop_stream(ctx);
 }
 
-static inline const umugu_attrib_info *
-app_find_node_attrib(umugu_ctx *ctx, const umugu_node *node, umugu_name attr_name)
-{
-    const size_t attrib_count = ctx->nodes_info[node->info_idx].attrib_count;
-    for (size_t i = 0; i < attrib_count; ++i) {
-        const umugu_attrib_info *attrib = &ctx->nodes_info[node->info_idx].attribs[i];
-        if (!memcmp(attrib->name.str, attr_name.str, UMUGU_NAME_LEN)) {
-            return attrib;
-        }
-    }
-    return NULL;
-}
-
 static inline void
 app_set_node_filepath(umugu_ctx *ctx, const char *file, umugu_name attr_name)
 {
     umugu_node *n = ctx->pipeline.nodes[0];
     const umugu_attrib_info *attri = app_find_node_attrib(ctx, n, attr_name);
     strncpy((char *)n + attri->offset_bytes, file, UMUGU_PATH_LEN);
+    um_pipeline_init(ctx); /* The node opens it. */
 }
 
 enum { APP_ARENA_SIZE = 1024 * 1024 };
 static char g_arena[APP_ARENA_SIZE];
 
+enum { APP_RENDER_ARENA_SIZE = 16 * 1024 * 1024, APP_RENDER_MAX_JOBS = 256 };
+
+typedef struct {
+    const umugu_config *cfg;
+    const char **files;
+    int count;
+    float seconds;
+    int next;   /* Next file to render, shared by the render threads. */
+    int failed;
+} app_render_batch;
+
+/* Render thread: takes the next pipeline file of the batch until there are none left.
+ * Every render has its own context. */
+static void *
+app_render_run(void *arg)
+{
+    app_render_batch *batch = arg;
+    umugu_config cfg = *batch->cfg;
+    cfg.arena = malloc(APP_RENDER_ARENA_SIZE);
+    cfg.arena_size = APP_RENDER_ARENA_SIZE;
+    cfg.fallback_ppln_node_count = 0;
+    int i;
+    while ((i = __atomic_fetch_add(&batch->next, 1, __ATOMIC_RELAXED)) < batch->count) {
+        char out_file[1024];
+        snprintf(out_file, sizeof(out_file), "%s.wav", batch->files[i]);
+        umugu_ctx *ctx = umugu_load(&cfg);
+        int err = umugu_pipeline_import(ctx, batch->files[i]);
+        if (err >= UMUGU_SUCCESS) {
+            const int64_t frames = (int64_t)(batch->seconds * ctx->pipeline.sig.sample_rate);
+            err = umugu_render(ctx, out_file, frames, 0);
+        }
+        if (err < UMUGU_SUCCESS) {
+            printf("Render of %s failed (error %d).\n", batch->files[i], err);
+            __atomic_fetch_add(&batch->failed, 1, __ATOMIC_RELAXED);
+        }
+        umugu_unload(ctx);
+    }
+    free(cfg.arena);
+    return NULL;
+}
+
+/* Offline renders of the batch on job_count threads, reporting the overall realtime
+ * factor (seconds of audio per second of wall clock). */
+static inline int
+app_render_batch_run(app_render_batch *batch, int job_count)
+{
+    UM_TRACE_ZONE();
+    pthread_t threads[APP_RENDER_MAX_JOBS];
+    job_count = um_mini(um_maxi(job_count, 1), um_mini(batch->count, APP_RENDER_MAX_JOBS));
+    const um_nanosec start = um_time_now();
+    for (int i = 0; i < job_count; ++i) {
+        pthread_create(&threads[i], NULL, app_render_run, batch);
+    }
+    for (int i = 0; i < job_count; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    const float elapsed = um_time_sec(um_time_elapsed(start));
+    const float audio = batch->seconds * (batch->count - batch->failed);
+    printf(
+        "Rendered %d of %d pipelines (%.1fs of audio) on %d threads in %.3fs: %.1fx realtime.\n",
+        batch->count - batch->failed, batch->count, audio, job_count, elapsed,
+        audio / (elapsed > 0.0f ? elapsed : 1e-9f));
+    return batch->failed ? 1 : 0;
+}
+
 int
 main(int argc, char **argv)
 {
@@ -180,12 +2254,17 @@ main(int argc, char **argv)
         APP_STDOUT, /* no backend */
         APP_MIDI_SYNTH,
         APP_PLAYBACK,
+        APP_RENDER, /* offline, no backend */
     } mode = argc == 1 ? APP_MIDI_SYNTH : APP_NONE;
 
     bool print_help = false;
     bool run_tests = false;
+    bool run_benchmarks = false;
     const char *arg_filename = NULL;
     const char *arg_midi_device = "hw:Minilab3";
+    const char *render_files[APP_RENDER_MAX_JOBS];
+    app_render_batch render = {.files = render_files, .seconds = 10.0f};
+    int render_jobs = 1;
 
     umugu_config umgcfg = {
         .config_file = "../assets/config.ucg",
@@ -226,23 +2305,57 @@ main(int argc, char **argv)
             umgcfg.config_file = &argv[i][2];
             break;
         }
+        case 'R': {
+            mode = APP_RENDER;
+            if (render.count < APP_RENDER_MAX_JOBS) {
+                render_files[render.count++] = &argv[i][2];
+            }
+            break;
+        }
+        case 'D': {
+            render.seconds = strtof(&argv[i][2], NULL);
+            break;
+        }
+        case 'J': {
+            render_jobs = atoi(&argv[i][2]);
+            break;
+        }
         case 'T': {
             run_tests = true;
             break;
         }
+        case 'B': {
+            run_benchmarks = true;
+            break;
+        }
         }
     }
 
-    if (print_help || (mode == APP_NONE && !run_tests)) {
+    if (print_help || (mode == APP_NONE && !run_tests && !run_benchmarks)) {
         app_print_help();
         return 1;
     }
 
+    if (mode == APP_RENDER && !run_tests && !run_benchmarks) {
+        /* Every render loads its own context. */
+        render.cfg = &umgcfg;
+        return app_render_batch_run(&render, render_jobs);
+    }
+
+    /* The audio callback of the realtime demos never faults on the arena pages. */
+    if (mode == APP_MIDI_SYNTH || mode == APP_PLAYBACK) {
+        umugu_arena_map(&umgcfg, APP_ARENA_SIZE, UMUGU_ARENA_REALTIME);
+    }
+
     /* umugu loading */
     umugu_ctx *umgctx = umugu_load(&umgcfg);
 
     if (run_tests) {
-        app_run_unit_test();
+        app_run_unit_test(umgctx, &umgcfg);
+    }
+
+    if (run_benchmarks) {
+        app_run_benchmarks(&umgcfg);
     }
 
     switch (mode) {
@@ -261,6 +2374,11 @@ main(int argc, char **argv)
         app_playback_demo(umgctx);
         break;
     }
+    case APP_RENDER: {
+        render.cfg = &umgcfg;
+        app_render_batch_run(&render, render_jobs);
+        break;
+    }
     default:
         break;
     }
@@ -272,6 +2390,9 @@ main(int argc, char **argv)
 
     /* umugu unloading */
     umugu_unload(umgctx);
+    if (umgcfg.arena != g_arena) {
+        umugu_arena_unmap(umgcfg.arena, umgcfg.arena_size);
+    }
 
     return 0;
 }
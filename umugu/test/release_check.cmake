@@ -0,0 +1,34 @@
+# Checks that the release objects do not emit instrumentation: umugu_process (the audio
+# callback) must not call the tracy client and the objects must not reference it.
+# Usage: cmake -DOBJDUMP=<objdump> -DNM=<nm> -DOBJECTS=<a.o|b.o> -P release_check.cmake
+
+string(REPLACE "|" ";" OBJECTS "${OBJECTS}")
+set(found_process FALSE)
+
+foreach(obj IN LISTS OBJECTS)
+    execute_process(COMMAND ${NM} --undefined-only ${obj}
+        OUTPUT_VARIABLE undefined RESULT_VARIABLE res)
+    if(NOT res EQUAL 0)
+        message(FATAL_ERROR "${NM} failed on ${obj}")
+    endif()
+    if(undefined MATCHES "tracy")
+        message(FATAL_ERROR "Release object ${obj} references the tracy client:\n${undefined}")
+    endif()
+
+    execute_process(COMMAND ${OBJDUMP} -dr --disassemble=umugu_process ${obj}
+        OUTPUT_VARIABLE disasm RESULT_VARIABLE res)
+    if(NOT res EQUAL 0)
+        message(FATAL_ERROR "${OBJDUMP} failed on ${obj}")
+    endif()
+    if(disasm MATCHES "<umugu_process>:")
+        set(found_process TRUE)
+        if(disasm MATCHES "call[^\n]*(tracy|Tracy)")
+            message(FATAL_ERROR "Release umugu_process calls the tracy client:\n${disasm}")
+        endif()
+    endif()
+endforeach()
+
+if(NOT found_process)
+    message(FATAL_ERROR "umugu_process not found in: ${OBJECTS}")
+endif()
+message(STATUS "umugu_process has no instrumentation.")